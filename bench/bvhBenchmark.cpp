@@ -0,0 +1,143 @@
+#include "frustumCuller.hpp"
+#include "parallel.hpp"
+#include "sceneBvh.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <atomic>
+#include <chrono>
+#include <print>
+#include <random>
+
+namespace {
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main() {
+    const size_t submeshCount = 2000;
+    const size_t trianglesPerSubmesh = 200;
+    const size_t rayCount = 200000;
+    const int cullIterations = 200;
+
+    // small clusters of random triangles spread in a box, one range per submesh
+    std::mt19937 generator = std::mt19937(42);
+    std::uniform_real_distribution<float> position = std::uniform_real_distribution<float>(-100, 100);
+    std::uniform_real_distribution<float> offset = std::uniform_real_distribution<float>(-2, 2);
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    // three corners per triangle for the flat hierarchy and the brute force check
+    std::vector<glm::vec3> corners;
+    std::vector<be::IndexRange> ranges;
+    std::vector<be::Submesh> submeshes;
+    for (size_t s = 0; s < submeshCount; s++) {
+        glm::vec3 center = glm::vec3(position(generator), position(generator), position(generator));
+        be::IndexRange range = {};
+        range.firstIndex = indices.size();
+        range.vertexOffset = vertices.size();
+        be::Submesh submesh = {};
+        submesh.firstIndex = indices.size();
+        submesh.firstRange = ranges.size();
+        submesh.rangeCount = 1;
+        glm::vec3 boxMin = glm::vec3(INFINITY), boxMax = glm::vec3(-INFINITY);
+        for (size_t t = 0; t < trianglesPerSubmesh; t++) {
+            glm::vec3 corner = center + glm::vec3(offset(generator), offset(generator), offset(generator));
+            for (int c = 0; c < 3; c++) {
+                Vertex vertex = {};
+                vertex.pos = corner + glm::vec3(offset(generator), offset(generator), offset(generator)) * 0.2f;
+                boxMin = glm::min(boxMin, vertex.pos);
+                boxMax = glm::max(boxMax, vertex.pos);
+                indices.push_back(range.vertexCount++);
+                vertices.push_back(vertex);
+                corners.push_back(vertex.pos);
+            }
+        }
+        range.indexCount = indices.size() - range.firstIndex;
+        submesh.indexCount = range.indexCount;
+        submesh.aabbMin = glm::vec4(boxMin, 0);
+        submesh.aabbMax = glm::vec4(boxMax, 0);
+        ranges.push_back(range);
+        submeshes.push_back(submesh);
+    }
+    size_t triangleCount = indices.size() / 3;
+    std::println("{} submeshes, {} triangles, {} workers", submeshCount, triangleCount, be::getWorkerCount());
+
+    be::SceneBvh scene;
+    auto start = std::chrono::steady_clock::now();
+    scene.build(submeshes, vertices, indices, ranges, false);
+    std::println("submesh build: {:.2f} ms", elapsedMilliseconds(start));
+    start = std::chrono::steady_clock::now();
+    scene.build(submeshes, vertices, indices, ranges, true);
+    std::println("two level build: {:.2f} ms, {} nodes", elapsedMilliseconds(start), scene.getNodeCount());
+
+    // a single hierarchy over every triangle shows the subtree parallelism
+    std::vector<be::Aabb> triangleBounds;
+    for (size_t t = 0; t < triangleCount; t++) {
+        be::Aabb box;
+        for (int c = 0; c < 3; c++)
+            box.grow(corners[3 * t + c]);
+        triangleBounds.push_back(box);
+    }
+    be::Bvh flat;
+    for (bool parallel : {false, true}) {
+        start = std::chrono::steady_clock::now();
+        flat.build(triangleBounds, parallel);
+        std::println("flat build {}: {:.2f} ms, {} nodes, depth {}", parallel ? "parallel" : "serial", elapsedMilliseconds(start), flat.getNodeCount(), flat.getDepth());
+    }
+
+    glm::mat4 proj = glm::perspective(glm::radians(90.f), 16.f / 9, 0.1f, 200.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(1, 0.2f, 0.5f), glm::vec3(0, 1, 0));
+    be::Frustum frustum = be::Frustum::fromMatrix(proj * view);
+    std::vector<glm::vec3> boxesMin, boxesMax;
+    for (const be::Submesh& submesh : submeshes) {
+        boxesMin.push_back(glm::vec3(submesh.aabbMin));
+        boxesMax.push_back(glm::vec3(submesh.aabbMax));
+    }
+    be::FrustumCuller culler;
+    culler.setBoxes(boxesMin, boxesMax);
+    std::vector<uint32_t> reference, visible;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < cullIterations; i++)
+        culler.cull(frustum, reference);
+    double flatCull = elapsedMilliseconds(start) / cullIterations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < cullIterations; i++)
+        scene.cull(frustum, visible);
+    double bvhCull = elapsedMilliseconds(start) / cullIterations;
+    std::ranges::sort(visible);
+    std::println("cull: {:.1f} us flat, {:.1f} us bvh, {} visible{}", flatCull * 1000, bvhCull * 1000, visible.size(), visible == reference ? "" : ", MISMATCH");
+
+    // rays from the middle of the scene, checked against a brute force loop for the first ones
+    std::vector<be::Ray> rays;
+    std::uniform_real_distribution<float> direction = std::uniform_real_distribution<float>(-1, 1);
+    for (size_t r = 0; r < rayCount; r++)
+        rays.push_back({glm::vec3(position(generator), position(generator), position(generator)) * 0.5f, glm::normalize(glm::vec3(direction(generator), direction(generator), direction(generator)))});
+    size_t mismatches = 0;
+    for (size_t r = 0; r < 200; r++) {
+        float closest = INFINITY;
+        for (size_t t = 0; t < triangleCount; t++)
+            closest = std::min(closest, be::intersectTriangle(rays[r], corners[3 * t], corners[3 * t + 1], corners[3 * t + 2]));
+        std::optional<be::RayHit> hit = scene.pick(rays[r]);
+        mismatches += (hit ? hit->distance : INFINITY) != closest;
+    }
+
+    std::atomic<size_t> hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (const be::Ray& ray : rays)
+        hits += scene.pick(ray).has_value();
+    double singleThread = elapsedMilliseconds(start);
+    const size_t batchSize = 1024;
+    start = std::chrono::steady_clock::now();
+    be::parallelFor((rayCount + batchSize - 1) / batchSize, [&](size_t batch) {
+        size_t batchHits = 0;
+        for (size_t r = batch * batchSize; r < std::min(rayCount, (batch + 1) * batchSize); r++)
+            batchHits += scene.pick(rays[r]).has_value();
+        hits += batchHits;
+    });
+    double multiThread = elapsedMilliseconds(start);
+    std::println("rays: {:.2f} Mrays/s single thread, {:.2f} Mrays/s on every core, {} hits per pass{}",
+        rayCount / singleThread / 1000,
+        rayCount / multiThread / 1000,
+        hits.load() / 2,
+        mismatches == 0 ? "" : ", MISMATCH"
+    );
+}
@@ -0,0 +1,45 @@
+#include "frustumCuller.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <print>
+#include <random>
+
+int main() {
+    const size_t boxCount = 100000;
+    const int iterations = 200;
+
+    std::mt19937 generator = std::mt19937(42);
+    std::uniform_real_distribution<float> position = std::uniform_real_distribution<float>(-100, 100);
+    std::uniform_real_distribution<float> size = std::uniform_real_distribution<float>(0.1f, 5);
+    std::vector<glm::vec3> boxesMin, boxesMax;
+    for (size_t i = 0; i < boxCount; i++) {
+        glm::vec3 corner = glm::vec3(position(generator), position(generator), position(generator));
+        boxesMin.push_back(corner);
+        boxesMax.push_back(corner + glm::vec3(size(generator), size(generator), size(generator)));
+    }
+
+    glm::mat4 proj = glm::perspective(glm::radians(90.f), 16.f / 9, 0.1f, 200.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(1, 0.2f, 0.5f), glm::vec3(0, 1, 0));
+    be::Frustum frustum = be::Frustum::fromMatrix(proj * view);
+
+    be::FrustumCuller culler;
+    culler.setBoxes(boxesMin, boxesMax);
+    std::vector<uint32_t> reference;
+    culler.setKernel(be::CullKernel::scalar);
+    culler.cull(frustum, reference);
+
+    std::println("{} boxes, {} visible", boxCount, reference.size());
+    for (auto [kernel, name] : {std::pair(be::CullKernel::scalar, "scalar"), std::pair(be::CullKernel::sse, "sse"), std::pair(be::CullKernel::avx2, "avx2")}) {
+        if (!be::FrustumCuller::isSupported(kernel)) {
+            std::println("{:>8}: not supported", name);
+            continue;
+        }
+        culler.setKernel(kernel);
+        std::vector<uint32_t> visible;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            culler.cull(frustum, visible);
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::println("{:>8}: {:.0f} ns per 10k boxes{}", name, elapsed / iterations / (boxCount / 10000.0), visible == reference ? "" : ", MISMATCH");
+    }
+}
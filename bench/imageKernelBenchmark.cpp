@@ -0,0 +1,115 @@
+#include "imageKernels.hpp"
+#include <chrono>
+#include <format>
+#include <functional>
+#include <print>
+#include <random>
+#include <vector>
+
+namespace {
+    const uint32_t WIDTH = 2048;
+    const uint32_t HEIGHT = 2048;
+    const size_t PIXELS = static_cast<size_t>(WIDTH) * HEIGHT;
+    const int ITERATIONS = 10;
+
+    // the expansion Texture::pickFormat used to do, one push_back per byte
+    std::vector<unsigned char> expandByPushBack(const unsigned char* pixels, size_t nbPixels) {
+        std::vector<unsigned char> finalTextures;
+        finalTextures.push_back(pixels[0]);
+        for (size_t i = 1; i < nbPixels * 3; i++) {
+            if (i % 3 == 0)
+                finalTextures.push_back(255);
+            finalTextures.push_back(pixels[i]);
+        }
+        return finalTextures;
+    }
+
+    double measure(const std::function<void()>& run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+            run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return PIXELS * ITERATIONS / seconds / 1e6;
+    }
+
+    int maxDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+        int difference = 0;
+        for (size_t i = 0; i < a.size(); i++)
+            difference = std::max(difference, std::abs(a[i] - b[i]));
+        return difference;
+    }
+}
+
+int main() {
+    std::mt19937 generator = std::mt19937(42);
+    std::uniform_int_distribution<int> byte = std::uniform_int_distribution<int>(0, 255);
+    std::vector<uint8_t> rgb = std::vector<uint8_t>(PIXELS * 3);
+    std::vector<uint8_t> grey = std::vector<uint8_t>(PIXELS);
+    std::vector<uint8_t> rgba = std::vector<uint8_t>(PIXELS * 4);
+    for (std::vector<uint8_t>* image : {&rgb, &grey, &rgba})
+        for (uint8_t& value : *image)
+            value = byte(generator);
+
+    uint32_t nextWidth = WIDTH / 2;
+    uint32_t nextHeight = HEIGHT / 2;
+    std::vector<float> scratch = std::vector<float>(be::ImageKernels::getKaiserScratchSize(WIDTH, HEIGHT));
+    std::vector<uint8_t> level = std::vector<uint8_t>(static_cast<size_t>(nextWidth) * nextHeight * 4);
+
+    std::println("{}x{} image, Mpixel/s of the source", WIDTH, HEIGHT);
+    std::println("{:>20}: {:.0f}", "push_back rgb", measure([&] {
+        std::vector<unsigned char> texels = expandByPushBack(rgb.data(), PIXELS);
+        (void)texels;
+    }));
+
+    using Operation = std::function<void(const be::ImageKernels&, std::vector<uint8_t>&)>;
+    std::vector<std::pair<const char*, Operation>> operations = {
+        {"expand rgb", [&](const be::ImageKernels& kernels, std::vector<uint8_t>& output) {
+            output.resize(PIXELS * 4);
+            kernels.expandRgbToRgba(rgb, output);
+        }},
+        {"expand r", [&](const be::ImageKernels& kernels, std::vector<uint8_t>& output) {
+            output.resize(PIXELS * 4);
+            kernels.expandRToRgba(grey, output);
+        }},
+        {"premultiply", [&](const be::ImageKernels& kernels, std::vector<uint8_t>& output) {
+            output = rgba;
+            kernels.premultiplyAlpha(output);
+        }},
+        {"renormalize", [&](const be::ImageKernels& kernels, std::vector<uint8_t>& output) {
+            output = rgba;
+            kernels.renormalizeNormals(output);
+        }},
+        {"box linear", [&](const be::ImageKernels& kernels, std::vector<uint8_t>& output) {
+            output.resize(level.size());
+            kernels.downsampleBox(rgba, WIDTH, HEIGHT, output, false);
+        }},
+        {"box srgb", [&](const be::ImageKernels& kernels, std::vector<uint8_t>& output) {
+            output.resize(level.size());
+            kernels.downsampleBox(rgba, WIDTH, HEIGHT, output, true);
+        }},
+        {"kaiser srgb", [&](const be::ImageKernels& kernels, std::vector<uint8_t>& output) {
+            output.resize(level.size());
+            kernels.downsampleKaiser(rgba, WIDTH, HEIGHT, output, scratch, true);
+        }}
+    };
+
+    for (const auto& [operation, run] : operations) {
+        be::ImageKernels kernels;
+        kernels.setKernel(be::ImageKernel::scalar);
+        std::vector<uint8_t> reference;
+        run(kernels, reference);
+        for (auto [kernel, name] : {std::pair(be::ImageKernel::scalar, "scalar"), std::pair(be::ImageKernel::sse41, "sse4.1"), std::pair(be::ImageKernel::avx2, "avx2")}) {
+            if (!be::ImageKernels::isSupported(kernel)) {
+                std::println("{:>20}: not supported", std::format("{} {}", operation, name));
+                continue;
+            }
+            kernels.setKernel(kernel);
+            std::vector<uint8_t> output;
+            double throughput = measure([&] {
+                run(kernels, output);
+            });
+            int difference = maxDifference(output, reference);
+            std::println("{:>20}: {:.0f}{}", std::format("{} {}", operation, name), throughput, difference == 0 ? "" : std::format(", differs by up to {}", difference));
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef BINDLESSTABLE_HPP
+#define BINDLESSTABLE_HPP
+
+#include "buffer.hpp"
+#include <cstddef>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    constexpr uint32_t DEFAULT_BINDLESS_TEXTURES = 4096;
+    constexpr uint32_t DEFAULT_BINDLESS_BUFFERS = 256;
+    // descriptors written by one update template, a change rewrites its whole block
+    constexpr uint32_t BINDLESS_TEMPLATE_BLOCK = 64;
+
+    /**
+        One descriptor set per frame in flight holding every texture and storage buffer the shaders index,
+        binding 0 the storage buffers and binding 1 the combined image samplers.
+        Both bindings are partially bound and update after bind, the textures have a variable count so the layout,
+        and the pipelines built with it, do not depend on the capacity.
+        Indices are stable and come from free lists, a removed index is given again once no frame in flight can use it.
+        Changes go to a copy of the table and reach the set of a frame when update is called while recording it,
+        one update template per dirty block, so a frame in flight keeps what it was recorded with and nothing waits on the GPU.
+        The slots never written point to the fallback resources, every block can be written whole.
+        As with the defragmenter, a replaced resource has to stay alive until every frame in flight recorded after the change.
+    */
+    class BindlessTable {
+        public:
+            BindlessTable();
+            /**
+                The buffer capacity is lowered to the update after bind limits of the device for storage buffers.
+                The layout takes as many textures as the update after bind limits for samplers and sampled images allow,
+                and the per stage resource limit less the buffers and reservedResources, the descriptors of the other sets
+                and the color attachments of the stages sampling the table. The sets are allocated with textureCapacity, lowered to that count.
+            */
+            void init(
+                vk::Device device,
+                vk::PhysicalDevice physicalDevice,
+                size_t framesInFlight,
+                vk::DescriptorImageInfo fallbackTexture,
+                const be::Buffer& fallbackBuffer,
+                uint32_t reservedResources,
+                uint32_t textureCapacity = DEFAULT_BINDLESS_TEXTURES,
+                uint32_t bufferCapacity = DEFAULT_BINDLESS_BUFFERS
+            );
+            // on a new table, the indices follow the order of the additions from 0
+            uint32_t addTexture(vk::ImageView view, vk::Sampler sampler);
+            uint32_t addBuffer(const be::Buffer& buffer);
+            void replaceTexture(uint32_t index, vk::ImageView view, vk::Sampler sampler);
+            void replaceBuffer(uint32_t index, const be::Buffer& buffer);
+            // every slot pointing to a moved resource, for the defragmenter and the texture streamer
+            void replaceImageView(vk::ImageView oldView, vk::ImageView newView);
+            void replaceBuffer(vk::Buffer oldBuffer, vk::Buffer newBuffer);
+            void removeTexture(uint32_t index);
+            void removeBuffer(uint32_t index);
+            // called once per frame while recording its command buffer, before its set is bound
+            void update(size_t frame);
+            const vk::DescriptorSetLayout& getLayout() const;
+            vk::DescriptorSet getSet(size_t frame) const;
+            uint32_t getTextureCapacity() const;
+            uint32_t getBufferCapacity() const;
+            void clean();
+        private:
+            // a binding of the table, its copy, free indices and dirty blocks
+            template<typename Info>
+            struct Slots {
+                std::vector<Info> infos;
+                Info fallback;
+                std::vector<uint32_t> freeIndices;
+                // index and frame count of the removal
+                std::vector<std::pair<uint32_t, uint64_t>> retired;
+                std::vector<vk::DescriptorUpdateTemplate> templates;
+                // dirty[frame][block]
+                std::vector<std::vector<bool>> dirty;
+            };
+
+            template<typename Info>
+            void initSlots(Slots<Info>& slots, uint32_t capacity, uint32_t binding, vk::DescriptorType type);
+            template<typename Info>
+            uint32_t add(Slots<Info>& slots, const Info& info);
+            template<typename Info>
+            void write(Slots<Info>& slots, uint32_t index, const Info& info);
+            template<typename Info>
+            void remove(Slots<Info>& slots, uint32_t index);
+            template<typename Info>
+            void flush(Slots<Info>& slots, size_t frame);
+            template<typename Info>
+            void destroyTemplates(Slots<Info>& slots);
+
+            vk::Device m_device;
+            size_t m_framesInFlight;
+            vk::DescriptorSetLayout m_layout;
+            vk::DescriptorPool m_pool;
+            std::vector<vk::DescriptorSet> m_sets;
+            Slots<vk::DescriptorBufferInfo> m_buffers;
+            Slots<vk::DescriptorImageInfo> m_textures;
+            uint64_t m_frameCount;
+    };
+}
+
+#endif
@@ -1,7 +1,14 @@
 #ifndef BUFFER_HPP
 #define BUFFER_HPP
 
+#include "memoryAllocator.hpp"
 #include "vertex.hpp"
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 
 
@@ -17,29 +24,53 @@ namespace be {
             bool operator==(const Buffer& another) const;
             bool operator!=(const Buffer& another) const;
             void clean();
-            void create(vk::BufferUsageFlags usage, vk::SharingMode sharingMode, vk::PhysicalDevice physicalDevice);
+            // gpuOnly buffers can only be filled by transfers, the others are mapped for their whole life
+            // queueFamilies lists the families of a concurrent buffer
+            void create(vk::BufferUsageFlags usage, vk::SharingMode sharingMode, be::MemoryAllocator& allocator, be::MemoryUsage memoryUsage, std::string_view name, std::span<const uint32_t> queueFamilies = {});
             template<typename T>
             void map(const std::vector<T>& data);
+            template<typename T>
+            void map(std::span<const T> data);
             void map();
             template<typename T>
             void update(T* updatedData);
+            // copies the mapped memory back, the buffer has to be mapped
+            template<typename T>
+            void read(T* data) const;
+            // the buffer has to be mapped
+            void write(const void* data, vk::DeviceSize size, vk::DeviceSize offset);
             void copyBuffer(be::Buffer& stagingBuffer, vk::CommandPool commandPool, vk::Queue graphicsQueue);
+            // moves the content to a new buffer and allocation with a copy recorded in commandBuffer,
+            // gives back the old ones for the caller to release once the GPU no longer uses them
+            std::pair<vk::Buffer, be::Allocation> relocate(vk::CommandBuffer commandBuffer);
             const vk::Buffer& getBuffer() const;
             vk::DeviceSize getSize() const;
+            const be::Allocation& getAllocation() const;
         private:
             vk::Buffer m_buffer;
             vk::Device m_device;
             vk::DeviceSize m_size;
-            vk::DeviceMemory m_memory;
+            vk::BufferUsageFlags m_usage;
+            vk::SharingMode m_sharingMode;
+            std::vector<uint32_t> m_queueFamilies;
+            be::MemoryAllocator* m_allocator;
+            be::MemoryUsage m_memoryUsage;
+            std::string m_name;
+            be::Allocation m_allocation;
             void* m_data;
     };
 }
 
 template<typename T>
 void be::Buffer::map(const std::vector<T>& data) {
-    m_data = m_device.mapMemory(m_memory, 0, m_size);
-    memcpy(m_data, data.data(), m_size);
-    m_device.unmapMemory(m_memory);
+    map<T>(std::span<const T>(data));
+}
+
+template<typename T>
+void be::Buffer::map(std::span<const T> data) {
+    if (m_allocation.data == nullptr)
+        throw std::runtime_error("The buffer memory is not host visible!");
+    memcpy(m_allocation.data, data.data(), m_size);
 }
 
 template<typename T>
@@ -48,4 +79,9 @@ void be::Buffer::update(T* updatedData) {
 
 }
 
+template<typename T>
+void be::Buffer::read(T* data) const {
+    memcpy(data, m_data, m_size);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,154 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "frustum.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace be {
+    const uint32_t BVH_MAX_LEAF_SIZE = 4;
+    const uint32_t BVH_MAX_DEPTH = 64;
+
+    struct Aabb {
+        glm::vec3 min = glm::vec3(INFINITY);
+        glm::vec3 max = glm::vec3(-INFINITY);
+
+        void grow(const glm::vec3& point);
+        void grow(const Aabb& box);
+        // half of the surface area, only ratios are used by the SAH
+        float area() const;
+        glm::vec3 center() const;
+        bool overlaps(const Aabb& box) const;
+    };
+
+    struct Ray {
+        glm::vec3 origin;
+        glm::vec3 direction;
+
+        // ray through a point in normalized device coordinates, in the space the clip matrix transforms from
+        static Ray fromClip(const glm::mat4& clip, const glm::vec2& ndc);
+    };
+
+    // distance along the ray to the box entry, 0 from inside, INFINITY when missed or beyond maxDistance
+    float intersectBox(const Ray& ray, const Aabb& box, float maxDistance = INFINITY);
+    // distance along the ray or INFINITY, both faces are hit
+    float intersectTriangle(const Ray& ray, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
+
+    // a leaf when count is not 0, leftFirst is then the first primitive instead of the left child
+    struct alignas(32) BvhNode {
+        glm::vec3 min;
+        uint32_t leftFirst;
+        glm::vec3 max;
+        uint32_t count;
+
+        bool isLeaf() const { return count > 0; }
+    };
+    static_assert(sizeof(BvhNode) == 32);
+
+    // siblings share a cache line, the root is alone in the first one
+    struct alignas(64) BvhNodePair {
+        std::array<BvhNode, 2> nodes;
+    };
+    static_assert(sizeof(BvhNodePair) == 64);
+
+    /**
+        Bounding volume hierarchy over a set of boxes, split with a binned surface area heuristic.
+        The subtrees below the first levels are built on all the cores then stitched in one node array.
+        Queries return the indices of the boxes given to build, in no particular order.
+    */
+    class Bvh {
+        public:
+            Bvh();
+            void build(std::span<const Aabb> bounds, bool parallel = true);
+            void overlap(const Aabb& box, std::vector<uint32_t>& result) const;
+            void cull(const Frustum& frustum, std::vector<uint32_t>& result) const;
+            // intersect(primitive, maxDistance) returns the distance of a closer hit or INFINITY, the closest distance is returned
+            template<typename F>
+            float intersect(const Ray& ray, float maxDistance, F&& intersectPrimitive) const;
+            const Aabb& getBounds() const;
+            size_t getNodeCount() const;
+            uint32_t getDepth() const;
+            const BvhNode& getNode(uint32_t index) const;
+
+        private:
+            BvhNode& node(uint32_t index);
+            static float intersectBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance);
+
+            std::vector<BvhNodePair> m_pairs;
+            std::vector<uint32_t> m_indices;
+            // the boxes in leaf order, to test the primitives without going back to the caller's array
+            std::vector<Aabb> m_primitiveBounds;
+            Aabb m_bounds;
+            uint32_t m_depth;
+    };
+}
+
+inline const be::BvhNode& be::Bvh::getNode(uint32_t index) const {
+    return m_pairs[index >> 1].nodes[index & 1];
+}
+
+inline be::BvhNode& be::Bvh::node(uint32_t index) {
+    return m_pairs[index >> 1].nodes[index & 1];
+}
+
+inline float be::Bvh::intersectBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+    glm::vec3 t0 = (node.min - origin) * inverseDirection;
+    glm::vec3 t1 = (node.max - origin) * inverseDirection;
+    glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+    float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.f));
+    float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+    return enter <= exit ? enter : INFINITY;
+}
+
+template<typename F>
+float be::Bvh::intersect(const Ray& ray, float maxDistance, F&& intersectPrimitive) const {
+    if (m_pairs.empty())
+        return INFINITY;
+    glm::vec3 inverseDirection = 1.f / ray.direction;
+    float closest = maxDistance;
+    struct StackEntry {
+        uint32_t node;
+        float distance;
+    };
+    std::array<StackEntry, BVH_MAX_DEPTH> stack;
+    size_t stackSize = 0;
+    uint32_t current = 0;
+    if (intersectBox(getNode(0), ray.origin, inverseDirection, closest) == INFINITY)
+        return INFINITY;
+    while (true) {
+        const BvhNode& currentNode = getNode(current);
+        if (currentNode.isLeaf()) {
+            for (uint32_t i = currentNode.leftFirst; i < currentNode.leftFirst + currentNode.count; i++)
+                closest = std::min(closest, intersectPrimitive(m_indices[i], closest));
+        } else {
+            // visit the nearest child first so the farther one is often skipped
+            uint32_t nearChild = currentNode.leftFirst, farChild = currentNode.leftFirst + 1;
+            float nearDistance = intersectBox(getNode(nearChild), ray.origin, inverseDirection, closest);
+            float farDistance = intersectBox(getNode(farChild), ray.origin, inverseDirection, closest);
+            if (farDistance < nearDistance) {
+                std::swap(nearChild, farChild);
+                std::swap(nearDistance, farDistance);
+            }
+            if (nearDistance != INFINITY) {
+                if (farDistance != INFINITY)
+                    stack[stackSize++] = {farChild, farDistance};
+                current = nearChild;
+                continue;
+            }
+        }
+        // a closer hit may have been found since the entry was pushed
+        while (stackSize > 0 && stack[stackSize - 1].distance > closest)
+            stackSize--;
+        if (stackSize == 0)
+            break;
+        current = stack[--stackSize].node;
+    }
+    return closest < maxDistance ? closest : INFINITY;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef DEFRAGMENTER_HPP
+#define DEFRAGMENTER_HPP
+
+#include "buffer.hpp"
+#include "memoryAllocator.hpp"
+#include "texture.hpp"
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    // 8 MiB
+    constexpr vk::DeviceSize DEFAULT_DEFRAGMENTATION_BUDGET = 8ull << 20;
+    // fuller blocks are left alone
+    constexpr float DEFAULT_EVACUATION_USAGE = 0.5f;
+
+    struct DefragmentationStats {
+        // evacuations that ended with their block released
+        size_t releasedBlocks;
+        // evacuations stopped because the block held resources that are not registered
+        size_t abandonedEvacuations;
+        size_t movedBuffers;
+        size_t movedImages;
+        vk::DeviceSize movedBytes;
+        // allocator stats around the last finished evacuation
+        MemoryStats before;
+        MemoryStats after;
+    };
+
+    /**
+        Empties the sparse blocks of the allocator a few resources per frame, without ever waiting on the GPU.
+        The copies are recorded in the frame command buffer, so they run after the previous frames on the same queue,
+        and the registered buffer or texture takes the new handles at once. The descriptor sets of the other frames
+        in flight are patched when they are recorded next, and the old copy is destroyed once all of them are done with it.
+    */
+    class Defragmenter {
+        public:
+            // rewrites what refers to a moved resource in the descriptor sets of one frame in flight
+            using BufferPatch = std::function<void(size_t frame, vk::Buffer oldBuffer, vk::Buffer newBuffer)>;
+            using ImagePatch = std::function<void(size_t frame, vk::ImageView oldView, vk::ImageView newView)>;
+
+            Defragmenter();
+            void init(vk::Device device, be::MemoryAllocator& allocator, size_t framesInFlight, BufferPatch bufferPatch, ImagePatch imagePatch);
+            // the resources keep their address, a move updates them in place
+            void addBuffer(be::Buffer& buffer);
+            void addTexture(be::Texture& texture);
+            /**
+                Called once per frame while recording its command buffer, before anything uses the registered resources.
+                Releases the old copies every frame in flight is done with, patches the sets of frame and, when canMove,
+                records the moves of the next resources of the block being emptied, within the budget.
+                True when an evacuation ended, the stats then hold its before and after.
+            */
+            bool update(vk::CommandBuffer commandBuffer, size_t frame, bool canMove);
+            void setBudget(vk::DeviceSize budget);
+            vk::DeviceSize getBudget() const;
+            const DefragmentationStats& getStats() const;
+            // releases the old copies still waiting, the device has to be idle
+            void clean();
+        private:
+            struct Move {
+                // frame count when the copy was recorded
+                uint64_t frame;
+                vk::Buffer oldBuffer;
+                vk::Buffer newBuffer;
+                vk::Image oldImage;
+                vk::ImageView oldView;
+                vk::ImageView newView;
+                be::Allocation oldAllocation;
+                std::vector<bool> patched;
+            };
+
+            void patch(Move& move, size_t frame);
+            void release(const Move& move);
+
+            vk::Device m_device;
+            be::MemoryAllocator* m_allocator;
+            size_t m_framesInFlight;
+            BufferPatch m_bufferPatch;
+            ImagePatch m_imagePatch;
+            std::vector<be::Buffer*> m_buffers;
+            std::vector<be::Texture*> m_textures;
+            std::vector<Move> m_moves;
+            uint64_t m_frameCount;
+            vk::DeviceSize m_budget;
+            bool m_evacuating;
+            DefragmentationStats m_stats;
+    };
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef DEPTHPYRAMID_HPP
+#define DEPTHPYRAMID_HPP
+
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <cstdint>
+
+namespace be {
+    // enough for a 65536 pixels wide swap chain
+    constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+
+    // push constant of shaders/depthPyramid.slang
+    struct PyramidLevel {
+        vk::Extent2D sourceSize;
+        vk::Extent2D size;
+        uint32_t fromDepth;
+    };
+
+    /**
+        Every level halves the previous one rounding up, starting from half of the depth buffer,
+        so a texel of level l covers 2^(l + 1) pixels and the odd rows are never dropped.
+    */
+    inline vk::Extent2D getPyramidLevelExtent(vk::Extent2D depthExtent, uint32_t level) {
+        return vk::Extent2D(
+            std::max(1u, ((depthExtent.width - 1) >> (level + 1)) + 1),
+            std::max(1u, ((depthExtent.height - 1) >> (level + 1)) + 1)
+        );
+    }
+
+    inline uint32_t getPyramidLevelCount(vk::Extent2D depthExtent) {
+        uint32_t levelCount = 1;
+        while (getPyramidLevelExtent(depthExtent, levelCount - 1).width > 1 || getPyramidLevelExtent(depthExtent, levelCount - 1).height > 1)
+            levelCount++;
+        return levelCount;
+    }
+}
+
+#endif
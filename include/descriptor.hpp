@@ -4,7 +4,6 @@
 #include <cstddef>
 #include <vulkan/vulkan.hpp>
 #include "buffer.hpp"
-#include "texture.hpp"
 
 namespace be {
     class Descriptor {
@@ -14,19 +13,52 @@ namespace be {
             Descriptor(const Descriptor& another);
             be::Descriptor& operator=(const Descriptor& another);
             void clean();
-            void createSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& descriptorSetLayoutBinding);
+            // bindingFlags is empty or has one entry per binding, update after bind also goes to the pool
+            void createSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& descriptorSetLayoutBinding, const std::vector<vk::DescriptorBindingFlags>& bindingFlags = {});
             void createPool(const std::vector<vk::DescriptorPoolSize>& createInfo, int numFrame);
-            void createSet(size_t numberFrame, const std::vector<be::Buffer>& buffers, const be::Buffer& ssbo,const std::vector<be::Texture>& textures = {});
+            // storageBuffers[frame][binding]
+            void createStorageSet(size_t numberFrame, const std::vector<std::vector<be::Buffer>>& storageBuffers);
+            // buffers[frame][binding] of type types[binding]
+            void createBufferSet(size_t numberFrame, const std::vector<std::vector<be::Buffer>>& buffers, const std::vector<vk::DescriptorType>& types);
+            // images[set][binding] of type types[binding]
+            void createImageSet(const std::vector<std::vector<vk::DescriptorImageInfo>>& images, const std::vector<vk::DescriptorType>& types);
+            // gives the sets back to the pool, the layout stays valid
+            void freeSets();
+            // rewrites the bindings of a set that point to a moved resource, the set must not be in use
+            void replaceBuffer(size_t set, vk::Buffer oldBuffer, vk::Buffer newBuffer);
+            void replaceImageView(size_t set, vk::ImageView oldView, vk::ImageView newView);
             const vk::DescriptorSetLayout& getLayout() const;
             size_t getLayoutSize() const;
             const std::vector<vk::DescriptorSet>& getSets() const;
 
         private:
+            struct BufferWrite {
+                size_t set;
+                uint32_t binding;
+                uint32_t arrayElement;
+                vk::DescriptorType type;
+                vk::DescriptorBufferInfo info;
+            };
+
+            struct ImageWrite {
+                size_t set;
+                uint32_t binding;
+                uint32_t arrayElement;
+                vk::DescriptorType type;
+                vk::DescriptorImageInfo info;
+            };
+
+            void recordWrites(const std::vector<vk::WriteDescriptorSet>& writeDescriptorSets);
+
             vk::Device m_device;
             vk::DescriptorSetLayout m_descriptorSetLayout;
             size_t m_layoutSize;
+            bool m_updateAfterBind;
             std::vector<vk::DescriptorSet> m_descriptorSets;
             vk::DescriptorPool m_descriptorPool;
+            // what the sets point to, to patch them when a resource moves
+            std::vector<BufferWrite> m_bufferWrites;
+            std::vector<ImageWrite> m_imageWrites;
     };
 }
 #endif
\ No newline at end of file
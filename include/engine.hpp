@@ -3,15 +3,46 @@
 
 #include <vulkan/vulkan.hpp>
 #include "VkBootstrap.h"
+#include "bindlessTable.hpp"
 #include "camera.hpp"
+#include "frustumCuller.hpp"
+#include "defragmenter.hpp"
+#include "depthPyramid.hpp"
 #include "descriptor.hpp"
 #include "materialObject.hpp"
+#include "lod.hpp"
+#include "meshOptimizer.hpp"
+#include "memoryAllocator.hpp"
+#include "meshlet.hpp"
+#include "occlusionRasterizer.hpp"
+#include "sceneBvh.hpp"
+#include "submesh.hpp"
 #include "texture.hpp"
+#include "textureStreamer.hpp"
+#include "uploadManager.hpp"
 #include "window.hpp"
 #include "meshObject.hpp"
 #include "buffer.hpp"
 
 const int MAX_FRAME_IN_FLIGHT = 2;
+
+namespace be {
+	enum class RenderMode {
+		// every index range drawn every frame
+		indexRanges,
+		// meshlets culled by a compute pass writing the index stream of an indirect draw
+		meshletCulling,
+		// index ranges culled and their level selected by a compute pass, drawn with drawIndexedIndirectCount
+		gpuCulling
+	};
+
+	// push constant of shaders/gpuCulling.slang
+	enum class CullingPhase : uint32_t {
+		early,
+		late
+	};
+}
+
 class Engine
 {
 	public:
@@ -28,6 +59,37 @@ class Engine
 
 		void setRenderer(const Window& window);
 
+		// has to be called before initVulkan
+		void setVertexFormat(be::VertexFormat format);
+
+		// has to be called before initVulkan
+		void setRenderMode(be::RenderMode mode);
+
+		// prints what is under the cursor, in window coordinates
+		void pick(const glm::vec2& cursorPos);
+
+		// has to be called before initVulkan, the gpu culling and meshlet modes test the ranges or the meshlets against a depth pyramid, every mode but gpu culling also tests the submeshes, and the meshlets, against a software depth buffer
+		void setOcclusionCulling(bool enabled);
+
+		// counters of the last completed frame in the gpu culling mode
+		const be::OcclusionStats& getOcclusionStats() const;
+
+		// counters of the last frame in the cpu culling modes
+		const be::SoftwareOcclusionStats& getSoftwareOcclusionStats() const;
+
+		// writes queued here are flushed at the start of every frame, within its budget,
+		// into buffers created with its sharing mode and queue families
+		be::UploadManager& getUploads();
+
+		// moves a few resources out of the sparse memory blocks every frame
+		be::Defragmenter& getDefragmenter();
+
+		// loads the texture levels the scene samples and evicts over its budget
+		be::TextureStreamer& getTextureStreamer();
+
+		// every texture the shaders index, resources can be added or replaced while frames are in flight
+		be::BindlessTable& getBindlessTable();
+
 
 	private:
 
@@ -71,34 +133,88 @@ class Engine
 
 		void recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame);
 
+		void beginScenePass(vk::CommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, vk::AttachmentLoadOp loadOp);
+
 		void createSyncObjects();
+		// registers the device local buffers and the textures, after the descriptor sets exist
+		void createDefragmenter();
 
-		void createVertexBuffer(const std::vector<Vertex>& verticies);
+		void createVertexBuffer(std::span<const Vertex> verticies);
 
-		void createIndexBuffer(const std::vector<int>& indexes);
+		// 16 or 32 bit indices, local to the vertex block of their range
+		template<typename T>
+		void createIndexBuffer(std::span<const T> indexes, std::span<const be::IndexRange> ranges);
 
 		void createDescriptorPool();
 
 		void createDescriptorSetLayout();
 
+		// what the slots of the bindless table without a texture or a buffer point to
+		void createFallbackResources();
+
+		// set 1 of the scene pipeline, after the textures are loaded
+		void createBindlessTable();
+
 		void createDescriptorSets();
 
 		void updateUniformBuffer(uint32_t image);
 
+		void selectLods(uint32_t currentFrame);
+
 		void loadObjects();
 
-		void createSSBO(const std::vector<MaterialObject>& materials);
+		void createSSBO(std::span<const MaterialObject> materials);
 
-		void loadTextures(const std::vector<std::filesystem::path>& texturePath);
+		// the bump maps of materials are encoded as linear data
+		void loadTextures(const std::vector<std::filesystem::path>& texturePath, std::span<const MaterialObject> materials);
 
 		void createDepthMaps();
 
+		template<typename T>
+		be::Buffer createDeviceBuffer(std::span<const T> data, vk::BufferUsageFlags usage, std::string_view name);
+
+		void createSubmeshBuffer(std::span<const be::Submesh> submeshTable);
+
+		void createMeshletBuffers(std::span<const be::Meshlet> meshlets, std::span<const uint32_t> meshletVertices, std::span<const uint32_t> meshletTriangles);
+
+		void createCullingDescriptors();
+
+		void createCullingPipeline();
+
+		void recordCulling(vk::CommandBuffer commandBuffer, uint32_t currentFrame, be::CullingPhase phase);
+
+		vk::Pipeline createComputePipeline(const std::string& moduleName, const char* entryPoint, vk::PipelineLayout layout);
+
+		void createGpuCullingBuffers();
+
+		void createGpuCullingDescriptors();
+
+		void createGpuCullingPipeline();
+
+		void updateCullingCamera(uint32_t currentFrame);
+
+		void recordGpuCulling(vk::CommandBuffer commandBuffer, uint32_t currentFrame, be::CullingPhase phase);
+
+		void createDepthPyramidDescriptors();
+
+		void createDepthPyramid();
+
+		void cleanUpDepthPyramid();
+
+		void createDepthPyramidPipeline();
+
+		void recordDepthPyramid(vk::CommandBuffer commandBuffer);
+
 		vkb::Instance vkbInstance;
 		vk::Instance vkInstance;
 		vkb::PhysicalDevice vkbPhysicalDevice;
 		vk::PhysicalDevice vkPhysicalDevice;
+		// BC formats can be sampled, textures are loaded block compressed
+		bool blockCompression = false;
 		vkb::Device vkbDevice;
 		vk::Device vkDevice;
+		// every buffer and image takes its memory here
+		be::MemoryAllocator allocator;
 		vkb::Swapchain vkbSwapChain;
 		vk::SwapchainKHR vkSwapChain;
 		vk::Extent2D swapChainExtent;
@@ -107,6 +223,10 @@ class Engine
 		vk::SurfaceKHR surface;
 		vk::Queue graphicsQueue;
 		vk::Queue presentQueue;
+		// a dedicated transfer queue when the device has one, the graphics queue otherwise
+		vk::Queue transferQueue;
+		uint32_t graphicsQueueFamily = 0;
+		uint32_t transferQueueFamily = 0;
 		std::vector<vk::Image> swapChainImages;
 		std::vector<vk::ImageView> swapChainImageViews;
 		vk::PipelineLayout pipelineLayout;
@@ -120,16 +240,83 @@ class Engine
 		std::vector<MeshObject> objects;
 		be::Buffer vbo;
 		size_t numVerticies = 0;
+		be::VertexFormat vertexFormat = be::VertexFormat::packed;
+		// dequantization of packed positions, identity otherwise
+		glm::mat4 meshTransform = glm::mat4(1);
 		size_t numMaterials = 0;
 		be::Buffer ibo;
+		vk::IndexType indexType = vk::IndexType::eUint16;
+		std::vector<be::IndexRange> indexRanges;
+		std::vector<be::LodLevel> lods;
+		std::vector<be::Submesh> submeshes;
+		be::Buffer submeshBuffer;
+		be::UploadManager uploads;
+		// timeline value of the copies the frame being recorded may read
+		uint64_t uploadWaitValue = 0;
+		be::Defragmenter defragmenter;
+		be::FrustumCuller submeshCuller;
+		be::SceneBvh sceneBvh;
+		// draws the simplified large submeshes, empty in the gpu culling mode
+		be::OcclusionRasterizer occlusionRasterizer;
+		// submeshes intersecting the frustum this frame, drives the draw recording
+		std::vector<uint32_t> visibleSubmeshes;
+		// level drawn for every range this frame, LOD_CULLED outside of the frustum
+		std::vector<uint32_t> selectedLods;
+		be::RenderMode renderMode = be::RenderMode::meshletCulling;
+		size_t numMeshlets = 0;
+		be::Buffer meshletBuffer;
+		be::Buffer meshletVertexBuffer;
+		be::Buffer meshletTriangleBuffer;
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> culledIndexBuffers;
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> drawCommandBuffers;
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> lodSelectionBuffers;
+		// 1 per meshlet drawn last frame, seeds the early phase
+		be::Buffer meshletVisibilityBuffer;
+		// the software occlusion depth the meshlets are tested against
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> occlusionDepthBuffers;
+		be::Descriptor cullingDescriptor;
+		vk::PipelineLayout cullingPipelineLayout;
+		vk::Pipeline cullingPipeline;
+		be::Buffer rangeBuffer;
+		be::Buffer lodBuffer;
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> cullingCameraBuffers;
+		// one command slot per range, the count buffer tells how many were written
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> rangeDrawBuffers;
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> drawCountBuffers;
+		be::Descriptor gpuCullingDescriptor;
+		vk::PipelineLayout gpuCullingPipelineLayout;
+		vk::Pipeline gpuCullingPipeline;
+		bool occlusionCulling = true;
+		// 1 per range drawn last frame, seeds the early phase
+		be::Buffer visibilityBuffer;
+		std::array<be::Buffer, MAX_FRAME_IN_FLIGHT> occlusionStatsBuffers;
+		be::OcclusionStats occlusionStats = {};
+		double occlusionStatsTimer = 0;
+		vk::Image depthPyramidImage;
+		be::Allocation depthPyramidAllocation;
+		vk::ImageView depthPyramidView;
+		std::vector<vk::ImageView> depthPyramidLevelViews;
+		// one set per level to reduce, and the whole pyramid as set 1 of the culling pass
+		be::Descriptor depthPyramidDescriptor;
+		be::Descriptor pyramidSamplingDescriptor;
+		vk::PipelineLayout depthPyramidPipelineLayout;
+		vk::Pipeline depthPyramidPipeline;
 		std::vector<be::Buffer> uniformBufferObjects;
 		be::Buffer ssbo;
 		std::vector<be::Texture> textures;
+		be::TextureCache textureCache;
+		be::TextureStreamer textureStreamer;
+		double streamingStatsTimer = 0;
 		be::Descriptor descriptor;
+		be::BindlessTable bindlessTable;
+		vk::ImageView fallbackTextureView;
+		vk::Image fallbackTextureImage;
+		be::Allocation fallbackTextureAllocation;
+		be::Buffer fallbackBuffer;
 		vk::DescriptorPool descriptorPool;
 		vk::ImageView depthMapView;
 		vk::Image depthMapImage;
-		vk::DeviceMemory depthMapMemory;
+		be::Allocation depthMapAllocation;
 		vk::Format depthMapFormat;
 		Camera* camera;
 		
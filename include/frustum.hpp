@@ -0,0 +1,21 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+#include <array>
+
+namespace be {
+    /**
+        Six normalized planes pointing inward, extracted from a clip matrix with a zero to one depth range.
+        The planes live in the space the matrix transforms from.
+    */
+    struct Frustum {
+        // left, right, bottom, top, near, far
+        std::array<glm::vec4, 6> planes;
+
+        static Frustum fromMatrix(const glm::mat4& clip);
+        bool intersectsSphere(const glm::vec3& center, float radius) const;
+    };
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef FRUSTUMCULLER_HPP
+#define FRUSTUMCULLER_HPP
+
+#include "frustum.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace be {
+    enum class CullKernel {
+        scalar,
+        sse,
+        avx2
+    };
+
+    /**
+        Tests a set of axis aligned boxes against a frustum, eight boxes at a time with AVX2 or four with SSE.
+        The boxes are stored as centers and half extents in structure of arrays layout,
+        padded with empty boxes up to a multiple of eight so the kernels never need a tail loop.
+    */
+    class FrustumCuller {
+        public:
+            FrustumCuller();
+            void setBoxes(std::span<const glm::vec3> boxesMin, std::span<const glm::vec3> boxesMax);
+            // writes the indices of the boxes intersecting the frustum, in increasing order
+            void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+            size_t getBoxCount() const;
+            // the best kernel supported by the CPU is selected by default
+            void setKernel(CullKernel kernel);
+            CullKernel getKernel() const;
+            static bool isSupported(CullKernel kernel);
+        private:
+            void cullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+            void cullSse(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+            void cullAvx2(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+            size_t m_boxCount;
+            std::vector<float> m_centerX, m_centerY, m_centerZ;
+            std::vector<float> m_extentX, m_extentY, m_extentZ;
+            CullKernel m_kernel;
+    };
+}
+
+#endif
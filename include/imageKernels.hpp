@@ -0,0 +1,49 @@
+#ifndef IMAGEKERNELS_HPP
+#define IMAGEKERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace be {
+    enum class ImageKernel {
+        scalar,
+        sse41,
+        avx2
+    };
+
+    /**
+        Conversions and mip filters on tightly packed 8 bit images, with SSE4.1 and AVX2 paths picked at run time.
+        The results go to buffers sized by the caller, the kernels never allocate.
+        A downsampled level is max(width / 2, 1) by max(height / 2, 1), the last row or column of an odd side is dropped.
+        With srgb, the color channels are filtered in linear space and come back through a table, alpha is always linear.
+    */
+    class ImageKernels {
+        public:
+            ImageKernels();
+            // alpha is opaque
+            void expandRgbToRgba(std::span<const uint8_t> rgb, std::span<uint8_t> rgba) const;
+            // grey, the value goes to the three color channels and alpha is opaque
+            void expandRToRgba(std::span<const uint8_t> r, std::span<uint8_t> rgba) const;
+            // scales the color channels by alpha in place, on the stored values
+            void premultiplyAlpha(std::span<uint8_t> rgba) const;
+            // decodes xyz from [0, 255] to [-1, 1], normalizes and encodes back in place, alpha is kept
+            void renormalizeNormals(std::span<uint8_t> rgba) const;
+            void downsampleBox(std::span<const uint8_t> source, uint32_t width, uint32_t height, std::span<uint8_t> destination, bool srgb) const;
+            /**
+                Separable 8 tap Kaiser windowed sinc, sharper than the box and without its aliasing.
+                scratch holds getKaiserScratchSize floats, the linear source and the horizontal pass.
+                The AVX2 kernel only widens the vertical pass.
+            */
+            void downsampleKaiser(std::span<const uint8_t> source, uint32_t width, uint32_t height, std::span<uint8_t> destination, std::span<float> scratch, bool srgb) const;
+            static size_t getKaiserScratchSize(uint32_t width, uint32_t height);
+            // the best kernel supported by the CPU is selected by default
+            void setKernel(ImageKernel kernel);
+            ImageKernel getKernel() const;
+            static bool isSupported(ImageKernel kernel);
+        private:
+            ImageKernel m_kernel;
+    };
+}
+
+#endif
@@ -8,9 +8,13 @@ class InputHandler {
     public:   
         InputHandler();
         void event(const Window& renderer, Camera& cam, double dt);
+        // true once per right click
+        bool consumePickRequest();
     private:
         glm::vec2 m_cursorPos;
         bool leftClickPressed; 
+        bool rightClickPressed;
+        bool m_pickRequested;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef KTXFILE_HPP
+#define KTXFILE_HPP
+
+#include "mappedFile.hpp"
+#include "textureEncoder.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    /**
+        Block compressed texture in a KTX2 file, written next to its source image.
+        The file holds the header, the level index, a basic data format descriptor, and a key/value entry
+        with the stamp of the source and the role it was encoded for. Levels are stored smallest first, without supercompression.
+        The file is memory mapped on load and the levels are views into the mapping.
+    */
+    class KtxFile {
+        public:
+            KtxFile();
+            KtxFile(const KtxFile& another) = delete;
+            KtxFile& operator=(const KtxFile& another) = delete;
+            KtxFile(KtxFile&& another) = default;
+            KtxFile& operator=(KtxFile&& another) = default;
+            // false when the file is missing or malformed, or was encoded from another version of the source or for another role
+            bool load(const std::filesystem::path& path, const std::filesystem::path& sourcePath, TextureRole role);
+            static bool write(const std::filesystem::path& path, const std::filesystem::path& sourcePath, TextureRole role, const EncodedTexture& texture);
+            vk::Format getFormat() const;
+            vk::Extent3D getExtent() const;
+            uint32_t getLevelCount() const;
+            std::span<const std::byte> getLevel(uint32_t level) const;
+            void clean();
+
+            static constexpr uint32_t VERSION = 3;
+
+        private:
+            be::MappedFile m_file;
+            vk::Format m_format;
+            uint32_t m_width;
+            uint32_t m_height;
+            std::vector<std::span<const std::byte>> m_levels;
+    };
+}
+
+#endif
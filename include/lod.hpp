@@ -0,0 +1,36 @@
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+
+namespace be {
+    const uint32_t MAX_LOD_LEVELS = 5;
+    // screen space error under which a level is indistinguishable from the full mesh
+    const float LOD_PIXEL_ERROR = 1.0f;
+    // marks a range without any level to draw
+    const uint32_t LOD_CULLED = UINT32_MAX;
+
+    // one simplification level in the index buffer, its indices are relative to the vertex block of the range
+    // the layout matches the std430 struct of shaders/gpuCulling.slang
+    struct LodLevel {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        // object space, cumulated over the previous levels
+        float error;
+    };
+
+    /**
+        Size in pixels of an object space error seen at the closest point of the bounding sphere.
+        pixelsPerUnit is the height in pixels of one unit at distance one: proj[1][1] * viewportHeight / 2.
+    */
+    float projectError(float error, const glm::vec4& sphere, const glm::mat4& modelView, float pixelsPerUnit);
+
+    /**
+        Index of the coarsest level whose projected error stays under maxPixelError, levels are sorted from the finest.
+    */
+    uint32_t selectLod(std::span<const LodLevel> levels, const glm::vec4& sphere, const glm::mat4& modelView, float pixelsPerUnit, float maxPixelError = LOD_PIXEL_ERROR);
+}
+
+#endif
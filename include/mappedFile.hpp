@@ -0,0 +1,32 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace be {
+    /**
+        Read-only memory mapping of a whole file. The mapping lives as long as the object.
+    */
+    class MappedFile {
+        public:
+            MappedFile();
+            MappedFile(const std::filesystem::path& path);
+            MappedFile(const MappedFile& another) = delete;
+            MappedFile(MappedFile&& another);
+            MappedFile& operator=(const MappedFile& another) = delete;
+            MappedFile& operator=(MappedFile&& another);
+            ~MappedFile();
+            bool open(const std::filesystem::path& path);
+            bool isOpen() const;
+            std::span<const std::byte> getData() const;
+            size_t getSize() const;
+            void clean();
+        private:
+            const std::byte* m_data;
+            size_t m_size;
+    };
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef MEMORYALLOCATOR_HPP
+#define MEMORYALLOCATOR_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    // 64 MiB
+    constexpr vk::DeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64ull << 20;
+    // 16 MiB, images at least this large get their own vk::DeviceMemory
+    constexpr vk::DeviceSize DEDICATED_IMAGE_SIZE = 16ull << 20;
+    constexpr uint32_t NO_MEMORY_NODE = UINT32_MAX;
+
+    enum class MemoryUsage {
+        // device local, only reached through transfers and shaders
+        gpuOnly,
+        // host visible and coherent, written by the CPU and read by the GPU
+        upload,
+        // host visible and coherent, cached when possible, written by the GPU and read by the CPU
+        readback
+    };
+
+    struct Allocation {
+        vk::DeviceMemory memory;
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+        // persistently mapped address of offset, null when the memory is not host visible
+        void* data;
+        // null node for a dedicated allocation
+        uint32_t pool;
+        uint32_t node;
+    };
+
+    struct MemoryStats {
+        size_t blocks;
+        size_t dedicatedAllocations;
+        size_t allocations;
+        // bytes of vk::DeviceMemory, blocks and dedicated allocations together
+        vk::DeviceSize reservedBytes;
+        vk::DeviceSize usedBytes;
+        vk::DeviceSize peakUsedBytes;
+        // many free ranges for the same free bytes means fragmented blocks
+        size_t freeRanges;
+        vk::DeviceSize freeBytes;
+        vk::DeviceSize largestFreeRange;
+    };
+
+    // share of the free bytes of the blocks outside their largest free range, 0 when the free space is in one piece
+    float getFragmentation(const MemoryStats& stats);
+
+    /**
+        Sub-allocates large blocks of device memory, one list of blocks per memory type.
+        The free ranges of a pool are found in constant time with a two level segregated fit (TLSF),
+        and merged with their free neighbours when released.
+        When bufferImageGranularity is above one, linear and optimal resources get separate pools so they never share a page.
+        Large images, large requests and resources the driver wants alone get a dedicated allocation.
+        Host visible blocks stay mapped for their whole life.
+    */
+    class MemoryAllocator {
+        public:
+            MemoryAllocator();
+            void init(vk::Device device, vk::PhysicalDevice physicalDevice, vk::DeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE);
+            // allocates and binds the memory of buffer, name shows in the leak report
+            Allocation allocateBuffer(vk::Buffer buffer, MemoryUsage usage, std::string_view name);
+            Allocation allocateImage(vk::Image image, vk::ImageTiling tiling, MemoryUsage usage, std::string_view name);
+            void free(const Allocation& allocation);
+            // only blocks whose allocations are all movable are emptied by an evacuation
+            void setMovable(const Allocation& allocation);
+            /**
+                Picks the least used block, at most maxUsage full, of a pool whose other blocks have free ranges for all its allocations,
+                and stops allocating from it. The block is released when its last allocation is freed.
+                False when no block is worth emptying or an evacuation is running.
+            */
+            bool beginEvacuation(float maxUsage);
+            // gives the free ranges of the block back to its pool when it could not be emptied
+            void endEvacuation();
+            bool isEvacuating() const;
+            bool isEvacuating(const Allocation& allocation) const;
+            MemoryStats getStats() const;
+            uint32_t getMemoryAllocationLimit() const;
+            // reports the allocations still alive and releases every block
+            void clean();
+        private:
+            enum class NodeState : uint8_t { unused, free, allocated };
+
+            // a range of a block, linked to its physical neighbours and, when free, to the other ranges of its size class
+            struct Node {
+                vk::DeviceSize offset;
+                vk::DeviceSize size;
+                // of the allocation, for the evacuation planning
+                vk::DeviceSize alignment;
+                uint32_t block;
+                uint32_t previous;
+                uint32_t next;
+                uint32_t previousFree;
+                uint32_t nextFree;
+                NodeState state;
+                bool movable;
+                std::string name;
+            };
+
+            struct Block {
+                vk::DeviceMemory memory;
+                void* data;
+                vk::DeviceSize size;
+                // number of allocated nodes
+                size_t allocations;
+                // its free ranges are out of the free lists
+                bool evacuating;
+            };
+
+            static constexpr uint32_t SECOND_LEVEL_LOG2 = 4;
+            static constexpr uint32_t SECOND_LEVEL_COUNT = 1u << SECOND_LEVEL_LOG2;
+            // every range below 256 bytes shares the first class
+            static constexpr uint32_t SMALL_SIZE_LOG2 = 8;
+            static constexpr uint32_t FIRST_LEVEL_COUNT = 64 - SMALL_SIZE_LOG2 + 1;
+
+            struct Pool {
+                uint32_t memoryType;
+                std::vector<Block> blocks;
+                std::vector<Node> nodes;
+                std::vector<uint32_t> unusedNodes;
+                uint64_t firstLevelMap;
+                uint32_t secondLevelMaps[FIRST_LEVEL_COUNT];
+                uint32_t heads[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+            };
+
+            struct DedicatedAllocation {
+                vk::DeviceMemory memory;
+                vk::DeviceSize size;
+                uint32_t memoryType;
+                std::string name;
+            };
+
+            Allocation allocate(
+                const vk::MemoryRequirements& requirements,
+                MemoryUsage usage,
+                bool linear,
+                bool dedicated,
+                const vk::MemoryDedicatedAllocateInfo& dedicatedInfo,
+                std::string_view name
+            );
+            Allocation allocateDedicated(
+                const vk::MemoryRequirements& requirements,
+                uint32_t memoryType,
+                const vk::MemoryDedicatedAllocateInfo& dedicatedInfo,
+                std::string_view name
+            );
+            uint32_t selectMemoryType(uint32_t typeBits, MemoryUsage usage) const;
+            void* mapIfHostVisible(vk::DeviceMemory memory, uint32_t memoryType);
+            // false when no block of the pool has room
+            bool allocateFromPool(Pool& pool, uint32_t poolIndex, const vk::MemoryRequirements& requirements, std::string_view name, Allocation& allocation);
+            void addBlock(Pool& pool, vk::DeviceSize size);
+            void releaseBlock(Pool& pool, uint32_t block);
+            // the range size findFree needs to serve size bytes at this alignment
+            static vk::DeviceSize getSearchSize(vk::DeviceSize size, vk::DeviceSize alignment);
+            static void mapping(vk::DeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel);
+            // a free node of at least size bytes, NO_MEMORY_NODE when there is none
+            static uint32_t findFree(const Pool& pool, vk::DeviceSize size);
+            static void insertFree(Pool& pool, uint32_t node);
+            static void removeFree(Pool& pool, uint32_t node);
+            static uint32_t createNode(Pool& pool);
+            static void destroyNode(Pool& pool, uint32_t node);
+
+            vk::Device m_device;
+            vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+            vk::DeviceSize m_blockSize;
+            vk::DeviceSize m_granularity;
+            uint32_t m_allocationLimit;
+            // two per memory type when linear and optimal resources are separated, linear first
+            std::vector<Pool> m_pools;
+            std::vector<DedicatedAllocation> m_dedicated;
+            uint32_t m_evacuationPool;
+            uint32_t m_evacuationBlock;
+            MemoryStats m_stats;
+            mutable std::mutex m_mutex;
+    };
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include "mappedFile.hpp"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace be {
+    /**
+        Binary cache of the data produced by the ObjLoader, written next to the source file.
+        The cache is memory mapped on load so the arrays can be copied straight into staging buffers.
+        It is invalidated when the version, the element layout, the source file or one of its material libraries changes.
+    */
+    class MeshCache {
+        public:
+            enum class Section : uint32_t {
+                vertices,
+                indices,
+                materials,
+                texturePaths,
+                indexRanges,
+                meshlets,
+                meshletVertices,
+                meshletTriangles,
+                lods,
+                submeshes,
+                materialLibraries,
+                count
+            };
+
+            MeshCache() = delete;
+            MeshCache(const std::filesystem::path& sourcePath);
+            MeshCache(const MeshCache& another) = delete;
+            MeshCache& operator=(const MeshCache& another) = delete;
+            bool load();
+            bool write();
+            template<typename T>
+            void addSection(Section section, std::span<const T> data);
+            void addTexturePaths(const std::vector<std::filesystem::path>& texturesPath);
+            // the files the source depends on, stamped with it
+            void addMaterialLibraries(const std::vector<std::filesystem::path>& materialLibraries);
+            template<typename T>
+            std::span<const T> getSection(Section section) const;
+            const std::vector<std::filesystem::path>& getTexturePath() const;
+            const std::filesystem::path& getPath() const;
+            void clean();
+
+            static constexpr uint32_t VERSION = 8;
+
+        private:
+            // of the source and its material libraries, the sizes are summed and the latest modification time kept
+            struct SourceStamp {
+                uint64_t size;
+                int64_t lastWrite;
+                uint64_t hash;
+            };
+            struct SectionData {
+                uint32_t elementSize;
+                std::span<const std::byte> bytes;
+            };
+
+            SourceStamp stampSource(bool withHash) const;
+            // rewrites the modification time in the header of the cache file
+            void restamp(const SourceStamp& stamp) const;
+            static std::string joinPaths(const std::vector<std::filesystem::path>& paths);
+            std::vector<std::filesystem::path> parsePaths(Section section) const;
+
+            std::filesystem::path m_sourcePath;
+            std::filesystem::path m_cachePath;
+            be::MappedFile m_file;
+            std::array<SectionData, static_cast<size_t>(Section::count)> m_sections;
+            std::string m_texturePathsBlob;
+            std::vector<std::filesystem::path> m_texturesPath;
+            std::string m_materialLibrariesBlob;
+            std::vector<std::filesystem::path> m_materialLibraries;
+    };
+}
+
+template<typename T>
+void be::MeshCache::addSection(Section section, std::span<const T> data) {
+    m_sections[static_cast<size_t>(section)] = {sizeof(T), std::as_bytes(data)};
+}
+
+template<typename T>
+std::span<const T> be::MeshCache::getSection(Section section) const {
+    const SectionData& sectionData = m_sections[static_cast<size_t>(section)];
+    if (sectionData.elementSize != sizeof(T))
+        return {};
+    return {reinterpret_cast<const T*>(sectionData.bytes.data()), sectionData.bytes.size() / sizeof(T)};
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include "vertex.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace be {
+    const uint32_t VERTEX_CACHE_SIZE = 16;
+    const size_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+    struct VertexCacheStats {
+        // transformed vertices per triangle, 0.5 at best and 3 at worst
+        float acmr;
+        // transformed vertices per vertex, 1 at best
+        float atvr;
+    };
+
+    struct MeshOptimizationReport {
+        VertexCacheStats before;
+        VertexCacheStats after;
+    };
+
+    // drawn with drawIndexed(indexCount, 1, firstIndex, vertexOffset, 0), laid out for a std430 storage buffer
+    struct IndexRange {
+        // center and radius
+        glm::vec4 sphere;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        uint32_t vertexCount;
+        // simplification levels, the first one is the range itself
+        uint32_t firstLod;
+        uint32_t lodCount;
+        uint32_t submeshIndex;
+        uint32_t padding;
+    };
+
+    static_assert(sizeof(IndexRange) == 48);
+
+    /**
+        Simulates a FIFO post-transform cache over the index buffer.
+    */
+    VertexCacheStats analyzeVertexCache(std::span<const int> indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    /**
+        Reorders triangles for the post-transform cache with Tipsify (Sander et al. 2007).
+        @return the first triangle of every cluster that started on a dead end.
+    */
+    std::vector<uint32_t> optimizeVertexCache(std::span<int> indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    /**
+        Sorts triangle clusters so the ones facing away from the mesh center come first, which are likely to occlude the others.
+        Clusters are split further as long as the cache efficiency stays within threshold of the input order.
+    */
+    void optimizeOverdraw(std::span<int> indices, std::span<const Vertex> vertices, std::span<const uint32_t> hardBoundaries, float threshold = 1.05f, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    /**
+        Reorders vertices by first use and drops the unreferenced ones.
+    */
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<int> indices);
+
+    /**
+        Splits the triangles in consecutive ranges referencing at most maxVertices vertices each, so they fit in 16 bit indices by default.
+        Every range gets its own block of vertices appended to rangeVertices, vertices shared between ranges are duplicated.
+        The indices, local to the block of their range, are appended to localIndices.
+    */
+    std::vector<IndexRange> splitIndexRanges(std::span<const Vertex> vertices, std::span<const int> indices, std::vector<Vertex>& rangeVertices, std::vector<uint32_t>& localIndices, size_t maxVertices = MAX_SHORT_INDEX_VERTICES);
+
+    // distinct vertices the triangles reference, the vertices of an unsplit range
+    size_t countUniqueVertices(std::span<const int> indices, size_t vertexCount);
+}
+
+#endif
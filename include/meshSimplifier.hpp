@@ -0,0 +1,27 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include "vertex.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace be {
+    struct SimplifiedMesh {
+        std::vector<uint32_t> indices;
+        // largest distance between a collapsed vertex and the planes of its original triangles
+        float error;
+    };
+
+    /**
+        Edge collapse simplification driven by quadric error metrics (Garland and Heckbert 1997).
+        Vertices only collapse onto one of their neighbours, so the result indexes the same vertex buffer.
+        Vertices on borders, on attribute seams or on non-manifold edges are locked,
+        which keeps the boundaries between ranges and the texture seams watertight.
+    */
+    SimplifiedMesh simplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float maxError = std::numeric_limits<float>::max());
+}
+
+#endif
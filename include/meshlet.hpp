@@ -0,0 +1,69 @@
+#ifndef MESHLET_HPP
+#define MESHLET_HPP
+
+#include "vertex.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace be {
+    const uint32_t MESHLET_MAX_VERTICES = 64;
+    const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+    /**
+        Cluster of triangles sharing a small set of vertices, laid out for a std430 storage buffer.
+        The cluster is back facing for every camera position where
+        dot(center - camera, cone.xyz) >= cone.w * length(center - camera) + radius.
+    */
+    struct Meshlet {
+        // center and radius
+        glm::vec4 sphere;
+        // axis and cutoff, a cutoff of 1 never culls
+        glm::vec4 cone;
+        uint32_t vertexOffset;
+        uint32_t triangleOffset;
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+        // drawn only when this level is the one selected for the range
+        uint32_t rangeIndex;
+        uint32_t lodLevel;
+        uint32_t padding[2];
+    };
+
+    static_assert(sizeof(Meshlet) == 64);
+
+    struct MeshletData {
+        std::vector<Meshlet> meshlets;
+        // indices in the vertex buffer, vertexCount per meshlet
+        std::vector<uint32_t> vertices;
+        // three 8 bit indices in the meshlet vertices per triangle
+        std::vector<uint32_t> triangles;
+    };
+
+    // push constants of shaders/meshletCulling.slang, the frustum planes are taken from clip
+    struct CullingData {
+        // mesh space to clip space
+        glm::mat4 clip;
+        // in mesh space
+        glm::vec4 cameraPosition;
+        uint32_t meshletCount;
+        uint32_t coneCulling;
+        // the meshlets are tested against the depth pyramid of the early pass
+        uint32_t occlusionCulling;
+        // be::CullingPhase
+        uint32_t phase;
+        // of the depth buffer the pyramid is built from
+        glm::vec2 depthSize;
+        uint32_t pyramidLevels;
+        // the meshlets are also tested against the depth of be::OcclusionRasterizer
+        uint32_t softwareOcclusion;
+    };
+
+    /**
+        Groups consecutive triangles greedily, so the clusters follow the index buffer order.
+        The indices are relative to the vertex block starting at vertexOffset in the vertex buffer.
+    */
+    void appendMeshlets(MeshletData& data, std::span<const Vertex> vertices, std::span<const uint32_t> indices, uint32_t vertexOffset, uint32_t rangeIndex, uint32_t lodLevel);
+}
+
+#endif
@@ -1,8 +1,14 @@
 #ifndef OBJLOADER_HPP
 #define OBJLOADER_HPP
+#include "lod.hpp"
 #include "materialObject.hpp"
+#include "meshOptimizer.hpp"
+#include "meshlet.hpp"
+#include "submesh.hpp"
 #include "vertex.hpp"
+#include "vertexWelder.hpp"
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <unordered_map>
 #include <utility>
@@ -13,17 +19,42 @@ class ObjLoader {
         ObjLoader() = delete;
         ObjLoader(const std::filesystem::path& path);
         const std::vector<std::filesystem::path>& getTexturePath();
+        const std::vector<std::filesystem::path>& getMaterialLibraries();
         const std::vector<MaterialObject>& getMaterials();
         const std::vector<Vertex>& getVertices();
         const std::vector<int>& getIndices();
+        const be::WeldStats& getWeldStats();
+        be::MeshOptimizationReport optimize();
+        // in 16 bit ranges, unless the vertices they duplicate, of vertexSize bytes, cost more than the halved indices save
+        void splitIndexRanges(size_t vertexSize);
+        bool hasShortIndices();
+        // local to the vertex block of their range
+        const std::vector<uint32_t>& getRangeIndices();
+        // the range indices narrowed, when they fit
+        std::vector<uint16_t> getShortIndices();
+        const std::vector<be::IndexRange>& getIndexRanges();
+        const std::vector<be::Submesh>& getSubmeshes();
+        // appends the simplified levels of every range to the range indices
+        void buildLods();
+        const std::vector<be::LodLevel>& getLods();
+        be::MeshletData buildMeshlets();
     private:
         std::filesystem::path correctPathFormat(const std::string& entryPath);
+        // one pass of splitIndexRanges, rangeVertices receives the vertices of the ranges
+        void split(size_t maxVertices, std::vector<Vertex>& rangeVertices);
         int checkAndGetIndexTexture(std::unordered_map<std::filesystem::path, size_t>& uniqueTexturesNames, const std::string& texturePath);
         std::vector<std::filesystem::path> m_texturesPath;
+        std::vector<std::filesystem::path> m_materialLibraries;
         std::vector<int> m_vertexIndices;
+        std::vector<uint32_t> m_rangeIndices;
+        bool m_shortIndices = true;
+        std::vector<be::IndexRange> m_indexRanges;
+        std::vector<be::LodLevel> m_lods;
+        std::vector<be::Submesh> m_submeshes;
         std::vector<int> m_materialsIndicies;
         std::vector<Vertex> m_verticies;
         std::vector<MaterialObject> m_materials;
+        be::WeldStats m_weldStats;
 };
 
 #endif
@@ -0,0 +1,81 @@
+#ifndef OBJPARSER_HPP
+#define OBJPARSER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace be {
+    struct ObjIndex {
+        int vertexIndex;
+        int normalIndex;
+        int texCoordIndex;
+    };
+
+    struct ObjAttrib {
+        std::vector<float> vertices;
+        std::vector<float> normals;
+        std::vector<float> texCoords;
+        // empty when the file has no vertex colors
+        std::vector<float> colors;
+    };
+
+    /**
+        Triangulated faces sharing the same "o"/"g" statement.
+    */
+    struct ObjShape {
+        std::string name;
+        std::vector<ObjIndex> indices;
+        std::vector<int> materialIds;
+    };
+
+    struct ObjMaterial {
+        std::string name;
+        std::array<float, 3> ambient = {0, 0, 0};
+        std::array<float, 3> diffuse = {0, 0, 0};
+        std::array<float, 3> specular = {0, 0, 0};
+        std::array<float, 3> transmittance = {0, 0, 0};
+        std::array<float, 3> emission = {0, 0, 0};
+        float shininess = 1;
+        float ior = 1;
+        float dissolve = 1;
+        int illum = 0;
+        std::string ambientTexture;
+        std::string diffuseTexture;
+        std::string specularTexture;
+        std::string bumpTexture;
+    };
+
+    /**
+        OBJ/MTL parser. The OBJ file is memory mapped, split in line aligned chunks
+        parsed on every core, then merged in file order so the result does not depend on the thread count.
+        Faces are triangulated the same way tinyobjloader does.
+    */
+    class ObjParser {
+        public:
+            ObjParser() = delete;
+            ObjParser(const std::filesystem::path& path);
+            const ObjAttrib& getAttrib() const;
+            const std::vector<ObjShape>& getShapes() const;
+            const std::vector<ObjMaterial>& getMaterials() const;
+            const std::string& getWarning() const;
+            // every mtllib of the file, found or not
+            const std::vector<std::filesystem::path>& getMaterialLibraries() const;
+        private:
+            struct Chunk;
+            void parseChunk(std::string_view text, Chunk& chunk) const;
+            void parseMaterials(const std::filesystem::path& path);
+            void triangulate(const Chunk& chunk, std::vector<ObjIndex>& triangles, std::vector<uint32_t>& trianglesPerFace) const;
+            ObjAttrib m_attrib;
+            std::vector<ObjShape> m_shapes;
+            std::vector<ObjMaterial> m_materials;
+            std::vector<std::filesystem::path> m_materialLibraries;
+            std::string m_warning;
+    };
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef OCCLUSIONRASTERIZER_HPP
+#define OCCLUSIONRASTERIZER_HPP
+
+#include "frustumCuller.hpp"
+#include "meshOptimizer.hpp"
+#include "submesh.hpp"
+#include "vertex.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace be {
+    // multiple of eight so a row is a whole number of AVX2 blocks
+    constexpr uint32_t OCCLUSION_BUFFER_WIDTH = 320;
+    constexpr uint32_t OCCLUSION_BUFFER_HEIGHT = 192;
+    // rows rasterized by one task
+    constexpr uint32_t OCCLUSION_BAND_HEIGHT = 16;
+
+    // simplified copies of the large submeshes, in mesh space like the submesh table
+    struct OccluderMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        uint32_t submeshCount;
+    };
+
+    /**
+        Picks the submeshes whose two largest box extents reach minExtent times the scene diagonal,
+        welds them by position so the texture seams do not lock the simplifier, and simplifies them towards reduction of their triangles.
+        Only the vertices lying on the planes of their triangles collapse, so the occluders never leave the surface and stop short of reduction on curved meshes.
+    */
+    OccluderMesh buildOccluders(
+        std::span<const Submesh> submeshes,
+        std::span<const Vertex> vertices,
+        std::span<const uint32_t> indices,
+        std::span<const IndexRange> ranges,
+        float minExtent = 0.05f,
+        float reduction = 0.25f
+    );
+
+    struct SoftwareOcclusionStats {
+        size_t occluderTriangles;
+        // in front of the camera and overlapping the buffer
+        size_t rasterizedTriangles;
+        size_t testedBoxes;
+        size_t occludedBoxes;
+        double rasterMilliseconds;
+        double testMilliseconds;
+    };
+
+    /**
+        Software occlusion culling on a small depth buffer.
+        Occluders write the pixels they cover whole with the farthest depth of the triangle,
+        and a box is occluded when its nearest depth is behind every pixel its screen rectangle touches.
+        An edge shared with a neighbour facing the same way is sampled at the pixel centres with the top-left rule instead,
+        so exactly one of the two triangles writes the pixels along it, with the farthest depth of both.
+        The buffer is split in bands of rows rasterized on all the cores, eight pixels at a time with AVX2 or four with SSE.
+    */
+    class OcclusionRasterizer {
+        public:
+            OcclusionRasterizer();
+            void setOccluders(OccluderMesh occluders);
+            bool hasOccluders() const;
+            // clears the depth buffer and draws the occluders, clip goes from mesh space to clip space
+            void render(const glm::mat4& clip);
+            // removes the occluded submeshes from visibleSubmeshes, render has to be called first with the same matrix
+            void cull(const glm::mat4& clip, std::span<const Submesh> submeshes, std::vector<uint32_t>& visibleSubmeshes);
+            bool isBoxVisible(const glm::mat4& clip, const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+            std::span<const float> getDepth() const;
+            const SoftwareOcclusionStats& getStats() const;
+            // the best kernel supported by the CPU is selected by default
+            void setKernel(CullKernel kernel);
+            CullKernel getKernel() const;
+        private:
+            // edge functions evaluated at integer pixel coordinates, a pixel is covered when every edge reaches its threshold
+            struct ScreenTriangle {
+                float a[3], b[3], c[3];
+                float threshold[3];
+                float depth;
+                int32_t minX, maxX, minY, maxY;
+            };
+
+            void rasterizeBand(uint32_t band);
+            void rasterizeRowScalar(const ScreenTriangle& triangle, int32_t y);
+            void rasterizeRowSse(const ScreenTriangle& triangle, int32_t y);
+            void rasterizeRowAvx2(const ScreenTriangle& triangle, int32_t y);
+            // true when one pixel of [minX, maxX] on row y is not in front of depth
+            bool testRowScalar(int32_t y, int32_t minX, int32_t maxX, float depth) const;
+            bool testRowSse(int32_t y, int32_t minX, int32_t maxX, float depth) const;
+            bool testRowAvx2(int32_t y, int32_t minX, int32_t maxX, float depth) const;
+
+            std::vector<glm::vec3> m_positions;
+            std::vector<uint32_t> m_indices;
+            std::vector<glm::vec4> m_clipPositions;
+            // triangle across each edge, wound the other way round it, UINT32_MAX on borders and non-manifold edges
+            std::vector<uint32_t> m_neighbors;
+            // signed pixel area and farthest depth of the triangles this frame, 0 and INFINITY when not rasterized
+            std::vector<float> m_areas;
+            std::vector<float> m_farthest;
+            std::vector<ScreenTriangle> m_triangles;
+            std::vector<float> m_depth;
+            SoftwareOcclusionStats m_stats;
+            CullKernel m_kernel;
+    };
+}
+
+#endif
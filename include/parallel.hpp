@@ -0,0 +1,43 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace be {
+    size_t getWorkerCount();
+
+    /**
+        Runs task(i) for every i in [0, taskCount) on all the cores, the calling thread included.
+        Tasks are handed out one by one so uneven tasks still balance.
+    */
+    template<typename F>
+    void parallelFor(size_t taskCount, F&& task) {
+        size_t threadCount = std::min(taskCount, getWorkerCount());
+        if (threadCount <= 1) {
+            for (size_t i = 0; i < taskCount; i++)
+                task(i);
+            return;
+        }
+
+        std::atomic<size_t> nextTask = 0;
+        auto worker = [&nextTask, &task, taskCount]() {
+            for (size_t i = nextTask++; i < taskCount; i = nextTask++)
+                task(i);
+        };
+        std::vector<std::jthread> threads;
+        threads.reserve(threadCount - 1);
+        for (size_t i = 1; i < threadCount; i++)
+            threads.emplace_back(worker);
+        worker();
+    }
+}
+
+inline size_t be::getWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+#endif
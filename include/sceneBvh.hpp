@@ -0,0 +1,51 @@
+#ifndef SCENEBVH_HPP
+#define SCENEBVH_HPP
+
+#include "bvh.hpp"
+#include "meshOptimizer.hpp"
+#include "submesh.hpp"
+#include "vertex.hpp"
+#include <optional>
+
+namespace be {
+    struct RayHit {
+        float distance;
+        uint32_t submesh;
+        // first index of the triangle in the index buffer divided by 3, UINT32_MAX when only the boxes are hit
+        uint32_t triangle;
+    };
+
+    /**
+        Two level hierarchy: a BVH over the submesh boxes and, when requested, a BVH over the triangles of every submesh.
+        The full resolution level is used and everything is in mesh space, like the submesh table.
+    */
+    class SceneBvh {
+        public:
+            void build(
+                std::span<const Submesh> submeshes,
+                std::span<const Vertex> vertices,
+                std::span<const uint32_t> indices,
+                std::span<const IndexRange> ranges,
+                bool withTriangles
+            );
+            void cull(const Frustum& frustum, std::vector<uint32_t>& visibleSubmeshes) const;
+            void overlap(const Aabb& box, std::vector<uint32_t>& submeshes) const;
+            std::optional<RayHit> pick(const Ray& ray) const;
+            bool hasTriangles() const;
+            // top level and triangle nodes
+            size_t getNodeCount() const;
+        private:
+            struct TriangleMesh {
+                Bvh bvh;
+                // three corners per triangle
+                std::vector<glm::vec3> corners;
+                std::vector<uint32_t> triangles;
+            };
+
+            std::vector<Aabb> m_submeshBounds;
+            Bvh m_submeshBvh;
+            std::vector<TriangleMesh> m_triangleMeshes;
+    };
+}
+
+#endif
@@ -1,4 +1,6 @@
 #include <string>
+#include <utility>
+#include <vector>
 #include "slang.h"
 #include "slang-com-ptr.h"
 
@@ -7,11 +9,14 @@ class ShaderCompiler
 private:
   Slang::ComPtr<slang::IGlobalSession> globalSession;
   Slang::ComPtr<slang::ISession> session;
+  std::vector<std::pair<std::string, std::string>> macros;
   void setOptions();
   void diagnoseIfNeeded(slang::IBlob* diagnosticBlob) const;
 
 public:
   ShaderCompiler();
+  // has to be called before createSession
+  void addMacro(const std::string& name, const std::string& value);
   void createSession(const SlangCompileTarget format, const std::string& profile);
   std::string  loadProgram(const std::string& moduleNames);
 };
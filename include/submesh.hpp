@@ -0,0 +1,57 @@
+#ifndef SUBMESH_HPP
+#define SUBMESH_HPP
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+namespace be {
+    /**
+        Triangles of one OBJ shape sharing a material, laid out for a std430 storage buffer.
+        The index span covers the full resolution level in the index buffer.
+    */
+    struct Submesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+        // the 16 bit index ranges the submesh was split into
+        uint32_t firstRange;
+        uint32_t rangeCount;
+        // -1 without material
+        int32_t materialIndex;
+        uint32_t shapeIndex;
+        // w unused
+        glm::vec4 aabbMin;
+        glm::vec4 aabbMax;
+        // center and radius
+        glm::vec4 sphere;
+    };
+
+    static_assert(sizeof(Submesh) == 80);
+
+    // uniform block of shaders/gpuCulling.slang, the model matrix is the one of the mesh space bounds
+    struct CullingCamera {
+        glm::mat4 modelView;
+        glm::mat4 proj;
+        float pixelsPerUnit;
+        float maxPixelError;
+        uint32_t rangeCount;
+        uint32_t occlusionCulling;
+        glm::vec2 depthSize;
+        uint32_t pyramidLevels;
+        uint32_t padding;
+    };
+    static_assert(sizeof(CullingCamera) == 160);
+
+    // counters written by shaders/gpuCulling.slang, in ranges
+    struct OcclusionStats {
+        uint32_t inFrustum;
+        uint32_t occluded;
+        // visible last frame and drawn before the depth pyramid is built
+        uint32_t earlyDraws;
+        // found visible by the test against the pyramid
+        uint32_t lateDraws;
+    };
+}
+
+#endif
@@ -1,16 +1,58 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 #include "buffer.hpp"
+#include "ktxFile.hpp"
+#include "mappedFile.hpp"
+#include "textureCache.hpp"
+#include "textureEncoder.hpp"
 #include <filesystem>
+#include <span>
+#include <tuple>
+#include <vector>
 
 namespace be {
+    // levels down to 1x1
+    uint32_t getMipLevelCount(vk::Extent3D extent);
+
+    // the levels of an image as Texture::readLevels finds them, the spans point into the members below them
+    struct TextureLevels {
+        vk::Format format;
+        uint32_t width;
+        uint32_t height;
+        // largest first, only the first one when the others are left to blits
+        std::vector<std::span<const std::byte>> levels;
+        be::KtxFile compressed;
+        be::MappedFile cached;
+        be::EncodedTexture encoded;
+        std::vector<unsigned char> decoded;
+    };
+
     class Texture {
         public:
             Texture() = delete;
-            Texture(const std::filesystem::path& name, vk::Queue queue);
+            /**
+                A streamed texture has the levels of uncompressed images filtered on the CPU, so they can be uploaded one by one,
+                and only stages and keeps the chain from the first level no larger than the resident size, the finer ones are read again when streamed.
+                The others keep their whole chain, blitted on the GPU when the device can.
+            */
+            Texture(const std::filesystem::path& name, vk::Queue queue, TextureRole role = TextureRole::color, bool streamed = false);
             static void setDevice(vk::Device device);
             static void setPhysicalDevice(vk::PhysicalDevice physicaldevice);
+            static void setAllocator(be::MemoryAllocator& allocator);
+            // the device has textureCompressionBC enabled
+            static void setBlockCompression(bool enabled);
+            // the uncompressed textures are read from and added to cache, none when null
+            static void setCache(be::TextureCache* cache);
+            // largest side of the first level a streamed texture keeps
+            static void setResidentSize(uint32_t residentSize);
+            /**
+                Reads the block compressed copy of the image, name with a .ktx2 suffix, when it is up to date.
+                Otherwise decodes the image and, with block compression, encodes it and writes the copy for the next launches.
+                Without it, the decoded texels and their mips come from the cache when it has the image.
+            */
             void loadImage(const std::filesystem::path& name);
+            // what loadImage reads, without the device so any thread can call it, mipChain filters the levels of uncompressed images
+            static TextureLevels readLevels(const std::filesystem::path& name, TextureRole role, bool mipChain);
             void createTextureImage(
                 vk::ImageType type,
                 uint32_t mipLevel,
@@ -19,21 +61,63 @@ namespace be {
                 vk::ImageTiling tiling,
                 vk::ImageUsageFlags usage,
                 vk::SharingMode sharingMode,
-                vk::MemoryPropertyFlags properties
+                be::MemoryUsage memoryUsage
             );
             void copyBufferToImage(vk::CommandPool commandPool);
-            void transitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::CommandPool commandPool);
-            std::pair<vk::Format, std::vector<unsigned char>> pickFormat(const std::filesystem::path& path, unsigned char* pixels, size_t nbPixels, int nbChannels) const;
+            // once the image is uploaded, the staging buffer is not needed anymore
+            void releaseStagingBuffer();
+            // every level in the staging buffer, only the first one when the others are generated with blits
+            std::vector<vk::BufferImageCopy> getCopyRegions() const;
+            // the chain from the base level is in the staging buffer, read from the compressed file or filtered on the CPU when blits are not possible
+            bool hasUploadedMips() const;
+            // copies every level to a new image in shader read only layout with commandBuffer,
+            // gives back the old image, view and allocation for the caller to release once the GPU no longer uses them
+            std::tuple<vk::Image, vk::ImageView, be::Allocation> relocate(vk::CommandBuffer commandBuffer);
+            /**
+                Like relocate, but the new image holds the chain from baseLevel on. Only the levels both images hold are copied,
+                the new image keeps the others undefined for the caller to upload.
+            */
+            std::tuple<vk::Image, vk::ImageView, be::Allocation> rebase(vk::CommandBuffer commandBuffer, uint32_t baseLevel);
+            void transitionImageLayout(
+                vk::ImageLayout oldLayout,
+                vk::ImageLayout newLayout,
+                vk::CommandPool commandPool,
+                uint32_t baseMipLevel = 0,
+                uint32_t levelCount = vk::RemainingMipLevels
+            );
     		static void createTextureSampler();
             static void cleanSampler(); 
             vk::ImageView getImageView() const;
             vk::Image getImage() const;
+            // of the first level of the chain, whatever the image holds
+            vk::Extent3D getExtent() const;
+            // of a level of the chain
+            vk::Extent3D getLevelExtent(uint32_t level) const;
+            uint32_t getMipLevels() const;
+            uint32_t getBaseLevel() const;
+            // the levels the texture can fill, those of its file or down to 1x1 when they are blitted
+            uint32_t getMipChainLength() const;
+            vk::Format getFormat() const;
             vk::Buffer getBuffer() const;
+            const be::Allocation& getAllocation() const;
             static vk::Sampler getSampler();
             void clean();
         private:
+            // RGBA texels of the image in source
+            static std::vector<unsigned char> decodeImage(const be::MappedFile& source, const std::filesystem::path& name, int& width, int& height);
+            // first level of a chain of chainLength levels no larger than residentSize
+            static uint32_t getResidentLevel(vk::Extent3D extent, uint32_t chainLength);
+            // levels back to back in a new staging buffer, the sizes of block compressed levels keep the offsets aligned
+            void stageLevels(std::span<const std::span<const std::byte>> levels, const std::filesystem::path& name);
+
             inline static vk::Device m_device = nullptr;
             inline static vk::PhysicalDevice m_physicalDevice = nullptr;
+            inline static be::MemoryAllocator* m_allocator = nullptr;
+            inline static bool m_blockCompression = false;
+            inline static be::TextureCache* m_cache = nullptr;
+            inline static uint32_t m_residentSize = 0;
+            TextureRole m_role;
+            bool m_streamed;
             vk::Queue m_queue;
             int m_height;
             int m_width;
@@ -41,7 +125,17 @@ namespace be {
             vk::Image m_image;
             vk::Format m_format;
             vk::ImageView m_imageView;
-            vk::DeviceMemory m_memory;
+            uint32_t m_mipLevels;
+            // level of the chain in the first level of the image
+            uint32_t m_baseLevel;
+            // levels the texture can fill
+            uint32_t m_chainLength;
+            // staging buffer offset of each level from the base one, empty when only the first one is loaded
+            std::vector<vk::DeviceSize> m_levelOffsets;
+            vk::ImageTiling m_tiling;
+            vk::ImageUsageFlags m_usage;
+            be::MemoryUsage m_memoryUsage;
+            be::Allocation m_allocation;
             be::Buffer m_buffer;
             inline static vk::Sampler sampler = nullptr;
     };
@@ -0,0 +1,76 @@
+#ifndef TEXTURECACHE_HPP
+#define TEXTURECACHE_HPP
+
+#include "mappedFile.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    // 1 GiB
+    constexpr uint64_t DEFAULT_TEXTURE_CACHE_SIZE = 1ull << 30;
+
+    struct TextureCacheStats {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t entries;
+        uint64_t bytes;
+    };
+
+    struct DecodedTexture {
+        uint32_t width;
+        uint32_t height;
+        // of the source image, before the expansion to RGBA
+        uint32_t sourceChannels;
+        // RGBA texels of every level down to 1x1, back to back
+        std::span<const unsigned char> texels;
+        std::vector<vk::DeviceSize> levelOffsets;
+    };
+
+    /**
+        Directory of decoded textures, the upload ready RGBA texels of their whole mip chain.
+        An entry is keyed by the hash of the source file content and of the settings that shaped the texels,
+        so a renamed or touched image still hits and an edited one misses. Entries are memory mapped on a hit.
+        When the directory grows past its size, the least recently used entries are deleted,
+        the last use of an entry being the modification time of its file.
+    */
+    class TextureCache {
+        public:
+            TextureCache();
+            TextureCache(const TextureCache& another) = delete;
+            TextureCache& operator=(const TextureCache& another) = delete;
+            // creates the directory when missing and lists the entries already there
+            void init(const std::filesystem::path& directory, uint64_t maxSize = DEFAULT_TEXTURE_CACHE_SIZE);
+            static uint64_t getKey(std::span<const std::byte> source, uint64_t settings);
+            // maps the entry into file, texture views the mapping, false on a miss
+            bool find(uint64_t key, be::MappedFile& file, DecodedTexture& texture);
+            // false when the entry could not be written, the texture is then decoded again next time
+            bool store(uint64_t key, const DecodedTexture& texture);
+            const TextureCacheStats& getStats() const;
+
+            static constexpr uint32_t VERSION = 1;
+
+        private:
+            struct Entry {
+                uint64_t size;
+                std::filesystem::file_time_type lastUse;
+            };
+
+            std::filesystem::path getPath(uint64_t key) const;
+            // deletes the least recently used entries until size more bytes fit
+            void evict(uint64_t size);
+            void remove(uint64_t key);
+
+            std::filesystem::path m_directory;
+            uint64_t m_maxSize;
+            std::unordered_map<uint64_t, Entry> m_entries;
+            TextureCacheStats m_stats;
+    };
+}
+
+#endif
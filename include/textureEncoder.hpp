@@ -0,0 +1,60 @@
+#ifndef TEXTUREENCODER_HPP
+#define TEXTUREENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    enum class TextureRole {
+        // sampled as sRGB color
+        color,
+        // normal or height map, kept linear
+        bump
+    };
+
+    struct EncodedTexture {
+        vk::Format format;
+        uint32_t width;
+        uint32_t height;
+        // largest first, down to 1x1
+        std::vector<std::vector<std::byte>> levels;
+    };
+
+    enum class MipFilter {
+        // 2x2 average, the last row or column of an odd level is dropped
+        box,
+        // 8 tap windowed sinc, sharper but slower
+        kaiser
+    };
+
+    /**
+        Appends the levels below the RGBA texels, the buffer grows once for the whole chain.
+        sRGB texels are filtered in linear space, or the smaller levels come out darker.
+        Gives back the byte offset of each level, the first one included.
+    */
+    std::vector<vk::DeviceSize> appendMipChain(std::vector<unsigned char>& texels, int width, int height, bool srgb, MipFilter filter = MipFilter::box);
+    /**
+        A bump map with 3 or more channels, not grey and whose texels mostly decode to unit vectors facing out of the surface.
+        Tells tangent space normal maps from the height maps a material can also bind as bump.
+    */
+    bool isNormalMap(std::span<const unsigned char> rgba, int channels, TextureRole role);
+    // BC5 for normal maps, BC4 for height maps and BC7 for color, channels is the count of the source image
+    vk::Format getEncodedFormat(std::span<const unsigned char> rgba, int channels, TextureRole role);
+    // the whole mip chain of the RGBA texels in the format getEncodedFormat picks
+    EncodedTexture encodeTexture(std::span<const unsigned char> rgba, uint32_t width, uint32_t height, int channels, TextureRole role);
+
+    /**
+        Block compressors of RGBA8 texels, the 4x4 blocks are encoded in parallel.
+        Blocks crossing the right or bottom edge repeat the last column or row.
+        BC7 only uses mode 6, one subset with 7 bit RGBA endpoints, p-bits and 4 bit indices.
+        BC5 keeps red and green, BC4 keeps red.
+    */
+    std::vector<std::byte> encodeBC7(std::span<const unsigned char> rgba, uint32_t width, uint32_t height);
+    std::vector<std::byte> encodeBC5(std::span<const unsigned char> rgba, uint32_t width, uint32_t height);
+    std::vector<std::byte> encodeBC4(std::span<const unsigned char> rgba, uint32_t width, uint32_t height);
+}
+
+#endif
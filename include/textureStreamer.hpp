@@ -0,0 +1,162 @@
+#ifndef TEXTURESTREAMER_HPP
+#define TEXTURESTREAMER_HPP
+
+#include "buffer.hpp"
+#include "materialObject.hpp"
+#include "memoryAllocator.hpp"
+#include "texture.hpp"
+#include "uploadManager.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    // 256 MiB
+    constexpr vk::DeviceSize DEFAULT_TEXTURE_BUDGET = 256ull << 20;
+    // largest side of the level a streamed texture starts from, given to Texture::setResidentSize
+    constexpr uint32_t STREAMING_RESIDENT_SIZE = 64;
+    // frames without a sample before the levels of a texture can be evicted
+    constexpr uint64_t STREAMING_EVICTION_DELAY = 120;
+    // added to the level written by the fragment shader so it stays unsigned, has to match shaders/firstShader.slang
+    constexpr uint32_t FEEDBACK_LEVEL_BIAS = 16;
+    // a feedback slot no fragment wrote
+    constexpr uint32_t FEEDBACK_UNUSED = 0xFFFFFFFF;
+
+    struct StreamingStats {
+        size_t loadedLevels;
+        size_t evictedLevels;
+        size_t swaps;
+        // levels the worker could not read, their texture stays as it is
+        size_t failedLoads;
+        vk::DeviceSize residentBytes;
+    };
+
+    /**
+        Keeps the textures resident from a small level and streams the finer ones in as the scene samples them.
+        The fragment shader writes the finest level it needed for each material in the feedback buffer of the frame,
+        read once the fence of the frame is signaled, so it never waits on the GPU.
+        A worker thread reads the missing levels, then the texture takes a new image where the levels it had are copied on the GPU
+        and the others are uploaded. Like the moves of the defragmenter, the descriptor set of each frame takes the new view
+        when it is recorded next, once the transfer queue is done with the uploads, and the old image is released when no frame in flight uses it.
+        Over the budget, the textures sampled the longest time ago drop their finest level, one per frame.
+    */
+    class TextureStreamer {
+        public:
+            // rewrites what refers to a swapped texture in the descriptor sets of one frame in flight
+            using ImagePatch = std::function<void(size_t frame, vk::ImageView oldView, vk::ImageView newView)>;
+
+            TextureStreamer();
+            void init(
+                vk::Device device,
+                be::MemoryAllocator& allocator,
+                be::UploadManager& uploads,
+                size_t framesInFlight,
+                std::span<const MaterialObject> materials,
+                ImagePatch imagePatch
+            );
+            // every texture of the table in order, the texture keeps its address, path and role are those it was loaded with,
+            // those not streamed start from level 0 and the feedback never asks them for another
+            void addTexture(be::Texture& texture, const std::filesystem::path& path, TextureRole role);
+            // one per frame in flight, bound as the feedback of the fragment shader
+            const std::vector<be::Buffer>& getFeedbackBuffers() const;
+            // after the fence of frame, takes the levels its fragments asked for
+            void readFeedback(size_t frame);
+            /**
+                Called once per frame while recording its command buffer, after the defragmenter and before the acquires of the uploads.
+                Releases the old images every frame in flight is done with, patches the set of frame, starts the swaps
+                of the levels the worker loaded, evicts over the budget and resets the feedback buffer of frame.
+            */
+            void update(vk::CommandBuffer commandBuffer, size_t frame);
+            // at the end of the command buffer of the frame, so readFeedback sees what its fragments wrote
+            void recordReadback(vk::CommandBuffer commandBuffer);
+            // a texture is changing image, the defragmenter has to leave them alone
+            bool isSwapping() const;
+            void setBudget(vk::DeviceSize budget);
+            vk::DeviceSize getBudget() const;
+            const StreamingStats& getStats() const;
+            // stops the worker and releases the old images still waiting, the device has to be idle
+            void clean();
+        private:
+            struct Resident {
+                be::Texture* texture;
+                std::filesystem::path path;
+                TextureRole role;
+                // base level the texture never goes above
+                uint32_t initialLevel;
+                // finest level of the chain asked for by the last feedback that sampled it
+                uint32_t wantedLevel;
+                // frame count of that feedback
+                uint64_t lastSampled;
+                // read by the worker or swapped
+                bool busy;
+                bool failed;
+            };
+
+            struct Load {
+                size_t texture;
+                // the worker never reads m_textures
+                std::filesystem::path path;
+                TextureRole role;
+                uint32_t firstLevel;
+                uint32_t levelCount;
+                vk::Format format;
+                // copies of the levels, empty when they could not be read
+                std::vector<std::vector<std::byte>> levels;
+            };
+
+            struct Swap {
+                size_t texture;
+                uint32_t baseLevel;
+                vk::Image newImage;
+                vk::Image oldImage;
+                vk::ImageView oldView;
+                vk::ImageView newView;
+                be::Allocation oldAllocation;
+                // upload requests of the new levels, consecutive
+                uint64_t firstUpload;
+                uint32_t uploadCount;
+                // frame count when the first set was patched, 0 while the uploads are pending
+                uint64_t frame;
+                std::vector<bool> patched;
+            };
+
+            void work(std::stop_token stopToken);
+            void startSwap(vk::CommandBuffer commandBuffer, Load& load);
+            void evict(vk::CommandBuffer commandBuffer);
+            void release(const Swap& swap);
+
+            vk::Device m_device;
+            be::MemoryAllocator* m_allocator;
+            be::UploadManager* m_uploads;
+            size_t m_framesInFlight;
+            ImagePatch m_imagePatch;
+            // texture sampled by each material, -1 without one
+            std::vector<int> m_materialTextures;
+            std::vector<Resident> m_textures;
+            // base level of every texture in the set of each frame, what its feedback is relative to
+            std::vector<std::vector<uint32_t>> m_frameBases;
+            std::vector<be::Buffer> m_feedbackBuffers;
+            std::vector<uint32_t> m_feedback;
+            std::vector<Swap> m_swaps;
+            uint64_t m_frameCount;
+            vk::DeviceSize m_budget;
+            // a texture asked for levels the budget had no room for
+            bool m_budgetReached;
+            StreamingStats m_stats;
+            // requests for the worker and what it read, under m_mutex
+            std::mutex m_mutex;
+            std::condition_variable_any m_condition;
+            std::deque<Load> m_requests;
+            std::deque<Load> m_loaded;
+            std::jthread m_worker;
+    };
+}
+
+#endif
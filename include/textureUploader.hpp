@@ -0,0 +1,41 @@
+#ifndef TEXTUREUPLOADER_HPP
+#define TEXTUREUPLOADER_HPP
+
+#include "texture.hpp"
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    /**
+        Records the uploads of a set of textures in one command buffer:
+        one barrier array to the transfer layout, every copy, the mip chains, then one barrier array to the shader layout.
+        The chains are blitted level by level, each level of every texture being read once its own copy or blit is done.
+        The batch is submitted once and waited on with a fence instead of idling the queue per command.
+    */
+    class TextureUploader {
+        public:
+            TextureUploader(vk::Device device, vk::CommandPool commandPool, vk::Queue queue);
+            // the texture image has to be created, its staging buffer has to stay alive until submit returns
+            void add(const Texture& texture);
+            // blocks until the textures are in the shader read only layout
+            void submit();
+            size_t getTextureCount() const;
+        private:
+            struct Upload {
+                vk::Buffer staging;
+                vk::Image image;
+                vk::Extent3D extent;
+                uint32_t mipLevels;
+                std::vector<vk::BufferImageCopy> regions;
+                // the levels below the first are blitted rather than copied
+                bool blitMips;
+            };
+
+            vk::Device m_device;
+            vk::CommandPool m_commandPool;
+            vk::Queue m_queue;
+            std::vector<Upload> m_uploads;
+    };
+}
+
+#endif
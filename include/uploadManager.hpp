@@ -0,0 +1,164 @@
+#ifndef UPLOADMANAGER_HPP
+#define UPLOADMANAGER_HPP
+
+#include "buffer.hpp"
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace be {
+    // 64 MiB
+    constexpr vk::DeviceSize DEFAULT_STAGING_CAPACITY = 64ull << 20;
+    // 8 MiB
+    constexpr vk::DeviceSize DEFAULT_FRAME_UPLOAD_BUDGET = 8ull << 20;
+
+    struct UploadStats {
+        size_t bytesUploaded;
+        size_t submissions;
+        // waits on an older submission to free staging space
+        size_t stalls;
+        double stallMilliseconds;
+        // flushes that left work for the next frame, because of the budget or a full ring
+        size_t deferredFlushes;
+        size_t pendingBytes;
+        // time spent copying into the staging ring and recording
+        double recordMilliseconds;
+    };
+
+    /**
+        Uploads through a persistently mapped staging ring.
+        Writes are queued with a copy of their data and moved to the ring by flush, at most the frame budget at a time;
+        each flush records one command buffer and submits it on the upload queue, a dedicated transfer queue when the device has one.
+        Every submission signals the next value of a timeline semaphore, its ring space is reclaimed once that value is reached.
+        The graphics submit only waits on the value returned by recordAcquires: the submissions writing buffers, which the frames may already read,
+        and those of the images taken with acquire. The other copies go on while the frames render.
+        On a dedicated queue the destination buffers are concurrent between the two families, see getSharingMode,
+        and the images are released with a queue family ownership transfer, acquired when they are taken.
+        Writes larger than the ring are split, buffers by bytes and images by rows of texels or blocks.
+    */
+    class UploadManager {
+        public:
+            UploadManager();
+            void init(
+                vk::Device device,
+                vk::PhysicalDevice physicalDevice,
+                be::MemoryAllocator& allocator,
+                vk::Queue queue,
+                uint32_t queueFamily,
+                uint32_t graphicsQueueFamily,
+                vk::DeviceSize capacity = DEFAULT_STAGING_CAPACITY
+            );
+            // the returned request is what isComplete and acquire take, 0 for no data, the buffer has to be created with getSharingMode and getQueueFamilies
+            uint64_t enqueueBuffer(const be::Buffer& destination, std::span<const std::byte> data, vk::DeviceSize destinationOffset = 0);
+            template<typename T>
+            uint64_t enqueueBuffer(const be::Buffer& destination, std::span<const T> data, vk::DeviceSize destinationOffset = 0);
+            // replaces a whole mip level, which ends in the shader read only layout, block compressed levels go by rows of blocks
+            uint64_t enqueueImage(vk::Image image, uint32_t mipLevel, vk::Extent3D extent, vk::Format format, std::span<const std::byte> data);
+            // the request is submitted and the transfer queue is done with it
+            bool isComplete(uint64_t request) const;
+            // the graphics submits from the next one wait on the image of a submitted request, the next acquires it on a dedicated queue
+            void acquire(uint64_t request);
+            // moves at most the frame budget to the ring and submits it, never waits
+            void flush();
+            // submits everything queued and waits for it
+            void finish();
+            /**
+                Records the acquires of the images taken since the last call, before their first use in graphics commands,
+                and returns the timeline value the graphics submit has to wait on. It never decreases, so a frame does not overtake
+                the copies an earlier frame waited on, and it is already reached unless a buffer was written since.
+            */
+            uint64_t recordAcquires(vk::CommandBuffer commandBuffer);
+            vk::Semaphore getTimeline() const;
+            bool usesDedicatedQueue() const;
+            // concurrent on a dedicated queue, the buffers written by the transfer queue while the frames read them need no ownership transfer
+            vk::SharingMode getSharingMode() const;
+            std::span<const uint32_t> getQueueFamilies() const;
+            void setFrameBudget(vk::DeviceSize budget);
+            vk::DeviceSize getFrameBudget() const;
+            bool hasPendingUploads() const;
+            const UploadStats& getStats() const;
+            void clean();
+        private:
+            struct Request {
+                uint64_t id;
+                vk::Buffer buffer;
+                vk::DeviceSize bufferOffset;
+                // null for a buffer write
+                vk::Image image;
+                uint32_t mipLevel;
+                vk::Extent3D extent;
+                vk::Format format;
+                std::vector<std::byte> data;
+                // bytes already moved to the ring
+                vk::DeviceSize uploaded;
+            };
+
+            struct Submission {
+                uint64_t value;
+                vk::CommandBuffer commandBuffer;
+                // ring offset after the last allocation and bytes to give back, wrapping included
+                vk::DeviceSize end;
+                vk::DeviceSize bytes;
+                // requests completed by the submission, none when the first is after the last
+                uint64_t firstRequest;
+                uint64_t lastRequest;
+                bool writesBuffers;
+            };
+
+            // a copied image and, on a dedicated queue, the acquire half of its ownership transfer
+            struct Release {
+                uint64_t request;
+                vk::ImageMemoryBarrier2 acquire;
+            };
+
+            void upload(vk::DeviceSize budget, bool wait);
+            // false when the ring has no contiguous room for size bytes
+            bool allocate(vk::DeviceSize size, vk::DeviceSize& offset);
+            void reclaim(bool waitOldest);
+            void beginSubmission();
+            void endSubmission();
+            // on a dedicated queue the release barrier, otherwise the final layout transition
+            void releaseImage(const Request& request);
+            // value of the submission completing a submitted request, 0 once it is reclaimed
+            uint64_t getValue(uint64_t request) const;
+
+            vk::Device m_device;
+            vk::Queue m_queue;
+            uint32_t m_queueFamily;
+            uint32_t m_graphicsQueueFamily;
+            vk::CommandPool m_commandPool;
+            vk::Semaphore m_timeline;
+            std::array<uint32_t, 2> m_queueFamilies;
+            uint64_t m_submittedValue;
+            uint64_t m_nextRequest;
+            uint64_t m_submittedRequest;
+            // value of the last submission writing buffers or of the latest image acquired
+            uint64_t m_waitValue;
+            std::vector<Release> m_releases;
+            std::vector<vk::ImageMemoryBarrier2> m_imageAcquires;
+            be::Buffer m_ring;
+            vk::DeviceSize m_capacity;
+            vk::DeviceSize m_alignment;
+            vk::DeviceSize m_head;
+            vk::DeviceSize m_tail;
+            vk::DeviceSize m_used;
+            vk::DeviceSize m_frameBudget;
+            std::deque<Request> m_pending;
+            std::deque<Submission> m_inFlight;
+            std::vector<Submission> m_free;
+            // being recorded
+            Submission m_current;
+            bool m_recording;
+            UploadStats m_stats;
+    };
+}
+
+template<typename T>
+uint64_t be::UploadManager::enqueueBuffer(const be::Buffer& destination, std::span<const T> data, vk::DeviceSize destinationOffset) {
+    return enqueueBuffer(destination, std::as_bytes(data), destinationOffset);
+}
+
+#endif
@@ -1,14 +1,18 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
+#include "memoryAllocator.hpp"
+#include <string_view>
+#include <utility>
 #include <vulkan/vulkan.hpp>
 
 uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::PhysicalDevice physicalDevice);
 vk::CommandBuffer beginSingleTimeCommands(vk::Device device, vk::CommandPool commandPool);
 void endSingleTimeCommands(vk::Device device, vk::CommandPool commandPool, vk::CommandBuffer commandBuffer, vk::Queue graphicsQueue);
 vk::Format findSupportedFormat(vk::PhysicalDevice physicalDevice, const std::vector<vk::Format>& formats, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
-std::tuple<vk::DeviceMemory, vk::Image> createImage(
+// the image memory comes from allocator, name shows in its leak report
+std::tuple<be::Allocation, vk::Image> createImage(
     vk::Device device,
-    vk::PhysicalDevice physicalDevice,
+    be::MemoryAllocator& allocator,
     vk::ImageType type,
     vk::Format format,
     vk::Extent3D extent,
@@ -18,8 +22,23 @@ std::tuple<vk::DeviceMemory, vk::Image> createImage(
     vk::ImageTiling tiling,
     vk::ImageUsageFlags usage,
     vk::SharingMode sharingMode,
-    vk::MemoryPropertyFlags properties
+    be::MemoryUsage memoryUsage,
+    std::string_view name
 );
 
-vk::ImageView createImageView(vk::Device device, vk::Image image, vk::ImageViewType type, vk::Format format, vk::ImageSubresourceRange imageSubresourceRange);
+vk::ImageView createImageView(
+    vk::Device device,
+    vk::Image image,
+    vk::ImageViewType type,
+    vk::Format format,
+    vk::ImageSubresourceRange imageSubresourceRange,
+    vk::ComponentMapping components = {}
+);
+// the stages and accesses that use an image in layout, on both sides of the barriers entering or leaving it
+std::pair<vk::PipelineStageFlags2, vk::AccessFlags2> getLayoutSynchronization(vk::ImageLayout layout);
+vk::ImageMemoryBarrier2 createImageBarrier(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::ImageSubresourceRange range);
+// true when the optimal tiling of format can be blitted to itself with a linear filter
+bool supportsLinearBlit(vk::PhysicalDevice physicalDevice, vk::Format format);
+// true when the optimal tiling of format can be filled and moved by copies and sampled with a linear filter
+bool supportsSampledCopies(vk::PhysicalDevice physicalDevice, vk::Format format);
 #endif
\ No newline at end of file
@@ -5,9 +5,20 @@
 #include <glm/gtx/hash.hpp>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 
+namespace be {
+    enum class VertexFormat {
+        // 48 bytes, every attribute as 32 bit values
+        full,
+        // 16 bytes, see PackedVertex
+        packed
+    };
+}
+
 struct Vertex {
     glm::vec3 pos;
     glm::vec3 color;
@@ -16,18 +27,34 @@ struct Vertex {
     int indexMat;
 
     bool operator==(const Vertex&) const = default;
-    static vk::VertexInputBindingDescription getBindingDescription();
-    static std::array<vk::VertexInputAttributeDescription, 5> getAttributeDescriptions();
+    uint64_t hash() const;
+    static vk::VertexInputBindingDescription getBindingDescription(be::VertexFormat format = be::VertexFormat::full);
+    static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions(be::VertexFormat format = be::VertexFormat::full);
 };
 
+/**
+    Compact vertex for static meshes without vertex colors.
+    Positions are quantized relative to the mesh bounds, the matching transform is given by getDequantization.
+    The position is fetched as four components so indexMat is read as the w channel and ignored.
+*/
+struct PackedVertex {
+    std::array<uint16_t, 3> pos;
+    int16_t indexMat;
+    // octahedral encoding
+    std::array<int16_t, 2> normal;
+    // half floats
+    std::array<uint16_t, 2> texCoord;
+
+    static PackedVertex pack(const Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    static glm::mat4 getDequantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+};
+
+static_assert(sizeof(PackedVertex) == 16);
+
 template<>
 struct std::hash<Vertex> {
     size_t operator()(const Vertex& vertex) const noexcept{
-        return (hash<glm::vec3>()(vertex.pos) ^
-                ((hash<glm::vec3>()(vertex.color) << 1) ^
-                ((hash<glm::vec3>()(vertex.normal) >> 1) ^
-                (hash<glm::vec2>()(vertex.texCoord) << 1) >> 1))) ^
-                hash<int>()(vertex.indexMat);
+        return vertex.hash();
     }
 };
 
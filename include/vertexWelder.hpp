@@ -0,0 +1,45 @@
+#ifndef VERTEXWELDER_HPP
+#define VERTEXWELDER_HPP
+
+#include "vertex.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace be {
+    struct WeldStats {
+        size_t lookups = 0;
+        size_t uniqueVertices = 0;
+        size_t collisions = 0;
+        size_t totalProbes = 0;
+        size_t maxProbeLength = 0;
+        size_t capacity = 0;
+    };
+
+    /**
+        Flat open addressing table merging identical vertices with a single find-or-insert.
+        With a non-zero epsilon, every attribute is snapped on a grid of that size before comparison,
+        so vertices closer than epsilon are welded unless they fall on both sides of a grid line.
+    */
+    class VertexWelder {
+        public:
+            VertexWelder() = delete;
+            VertexWelder(size_t expectedVertices, float epsilon = 0);
+            uint32_t findOrInsert(const Vertex& vertex);
+            const std::vector<Vertex>& getVertices() const;
+            std::vector<Vertex> releaseVertices();
+            const WeldStats& getStats() const;
+        private:
+            static constexpr uint32_t EMPTY = UINT32_MAX;
+            Vertex snap(const Vertex& vertex) const;
+            void rehash(size_t capacity);
+            std::vector<Vertex> m_vertices;
+            std::vector<uint32_t> m_slots;
+            std::vector<uint32_t> m_hashes;
+            size_t m_mask;
+            float m_epsilon;
+            WeldStats m_stats;
+    };
+}
+
+#endif
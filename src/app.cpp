@@ -32,6 +32,8 @@ void App::run() {
 		previousTime = currentTime;
 		isRunning = window.loop();
 		handler.event(window, camera, deltaTime.count());	
+		if (handler.consumePickRequest())
+			engine.pick(window.getCursorPos());
 		engine.drawFrame(deltaTime.count());
 	}
 	engine.cleanUp();
@@ -0,0 +1,231 @@
+#include "bindlessTable.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+be::BindlessTable::BindlessTable() :
+    m_device(nullptr),
+    m_framesInFlight(1),
+    m_frameCount(0)
+{}
+
+void be::BindlessTable::init(
+    vk::Device device,
+    vk::PhysicalDevice physicalDevice,
+    size_t framesInFlight,
+    vk::DescriptorImageInfo fallbackTexture,
+    const be::Buffer& fallbackBuffer,
+    uint32_t reservedResources,
+    uint32_t textureCapacity,
+    uint32_t bufferCapacity
+) {
+    m_device = device;
+    m_framesInFlight = framesInFlight;
+    vk::PhysicalDeviceVulkan12Properties limits = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>().get<vk::PhysicalDeviceVulkan12Properties>();
+    bufferCapacity = std::max(std::min({
+        bufferCapacity,
+        limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+        limits.maxDescriptorSetUpdateAfterBindStorageBuffers
+    }), 1u);
+    // the layout takes the largest texture count, a combined image sampler counts as a sampler and as a sampled image
+    uint32_t maxTextures = std::min({
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+        limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        limits.maxDescriptorSetUpdateAfterBindSamplers,
+        limits.maxDescriptorSetUpdateAfterBindSampledImages
+    });
+    if (limits.maxPerStageUpdateAfterBindResources > bufferCapacity + reservedResources)
+        maxTextures = std::min(maxTextures, limits.maxPerStageUpdateAfterBindResources - bufferCapacity - reservedResources);
+    maxTextures = std::max(maxTextures, 1u);
+    // the sets are allocated with the capacity
+    textureCapacity = std::max(std::min(textureCapacity, maxTextures), 1u);
+
+    std::vector bindings = {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, bufferCapacity, vk::ShaderStageFlagBits::eAll),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, maxTextures, vk::ShaderStageFlagBits::eAll)
+    };
+    vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    std::vector<vk::DescriptorBindingFlags> flags = {
+        bindingFlags,
+        // only the last binding can have a variable count
+        bindingFlags | vk::DescriptorBindingFlagBits::eVariableDescriptorCount
+    };
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo(flags);
+    m_layout = m_device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo(
+        vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+        bindings,
+        &bindingFlagsInfo
+    ));
+
+    std::vector poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, bufferCapacity * framesInFlight),
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, textureCapacity * framesInFlight)
+    };
+    m_pool = m_device.createDescriptorPool(vk::DescriptorPoolCreateInfo(
+        vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+        framesInFlight,
+        poolSizes
+    ));
+    std::vector layouts = std::vector<vk::DescriptorSetLayout>(framesInFlight, m_layout);
+    std::vector counts = std::vector<uint32_t>(framesInFlight, textureCapacity);
+    vk::DescriptorSetVariableDescriptorCountAllocateInfo countInfo = vk::DescriptorSetVariableDescriptorCountAllocateInfo(counts);
+    m_sets = m_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(m_pool, layouts, &countInfo));
+
+    m_buffers.fallback = vk::DescriptorBufferInfo(fallbackBuffer.getBuffer(), 0, vk::WholeSize);
+    m_textures.fallback = fallbackTexture;
+    initSlots(m_buffers, bufferCapacity, 0, vk::DescriptorType::eStorageBuffer);
+    initSlots(m_textures, textureCapacity, 1, vk::DescriptorType::eCombinedImageSampler);
+}
+
+template<typename Info>
+void be::BindlessTable::initSlots(Slots<Info>& slots, uint32_t capacity, uint32_t binding, vk::DescriptorType type) {
+    slots.infos.assign(capacity, slots.fallback);
+    // popped from the back, the first index comes out first
+    for (uint32_t index = capacity; index > 0; index--)
+        slots.freeIndices.push_back(index - 1);
+    for (uint32_t first = 0; first < capacity; first += BINDLESS_TEMPLATE_BLOCK) {
+        vk::DescriptorUpdateTemplateEntry entry = vk::DescriptorUpdateTemplateEntry(
+            binding,
+            first,
+            std::min(BINDLESS_TEMPLATE_BLOCK, capacity - first),
+            type,
+            0,
+            sizeof(Info)
+        );
+        slots.templates.push_back(m_device.createDescriptorUpdateTemplate(vk::DescriptorUpdateTemplateCreateInfo(
+            {},
+            1,
+            &entry,
+            vk::DescriptorUpdateTemplateType::eDescriptorSet,
+            m_layout
+        )));
+    }
+    // the sets start empty, every block is written with the first update of each frame
+    slots.dirty.assign(m_framesInFlight, std::vector<bool>(slots.templates.size(), true));
+}
+
+uint32_t be::BindlessTable::addTexture(vk::ImageView view, vk::Sampler sampler) {
+    return add(m_textures, vk::DescriptorImageInfo(sampler, view, vk::ImageLayout::eShaderReadOnlyOptimal));
+}
+
+uint32_t be::BindlessTable::addBuffer(const be::Buffer& buffer) {
+    return add(m_buffers, vk::DescriptorBufferInfo(buffer.getBuffer(), 0, buffer.getSize()));
+}
+
+template<typename Info>
+uint32_t be::BindlessTable::add(Slots<Info>& slots, const Info& info) {
+    if (slots.freeIndices.empty())
+        throw std::runtime_error("The bindless table is full.");
+    uint32_t index = slots.freeIndices.back();
+    slots.freeIndices.pop_back();
+    write(slots, index, info);
+    return index;
+}
+
+void be::BindlessTable::replaceTexture(uint32_t index, vk::ImageView view, vk::Sampler sampler) {
+    write(m_textures, index, vk::DescriptorImageInfo(sampler, view, vk::ImageLayout::eShaderReadOnlyOptimal));
+}
+
+void be::BindlessTable::replaceBuffer(uint32_t index, const be::Buffer& buffer) {
+    write(m_buffers, index, vk::DescriptorBufferInfo(buffer.getBuffer(), 0, buffer.getSize()));
+}
+
+void be::BindlessTable::replaceImageView(vk::ImageView oldView, vk::ImageView newView) {
+    if (m_textures.fallback.imageView == oldView)
+        m_textures.fallback.imageView = newView;
+    for (uint32_t index = 0; index < m_textures.infos.size(); index++) {
+        if (m_textures.infos[index].imageView != oldView)
+            continue;
+        vk::DescriptorImageInfo info = m_textures.infos[index];
+        info.imageView = newView;
+        write(m_textures, index, info);
+    }
+}
+
+void be::BindlessTable::replaceBuffer(vk::Buffer oldBuffer, vk::Buffer newBuffer) {
+    if (m_buffers.fallback.buffer == oldBuffer)
+        m_buffers.fallback.buffer = newBuffer;
+    for (uint32_t index = 0; index < m_buffers.infos.size(); index++) {
+        if (m_buffers.infos[index].buffer != oldBuffer)
+            continue;
+        vk::DescriptorBufferInfo info = m_buffers.infos[index];
+        info.buffer = newBuffer;
+        write(m_buffers, index, info);
+    }
+}
+
+template<typename Info>
+void be::BindlessTable::write(Slots<Info>& slots, uint32_t index, const Info& info) {
+    if (index >= slots.infos.size())
+        throw std::runtime_error("Bindless index out of range.");
+    slots.infos[index] = info;
+    for (std::vector<bool>& dirty : slots.dirty)
+        dirty[index / BINDLESS_TEMPLATE_BLOCK] = true;
+}
+
+void be::BindlessTable::removeTexture(uint32_t index) {
+    remove(m_textures, index);
+}
+
+void be::BindlessTable::removeBuffer(uint32_t index) {
+    remove(m_buffers, index);
+}
+
+template<typename Info>
+void be::BindlessTable::remove(Slots<Info>& slots, uint32_t index) {
+    write(slots, index, slots.fallback);
+    slots.retired.push_back({index, m_frameCount});
+}
+
+void be::BindlessTable::update(size_t frame) {
+    m_frameCount++;
+    flush(m_buffers, frame);
+    flush(m_textures, frame);
+}
+
+template<typename Info>
+void be::BindlessTable::flush(Slots<Info>& slots, size_t frame) {
+    // the frame recorded before a removal was the last to see the index, and its slot comes back framesInFlight frames later
+    std::erase_if(slots.retired, [&](const std::pair<uint32_t, uint64_t>& retired) {
+        if (m_frameCount < retired.second + m_framesInFlight)
+            return false;
+        slots.freeIndices.push_back(retired.first);
+        return true;
+    });
+    for (size_t block = 0; block < slots.templates.size(); block++) {
+        if (!slots.dirty[frame][block])
+            continue;
+        m_device.updateDescriptorSetWithTemplate(m_sets[frame], slots.templates[block], static_cast<const void*>(slots.infos.data() + block * BINDLESS_TEMPLATE_BLOCK));
+        slots.dirty[frame][block] = false;
+    }
+}
+
+const vk::DescriptorSetLayout& be::BindlessTable::getLayout() const {
+    return m_layout;
+}
+
+vk::DescriptorSet be::BindlessTable::getSet(size_t frame) const {
+    return m_sets[frame];
+}
+
+uint32_t be::BindlessTable::getTextureCapacity() const {
+    return m_textures.infos.size();
+}
+
+uint32_t be::BindlessTable::getBufferCapacity() const {
+    return m_buffers.infos.size();
+}
+
+template<typename Info>
+void be::BindlessTable::destroyTemplates(Slots<Info>& slots) {
+    for (vk::DescriptorUpdateTemplate updateTemplate : slots.templates)
+        m_device.destroyDescriptorUpdateTemplate(updateTemplate);
+    slots = {};
+}
+
+void be::BindlessTable::clean() {
+    destroyTemplates(m_buffers);
+    destroyTemplates(m_textures);
+    m_device.destroyDescriptorPool(m_pool);
+    m_device.destroyDescriptorSetLayout(m_layout);
+    m_sets.clear();
+}
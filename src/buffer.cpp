@@ -5,45 +5,78 @@ be::Buffer::Buffer() :
     m_buffer(nullptr),
     m_device(nullptr),
     m_size(0),
-    m_memory(nullptr)
+    m_usage(),
+    m_sharingMode(vk::SharingMode::eExclusive),
+    m_allocator(nullptr),
+    m_memoryUsage(be::MemoryUsage::gpuOnly),
+    m_allocation({}),
+    m_data(nullptr)
 {}
 
 be::Buffer::Buffer(vk::Device device, vk::DeviceSize size) :
     m_buffer(nullptr),
     m_device(device),
     m_size(size),
-    m_memory(nullptr)
+    m_usage(),
+    m_sharingMode(vk::SharingMode::eExclusive),
+    m_allocator(nullptr),
+    m_memoryUsage(be::MemoryUsage::gpuOnly),
+    m_allocation({}),
+    m_data(nullptr)
 {}
 
 be::Buffer::Buffer(const Buffer& another) :
     m_buffer(another.m_buffer),
     m_device(another.m_device),
     m_size(another.m_size),
-    m_memory(another.m_memory)
+    m_usage(another.m_usage),
+    m_sharingMode(another.m_sharingMode),
+    m_queueFamilies(another.m_queueFamilies),
+    m_allocator(another.m_allocator),
+    m_memoryUsage(another.m_memoryUsage),
+    m_name(another.m_name),
+    m_allocation(another.m_allocation),
+    m_data(another.m_data)
 {}
 
 be::Buffer::Buffer(Buffer&& another) :
     m_buffer(std::move(another.m_buffer)),
     m_device(std::move(another.m_device)),
     m_size(std::move(another.m_size)),
-    m_memory(std::move(another.m_memory))
+    m_usage(another.m_usage),
+    m_sharingMode(another.m_sharingMode),
+    m_queueFamilies(std::move(another.m_queueFamilies)),
+    m_allocator(another.m_allocator),
+    m_memoryUsage(another.m_memoryUsage),
+    m_name(std::move(another.m_name)),
+    m_allocation(another.m_allocation),
+    m_data(another.m_data)
 {
 	another.m_buffer = VK_NULL_HANDLE;
 	another.m_device = VK_NULL_HANDLE;
 	another.m_size = 0;
-	another.m_memory = VK_NULL_HANDLE;
+	another.m_allocator = nullptr;
+	another.m_allocation = {};
+	another.m_data = nullptr;
 }
 
 be::Buffer& be::Buffer::operator=(const Buffer& another) {
     if (m_buffer != nullptr) {
         m_device.destroyBuffer(m_buffer);
-        m_device.freeMemory(m_memory);    
+        m_allocator->free(m_allocation);
     }
 
     m_buffer = another.m_buffer;
     m_device = another.m_device;
     m_size = another.m_size;
-    m_memory = another.m_memory;
+    m_usage = another.m_usage;
+    m_sharingMode = another.m_sharingMode;
+    m_queueFamilies = another.m_queueFamilies;
+    m_allocator = another.m_allocator;
+    m_memoryUsage = another.m_memoryUsage;
+    m_name = another.m_name;
+    m_allocation = another.m_allocation;
+    m_data = another.m_data;
 
     return *this;
 }
@@ -56,8 +89,17 @@ be::Buffer& be::Buffer::operator=(Buffer&& another) {
 		another.m_device = VK_NULL_HANDLE;
 		m_size = another.m_size;
 		another.m_size = 0;
-		m_memory = another.m_memory;
-		another.m_memory = VK_NULL_HANDLE;
+		m_usage = another.m_usage;
+		m_sharingMode = another.m_sharingMode;
+		m_queueFamilies = std::move(another.m_queueFamilies);
+		m_allocator = another.m_allocator;
+		another.m_allocator = nullptr;
+		m_memoryUsage = another.m_memoryUsage;
+		m_name = std::move(another.m_name);
+		m_allocation = another.m_allocation;
+		another.m_allocation = {};
+		m_data = another.m_data;
+		another.m_data = nullptr;
     }
     return *this;
 }
@@ -66,29 +108,42 @@ bool be::Buffer::operator==(const Buffer& another) const {
 	return m_buffer == another.m_buffer
 			&& m_device == another.m_device
 			&& m_size == another.m_size
-			&& m_memory == another.m_memory;
+			&& m_allocation.memory == another.m_allocation.memory
+			&& m_allocation.offset == another.m_allocation.offset;
 }
 
 bool be::Buffer::operator!=(const Buffer& another) const {
 	return !(*this == another);
 }
-void be::Buffer::create(vk::BufferUsageFlags usage, vk::SharingMode sharingMode, vk::PhysicalDevice physicalDevice) {
+void be::Buffer::create(vk::BufferUsageFlags usage, vk::SharingMode sharingMode, be::MemoryAllocator& allocator, be::MemoryUsage memoryUsage, std::string_view name, std::span<const uint32_t> queueFamilies) {
+	// device local buffers can be moved by the defragmenter, which copies them
+	if (memoryUsage == be::MemoryUsage::gpuOnly)
+		usage |= vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+	m_usage = usage;
+	m_sharingMode = sharingMode;
+	m_queueFamilies.assign(queueFamilies.begin(), queueFamilies.end());
+	m_allocator = &allocator;
+	m_memoryUsage = memoryUsage;
+	m_name = name;
     vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo(
 		{},
 		m_size,
 		usage,
-		sharingMode
+		sharingMode,
+		m_queueFamilies
 	);
 	m_buffer = m_device.createBuffer(bufferInfo);
+	m_allocation = allocator.allocateBuffer(m_buffer, memoryUsage, name);
+}
 
-	vk::MemoryRequirements memoryRequirements = m_device.getBufferMemoryRequirements(m_buffer);
-	vk::MemoryAllocateInfo memoryAllocateInfo = vk::MemoryAllocateInfo(
-		memoryRequirements.size,
-		findMemoryType(memoryRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, physicalDevice)
-	);
-	
-	m_memory = m_device.allocateMemory(memoryAllocateInfo);
-    m_device.bindBufferMemory(m_buffer, m_memory, 0);
+std::pair<vk::Buffer, be::Allocation> be::Buffer::relocate(vk::CommandBuffer commandBuffer) {
+	std::pair<vk::Buffer, be::Allocation> old = {m_buffer, m_allocation};
+	m_buffer = m_device.createBuffer(vk::BufferCreateInfo({}, m_size, m_usage, m_sharingMode, m_queueFamilies));
+	m_allocation = m_allocator->allocateBuffer(m_buffer, m_memoryUsage, m_name);
+	if (m_data != nullptr)
+		m_data = m_allocation.data;
+	commandBuffer.copyBuffer(old.first, m_buffer, vk::BufferCopy(0, 0, m_size));
+	return old;
 }
 
 void be::Buffer::copyBuffer(be::Buffer& stagingBuffer, vk::CommandPool commandPool, vk::Queue graphicsQueue) {
@@ -119,7 +174,13 @@ void be::Buffer::copyBuffer(be::Buffer& stagingBuffer, vk::CommandPool commandPo
 }
 
 void be::Buffer::map() {
-	m_data = m_device.mapMemory(m_memory, 0, m_size);
+	if (m_allocation.data == nullptr)
+		throw std::runtime_error("The buffer memory is not host visible!");
+	m_data = m_allocation.data;
+}
+
+void be::Buffer::write(const void* data, vk::DeviceSize size, vk::DeviceSize offset) {
+	memcpy(static_cast<std::byte*>(m_data) + offset, data, size);
 }
 
 const vk::Buffer& be::Buffer::getBuffer() const {
@@ -130,8 +191,13 @@ vk::DeviceSize be::Buffer::getSize() const {
 	return m_size;
 }
 
+const be::Allocation& be::Buffer::getAllocation() const {
+	return m_allocation;
+}
+
 
 void be::Buffer::clean(){
     m_device.destroyBuffer(m_buffer);
-    m_device.freeMemory(m_memory);
+    if (m_allocator != nullptr)
+        m_allocator->free(m_allocation);
 }
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "bvh.hpp"
+#include "parallel.hpp"
+#include <numeric>
+
+namespace {
+    const uint32_t SAH_BINS = 12;
+    // below this size a subtree is not worth a task of its own
+    const uint32_t PARALLEL_SUBTREE_SIZE = 1024;
+
+    struct Subtree {
+        uint32_t node;
+        uint32_t first;
+        uint32_t count;
+        uint32_t depth;
+    };
+
+    struct Bin {
+        be::Aabb box;
+        uint32_t count = 0;
+    };
+
+    struct Split {
+        int axis = -1;
+        uint32_t bin = 0;
+        float cost = INFINITY;
+    };
+
+    /**
+        Recursive SAH build writing in its own pair array, the root being node 0.
+        When subtrees is set, the nodes smaller than deferSize are left as leaves and queued instead.
+    */
+    struct Builder {
+        std::span<const be::Aabb> bounds;
+        std::span<const glm::vec3> centroids;
+        std::span<uint32_t> indices;
+        std::vector<be::BvhNodePair>& pairs;
+        std::vector<Subtree>* subtrees;
+        uint32_t deferSize;
+        uint32_t depth = 0;
+
+        be::BvhNode& node(uint32_t index) {
+            return pairs[index >> 1].nodes[index & 1];
+        }
+
+        Split findSplit(uint32_t first, uint32_t count, const be::Aabb& centroidBox, float nodeArea) const {
+            Split best;
+            glm::vec3 extent = centroidBox.max - centroidBox.min;
+            for (int axis = 0; axis < 3; axis++) {
+                if (extent[axis] <= 0)
+                    continue;
+                std::array<Bin, SAH_BINS> bins;
+                float scale = SAH_BINS / extent[axis];
+                for (uint32_t i = first; i < first + count; i++) {
+                    uint32_t primitive = indices[i];
+                    uint32_t b = std::min<uint32_t>(SAH_BINS - 1, (centroids[primitive][axis] - centroidBox.min[axis]) * scale);
+                    bins[b].box.grow(bounds[primitive]);
+                    bins[b].count++;
+                }
+                // cost of every plane between two bins, swept from both sides
+                std::array<float, SAH_BINS - 1> leftCosts;
+                be::Aabb leftBox;
+                uint32_t leftCount = 0;
+                for (uint32_t b = 0; b + 1 < SAH_BINS; b++) {
+                    leftBox.grow(bins[b].box);
+                    leftCount += bins[b].count;
+                    leftCosts[b] = leftCount == 0 ? 0 : leftCount * leftBox.area();
+                }
+                be::Aabb rightBox;
+                uint32_t rightCount = 0;
+                for (uint32_t b = SAH_BINS - 1; b > 0; b--) {
+                    rightBox.grow(bins[b].box);
+                    rightCount += bins[b].count;
+                    if (rightCount == 0 || rightCount == count)
+                        continue;
+                    float cost = 1 + (leftCosts[b - 1] + rightCount * rightBox.area()) / std::max(nodeArea, 1e-20f);
+                    if (cost < best.cost)
+                        best = {axis, b, cost};
+                }
+            }
+            return best;
+        }
+
+        void build(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t nodeDepth) {
+            depth = std::max(depth, nodeDepth);
+            be::Aabb box, centroidBox;
+            for (uint32_t i = first; i < first + count; i++) {
+                box.grow(bounds[indices[i]]);
+                centroidBox.grow(centroids[indices[i]]);
+            }
+            be::BvhNode& current = node(nodeIndex);
+            current = {box.min, first, box.max, count};
+            if (count <= 1 || nodeDepth + 1 >= be::BVH_MAX_DEPTH)
+                return;
+            if (subtrees && count <= deferSize) {
+                subtrees->push_back({nodeIndex, first, count, nodeDepth});
+                return;
+            }
+
+            Split split = findSplit(first, count, centroidBox, box.area());
+            // a leaf costs one intersection per primitive
+            if (split.axis < 0 || (split.cost >= count && count <= be::BVH_MAX_LEAF_SIZE))
+                return;
+            int axis = split.axis;
+            float scale = SAH_BINS / (centroidBox.max[axis] - centroidBox.min[axis]);
+            auto middle = std::partition(indices.begin() + first, indices.begin() + first + count, [&](uint32_t primitive) {
+                return std::min<uint32_t>(SAH_BINS - 1, (centroids[primitive][axis] - centroidBox.min[axis]) * scale) < split.bin;
+            });
+            uint32_t leftCount = middle - (indices.begin() + first);
+            if (leftCount == 0 || leftCount == count)
+                return;
+
+            uint32_t child = 2 * pairs.size();
+            pairs.push_back({});
+            node(nodeIndex).leftFirst = child;
+            node(nodeIndex).count = 0;
+            build(child, first, leftCount, nodeDepth + 1);
+            build(child + 1, first + leftCount, count - leftCount, nodeDepth + 1);
+        }
+    };
+}
+
+void be::Aabb::grow(const glm::vec3& point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void be::Aabb::grow(const Aabb& box) {
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+}
+
+float be::Aabb::area() const {
+    glm::vec3 extent = max - min;
+    if (extent.x < 0)
+        return 0;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+glm::vec3 be::Aabb::center() const {
+    return (min + max) * 0.5f;
+}
+
+bool be::Aabb::overlaps(const Aabb& box) const {
+    return glm::all(glm::lessThanEqual(min, box.max)) && glm::all(glm::lessThanEqual(box.min, max));
+}
+
+be::Ray be::Ray::fromClip(const glm::mat4& clip, const glm::vec2& ndc) {
+    glm::mat4 inverse = glm::inverse(clip);
+    glm::vec4 nearPoint = inverse * glm::vec4(ndc, 0, 1);
+    glm::vec4 farPoint = inverse * glm::vec4(ndc, 1, 1);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    return {origin, glm::normalize(glm::vec3(farPoint) / farPoint.w - origin)};
+}
+
+float be::intersectBox(const Ray& ray, const Aabb& box, float maxDistance) {
+    glm::vec3 inverseDirection = 1.f / ray.direction;
+    glm::vec3 t0 = (box.min - ray.origin) * inverseDirection;
+    glm::vec3 t1 = (box.max - ray.origin) * inverseDirection;
+    glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+    float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.f));
+    float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+    return enter <= exit ? enter : INFINITY;
+}
+
+float be::intersectTriangle(const Ray& ray, const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+    // Moller-Trumbore, the barycentric coordinates are solved with Cramer's rule
+    glm::vec3 edge1 = p1 - p0, edge2 = p2 - p0;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::abs(determinant) < 1e-12f)
+        return INFINITY;
+    float inverseDeterminant = 1 / determinant;
+    glm::vec3 toOrigin = ray.origin - p0;
+    float u = glm::dot(toOrigin, p) * inverseDeterminant;
+    if (u < 0 || u > 1)
+        return INFINITY;
+    glm::vec3 q = glm::cross(toOrigin, edge1);
+    float v = glm::dot(ray.direction, q) * inverseDeterminant;
+    if (v < 0 || u + v > 1)
+        return INFINITY;
+    float distance = glm::dot(edge2, q) * inverseDeterminant;
+    return distance > 0 ? distance : INFINITY;
+}
+
+be::Bvh::Bvh() :
+    m_depth(0)
+{}
+
+void be::Bvh::build(std::span<const Aabb> bounds, bool parallel) {
+    m_pairs.clear();
+    m_primitiveBounds.clear();
+    m_bounds = {};
+    m_depth = 0;
+    m_indices.resize(bounds.size());
+    std::iota(m_indices.begin(), m_indices.end(), 0);
+    if (bounds.empty())
+        return;
+    std::vector<glm::vec3> centroids;
+    centroids.reserve(bounds.size());
+    for (const Aabb& box : bounds)
+        centroids.push_back(box.center());
+
+    // the top levels are split on this thread until there is enough subtrees to keep every core busy
+    std::vector<Subtree> subtrees;
+    size_t workerCount = getWorkerCount();
+    uint32_t deferSize = std::max<uint32_t>(PARALLEL_SUBTREE_SIZE, bounds.size() / (4 * workerCount));
+    m_pairs.push_back({});
+    Builder top = {bounds, centroids, m_indices, m_pairs, parallel && workerCount > 1 ? &subtrees : nullptr, deferSize};
+    top.build(0, 0, bounds.size(), 0);
+    m_depth = top.depth;
+
+    // the biggest subtrees first, parallelFor hands the tasks out in order
+    std::ranges::sort(subtrees, [](const Subtree& a, const Subtree& b) {
+        return a.count > b.count;
+    });
+    std::vector<std::vector<BvhNodePair>> subtreePairs = std::vector<std::vector<BvhNodePair>>(subtrees.size());
+    std::vector<uint32_t> subtreeDepths = std::vector<uint32_t>(subtrees.size());
+    parallelFor(subtrees.size(), [&](size_t i) {
+        subtreePairs[i].push_back({});
+        Builder builder = {bounds, centroids, m_indices, subtreePairs[i], nullptr, 0};
+        builder.build(0, subtrees[i].first, subtrees[i].count, subtrees[i].depth);
+        subtreeDepths[i] = builder.depth;
+    });
+
+    // the local root replaces the queued leaf, the other pairs are appended with their child links moved
+    for (size_t i = 0; i < subtrees.size(); i++) {
+        uint32_t offset = 2 * (m_pairs.size() - 1);
+        auto relocate = [offset](BvhNode child) {
+            if (!child.isLeaf())
+                child.leftFirst += offset;
+            return child;
+        };
+        node(subtrees[i].node) = relocate(subtreePairs[i][0].nodes[0]);
+        for (size_t p = 1; p < subtreePairs[i].size(); p++)
+            m_pairs.push_back({{relocate(subtreePairs[i][p].nodes[0]), relocate(subtreePairs[i][p].nodes[1])}});
+        m_depth = std::max(m_depth, subtreeDepths[i]);
+    }
+
+    const BvhNode& root = getNode(0);
+    m_bounds = {root.min, root.max};
+    m_primitiveBounds.reserve(bounds.size());
+    for (uint32_t primitive : m_indices)
+        m_primitiveBounds.push_back(bounds[primitive]);
+}
+
+void be::Bvh::overlap(const Aabb& box, std::vector<uint32_t>& result) const {
+    result.clear();
+    if (m_pairs.empty())
+        return;
+    std::array<uint32_t, BVH_MAX_DEPTH + 1> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& current = getNode(stack[--stackSize]);
+        if (!box.overlaps({current.min, current.max}))
+            continue;
+        if (current.isLeaf()) {
+            for (uint32_t i = current.leftFirst; i < current.leftFirst + current.count; i++)
+                if (box.overlaps(m_primitiveBounds[i]))
+                    result.push_back(m_indices[i]);
+        } else {
+            stack[stackSize++] = current.leftFirst;
+            stack[stackSize++] = current.leftFirst + 1;
+        }
+    }
+}
+
+void be::Bvh::cull(const Frustum& frustum, std::vector<uint32_t>& result) const {
+    result.clear();
+    if (m_pairs.empty())
+        return;
+    // -1 outside of a plane, 1 inside, 0 crossing it
+    auto classify = [&frustum](const glm::vec3& min, const glm::vec3& max, uint32_t plane) {
+        glm::vec3 center = (min + max) * 0.5f, extent = (max - min) * 0.5f;
+        const glm::vec4& p = frustum.planes[plane];
+        float distance = glm::dot(glm::vec3(p), center) + p.w;
+        float radius = glm::dot(glm::abs(glm::vec3(p)), extent);
+        return distance + radius < 0 ? -1 : (distance - radius >= 0 ? 1 : 0);
+    };
+    // the planes a node is fully inside of are not tested again below it
+    struct StackEntry {
+        uint32_t node;
+        uint32_t planeMask;
+    };
+    std::array<StackEntry, BVH_MAX_DEPTH + 1> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = {0, 0b111111};
+    while (stackSize > 0) {
+        auto [nodeIndex, planeMask] = stack[--stackSize];
+        const BvhNode& current = getNode(nodeIndex);
+        bool outside = false;
+        for (uint32_t plane = 0; plane < 6 && !outside; plane++) {
+            if (!(planeMask & (1u << plane)))
+                continue;
+            int side = classify(current.min, current.max, plane);
+            outside = side < 0;
+            if (side > 0)
+                planeMask &= ~(1u << plane);
+        }
+        if (outside)
+            continue;
+        if (!current.isLeaf()) {
+            stack[stackSize++] = {current.leftFirst, planeMask};
+            stack[stackSize++] = {current.leftFirst + 1, planeMask};
+            continue;
+        }
+        for (uint32_t i = current.leftFirst; i < current.leftFirst + current.count; i++) {
+            bool visible = true;
+            for (uint32_t plane = 0; plane < 6 && visible; plane++)
+                if (planeMask & (1u << plane))
+                    visible = classify(m_primitiveBounds[i].min, m_primitiveBounds[i].max, plane) >= 0;
+            if (visible)
+                result.push_back(m_indices[i]);
+        }
+    }
+}
+
+const be::Aabb& be::Bvh::getBounds() const {
+    return m_bounds;
+}
+
+size_t be::Bvh::getNodeCount() const {
+    // the second slot of the root pair is never used
+    return m_pairs.empty() ? 0 : 2 * m_pairs.size() - 1;
+}
+
+uint32_t be::Bvh::getDepth() const {
+    return m_depth;
+}
@@ -0,0 +1,160 @@
+#include "defragmenter.hpp"
+
+be::Defragmenter::Defragmenter() :
+    m_device(nullptr),
+    m_allocator(nullptr),
+    m_framesInFlight(1),
+    m_frameCount(0),
+    m_budget(DEFAULT_DEFRAGMENTATION_BUDGET),
+    m_evacuating(false),
+    m_stats({})
+{}
+
+void be::Defragmenter::init(vk::Device device, be::MemoryAllocator& allocator, size_t framesInFlight, BufferPatch bufferPatch, ImagePatch imagePatch) {
+    m_device = device;
+    m_allocator = &allocator;
+    m_framesInFlight = framesInFlight;
+    m_bufferPatch = std::move(bufferPatch);
+    m_imagePatch = std::move(imagePatch);
+}
+
+void be::Defragmenter::addBuffer(be::Buffer& buffer) {
+    m_buffers.push_back(&buffer);
+    m_allocator->setMovable(buffer.getAllocation());
+}
+
+void be::Defragmenter::addTexture(be::Texture& texture) {
+    m_textures.push_back(&texture);
+    m_allocator->setMovable(texture.getAllocation());
+}
+
+bool be::Defragmenter::update(vk::CommandBuffer commandBuffer, size_t frame, bool canMove) {
+    m_frameCount++;
+    // the frame that recorded a move was the last to use the old copy, and its slot comes back framesInFlight frames later
+    std::erase_if(m_moves, [&](const Move& move) {
+        if (m_frameCount < move.frame + m_framesInFlight)
+            return false;
+        release(move);
+        return true;
+    });
+    for (Move& move : m_moves)
+        patch(move, frame);
+
+    if (m_evacuating && !m_allocator->isEvacuating()) {
+        // the last old copy was released with the block
+        m_evacuating = false;
+        m_stats.releasedBlocks++;
+        m_stats.after = m_allocator->getStats();
+        return true;
+    }
+    if (!canMove)
+        return false;
+    if (!m_evacuating) {
+        MemoryStats before = m_allocator->getStats();
+        if (!m_allocator->beginEvacuation(DEFAULT_EVACUATION_USAGE))
+            return false;
+        m_evacuating = true;
+        m_stats.before = before;
+    }
+
+    std::vector<be::Buffer*> buffers;
+    for (be::Buffer* buffer : m_buffers)
+        if (m_allocator->isEvacuating(buffer->getAllocation()))
+            buffers.push_back(buffer);
+    std::vector<be::Texture*> textures;
+    for (be::Texture* texture : m_textures)
+        if (m_allocator->isEvacuating(texture->getAllocation()))
+            textures.push_back(texture);
+    if (buffers.empty() && textures.empty()) {
+        if (!m_moves.empty())
+            return false;
+        // nothing registered is left but the block is still alive
+        m_allocator->endEvacuation();
+        m_evacuating = false;
+        m_stats.abandonedEvacuations++;
+        m_stats.after = m_allocator->getStats();
+        return true;
+    }
+
+    // the previous frames may still write the buffers, the copies wait for them
+    vk::MemoryBarrier2 beforeCopies = vk::MemoryBarrier2(
+        vk::PipelineStageFlagBits2::eAllCommands,
+        vk::AccessFlagBits2::eMemoryWrite,
+        vk::PipelineStageFlagBits2::eCopy,
+        vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite
+    );
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, beforeCopies, {}, {}));
+    vk::DeviceSize movedBytes = 0;
+    for (be::Buffer* buffer : buffers) {
+        if (movedBytes >= m_budget)
+            break;
+        movedBytes += buffer->getAllocation().size;
+        auto [oldBuffer, oldAllocation] = buffer->relocate(commandBuffer);
+        m_allocator->setMovable(buffer->getAllocation());
+        m_moves.push_back({m_frameCount, oldBuffer, buffer->getBuffer(), nullptr, nullptr, nullptr, oldAllocation, std::vector<bool>(m_framesInFlight, false)});
+        patch(m_moves.back(), frame);
+        m_stats.movedBuffers++;
+    }
+    for (be::Texture* texture : textures) {
+        if (movedBytes >= m_budget)
+            break;
+        movedBytes += texture->getAllocation().size;
+        auto [oldImage, oldView, oldAllocation] = texture->relocate(commandBuffer);
+        m_allocator->setMovable(texture->getAllocation());
+        m_moves.push_back({m_frameCount, nullptr, nullptr, oldImage, oldView, texture->getImageView(), oldAllocation, std::vector<bool>(m_framesInFlight, false)});
+        patch(m_moves.back(), frame);
+        m_stats.movedImages++;
+    }
+    m_stats.movedBytes += movedBytes;
+    vk::MemoryBarrier2 afterCopies = vk::MemoryBarrier2(
+        vk::PipelineStageFlagBits2::eCopy,
+        vk::AccessFlagBits2::eTransferWrite,
+        vk::PipelineStageFlagBits2::eAllCommands,
+        vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite
+    );
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, afterCopies, {}, {}));
+    return false;
+}
+
+void be::Defragmenter::patch(Move& move, size_t frame) {
+    if (move.patched[frame])
+        return;
+    if (move.oldBuffer)
+        m_bufferPatch(frame, move.oldBuffer, move.newBuffer);
+    else
+        m_imagePatch(frame, move.oldView, move.newView);
+    move.patched[frame] = true;
+}
+
+void be::Defragmenter::release(const Move& move) {
+    if (move.oldBuffer) {
+        m_device.destroyBuffer(move.oldBuffer);
+    } else {
+        m_device.destroyImageView(move.oldView);
+        m_device.destroyImage(move.oldImage);
+    }
+    m_allocator->free(move.oldAllocation);
+}
+
+void be::Defragmenter::setBudget(vk::DeviceSize budget) {
+    m_budget = budget;
+}
+
+vk::DeviceSize be::Defragmenter::getBudget() const {
+    return m_budget;
+}
+
+const be::DefragmentationStats& be::Defragmenter::getStats() const {
+    return m_stats;
+}
+
+void be::Defragmenter::clean() {
+    for (const Move& move : m_moves)
+        release(move);
+    m_moves.clear();
+    if (m_evacuating)
+        m_allocator->endEvacuation();
+    m_evacuating = false;
+    m_buffers.clear();
+    m_textures.clear();
+}
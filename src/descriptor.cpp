@@ -1,34 +1,50 @@
 #include "descriptor.hpp"
-#include "texture.hpp"
+#include <algorithm>
 #include <vulkan/vulkan_structs.hpp>
 
 be::Descriptor::Descriptor() :
-    m_device(nullptr)
+    m_device(nullptr),
+    m_updateAfterBind(false)
 {}
 
 be::Descriptor::Descriptor(vk::Device device) :
-    m_device(device)
+    m_device(device),
+    m_updateAfterBind(false)
 {}
 
 be::Descriptor::Descriptor(const Descriptor& another) :
     m_device(another.m_device),
     m_descriptorSetLayout(another.m_descriptorSetLayout),
-    m_descriptorSets(another.m_descriptorSets)
+    m_updateAfterBind(another.m_updateAfterBind),
+    m_descriptorSets(another.m_descriptorSets),
+    m_bufferWrites(another.m_bufferWrites),
+    m_imageWrites(another.m_imageWrites)
 {}
 
 be::Descriptor& be::Descriptor::operator=(const Descriptor& another) {
     m_device = another.m_device;
     m_descriptorSetLayout = another.m_descriptorSetLayout;
+    m_updateAfterBind = another.m_updateAfterBind;
     m_descriptorSets = another.m_descriptorSets;
+    m_bufferWrites = another.m_bufferWrites;
+    m_imageWrites = another.m_imageWrites;
 
     return *this;
 }
 
-void be::Descriptor::createSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& descriptorSetLayoutBinding) {
+void be::Descriptor::createSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& descriptorSetLayoutBinding, const std::vector<vk::DescriptorBindingFlags>& bindingFlags) {
+    m_updateAfterBind = std::ranges::any_of(bindingFlags, [](vk::DescriptorBindingFlags flags) {
+        return static_cast<bool>(flags & vk::DescriptorBindingFlagBits::eUpdateAfterBind);
+    });
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo(
+        bindingFlags.size(),
+        bindingFlags.data()
+    );
     vk::DescriptorSetLayoutCreateInfo descSetLayoutInfo = vk::DescriptorSetLayoutCreateInfo(
-		{},
+		m_updateAfterBind ? vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool : vk::DescriptorSetLayoutCreateFlags(),
 		descriptorSetLayoutBinding.size(),
-		descriptorSetLayoutBinding.data()
+		descriptorSetLayoutBinding.data(),
+        bindingFlags.empty() ? nullptr : &bindingFlagsInfo
 	);
     m_layoutSize = descriptorSetLayoutBinding.size();
     m_descriptorSetLayout = m_device.createDescriptorSetLayout(descSetLayoutInfo);
@@ -36,7 +52,7 @@ void be::Descriptor::createSetLayout(const std::vector<vk::DescriptorSetLayoutBi
 
 void be::Descriptor::createPool(const std::vector<vk::DescriptorPoolSize>& createInfo, int numFrame) {
     vk::DescriptorPoolCreateInfo descriptorPoolCreateInfo = vk::DescriptorPoolCreateInfo(
-		vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+		m_updateAfterBind ? vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet | vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind : vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
 		numFrame,
         createInfo.size(),
 		createInfo.data()
@@ -44,7 +60,12 @@ void be::Descriptor::createPool(const std::vector<vk::DescriptorPoolSize>& creat
 	m_descriptorPool = m_device.createDescriptorPool(descriptorPoolCreateInfo);
 }
 
-void be::Descriptor::createSet(size_t numberFrame, const std::vector<be::Buffer>& buffers, const be::Buffer& ssbo, const std::vector<be::Texture>& textures) {
+void be::Descriptor::createStorageSet(size_t numberFrame, const std::vector<std::vector<be::Buffer>>& storageBuffers) {
+    std::vector<vk::DescriptorType> types = std::vector<vk::DescriptorType>(storageBuffers.front().size(), vk::DescriptorType::eStorageBuffer);
+    createBufferSet(numberFrame, storageBuffers, types);
+}
+
+void be::Descriptor::createBufferSet(size_t numberFrame, const std::vector<std::vector<be::Buffer>>& buffers, const std::vector<vk::DescriptorType>& types) {
     std::vector layouts = std::vector<vk::DescriptorSetLayout>(numberFrame, m_descriptorSetLayout);
     vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo(
 		m_descriptorPool,
@@ -53,67 +74,111 @@ void be::Descriptor::createSet(size_t numberFrame, const std::vector<be::Buffer>
 	);
     m_descriptorSets = m_device.allocateDescriptorSets(allocInfo);
     std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
-    std::vector<std::vector<vk::DescriptorImageInfo>> imagesInfo;
-    imagesInfo.resize(numberFrame);
     std::vector<std::vector<vk::DescriptorBufferInfo>> buffersInfo;
     buffersInfo.resize(numberFrame);
-    std::vector<std::vector<vk::DescriptorBufferInfo>> ssbosInfo;
-    ssbosInfo.resize(numberFrame);
     for (size_t i = 0; i < numberFrame; i++) {
-        vk::DescriptorBufferInfo uboInfo = vk::DescriptorBufferInfo(
-            buffers[i].getBuffer(),
-            0,
-            buffers[i].getSize()
-        );
-        buffersInfo[i].push_back(uboInfo);
-        vk::WriteDescriptorSet writeDescriptorSet = vk::WriteDescriptorSet(
-            m_descriptorSets[i],
-            0,
-            0,
-            1,
-            vk::DescriptorType::eUniformBuffer,
-            {},
-            buffersInfo[i].data()
-        );
-        writeDescriptorSets.push_back(writeDescriptorSet);
-        
-        vk::DescriptorBufferInfo ssboInfo = vk::DescriptorBufferInfo(
-            ssbo.getBuffer(),
-            0,
-            ssbo.getSize()
-        );
-        ssbosInfo[i].push_back(ssboInfo);
-        writeDescriptorSet = vk::WriteDescriptorSet(
-            m_descriptorSets[i],
-            2,
-            0,
-            1,
-            vk::DescriptorType::eStorageBuffer,
-            {},
-            ssbosInfo[i].data()
-        );
-        writeDescriptorSets.push_back(writeDescriptorSet);
-
-        for (const be::Texture& texture : textures) {
+        for (const be::Buffer& buffer : buffers[i])
+            buffersInfo[i].push_back(vk::DescriptorBufferInfo(buffer.getBuffer(), 0, buffer.getSize()));
+        for (size_t binding = 0; binding < buffersInfo[i].size(); binding++) {
+            vk::WriteDescriptorSet writeDescriptorSet = vk::WriteDescriptorSet(
+                m_descriptorSets[i],
+                binding,
+                0,
+                1,
+                types[binding],
+                {},
+                &buffersInfo[i][binding]
+            );
+            writeDescriptorSets.push_back(writeDescriptorSet);
+        }
+    }
+    m_device.updateDescriptorSets(writeDescriptorSets, {});
+    recordWrites(writeDescriptorSets);
+}
 
-            vk::DescriptorImageInfo imageInfo = vk::DescriptorImageInfo(
-            be::Texture::getSampler(),
-            texture.getImageView(),
-            vk::ImageLayout::eShaderReadOnlyOptimal
+void be::Descriptor::createImageSet(const std::vector<std::vector<vk::DescriptorImageInfo>>& images, const std::vector<vk::DescriptorType>& types) {
+    std::vector layouts = std::vector<vk::DescriptorSetLayout>(images.size(), m_descriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo(
+		m_descriptorPool,
+		layouts.size(),
+		layouts.data()
+	);
+    m_descriptorSets = m_device.allocateDescriptorSets(allocInfo);
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    for (size_t i = 0; i < images.size(); i++) {
+        for (size_t binding = 0; binding < images[i].size(); binding++) {
+            vk::WriteDescriptorSet writeDescriptorSet = vk::WriteDescriptorSet(
+                m_descriptorSets[i],
+                binding,
+                0,
+                1,
+                types[binding],
+                &images[i][binding]
             );
-            imagesInfo[i].push_back(imageInfo);
+            writeDescriptorSets.push_back(writeDescriptorSet);
         }
-        writeDescriptorSet = vk::WriteDescriptorSet(
-            m_descriptorSets[i],
-            1,
-            0,
-            imagesInfo[i].size(),
-            vk::DescriptorType::eCombinedImageSampler,
-            imagesInfo[i].data()
-        );
-        writeDescriptorSets.push_back(writeDescriptorSet);
     }
     m_device.updateDescriptorSets(writeDescriptorSets, {});
+    recordWrites(writeDescriptorSets);
+}
+
+void be::Descriptor::freeSets() {
+    if (!m_descriptorSets.empty())
+        m_device.freeDescriptorSets(m_descriptorPool, m_descriptorSets);
+    m_descriptorSets.clear();
+    m_bufferWrites.clear();
+    m_imageWrites.clear();
+}
+
+void be::Descriptor::recordWrites(const std::vector<vk::WriteDescriptorSet>& writeDescriptorSets) {
+    for (const vk::WriteDescriptorSet& write : writeDescriptorSets) {
+        size_t set = std::distance(m_descriptorSets.begin(), std::ranges::find(m_descriptorSets, write.dstSet));
+        for (uint32_t i = 0; i < write.descriptorCount; i++) {
+            if (write.pBufferInfo != nullptr)
+                m_bufferWrites.push_back({set, write.dstBinding, write.dstArrayElement + i, write.descriptorType, write.pBufferInfo[i]});
+            else if (write.pImageInfo != nullptr)
+                m_imageWrites.push_back({set, write.dstBinding, write.dstArrayElement + i, write.descriptorType, write.pImageInfo[i]});
+        }
+    }
+}
+
+void be::Descriptor::replaceBuffer(size_t set, vk::Buffer oldBuffer, vk::Buffer newBuffer) {
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    for (BufferWrite& bufferWrite : m_bufferWrites) {
+        if (bufferWrite.set != set || bufferWrite.info.buffer != oldBuffer)
+            continue;
+        bufferWrite.info.buffer = newBuffer;
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet(
+            m_descriptorSets[set],
+            bufferWrite.binding,
+            bufferWrite.arrayElement,
+            1,
+            bufferWrite.type,
+            {},
+            &bufferWrite.info
+        ));
+    }
+    if (!writeDescriptorSets.empty())
+        m_device.updateDescriptorSets(writeDescriptorSets, {});
+}
+
+void be::Descriptor::replaceImageView(size_t set, vk::ImageView oldView, vk::ImageView newView) {
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    for (ImageWrite& imageWrite : m_imageWrites) {
+        if (imageWrite.set != set || imageWrite.info.imageView != oldView)
+            continue;
+        imageWrite.info.imageView = newView;
+        writeDescriptorSets.push_back(vk::WriteDescriptorSet(
+            m_descriptorSets[set],
+            imageWrite.binding,
+            imageWrite.arrayElement,
+            1,
+            imageWrite.type,
+            &imageWrite.info
+        ));
+    }
+    if (!writeDescriptorSets.empty())
+        m_device.updateDescriptorSets(writeDescriptorSets, {});
 }
 
 const vk::DescriptorSetLayout& be::Descriptor::getLayout() const {
@@ -1,14 +1,23 @@
 #include "engine.hpp"
+#include "frustum.hpp"
 #include "descriptor.hpp"
 #include "materialObject.hpp"
+#include "meshCache.hpp"
 #include "objLoader.hpp"
 #include "shaderCompiler.hpp"
 #include "texture.hpp"
+#include "textureUploader.hpp"
 #include "utils.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <filesystem>
+#include <format>
+#include <limits>
+#include <optional>
 #include <ranges>
 #include <print>
+#include <type_traits>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_structs.hpp>
 
@@ -61,10 +70,22 @@ void Engine::getPhysicalDevice() {
 													.setSynchronization2(vk::True);
 
 	vk::PhysicalDeviceVulkan12Features features12 = vk::PhysicalDeviceVulkan12Features()
-													.setRuntimeDescriptorArray(vk::True);
-
+													.setRuntimeDescriptorArray(vk::True)
+													.setDrawIndirectCount(vk::True)
+													.setTimelineSemaphore(vk::True)
+													// the bindless table
+													.setDescriptorBindingPartiallyBound(vk::True)
+													.setDescriptorBindingSampledImageUpdateAfterBind(vk::True)
+													.setDescriptorBindingStorageBufferUpdateAfterBind(vk::True)
+													.setDescriptorBindingUpdateUnusedWhilePending(vk::True)
+													.setDescriptorBindingVariableDescriptorCount(vk::True);
+
+	// the depth pyramid is a two channel float storage image, the fragment shader writes the texture feedback
 	vk::PhysicalDeviceFeatures2 features2 = vk::PhysicalDeviceFeatures2()
-											.setFeatures(vk::PhysicalDeviceFeatures().setSamplerAnisotropy(vk::True));
+											.setFeatures(vk::PhysicalDeviceFeatures()
+												.setSamplerAnisotropy(vk::True)
+												.setShaderStorageImageExtendedFormats(vk::True)
+												.setFragmentStoresAndAtomics(vk::True));
 
 	// take in account all required extension that the device has to support
 	std::ranges::for_each(deviceExtensions, [&selector](const char* c) {
@@ -80,6 +101,8 @@ void Engine::getPhysicalDevice() {
 	}
 	vkbPhysicalDevice = selectedDevice.value();
 	vkPhysicalDevice = vkbPhysicalDevice.physical_device;
+	// optional, the textures stay uncompressed without it
+	blockCompression = vkbPhysicalDevice.enable_features_if_present(vk::PhysicalDeviceFeatures().setTextureCompressionBC(vk::True));
 }
 
 void Engine::createLogicalDevice() {
@@ -90,6 +113,7 @@ void Engine::createLogicalDevice() {
 	}
 	vkbDevice = builderRet.value();
 	vkDevice = vkbDevice.device;
+	allocator.init(vkDevice, vkPhysicalDevice);
 }
 
 void Engine::getQueueFamilies() {
@@ -100,6 +124,23 @@ void Engine::getQueueFamilies() {
 	}
 	graphicsQueue = graphicQueueRet.value();
 	presentQueue = presentQueueRet.value();
+	graphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+
+	// a family without graphics runs the copies next to the rendering, the graphics queue is the fallback
+	auto transferQueueRet = vkbDevice.get_dedicated_queue(vkb::QueueType::transfer);
+	if (!transferQueueRet)
+		transferQueueRet = vkbDevice.get_queue(vkb::QueueType::transfer);
+	if (transferQueueRet) {
+		transferQueue = transferQueueRet.value();
+		auto transferIndexRet = vkbDevice.get_dedicated_queue_index(vkb::QueueType::transfer);
+		if (!transferIndexRet)
+			transferIndexRet = vkbDevice.get_queue_index(vkb::QueueType::transfer);
+		transferQueueFamily = transferIndexRet.value();
+	} else {
+		transferQueue = graphicsQueue;
+		transferQueueFamily = graphicsQueueFamily;
+	}
+	std::println("Uploads run on queue family {}{}.", transferQueueFamily, transferQueueFamily == graphicsQueueFamily ? ", shared with graphics" : "");
 }
 
 void Engine::createSwapChain() {
@@ -143,7 +184,14 @@ void Engine::recreateSwapChain() {
 	}
 	
 	createImageViews();
+	vkDevice.destroyImageView(depthMapView);
+	vkDevice.destroyImage(depthMapImage);
+	allocator.free(depthMapAllocation);
 	createDepthMaps();
+	if (renderMode == be::RenderMode::meshletCulling || renderMode == be::RenderMode::gpuCulling) {
+		cleanUpDepthPyramid();
+		createDepthPyramid();
+	}
 }
 
 void Engine::createImageViews() {
@@ -164,6 +212,7 @@ vk::ShaderModule Engine::createShaderModule(const std::string& binaryShader) {
 
 void Engine::createGraphicPipeline() {
 	ShaderCompiler compiler;
+	compiler.addMacro("PACKED_VERTEX", vertexFormat == be::VertexFormat::packed ? "1" : "0");
 	compiler.createSession(SLANG_SPIRV, "spirv_1_5");
 	std::string shader = compiler.loadProgram("firstShader");
 	vk::ShaderModule shaderModule = createShaderModule(shader);
@@ -183,8 +232,8 @@ void Engine::createGraphicPipeline() {
 	std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {shaderVertCreateInfo, shaderFragCreateInfo};
 
 
-	auto vertexBindingDesc = Vertex::getBindingDescription();
-	auto vertexAttriDesc = Vertex::getAttributeDescriptions(); 
+	auto vertexBindingDesc = Vertex::getBindingDescription(vertexFormat);
+	auto vertexAttriDesc = Vertex::getAttributeDescriptions(vertexFormat);
 	
 	vk::PipelineVertexInputStateCreateInfo vertexInputInfo = vk::PipelineVertexInputStateCreateInfo(
 		{}, 
@@ -222,6 +271,7 @@ void Engine::createGraphicPipeline() {
 		vk::False,
 		vk::False,
 		vk::PolygonMode::eFill,
+		// the foliage, curtains and banners of the scene are single sheets seen from both sides
 		vk::CullModeFlagBits::eNone,
 		vk::FrontFace::eCounterClockwise,
 		vk::False
@@ -266,10 +316,12 @@ void Engine::createGraphicPipeline() {
 		vk::False
 	);
 
+	// the textures are in the bindless table, set 1
+	std::array<vk::DescriptorSetLayout, 2> setLayouts = {descriptor.getLayout(), bindlessTable.getLayout()};
 	vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo(
 		{},
-		1,
-		&descriptor.getLayout(),
+		setLayouts.size(),
+		setLayouts.data(),
 		0
 	);
 	
@@ -313,87 +365,837 @@ void Engine::createDescriptorSetLayout() {
 	uniformBufferObjects.resize(MAX_FRAME_IN_FLIGHT);
 	for (be::Buffer& ubo : uniformBufferObjects) {
 		ubo = be::Buffer(vkDevice, sizeof(glm::mat4));
-		ubo.create(vk::BufferUsageFlagBits::eUniformBuffer, vk::SharingMode::eExclusive, vkPhysicalDevice);
+		ubo.create(vk::BufferUsageFlagBits::eUniformBuffer, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::upload, "camera");
 		ubo.map();
 	}
+	// the materials are in the bindless table
 	std::vector bindings = {
 		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex),
-		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eCombinedImageSampler, textures.size(), vk::ShaderStageFlagBits::eFragment),
-		vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment)
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment)
 	};
 
 	descriptor.createSetLayout(bindings);
 }
 
+void Engine::createFallbackResources() {
+	std::tie(fallbackTextureAllocation, fallbackTextureImage) = createImage(
+		vkDevice,
+		allocator,
+		vk::ImageType::e2D,
+		vk::Format::eR8G8B8A8Unorm,
+		vk::Extent3D(1, 1, 1),
+		1,
+		1,
+		vk::SampleCountFlagBits::e1,
+		vk::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+		vk::SharingMode::eExclusive,
+		be::MemoryUsage::gpuOnly,
+		"fallback texture"
+	);
+	vk::ImageSubresourceRange range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	fallbackTextureView = createImageView(vkDevice, fallbackTextureImage, vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Unorm, range);
+	fallbackBuffer = be::Buffer(vkDevice, 256);
+	fallbackBuffer.create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::gpuOnly, "fallback buffer");
+	// a single white texel and zeros, cleared rather than uploaded
+	vk::CommandBuffer commandBuffer = beginSingleTimeCommands(vkDevice, commandPool);
+	commandBuffer.fillBuffer(fallbackBuffer.getBuffer(), 0, vk::WholeSize, 0);
+	transition_image_layout(
+		commandBuffer,
+		fallbackTextureImage,
+		vk::ImageLayout::eUndefined,
+		vk::ImageLayout::eTransferDstOptimal,
+		{},
+		vk::AccessFlagBits2::eTransferWrite,
+		vk::PipelineStageFlagBits2::eTopOfPipe,
+		vk::PipelineStageFlagBits2::eTransfer,
+		range
+	);
+	commandBuffer.clearColorImage(fallbackTextureImage, vk::ImageLayout::eTransferDstOptimal, vk::ClearColorValue(1.0f, 1.0f, 1.0f, 1.0f), range);
+	transition_image_layout(
+		commandBuffer,
+		fallbackTextureImage,
+		vk::ImageLayout::eTransferDstOptimal,
+		vk::ImageLayout::eShaderReadOnlyOptimal,
+		vk::AccessFlagBits2::eTransferWrite,
+		vk::AccessFlagBits2::eShaderSampledRead,
+		vk::PipelineStageFlagBits2::eTransfer,
+		vk::PipelineStageFlagBits2::eFragmentShader,
+		range
+	);
+	vk::MemoryBarrier2 fillBarrier = vk::MemoryBarrier2(
+		vk::PipelineStageFlagBits2::eTransfer,
+		vk::AccessFlagBits2::eTransferWrite,
+		vk::PipelineStageFlagBits2::eAllCommands,
+		vk::AccessFlagBits2::eShaderStorageRead
+	);
+	commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &fillBarrier));
+	endSingleTimeCommands(vkDevice, commandPool, commandBuffer, graphicsQueue);
+}
+
+void Engine::createBindlessTable() {
+	createFallbackResources();
+	vk::DescriptorImageInfo fallbackTexture = vk::DescriptorImageInfo(
+		be::Texture::getSampler(),
+		fallbackTextureView,
+		vk::ImageLayout::eShaderReadOnlyOptimal
+	);
+	// the camera and the feedback of set 0, and the color attachment
+	uint32_t reservedResources = 3;
+	bindlessTable.init(vkDevice, vkPhysicalDevice, MAX_FRAME_IN_FLIGHT, fallbackTexture, fallbackBuffer, reservedResources);
+	// indices of a new table follow the additions, the materials are buffer 0 and keep their texture indices
+	bindlessTable.addBuffer(ssbo);
+	for (const be::Texture& texture : textures)
+		bindlessTable.addTexture(texture.getImageView(), be::Texture::getSampler());
+}
+
 void Engine::createDescriptorSets() {
-	descriptor.createSet(MAX_FRAME_IN_FLIGHT, uniformBufferObjects, ssbo, textures);
+	std::vector<std::vector<be::Buffer>> buffers;
+	for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++)
+		buffers.push_back({uniformBufferObjects[i], textureStreamer.getFeedbackBuffers()[i]});
+	std::vector<vk::DescriptorType> types = {vk::DescriptorType::eUniformBuffer, vk::DescriptorType::eStorageBuffer};
+	descriptor.createBufferSet(MAX_FRAME_IN_FLIGHT, buffers, types);
 }
 
 
 void Engine::loadObjects() {
-	ObjLoader info = ObjLoader(std::filesystem::current_path()/"data"/"sponza"/"sponza.obj");
-	createVertexBuffer(info.getVertices());
-	createIndexBuffer(info.getIndices());
-	createSSBO(info.getMaterials());
-	loadTextures(info.getTexturePath());
+	std::filesystem::path objPath = std::filesystem::current_path()/"data"/"sponza"/"sponza.obj";
+	be::MeshCache cache = be::MeshCache(objPath);
+	// the loader has to outlive the uploads when the cache can't be written
+	std::optional<ObjLoader> info;
+	be::MeshletData meshletData;
+	std::vector<uint16_t> shortIndices;
+	if (!cache.load()) {
+		std::println("Mesh cache miss, parsing {}.", objPath.string());
+		info.emplace(objPath);
+		const be::WeldStats& weldStats = info->getWeldStats();
+		std::println("Welded {} corners into {} vertices, {} collisions, {:.2f} average probe length, {} max.",
+			weldStats.lookups,
+			weldStats.uniqueVertices,
+			weldStats.collisions,
+			static_cast<double>(weldStats.totalProbes) / std::max<size_t>(weldStats.lookups, 1),
+			weldStats.maxProbeLength
+		);
+		be::MeshOptimizationReport report = info->optimize();
+		std::println("Vertex cache ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.",
+			report.before.acmr,
+			report.after.acmr,
+			report.before.atvr,
+			report.after.atvr
+		);
+		size_t weldedVertices = info->getVertices().size();
+		info->splitIndexRanges(vertexFormat == be::VertexFormat::packed ? sizeof(PackedVertex) : sizeof(Vertex));
+		std::println("Split {} submeshes in {} {} bit ranges, {} vertices duplicated.",
+			info->getSubmeshes().size(),
+			info->getIndexRanges().size(),
+			info->hasShortIndices() ? 16 : 32,
+			info->getVertices().size() - weldedVertices
+		);
+		size_t baseIndexCount = info->getRangeIndices().size();
+		info->buildLods();
+		std::println("Built {} levels of detail for {} ranges, {} indices added.",
+			info->getLods().size(),
+			info->getIndexRanges().size(),
+			info->getRangeIndices().size() - baseIndexCount
+		);
+		shortIndices = info->getShortIndices();
+		meshletData = info->buildMeshlets();
+		std::println("Built {} meshlets.", meshletData.meshlets.size());
+		// the sections point into the loader until the written cache is mapped
+		auto addSections = [&]() {
+			cache.addSection<Vertex>(be::MeshCache::Section::vertices, info->getVertices());
+			// the element size tells the index type
+			if (info->hasShortIndices())
+				cache.addSection<uint16_t>(be::MeshCache::Section::indices, shortIndices);
+			else
+				cache.addSection<uint32_t>(be::MeshCache::Section::indices, info->getRangeIndices());
+			cache.addSection<be::IndexRange>(be::MeshCache::Section::indexRanges, info->getIndexRanges());
+			cache.addSection<be::LodLevel>(be::MeshCache::Section::lods, info->getLods());
+			cache.addSection<be::Submesh>(be::MeshCache::Section::submeshes, info->getSubmeshes());
+			cache.addSection<MaterialObject>(be::MeshCache::Section::materials, info->getMaterials());
+			cache.addSection<be::Meshlet>(be::MeshCache::Section::meshlets, meshletData.meshlets);
+			cache.addSection<uint32_t>(be::MeshCache::Section::meshletVertices, meshletData.vertices);
+			cache.addSection<uint32_t>(be::MeshCache::Section::meshletTriangles, meshletData.triangles);
+			cache.addTexturePaths(info->getTexturePath());
+			cache.addMaterialLibraries(info->getMaterialLibraries());
+		};
+		addSections();
+		// a failed load empties the cache, the data in memory is still good
+		if (cache.write() && !cache.load()) {
+			std::println("Failed to read back mesh cache {}, using the parsed data.", cache.getPath().string());
+			addSections();
+		}
+	}
+	createVertexBuffer(cache.getSection<Vertex>(be::MeshCache::Section::vertices));
+	std::span<const be::IndexRange> ranges = cache.getSection<be::IndexRange>(be::MeshCache::Section::indexRanges);
+	std::span<const uint16_t> cachedShortIndices = cache.getSection<uint16_t>(be::MeshCache::Section::indices);
+	std::span<const uint32_t> indices = cache.getSection<uint32_t>(be::MeshCache::Section::indices);
+	// the passes on the CPU read 32 bit indices, widened when the buffer takes 16 bit ones
+	std::vector<uint32_t> widenedIndices;
+	if (!cachedShortIndices.empty()) {
+		createIndexBuffer(cachedShortIndices, ranges);
+		widenedIndices.assign(cachedShortIndices.begin(), cachedShortIndices.end());
+		indices = widenedIndices;
+	} else {
+		createIndexBuffer(indices, ranges);
+	}
+	std::span<const be::LodLevel> cachedLods = cache.getSection<be::LodLevel>(be::MeshCache::Section::lods);
+	lods.assign(cachedLods.begin(), cachedLods.end());
+	selectedLods.assign(indexRanges.size(), 0);
+	createSubmeshBuffer(cache.getSection<be::Submesh>(be::MeshCache::Section::submeshes));
+	auto bvhStart = std::chrono::steady_clock::now();
+	sceneBvh.build(
+		submeshes,
+		cache.getSection<Vertex>(be::MeshCache::Section::vertices),
+		indices,
+		indexRanges,
+		true
+	);
+	std::println("Built the scene BVH, {} nodes in {:.1f} ms.",
+		sceneBvh.getNodeCount(),
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bvhStart).count()
+	);
+	if (occlusionCulling && renderMode != be::RenderMode::gpuCulling) {
+		auto occluderStart = std::chrono::steady_clock::now();
+		be::OccluderMesh occluders = be::buildOccluders(
+			submeshes,
+			cache.getSection<Vertex>(be::MeshCache::Section::vertices),
+			indices,
+			indexRanges
+		);
+		std::println("Simplified {} occluder submeshes to {} triangles in {:.1f} ms.",
+			occluders.submeshCount,
+			occluders.indices.size() / 3,
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - occluderStart).count()
+		);
+		occlusionRasterizer.setOccluders(std::move(occluders));
+	}
+	createSSBO(cache.getSection<MaterialObject>(be::MeshCache::Section::materials));
+	if (renderMode == be::RenderMode::meshletCulling)
+		createMeshletBuffers(
+			cache.getSection<be::Meshlet>(be::MeshCache::Section::meshlets),
+			cache.getSection<uint32_t>(be::MeshCache::Section::meshletVertices),
+			cache.getSection<uint32_t>(be::MeshCache::Section::meshletTriangles)
+		);
+	else if (renderMode == be::RenderMode::gpuCulling)
+		createGpuCullingBuffers();
+	// the buffers above only queued their data
+	uploads.finish();
+	const be::UploadStats& uploadStats = uploads.getStats();
+	std::println("Uploaded {} bytes of buffers in {} submissions, {} stalls.", uploadStats.bytesUploaded, uploadStats.submissions, uploadStats.stalls);
+	loadTextures(cache.getTexturePath(), cache.getSection<MaterialObject>(be::MeshCache::Section::materials));
+}
+
+template<typename T>
+be::Buffer Engine::createDeviceBuffer(std::span<const T> data, vk::BufferUsageFlags usage, std::string_view name) {
+	vk::DeviceSize size = sizeof(T) * data.size();
+	be::Buffer buffer = be::Buffer(vkDevice, size);
+	buffer.create(vk::BufferUsageFlagBits::eTransferDst | usage, uploads.getSharingMode(), allocator, be::MemoryUsage::gpuOnly, name, uploads.getQueueFamilies());
+	uploads.enqueueBuffer<T>(buffer, data);
+	return buffer;
+}
+
+void Engine::createSubmeshBuffer(std::span<const be::Submesh> submeshTable) {
+	submeshes.assign(submeshTable.begin(), submeshTable.end());
+	std::vector<glm::vec3> boxesMin, boxesMax;
+	for (const be::Submesh& submesh : submeshes) {
+		boxesMin.push_back(glm::vec3(submesh.aabbMin));
+		boxesMax.push_back(glm::vec3(submesh.aabbMax));
+	}
+	submeshCuller.setBoxes(boxesMin, boxesMax);
+	if (!submeshes.empty())
+		submeshBuffer = createDeviceBuffer<be::Submesh>(submeshes, vk::BufferUsageFlagBits::eStorageBuffer, "submeshes");
+}
+
+void Engine::createMeshletBuffers(std::span<const be::Meshlet> meshlets, std::span<const uint32_t> meshletVertices, std::span<const uint32_t> meshletTriangles) {
+	if (meshlets.empty() || submeshes.empty()) {
+		std::println("No meshlets, drawing the index ranges instead.");
+		renderMode = be::RenderMode::indexRanges;
+		return;
+	}
+	numMeshlets = meshlets.size();
+	// a single level per range is drawn, at worst the finest one everywhere
+	size_t maxTriangles = 0;
+	for (const be::Meshlet& meshlet : meshlets)
+		if (meshlet.lodLevel == 0)
+			maxTriangles += meshlet.triangleCount;
+	meshletBuffer = createDeviceBuffer<be::Meshlet>(meshlets, vk::BufferUsageFlagBits::eStorageBuffer, "meshlets");
+	meshletVertexBuffer = createDeviceBuffer<uint32_t>(meshletVertices, vk::BufferUsageFlagBits::eStorageBuffer, "meshlet vertices");
+	meshletTriangleBuffer = createDeviceBuffer<uint32_t>(meshletTriangles, vk::BufferUsageFlagBits::eStorageBuffer, "meshlet triangles");
+	// the occlusion test clamps the meshlet sphere to the box of its submesh
+	rangeBuffer = createDeviceBuffer<be::IndexRange>(indexRanges, vk::BufferUsageFlagBits::eStorageBuffer, "index ranges");
+	// nothing was visible before the first frame, its early phase draws nothing
+	std::vector<uint32_t> visibility = std::vector<uint32_t>(meshlets.size(), 0);
+	meshletVisibilityBuffer = createDeviceBuffer<uint32_t>(visibility, vk::BufferUsageFlagBits::eStorageBuffer, "meshlet visibility");
+
+	// the frames in flight each need their own stream
+	vk::DeviceSize culledIndexSize = sizeof(uint32_t) * 3 * maxTriangles;
+	for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+		culledIndexBuffers[i] = be::Buffer(vkDevice, culledIndexSize);
+		culledIndexBuffers[i].create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndexBuffer, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::gpuOnly, "culled indices");
+		// early then late command, the late indices follow the early ones
+		drawCommandBuffers[i] = be::Buffer(vkDevice, 2 * sizeof(vk::DrawIndexedIndirectCommand));
+		drawCommandBuffers[i].create(
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::SharingMode::eExclusive,
+			allocator,
+			be::MemoryUsage::gpuOnly,
+			"draw command"
+		);
+		lodSelectionBuffers[i] = be::Buffer(vkDevice, sizeof(uint32_t) * indexRanges.size());
+		lodSelectionBuffers[i].create(vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::upload, "lod selection");
+		lodSelectionBuffers[i].map();
+		occlusionDepthBuffers[i] = be::Buffer(vkDevice, sizeof(float) * be::OCCLUSION_BUFFER_WIDTH * be::OCCLUSION_BUFFER_HEIGHT);
+		occlusionDepthBuffers[i].create(vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::upload, "occlusion depth");
+		occlusionDepthBuffers[i].map();
+	}
+}
+
+void Engine::createCullingDescriptors() {
+	cullingDescriptor = be::Descriptor(vkDevice);
+	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	const uint32_t bindingCount = 10;
+	for (uint32_t binding = 0; binding < bindingCount; binding++)
+		bindings.push_back(vk::DescriptorSetLayoutBinding(binding, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute));
+	cullingDescriptor.createSetLayout(bindings);
+	cullingDescriptor.createPool({vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, bindingCount * MAX_FRAME_IN_FLIGHT)}, MAX_FRAME_IN_FLIGHT);
+
+	std::vector<std::vector<be::Buffer>> storageBuffers;
+	for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++)
+		storageBuffers.push_back({
+			meshletBuffer,
+			meshletVertexBuffer,
+			meshletTriangleBuffer,
+			culledIndexBuffers[i],
+			drawCommandBuffers[i],
+			lodSelectionBuffers[i],
+			submeshBuffer,
+			rangeBuffer,
+			meshletVisibilityBuffer,
+			occlusionDepthBuffers[i]
+		});
+	cullingDescriptor.createStorageSet(MAX_FRAME_IN_FLIGHT, storageBuffers);
+}
+
+void Engine::createCullingPipeline() {
+	std::array<vk::DescriptorSetLayout, 2> setLayouts = {cullingDescriptor.getLayout(), pyramidSamplingDescriptor.getLayout()};
+	vk::PushConstantRange pushConstantRange = vk::PushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(be::CullingData));
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo(
+		{},
+		setLayouts.size(),
+		setLayouts.data(),
+		1,
+		&pushConstantRange
+	);
+	cullingPipelineLayout = vkDevice.createPipelineLayout(pipelineLayoutInfo);
+	cullingPipeline = createComputePipeline("meshletCulling", "cullMeshlets", cullingPipelineLayout);
+}
+
+vk::Pipeline Engine::createComputePipeline(const std::string& moduleName, const char* entryPoint, vk::PipelineLayout layout) {
+	ShaderCompiler compiler;
+	compiler.createSession(SLANG_SPIRV, "spirv_1_5");
+	std::string shader = compiler.loadProgram(moduleName);
+	vk::ShaderModule shaderModule = createShaderModule(shader);
+
+	vk::ComputePipelineCreateInfo pipelineInfo = vk::ComputePipelineCreateInfo(
+		{},
+		vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eCompute, shaderModule, entryPoint),
+		layout
+	);
+	auto res = vkDevice.createComputePipeline({}, pipelineInfo);
+	vkDevice.destroyShaderModule(shaderModule);
+	if (res.result != vk::Result::eSuccess)
+		throw std::runtime_error(std::format("Failed to create the {} pipeline.", moduleName));
+	return res.value;
+}
+
+void Engine::recordCulling(vk::CommandBuffer commandBuffer, uint32_t currentFrame, be::CullingPhase phase) {
+	// the meshlet bounds are in mesh space, before the dequantization of packed positions
+	glm::mat4 modelView = camera->getView() * glm::scale(glm::mat4(1), glm::vec3(0.1));
+	be::CullingData cullingData = {
+		camera->getProj() * modelView,
+		glm::inverse(modelView)[3],
+		static_cast<uint32_t>(numMeshlets),
+		// the materials do not say which surfaces are double sided, a back facing meshlet may still be seen
+		0,
+		occlusionCulling,
+		static_cast<uint32_t>(phase),
+		glm::vec2(swapChainExtent.width, swapChainExtent.height),
+		static_cast<uint32_t>(depthPyramidLevelViews.size()),
+		// selectLods drew the occluders with the same matrix
+		occlusionRasterizer.hasOccluders()
+	};
+
+	if (phase == be::CullingPhase::early) {
+		std::array<vk::DrawIndexedIndirectCommand, 2> drawCommands = {
+			vk::DrawIndexedIndirectCommand(0, 1, 0, 0, 0),
+			vk::DrawIndexedIndirectCommand(0, 1, 0, 0, 0)
+		};
+		commandBuffer.updateBuffer(drawCommandBuffers[currentFrame].getBuffer(), 0, sizeof(drawCommands), drawCommands.data());
+		// the visibility was written by the late phase of the previous frame
+		vk::MemoryBarrier2 resetBarrier = vk::MemoryBarrier2(
+			vk::PipelineStageFlagBits2::eTransfer | vk::PipelineStageFlagBits2::eComputeShader,
+			vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eShaderStorageWrite,
+			vk::PipelineStageFlagBits2::eComputeShader,
+			vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+		);
+		commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &resetBarrier));
+	}
+
+	std::array<vk::DescriptorSet, 2> sets = {cullingDescriptor.getSets()[currentFrame], pyramidSamplingDescriptor.getSets()[0]};
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullingPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullingPipelineLayout, 0, sets, {});
+	commandBuffer.pushConstants(cullingPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(cullingData), &cullingData);
+	commandBuffer.dispatch((numMeshlets + 63) / 64, 1, 1);
+
+	// the late phase also reads the early count, its indices start after the early ones
+	vk::MemoryBarrier2 drawBarrier = vk::MemoryBarrier2(
+		vk::PipelineStageFlagBits2::eComputeShader,
+		vk::AccessFlagBits2::eShaderStorageWrite,
+		vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eIndexInput | vk::PipelineStageFlagBits2::eComputeShader,
+		vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eIndexRead | vk::AccessFlagBits2::eShaderStorageRead
+	);
+	commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &drawBarrier));
+}
+
+void Engine::createGpuCullingBuffers() {
+	if (submeshes.empty() || indexRanges.empty()) {
+		std::println("No submesh table, drawing the index ranges instead.");
+		renderMode = be::RenderMode::indexRanges;
+		return;
+	}
+	rangeBuffer = createDeviceBuffer<be::IndexRange>(indexRanges, vk::BufferUsageFlagBits::eStorageBuffer, "index ranges");
+	lodBuffer = createDeviceBuffer<be::LodLevel>(lods, vk::BufferUsageFlagBits::eStorageBuffer, "lods");
+	for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+		cullingCameraBuffers[i] = be::Buffer(vkDevice, sizeof(be::CullingCamera));
+		cullingCameraBuffers[i].create(vk::BufferUsageFlagBits::eUniformBuffer, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::upload, "culling camera");
+		cullingCameraBuffers[i].map();
+		// early then late commands
+		rangeDrawBuffers[i] = be::Buffer(vkDevice, 2 * sizeof(vk::DrawIndexedIndirectCommand) * indexRanges.size());
+		rangeDrawBuffers[i].create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::gpuOnly, "range draws");
+		drawCountBuffers[i] = be::Buffer(vkDevice, 2 * sizeof(uint32_t));
+		drawCountBuffers[i].create(
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::SharingMode::eExclusive,
+			allocator,
+			be::MemoryUsage::gpuOnly,
+			"draw counts"
+		);
+		occlusionStatsBuffers[i] = be::Buffer(vkDevice, sizeof(be::OcclusionStats));
+		occlusionStatsBuffers[i].create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::readback, "occlusion stats");
+		occlusionStatsBuffers[i].map();
+	}
+	// nothing was visible before the first frame, its early phase draws nothing
+	std::vector<uint32_t> visibility = std::vector<uint32_t>(indexRanges.size(), 0);
+	visibilityBuffer = createDeviceBuffer<uint32_t>(visibility, vk::BufferUsageFlagBits::eStorageBuffer, "visibility");
+}
+
+void Engine::createGpuCullingDescriptors() {
+	gpuCullingDescriptor = be::Descriptor(vkDevice);
+	// declaration order of shaders/gpuCulling.slang
+	std::vector<vk::DescriptorType> types = {
+		vk::DescriptorType::eUniformBuffer,
+		vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eStorageBuffer
+	};
+	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	for (uint32_t binding = 0; binding < types.size(); binding++)
+		bindings.push_back(vk::DescriptorSetLayoutBinding(binding, types[binding], 1, vk::ShaderStageFlagBits::eCompute));
+	gpuCullingDescriptor.createSetLayout(bindings);
+	gpuCullingDescriptor.createPool({
+		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAME_IN_FLIGHT),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, (types.size() - 1) * MAX_FRAME_IN_FLIGHT)
+	}, MAX_FRAME_IN_FLIGHT);
+
+	std::vector<std::vector<be::Buffer>> buffers;
+	for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++)
+		buffers.push_back({
+			cullingCameraBuffers[i],
+			submeshBuffer,
+			rangeBuffer,
+			lodBuffer,
+			rangeDrawBuffers[i],
+			drawCountBuffers[i],
+			visibilityBuffer,
+			occlusionStatsBuffers[i]
+		});
+	gpuCullingDescriptor.createBufferSet(MAX_FRAME_IN_FLIGHT, buffers, types);
+}
+
+void Engine::createDepthPyramidDescriptors() {
+	// the sets depend on the swap chain extent, they are written by createDepthPyramid
+	depthPyramidDescriptor = be::Descriptor(vkDevice);
+	std::vector<vk::DescriptorType> pyramidTypes = {
+		vk::DescriptorType::eSampledImage,
+		vk::DescriptorType::eSampledImage,
+		vk::DescriptorType::eStorageImage
+	};
+	std::vector<vk::DescriptorSetLayoutBinding> pyramidBindings;
+	for (uint32_t binding = 0; binding < pyramidTypes.size(); binding++)
+		pyramidBindings.push_back(vk::DescriptorSetLayoutBinding(binding, pyramidTypes[binding], 1, vk::ShaderStageFlagBits::eCompute));
+	depthPyramidDescriptor.createSetLayout(pyramidBindings);
+	depthPyramidDescriptor.createPool({
+		vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, 2 * be::MAX_PYRAMID_LEVELS),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, be::MAX_PYRAMID_LEVELS)
+	}, be::MAX_PYRAMID_LEVELS);
+
+	pyramidSamplingDescriptor = be::Descriptor(vkDevice);
+	pyramidSamplingDescriptor.createSetLayout({vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eSampledImage, 1, vk::ShaderStageFlagBits::eCompute)});
+	pyramidSamplingDescriptor.createPool({vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, 1)}, 1);
+}
+
+void Engine::createDepthPyramid() {
+	uint32_t levelCount = be::getPyramidLevelCount(swapChainExtent);
+	if (levelCount > be::MAX_PYRAMID_LEVELS)
+		throw std::runtime_error("The swap chain is too large for the depth pyramid.");
+	vk::Extent2D extent = be::getPyramidLevelExtent(swapChainExtent, 0);
+	std::tie(depthPyramidAllocation, depthPyramidImage) = createImage(
+		vkDevice,
+		allocator,
+		vk::ImageType::e2D,
+		vk::Format::eR32G32Sfloat,
+		vk::Extent3D(extent.width, extent.height, 1),
+		levelCount,
+		1,
+		vk::SampleCountFlagBits::e1,
+		vk::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+		vk::SharingMode::eExclusive,
+		be::MemoryUsage::gpuOnly,
+		"depth pyramid"
+	);
+	depthPyramidView = createImageView(
+		vkDevice,
+		depthPyramidImage,
+		vk::ImageViewType::e2D,
+		vk::Format::eR32G32Sfloat,
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1)
+	);
+	for (uint32_t level = 0; level < levelCount; level++)
+		depthPyramidLevelViews.push_back(createImageView(
+			vkDevice,
+			depthPyramidImage,
+			vk::ImageViewType::e2D,
+			vk::Format::eR32G32Sfloat,
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1)
+		));
+
+	// the pyramid stays in the general layout, level 0 reads the depth buffer and ignores its source
+	std::vector<std::vector<vk::DescriptorImageInfo>> levelImages;
+	for (uint32_t level = 0; level < levelCount; level++)
+		levelImages.push_back({
+			vk::DescriptorImageInfo({}, depthMapView, vk::ImageLayout::eShaderReadOnlyOptimal),
+			vk::DescriptorImageInfo({}, depthPyramidLevelViews[level == 0 ? 0 : level - 1], vk::ImageLayout::eGeneral),
+			vk::DescriptorImageInfo({}, depthPyramidLevelViews[level], vk::ImageLayout::eGeneral)
+		});
+	depthPyramidDescriptor.createImageSet(levelImages, {vk::DescriptorType::eSampledImage, vk::DescriptorType::eSampledImage, vk::DescriptorType::eStorageImage});
+	pyramidSamplingDescriptor.createImageSet(
+		{{vk::DescriptorImageInfo({}, depthPyramidView, vk::ImageLayout::eGeneral)}},
+		{vk::DescriptorType::eSampledImage}
+	);
+}
+
+void Engine::cleanUpDepthPyramid() {
+	depthPyramidDescriptor.freeSets();
+	pyramidSamplingDescriptor.freeSets();
+	for (vk::ImageView& levelView : depthPyramidLevelViews)
+		vkDevice.destroyImageView(levelView);
+	depthPyramidLevelViews.clear();
+	vkDevice.destroyImageView(depthPyramidView);
+	vkDevice.destroyImage(depthPyramidImage);
+	allocator.free(depthPyramidAllocation);
+}
+
+void Engine::createGpuCullingPipeline() {
+	std::array<vk::DescriptorSetLayout, 2> setLayouts = {gpuCullingDescriptor.getLayout(), pyramidSamplingDescriptor.getLayout()};
+	vk::PushConstantRange pushConstantRange = vk::PushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(be::CullingPhase));
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo(
+		{},
+		setLayouts.size(),
+		setLayouts.data(),
+		1,
+		&pushConstantRange
+	);
+	gpuCullingPipelineLayout = vkDevice.createPipelineLayout(pipelineLayoutInfo);
+	gpuCullingPipeline = createComputePipeline("gpuCulling", "cullRanges", gpuCullingPipelineLayout);
+}
+
+void Engine::createDepthPyramidPipeline() {
+	vk::PushConstantRange levelRange = vk::PushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(be::PyramidLevel));
+	vk::PipelineLayoutCreateInfo pyramidLayoutInfo = vk::PipelineLayoutCreateInfo(
+		{},
+		1,
+		&depthPyramidDescriptor.getLayout(),
+		1,
+		&levelRange
+	);
+	depthPyramidPipelineLayout = vkDevice.createPipelineLayout(pyramidLayoutInfo);
+	depthPyramidPipeline = createComputePipeline("depthPyramid", "reducePyramid", depthPyramidPipelineLayout);
+}
+
+void Engine::updateCullingCamera(uint32_t currentFrame) {
+	// the bounds are in mesh space, before the dequantization of packed positions
+	glm::mat4 proj = camera->getProj();
+	be::CullingCamera cullingCamera = {
+		camera->getView() * glm::scale(glm::mat4(1), glm::vec3(0.1)),
+		proj,
+		std::abs(proj[1][1]) * swapChainExtent.height / 2,
+		be::LOD_PIXEL_ERROR,
+		static_cast<uint32_t>(indexRanges.size()),
+		occlusionCulling,
+		glm::vec2(swapChainExtent.width, swapChainExtent.height),
+		static_cast<uint32_t>(depthPyramidLevelViews.size()),
+		0
+	};
+	cullingCameraBuffers[currentFrame].update<be::CullingCamera>(&cullingCamera);
+}
+
+void Engine::recordGpuCulling(vk::CommandBuffer commandBuffer, uint32_t currentFrame, be::CullingPhase phase) {
+	if (phase == be::CullingPhase::early) {
+		commandBuffer.fillBuffer(drawCountBuffers[currentFrame].getBuffer(), 0, vk::WholeSize, 0);
+		commandBuffer.fillBuffer(occlusionStatsBuffers[currentFrame].getBuffer(), 0, vk::WholeSize, 0);
+		// the visibility was written by the late phase of the previous frame
+		vk::MemoryBarrier2 resetBarrier = vk::MemoryBarrier2(
+			vk::PipelineStageFlagBits2::eTransfer | vk::PipelineStageFlagBits2::eComputeShader,
+			vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eShaderStorageWrite,
+			vk::PipelineStageFlagBits2::eComputeShader,
+			vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+		);
+		commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &resetBarrier));
+	}
+
+	std::array<vk::DescriptorSet, 2> sets = {gpuCullingDescriptor.getSets()[currentFrame], pyramidSamplingDescriptor.getSets()[0]};
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, gpuCullingPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, gpuCullingPipelineLayout, 0, sets, {});
+	commandBuffer.pushConstants(gpuCullingPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(phase), &phase);
+	commandBuffer.dispatch((indexRanges.size() + 63) / 64, 1, 1);
+
+	vk::MemoryBarrier2 drawBarrier = vk::MemoryBarrier2(
+		vk::PipelineStageFlagBits2::eComputeShader,
+		vk::AccessFlagBits2::eShaderStorageWrite,
+		vk::PipelineStageFlagBits2::eDrawIndirect,
+		vk::AccessFlagBits2::eIndirectCommandRead
+	);
+	commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &drawBarrier));
+	// the late phase writes the last stats, drawFrame reads them after the fence and the fence alone does not make them visible
+	if (phase == be::CullingPhase::late) {
+		vk::MemoryBarrier2 statsBarrier = vk::MemoryBarrier2(
+			vk::PipelineStageFlagBits2::eComputeShader,
+			vk::AccessFlagBits2::eShaderStorageWrite,
+			vk::PipelineStageFlagBits2::eHost,
+			vk::AccessFlagBits2::eHostRead
+		);
+		commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &statsBarrier));
+	}
+}
+
+void Engine::recordDepthPyramid(vk::CommandBuffer commandBuffer) {
+	transition_image_layout(
+		commandBuffer,
+		depthMapImage,
+		vk::ImageLayout::eDepthAttachmentOptimal,
+		vk::ImageLayout::eShaderReadOnlyOptimal,
+		vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+		vk::AccessFlagBits2::eShaderSampledRead,
+		vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+		vk::PipelineStageFlagBits2::eComputeShader,
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)
+	);
+	// the previous content is not needed, only the reads of the last culling pass have to be done
+	transition_image_layout(
+		commandBuffer,
+		depthPyramidImage,
+		vk::ImageLayout::eUndefined,
+		vk::ImageLayout::eGeneral,
+		{},
+		vk::AccessFlagBits2::eShaderStorageWrite,
+		vk::PipelineStageFlagBits2::eComputeShader,
+		vk::PipelineStageFlagBits2::eComputeShader,
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, depthPyramidLevelViews.size(), 0, 1)
+	);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, depthPyramidPipeline);
+	vk::Extent2D sourceSize = swapChainExtent;
+	for (uint32_t level = 0; level < depthPyramidLevelViews.size(); level++) {
+		be::PyramidLevel pyramidLevel = {sourceSize, be::getPyramidLevelExtent(swapChainExtent, level), level == 0};
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, depthPyramidPipelineLayout, 0, depthPyramidDescriptor.getSets()[level], {});
+		commandBuffer.pushConstants(depthPyramidPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(pyramidLevel), &pyramidLevel);
+		commandBuffer.dispatch((pyramidLevel.size.width + 7) / 8, (pyramidLevel.size.height + 7) / 8, 1);
+		// the next level, or the late culling phase after the last one
+		vk::MemoryBarrier2 levelBarrier = vk::MemoryBarrier2(
+			vk::PipelineStageFlagBits2::eComputeShader,
+			vk::AccessFlagBits2::eShaderStorageWrite,
+			vk::PipelineStageFlagBits2::eComputeShader,
+			vk::AccessFlagBits2::eShaderSampledRead
+		);
+		commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &levelBarrier));
+		sourceSize = pyramidLevel.size;
+	}
+
+	transition_image_layout(
+		commandBuffer,
+		depthMapImage,
+		vk::ImageLayout::eShaderReadOnlyOptimal,
+		vk::ImageLayout::eDepthAttachmentOptimal,
+		vk::AccessFlagBits2::eShaderSampledRead,
+		vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+		vk::PipelineStageFlagBits2::eComputeShader,
+		vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)
+	);
 }
 
-void Engine::createVertexBuffer(const std::vector<Vertex>& verticies) {
-	vk::DeviceSize vboSize = sizeof(Vertex) * verticies.size();
-	be::Buffer stagingBuffer = be::Buffer(vkDevice, vboSize);
-	stagingBuffer.create(vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, vkPhysicalDevice);
-	stagingBuffer.map<Vertex>(verticies);
+void Engine::createVertexBuffer(std::span<const Vertex> verticies) {
+	if (vertexFormat == be::VertexFormat::packed) {
+		bool hasColors = std::ranges::any_of(verticies, [](const Vertex& vertex) {
+			return vertex.color != glm::vec3(1);
+		});
+		if (hasColors) {
+			std::println("Mesh has vertex colors, falling back to the full vertex format.");
+			vertexFormat = be::VertexFormat::full;
+		}
+	}
+
+	vk::DeviceSize vboSize;
+	std::vector<PackedVertex> packedVerticies;
+	if (vertexFormat == be::VertexFormat::packed) {
+		glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+		for (const Vertex& vertex : verticies) {
+			boundsMin = glm::min(boundsMin, vertex.pos);
+			boundsMax = glm::max(boundsMax, vertex.pos);
+		}
+		packedVerticies.reserve(verticies.size());
+		for (const Vertex& vertex : verticies)
+			packedVerticies.push_back(PackedVertex::pack(vertex, boundsMin, boundsMax));
+		meshTransform = PackedVertex::getDequantization(boundsMin, boundsMax);
+
+		vboSize = sizeof(PackedVertex) * packedVerticies.size();
+		std::println("Packed {} vertices in {} bytes instead of {}.", verticies.size(), vboSize, sizeof(Vertex) * verticies.size());
+	} else {
+		vboSize = sizeof(Vertex) * verticies.size();
+	}
 
 	vbo = be::Buffer(vkDevice, vboSize);
-	vbo.create(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::SharingMode::eExclusive, vkPhysicalDevice);
-	vbo.copyBuffer(stagingBuffer, commandPool, graphicsQueue);
+	vbo.create(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, uploads.getSharingMode(), allocator, be::MemoryUsage::gpuOnly, "vertices", uploads.getQueueFamilies());
+	if (vertexFormat == be::VertexFormat::packed)
+		uploads.enqueueBuffer<PackedVertex>(vbo, packedVerticies);
+	else
+		uploads.enqueueBuffer<Vertex>(vbo, verticies);
 }
 
-void Engine::createIndexBuffer(const std::vector<int>& indexes) {
-	vk::DeviceSize iboSize = sizeof(int) * indexes.size();
+template<typename T>
+void Engine::createIndexBuffer(std::span<const T> indexes, std::span<const be::IndexRange> ranges) {
+	static_assert(std::is_same_v<T, uint16_t> || std::is_same_v<T, uint32_t>);
+	vk::DeviceSize iboSize = sizeof(T) * indexes.size();
 	numVerticies = indexes.size();
-	be::Buffer stagingBuffer = be::Buffer(vkDevice, iboSize);
-	stagingBuffer.create(vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, vkPhysicalDevice);
-	stagingBuffer.map<int>(indexes);
-
+	indexType = sizeof(T) == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	indexRanges.assign(ranges.begin(), ranges.end());
 	ibo = be::Buffer(vkDevice, iboSize);
-	ibo.create(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::SharingMode::eExclusive, vkPhysicalDevice);
-	ibo.copyBuffer(stagingBuffer, commandPool, graphicsQueue);
+	ibo.create(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, uploads.getSharingMode(), allocator, be::MemoryUsage::gpuOnly, "indices", uploads.getQueueFamilies());
+	uploads.enqueueBuffer<T>(ibo, indexes);
 }
 
-void Engine::createSSBO(const std::vector<MaterialObject>& materials) {
+void Engine::createSSBO(std::span<const MaterialObject> materials) {
 	vk::DeviceSize ssboSize = sizeof(MaterialObject) * materials.size();
 	numMaterials = materials.size();
-	be::Buffer stagingBuffer = be::Buffer(vkDevice, ssboSize);
-	stagingBuffer.create(vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, vkPhysicalDevice);
-	stagingBuffer.map<MaterialObject>(materials);
-
 	ssbo = be::Buffer(vkDevice, ssboSize);
-	ssbo.create(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive, vkPhysicalDevice);
-	ssbo.copyBuffer(stagingBuffer, commandPool, graphicsQueue);
+	ssbo.create(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, uploads.getSharingMode(), allocator, be::MemoryUsage::gpuOnly, "materials", uploads.getQueueFamilies());
+	uploads.enqueueBuffer<MaterialObject>(ssbo, materials);
 }
 
-void Engine::loadTextures(const std::vector<std::filesystem::path>& texturePath) {
+void Engine::loadTextures(const std::vector<std::filesystem::path>& texturePath, std::span<const MaterialObject> materials) {
 	be::Texture::setDevice(vkDevice);
 	be::Texture::setPhysicalDevice(vkPhysicalDevice);
+	be::Texture::setAllocator(allocator);
+	be::Texture::setBlockCompression(blockCompression);
+	textureCache.init(std::filesystem::current_path()/"data"/"textureCache");
+	be::Texture::setCache(&textureCache);
+	be::Texture::setResidentSize(be::STREAMING_RESIDENT_SIZE);
 	be::Texture::createTextureSampler();
+	std::vector<be::TextureRole> roles = std::vector<be::TextureRole>(texturePath.size(), be::TextureRole::color);
+	// only the diffuse maps get feedback from the shader, the other textures are loaded whole
+	std::vector<bool> streamed = std::vector<bool>(texturePath.size(), false);
+	for (const MaterialObject& material : materials) {
+		if (material.indexBumpMap >= 0)
+			roles[material.indexBumpMap] = be::TextureRole::bump;
+		if (material.indexDiffuseMap >= 0)
+			streamed[material.indexDiffuseMap] = true;
+	}
 	std::filesystem::path imagePath = std::filesystem::current_path()/"data"/"sponza";
-	for (const std::filesystem::path& path : texturePath) {
-		be::Texture texture = be::Texture(imagePath / path, graphicsQueue);
+	auto uploadStart = std::chrono::steady_clock::now();
+	be::TextureUploader uploader = be::TextureUploader(vkDevice, commandPool, graphicsQueue);
+	for (size_t i = 0; i < texturePath.size(); i++) {
+		be::Texture texture = be::Texture(imagePath / texturePath[i], graphicsQueue, roles[i], streamed[i]);
 		texture.createTextureImage(vk::ImageType::e2D,
-							1,
+							texture.getMipChainLength() - texture.getBaseLevel(),
 							1,
 							vk::SampleCountFlagBits::e1,
 							vk::ImageTiling::eOptimal,
-							vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+							// the defragmenter and the streamer copy the textures they move
+							vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
 							vk::SharingMode::eExclusive,
-							vk::MemoryPropertyFlagBits::eDeviceLocal
+							be::MemoryUsage::gpuOnly
 		);
-		texture.transitionImageLayout(vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, commandPool);
-		texture.copyBufferToImage(commandPool);
-		texture.transitionImageLayout(vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, commandPool);
+		uploader.add(texture);
 		textures.push_back(texture);
 	}
+	// a single submission and a single wait for every texture
+	uploader.submit();
+	// the streamer reads the finer levels again when they are sampled
+	for (be::Texture& texture : textures)
+		texture.releaseStagingBuffer();
+	textureStreamer.init(
+		vkDevice,
+		allocator,
+		uploads,
+		MAX_FRAME_IN_FLIGHT,
+		materials,
+		// the table writes the set of each frame when it is recorded
+		[this](size_t, vk::ImageView oldView, vk::ImageView newView) {
+			bindlessTable.replaceImageView(oldView, newView);
+		}
+	);
+	for (size_t i = 0; i < textures.size(); i++)
+		textureStreamer.addTexture(textures[i], imagePath / texturePath[i], roles[i]);
+	std::println("Loaded and uploaded {} textures in {:.1f} ms.",
+		textures.size(),
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count()
+	);
+	size_t compressedTextures = std::ranges::count_if(textures, [](const be::Texture& texture) {
+		return texture.getFormat() != vk::Format::eR8G8B8A8Srgb;
+	});
+	vk::DeviceSize textureBytes = 0;
+	for (const be::Texture& texture : textures)
+		textureBytes += texture.getAllocation().size;
+	std::println("{} of {} textures block compressed, {:.1f} MiB of texture memory resident before streaming.",
+		compressedTextures,
+		textures.size(),
+		textureBytes / (1024.0 * 1024.0)
+	);
+	const be::TextureCacheStats& cacheStats = textureCache.getStats();
+	std::println("Texture cache: {} hits, {} misses, {} evictions, {} entries in {:.1f} MiB.",
+		cacheStats.hits,
+		cacheStats.misses,
+		cacheStats.evictions,
+		cacheStats.entries,
+		cacheStats.bytes / (1024.0 * 1024.0)
+	);
+	be::MemoryStats memoryStats = allocator.getStats();
+	std::println("Device memory: {} allocations in {} blocks and {} dedicated allocations, {:.1f} of {:.1f} MiB used, {} of {} vkAllocateMemory allowed.",
+		memoryStats.allocations,
+		memoryStats.blocks,
+		memoryStats.dedicatedAllocations,
+		memoryStats.usedBytes / 1048576.0,
+		memoryStats.reservedBytes / 1048576.0,
+		memoryStats.blocks + memoryStats.dedicatedAllocations,
+		allocator.getMemoryAllocationLimit()
+	);
 }
 
 void Engine::createCommandPool() {
@@ -403,6 +1205,7 @@ void Engine::createCommandPool() {
 	);
 
 	commandPool = vkDevice.createCommandPool(commandPoolCreateInfo);
+	uploads.init(vkDevice, vkPhysicalDevice, allocator, transferQueue, transferQueueFamily, graphicsQueueFamily);
 }
 
 void Engine::createDescriptorPool() {
@@ -410,7 +1213,7 @@ void Engine::createDescriptorPool() {
 	std::vector poolSize = {
 		vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAME_IN_FLIGHT)
 	};
-	poolSize.push_back(vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, textures.size() * MAX_FRAME_IN_FLIGHT));
+	// texture feedback
 	poolSize.push_back(vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, MAX_FRAME_IN_FLIGHT));
 	descriptor.createPool(poolSize, MAX_FRAME_IN_FLIGHT);
 }
@@ -427,11 +1230,11 @@ void Engine::createCommandBuffers() {
 
 void Engine::createDepthMaps() {
 	depthMapFormat = findSupportedFormat(
-		vkPhysicalDevice, {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment
+		vkPhysicalDevice, {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage
 	);
-	std::tie(depthMapMemory, depthMapImage) = createImage(
+	std::tie(depthMapAllocation, depthMapImage) = createImage(
 		vkDevice,
-		vkPhysicalDevice,
+		allocator,
 		vk::ImageType::e2D,
 		depthMapFormat,
 		vk::Extent3D(swapChainExtent.width, swapChainExtent.height, 1),
@@ -439,9 +1242,11 @@ void Engine::createDepthMaps() {
 		1,
 		vk::SampleCountFlagBits::e1,
 		vk::ImageTiling::eOptimal,
-		vk::ImageUsageFlagBits::eDepthStencilAttachment,
+		// sampled by the depth pyramid reduction
+		vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
 		vk::SharingMode::eExclusive,
-		vk::MemoryPropertyFlagBits::eDeviceLocal
+		be::MemoryUsage::gpuOnly,
+		"depth map"
 	);
 	depthMapView = createImageView(
 		vkDevice, 
@@ -480,34 +1285,11 @@ void Engine::transition_image_layout(
 	commandBuffer.pipelineBarrier2(dependencyInfo);
 }
 
-void Engine::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame) {	
-	vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo();
-	commandBuffer.begin(beginInfo);
-
-	transition_image_layout(
-		commandBuffer,
-		swapChainImages[imageIndex],
-		vk::ImageLayout::eUndefined,
-		vk::ImageLayout::eColorAttachmentOptimal,
-		vk::AccessFlagBits2::eColorAttachmentWrite,
-		vk::AccessFlagBits2::eColorAttachmentWrite,
-		vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-		vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
-	);
-	transition_image_layout(
-		commandBuffer, 
-		depthMapImage, 
-		vk::ImageLayout::eUndefined, 
-		vk::ImageLayout::eDepthAttachmentOptimal, 
-		{}, 
-		vk::AccessFlagBits2::eDepthStencilAttachmentWrite, 
-		vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
-		vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
-		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)
-	);
+void Engine::beginScenePass(vk::CommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame, vk::AttachmentLoadOp loadOp) {
 	vk::ClearValue clearColor = vk::ClearColorValue(0.01f, 0.01f, 0.01f, 1.0f);
 	vk::ClearValue clearColorDepth = vk::ClearDepthStencilValue(1, 0);
+	// the depth pyramid is built from the depth of the early pass
+	bool keepDepth = (renderMode == be::RenderMode::meshletCulling || renderMode == be::RenderMode::gpuCulling) && occlusionCulling;
 
 	vk::RenderingAttachmentInfo attachementInfo = vk::RenderingAttachmentInfo(
 		swapChainImageViews[imageIndex],
@@ -515,7 +1297,7 @@ void Engine::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t image
 		vk::ResolveModeFlagBits::eNone,
 		{},
 		vk::ImageLayout::eUndefined,
-		vk::AttachmentLoadOp::eClear,
+		loadOp,
 		vk::AttachmentStoreOp::eStore,
 		clearColor
 	);
@@ -525,8 +1307,8 @@ void Engine::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t image
 		vk::ResolveModeFlagBits::eNone,
 		{},
 		vk::ImageLayout::eUndefined,
-		vk::AttachmentLoadOp::eClear,
-		vk::AttachmentStoreOp::eDontCare,
+		loadOp,
+		keepDepth ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
 		clearColorDepth
 	);
 	vk::RenderingInfo renderingInfo = vk::RenderingInfo(
@@ -543,8 +1325,12 @@ void Engine::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t image
 	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
 	VkDeviceSize offests[] = {0};
 	commandBuffer.bindVertexBuffers(0, 1, &vbo.getBuffer(), offests);
-	commandBuffer.bindIndexBuffer(ibo.getBuffer(), 0, vk::IndexType::eUint32);
-	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descriptor.getSets()[currentFrame], {});
+	if (renderMode == be::RenderMode::meshletCulling)
+		commandBuffer.bindIndexBuffer(culledIndexBuffers[currentFrame].getBuffer(), 0, vk::IndexType::eUint32);
+	else
+		commandBuffer.bindIndexBuffer(ibo.getBuffer(), 0, indexType);
+	std::array<vk::DescriptorSet, 2> sets = {descriptor.getSets()[currentFrame], bindlessTable.getSet(currentFrame)};
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, sets, {});
 
 	vk::Viewport viewport = vk::Viewport(
 		0,
@@ -561,9 +1347,114 @@ void Engine::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t image
 		swapChainExtent
 	);
 	commandBuffer.setScissor(0, 1, &scissor);
+}
+
+void Engine::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame) {	
+	vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo();
+	commandBuffer.begin(beginInfo);
+	// queued uploads hold the handles of their destination, nothing moves until they are flushed, nor while a texture changes image
+	if (defragmenter.update(commandBuffer, currentFrame, !uploads.hasPendingUploads() && !textureStreamer.isSwapping())) {
+		const be::DefragmentationStats& defragmentationStats = defragmenter.getStats();
+		std::println("Defragmentation {} a block: {} blocks, {:.1f} MiB reserved and {:.0f}% fragmentation before, {} blocks, {:.1f} MiB and {:.0f}% after.",
+			defragmentationStats.after.blocks < defragmentationStats.before.blocks ? "released" : "could not empty",
+			defragmentationStats.before.blocks,
+			defragmentationStats.before.reservedBytes / 1048576.0,
+			100.0f * be::getFragmentation(defragmentationStats.before),
+			defragmentationStats.after.blocks,
+			defragmentationStats.after.reservedBytes / 1048576.0,
+			100.0f * be::getFragmentation(defragmentationStats.after)
+		);
+	}
+	// also resets the texture feedback of the frame, before the scene pass writes it
+	textureStreamer.update(commandBuffer, currentFrame);
+	// the images the streamer took, before the scene samples them
+	uploadWaitValue = uploads.recordAcquires(commandBuffer);
+	// the changes of the defragmenter and the streamer reach the set of this frame
+	bindlessTable.update(currentFrame);
+
+	if (renderMode == be::RenderMode::meshletCulling)
+		recordCulling(commandBuffer, currentFrame, be::CullingPhase::early);
+	else if (renderMode == be::RenderMode::gpuCulling)
+		recordGpuCulling(commandBuffer, currentFrame, be::CullingPhase::early);
+
+	transition_image_layout(
+		commandBuffer,
+		swapChainImages[imageIndex],
+		vk::ImageLayout::eUndefined,
+		vk::ImageLayout::eColorAttachmentOptimal,
+		vk::AccessFlagBits2::eColorAttachmentWrite,
+		vk::AccessFlagBits2::eColorAttachmentWrite,
+		vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+		vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+	);
+	transition_image_layout(
+		commandBuffer, 
+		depthMapImage, 
+		vk::ImageLayout::eUndefined, 
+		vk::ImageLayout::eDepthAttachmentOptimal, 
+		{}, 
+		vk::AccessFlagBits2::eDepthStencilAttachmentWrite, 
+		vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+		vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)
+	);
 
-	commandBuffer.drawIndexed(numVerticies, 1, 0, 0, 0);
+	beginScenePass(commandBuffer, imageIndex, currentFrame, vk::AttachmentLoadOp::eClear);
+	if (renderMode == be::RenderMode::meshletCulling) {
+		// meshlets visible last frame, or every meshlet in the frustum without occlusion culling
+		commandBuffer.drawIndexedIndirect(drawCommandBuffers[currentFrame].getBuffer(), 0, 1, sizeof(vk::DrawIndexedIndirectCommand));
+	} else if (renderMode == be::RenderMode::gpuCulling) {
+		// ranges visible last frame, or every range in the frustum without occlusion culling
+		commandBuffer.drawIndexedIndirectCount(
+			rangeDrawBuffers[currentFrame].getBuffer(),
+			0,
+			drawCountBuffers[currentFrame].getBuffer(),
+			0,
+			indexRanges.size(),
+			sizeof(vk::DrawIndexedIndirectCommand)
+		);
+	} else {
+		for (uint32_t s : visibleSubmeshes) {
+			for (uint32_t r = submeshes[s].firstRange; r < submeshes[s].firstRange + submeshes[s].rangeCount; r++) {
+				if (selectedLods[r] == be::LOD_CULLED)
+					continue;
+				const be::LodLevel& lod = lods[indexRanges[r].firstLod + selectedLods[r]];
+				commandBuffer.drawIndexed(lod.indexCount, 1, lod.firstIndex, indexRanges[r].vertexOffset, 0);
+			}
+		}
+	}
 	commandBuffer.endRendering();
+
+	if ((renderMode == be::RenderMode::meshletCulling || renderMode == be::RenderMode::gpuCulling) && occlusionCulling) {
+		recordDepthPyramid(commandBuffer);
+		if (renderMode == be::RenderMode::meshletCulling)
+			recordCulling(commandBuffer, currentFrame, be::CullingPhase::late);
+		else
+			recordGpuCulling(commandBuffer, currentFrame, be::CullingPhase::late);
+		// the late pass loads what the early one rendered
+		vk::MemoryBarrier2 colorBarrier = vk::MemoryBarrier2(
+			vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+			vk::AccessFlagBits2::eColorAttachmentWrite,
+			vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+			vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite
+		);
+		commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &colorBarrier));
+		beginScenePass(commandBuffer, imageIndex, currentFrame, vk::AttachmentLoadOp::eLoad);
+		if (renderMode == be::RenderMode::meshletCulling)
+			commandBuffer.drawIndexedIndirect(drawCommandBuffers[currentFrame].getBuffer(), sizeof(vk::DrawIndexedIndirectCommand), 1, sizeof(vk::DrawIndexedIndirectCommand));
+		else
+			commandBuffer.drawIndexedIndirectCount(
+				rangeDrawBuffers[currentFrame].getBuffer(),
+				indexRanges.size() * sizeof(vk::DrawIndexedIndirectCommand),
+				drawCountBuffers[currentFrame].getBuffer(),
+				sizeof(uint32_t),
+				indexRanges.size(),
+				sizeof(vk::DrawIndexedIndirectCommand)
+			);
+		commandBuffer.endRendering();
+	}
+
 	transition_image_layout(
 		commandBuffer,
 		swapChainImages[imageIndex],
@@ -575,6 +1466,7 @@ void Engine::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t image
 		vk::PipelineStageFlagBits2::eBottomOfPipe,
 		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
 	);
+	textureStreamer.recordReadback(commandBuffer);
 	
 	commandBuffer.end();
 }
@@ -590,15 +1482,89 @@ void Engine::createSyncObjects() {
 	}
 }
 
+void Engine::selectLods(uint32_t currentFrame) {
+	// the range bounds are in mesh space, before the dequantization of packed positions
+	glm::mat4 modelView = camera->getView() * glm::scale(glm::mat4(1), glm::vec3(0.1));
+	glm::mat4 proj = camera->getProj();
+	be::Frustum frustum = be::Frustum::fromMatrix(proj * modelView);
+	float pixelsPerUnit = std::abs(proj[1][1]) * swapChainExtent.height / 2;
+	submeshCuller.cull(frustum, visibleSubmeshes);
+	if (occlusionRasterizer.hasOccluders()) {
+		occlusionRasterizer.render(proj * modelView);
+		occlusionRasterizer.cull(proj * modelView, submeshes, visibleSubmeshes);
+		// the culling pass tests the meshlets of the submeshes left against the same depth
+		if (renderMode == be::RenderMode::meshletCulling) {
+			std::span<const float> depth = occlusionRasterizer.getDepth();
+			occlusionDepthBuffers[currentFrame].write(depth.data(), depth.size_bytes(), 0);
+		}
+	}
+	std::ranges::fill(selectedLods, be::LOD_CULLED);
+	for (uint32_t s : visibleSubmeshes) {
+		for (uint32_t r = submeshes[s].firstRange; r < submeshes[s].firstRange + submeshes[s].rangeCount; r++) {
+			const be::IndexRange& range = indexRanges[r];
+			if (!frustum.intersectsSphere(glm::vec3(range.sphere), range.sphere.w))
+				continue;
+			std::span<const be::LodLevel> levels = std::span<const be::LodLevel>(lods).subspan(range.firstLod, range.lodCount);
+			selectedLods[r] = be::selectLod(levels, range.sphere, modelView, pixelsPerUnit);
+		}
+	}
+	if (renderMode == be::RenderMode::meshletCulling)
+		lodSelectionBuffers[currentFrame].update<uint32_t>(selectedLods.data());
+}
+
 void Engine::updateUniformBuffer(uint32_t imageIndex) {
-	glm::mat4 vp = camera->getProj() * camera->getView() * glm::scale(glm::mat4(1), glm::vec3(0.1));
+	glm::mat4 vp = camera->getProj() * camera->getView() * glm::scale(glm::mat4(1), glm::vec3(0.1)) * meshTransform;
 	uniformBufferObjects[imageIndex].update<glm::mat4>(&vp);
 }
 
-void Engine::drawFrame(double ) {
+void Engine::drawFrame(double dt) {
 	// Setup fence
 	while(vkDevice.waitForFences(1, &inFlightFences[currentFrame], vk::True, UINT64_MAX) == vk::Result::eTimeout)
 		;
+	// the levels sampled by the last submission of this frame slot
+	textureStreamer.readFeedback(currentFrame);
+	streamingStatsTimer += dt;
+	if (streamingStatsTimer >= 5e6) {
+		streamingStatsTimer = 0;
+		const be::StreamingStats& streamingStats = textureStreamer.getStats();
+		std::println("Texture streaming: {} levels loaded, {} evicted, {} swaps, {} failed, {:.1f} of {:.1f} MiB resident.",
+			streamingStats.loadedLevels,
+			streamingStats.evictedLevels,
+			streamingStats.swaps,
+			streamingStats.failedLoads,
+			streamingStats.residentBytes / 1048576.0,
+			textureStreamer.getBudget() / 1048576.0
+		);
+	}
+	if (renderMode == be::RenderMode::gpuCulling && occlusionCulling) {
+		// written by the last submission of this frame slot, complete once its fence is signaled
+		occlusionStatsBuffers[currentFrame].read(&occlusionStats);
+		occlusionStatsTimer += dt;
+		if (occlusionStatsTimer >= 5e6) {
+			occlusionStatsTimer = 0;
+			std::println("Occlusion culling: {} ranges in the frustum, {} occluded, {} drawn early, {} drawn late.",
+				occlusionStats.inFrustum,
+				occlusionStats.occluded,
+				occlusionStats.earlyDraws,
+				occlusionStats.lateDraws
+			);
+		}
+	} else if (occlusionRasterizer.hasOccluders()) {
+		occlusionStatsTimer += dt;
+		if (occlusionStatsTimer >= 5e6) {
+			occlusionStatsTimer = 0;
+			const be::SoftwareOcclusionStats& stats = occlusionRasterizer.getStats();
+			std::println("Software occlusion: {} of {} occluder triangles drawn in {:.2f} ms, {} of {} submeshes ({:.0f}%) occluded in {:.2f} ms.",
+				stats.rasterizedTriangles,
+				stats.occluderTriangles,
+				stats.rasterMilliseconds,
+				stats.occludedBoxes,
+				stats.testedBoxes,
+				stats.testedBoxes == 0 ? 0.0 : 100.0 * stats.occludedBoxes / stats.testedBoxes,
+				stats.testMilliseconds
+			);
+		}
+	}
 	
 	// get image of swapchain and check if the swap chain is still OK
 	uint32_t imageIndex;
@@ -617,23 +1583,36 @@ void Engine::drawFrame(double ) {
 		throw std::runtime_error("Failed to acquire image of the swapchain.");
 	}
 	vk::Result vkResult = vkDevice.resetFences(1, &inFlightFences[currentFrame]);
+	// submitted before the frame, so its commands see the uploaded data
+	uploads.flush();
 	
 	
 	// Setup record of command buffer
 	commandBuffers[currentFrame].reset();
+	// the gpu path only uploads the camera, its cost does not depend on the scene
+	if (renderMode == be::RenderMode::gpuCulling)
+		updateCullingCamera(currentFrame);
+	else
+		selectLods(currentFrame);
 	recordCommandBuffer(commandBuffers[currentFrame], imageIndex, currentFrame);
 
 	updateUniformBuffer(currentFrame);
-	vk::PipelineStageFlags waitDstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	// the frame also waits for the copies it reads, the binary semaphores ignore their values
+	std::array<vk::Semaphore, 2> waitSemaphores = {imageAvailableSemaphores[currentFrame], uploads.getTimeline()};
+	std::array<vk::PipelineStageFlags, 2> waitDstStageMasks = {vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eAllCommands};
+	std::array<uint64_t, 2> waitValues = {0, uploadWaitValue};
+	uint64_t signalValue = 0;
+	vk::TimelineSemaphoreSubmitInfo timelineInfo = vk::TimelineSemaphoreSubmitInfo(waitValues, signalValue);
 	// Submitting command buffer
 	vk::SubmitInfo submitInfo = vk::SubmitInfo(
-		1,
-		&imageAvailableSemaphores[currentFrame],
-		&waitDstStageMask,
+		waitSemaphores.size(),
+		waitSemaphores.data(),
+		waitDstStageMasks.data(),
 		1,
 		&commandBuffers[currentFrame],
 		1,
-		&renderFinishedSemaphores[imageIndex]
+		&renderFinishedSemaphores[imageIndex],
+		&timelineInfo
 	);
 
 	graphicsQueue.submit(submitInfo, inFlightFences[currentFrame]);
@@ -665,6 +1644,65 @@ void Engine::setRenderer(const Window& window) {
 	renderer = window;
 }
 
+void Engine::setVertexFormat(be::VertexFormat format) {
+	vertexFormat = format;
+}
+
+void Engine::setRenderMode(be::RenderMode mode) {
+	renderMode = mode;
+}
+
+void Engine::setOcclusionCulling(bool enabled) {
+	occlusionCulling = enabled;
+}
+
+const be::OcclusionStats& Engine::getOcclusionStats() const {
+	return occlusionStats;
+}
+
+const be::SoftwareOcclusionStats& Engine::getSoftwareOcclusionStats() const {
+	return occlusionRasterizer.getStats();
+}
+
+be::UploadManager& Engine::getUploads() {
+	return uploads;
+}
+
+be::Defragmenter& Engine::getDefragmenter() {
+	return defragmenter;
+}
+
+be::TextureStreamer& Engine::getTextureStreamer() {
+	return textureStreamer;
+}
+
+be::BindlessTable& Engine::getBindlessTable() {
+	return bindlessTable;
+}
+
+void Engine::pick(const glm::vec2& cursorPos) {
+	int width, height;
+	glfwGetWindowSize(renderer.getWindow(), &width, &height);
+	if (width == 0 || height == 0)
+		return;
+	glm::vec2 ndc = glm::vec2(2 * cursorPos.x / width - 1, 2 * cursorPos.y / height - 1);
+	// the hierarchy is in mesh space, before the dequantization of packed positions
+	glm::mat4 clip = camera->getProj() * camera->getView() * glm::scale(glm::mat4(1), glm::vec3(0.1));
+	std::optional<be::RayHit> hit = sceneBvh.pick(be::Ray::fromClip(clip, ndc));
+	if (!hit) {
+		std::println("Nothing under the cursor.");
+		return;
+	}
+	const be::Submesh& submesh = submeshes[hit->submesh];
+	std::println("Picked triangle {} of submesh {}, shape {} with material {}, {:.2f} units away.",
+		hit->triangle,
+		hit->submesh,
+		submesh.shapeIndex,
+		submesh.materialIndex,
+		hit->distance
+	);
+}
+
 void Engine::initVulkan() {
 	createInstance();
 	createSurface();
@@ -676,14 +1714,71 @@ void Engine::initVulkan() {
 	createCommandPool();
 	loadObjects();
 	createDescriptorSetLayout();
+	createBindlessTable();
 	createDepthMaps();
 	createGraphicPipeline();
+	if (renderMode == be::RenderMode::meshletCulling) {
+		createCullingDescriptors();
+		createDepthPyramidDescriptors();
+		createDepthPyramid();
+		createCullingPipeline();
+		createDepthPyramidPipeline();
+	} else if (renderMode == be::RenderMode::gpuCulling) {
+		createGpuCullingDescriptors();
+		createDepthPyramidDescriptors();
+		createDepthPyramid();
+		createGpuCullingPipeline();
+		createDepthPyramidPipeline();
+	}
 	// createVertexBuffer();
 	// createIndexBuffer();
 	createDescriptorPool();
 	createDescriptorSets();
 	createCommandBuffers();
 	createSyncObjects();
+	createDefragmenter();
+}
+
+void Engine::createDefragmenter() {
+	defragmenter.init(
+		vkDevice,
+		allocator,
+		MAX_FRAME_IN_FLIGHT,
+		[this](size_t frame, vk::Buffer oldBuffer, vk::Buffer newBuffer) {
+			descriptor.replaceBuffer(frame, oldBuffer, newBuffer);
+			cullingDescriptor.replaceBuffer(frame, oldBuffer, newBuffer);
+			gpuCullingDescriptor.replaceBuffer(frame, oldBuffer, newBuffer);
+			bindlessTable.replaceBuffer(oldBuffer, newBuffer);
+		},
+		[this](size_t, vk::ImageView oldView, vk::ImageView newView) {
+			bindlessTable.replaceImageView(oldView, newView);
+		}
+	);
+	// the vertex, index and indirect buffers are bound by handle every frame and follow their moves
+	defragmenter.addBuffer(vbo);
+	defragmenter.addBuffer(ibo);
+	defragmenter.addBuffer(ssbo);
+	if (!submeshes.empty())
+		defragmenter.addBuffer(submeshBuffer);
+	if (renderMode == be::RenderMode::meshletCulling) {
+		defragmenter.addBuffer(meshletBuffer);
+		defragmenter.addBuffer(meshletVertexBuffer);
+		defragmenter.addBuffer(meshletTriangleBuffer);
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			defragmenter.addBuffer(culledIndexBuffers[i]);
+			defragmenter.addBuffer(drawCommandBuffers[i]);
+		}
+	} else if (renderMode == be::RenderMode::gpuCulling) {
+		defragmenter.addBuffer(rangeBuffer);
+		defragmenter.addBuffer(lodBuffer);
+		defragmenter.addBuffer(visibilityBuffer);
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			defragmenter.addBuffer(rangeDrawBuffers[i]);
+			defragmenter.addBuffer(drawCountBuffers[i]);
+		}
+	}
+	for (be::Texture& texture : textures)
+		defragmenter.addTexture(texture);
 }
 
 void Engine::cleanUpSwapChain() {
@@ -704,11 +1799,55 @@ void Engine::cleanUp() {
 	for(be::Texture& texture : textures)
 		texture.clean();
 	ssbo.clean();
+	if (!submeshes.empty())
+		submeshBuffer.clean();
+	if (renderMode == be::RenderMode::meshletCulling) {
+		meshletBuffer.clean();
+		meshletVertexBuffer.clean();
+		meshletTriangleBuffer.clean();
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			culledIndexBuffers[i].clean();
+			drawCommandBuffers[i].clean();
+			lodSelectionBuffers[i].clean();
+			occlusionDepthBuffers[i].clean();
+		}
+		rangeBuffer.clean();
+		meshletVisibilityBuffer.clean();
+		cullingDescriptor.clean();
+		vkDevice.destroyPipeline(cullingPipeline);
+		vkDevice.destroyPipelineLayout(cullingPipelineLayout);
+	} else if (renderMode == be::RenderMode::gpuCulling) {
+		rangeBuffer.clean();
+		lodBuffer.clean();
+		for (size_t i = 0; i < MAX_FRAME_IN_FLIGHT; i++) {
+			cullingCameraBuffers[i].clean();
+			rangeDrawBuffers[i].clean();
+			drawCountBuffers[i].clean();
+			occlusionStatsBuffers[i].clean();
+		}
+		visibilityBuffer.clean();
+		gpuCullingDescriptor.clean();
+		vkDevice.destroyPipeline(gpuCullingPipeline);
+		vkDevice.destroyPipelineLayout(gpuCullingPipelineLayout);
+	}
+	if (renderMode == be::RenderMode::meshletCulling || renderMode == be::RenderMode::gpuCulling) {
+		cleanUpDepthPyramid();
+		depthPyramidDescriptor.clean();
+		pyramidSamplingDescriptor.clean();
+		vkDevice.destroyPipeline(depthPyramidPipeline);
+		vkDevice.destroyPipelineLayout(depthPyramidPipelineLayout);
+	}
 	be::Texture::cleanSampler();
+	uploads.clean();
 	descriptor.clean();
+	bindlessTable.clean();
+	vkDevice.destroyImageView(fallbackTextureView);
+	vkDevice.destroyImage(fallbackTextureImage);
+	allocator.free(fallbackTextureAllocation);
+	fallbackBuffer.clean();
 	vkDevice.destroyImage(depthMapImage);
 	vkDevice.destroyImageView(depthMapView);
-	vkDevice.freeMemory(depthMapMemory);
+	allocator.free(depthMapAllocation);
 	vkDevice.destroyPipeline(graphicsPipeline);
 	vkDevice.destroyCommandPool(commandPool);
 	for (vk::Semaphore& renderFinishedSemaphore : renderFinishedSemaphores) 
@@ -717,6 +1856,9 @@ void Engine::cleanUp() {
 		vkDevice.destroySemaphore(imageAvailableSemaphores[i]);
 		vkDevice.destroyFence(inFlightFences[i]);
 	}
+	defragmenter.clean();
+	textureStreamer.clean();
+	allocator.clean();
 	vkb::destroy_device(vkbDevice);
 	vkInstance.destroySurfaceKHR(surface);
 	vkb::destroy_instance(vkbInstance);
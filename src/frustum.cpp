@@ -0,0 +1,25 @@
+#include "frustum.hpp"
+
+be::Frustum be::Frustum::fromMatrix(const glm::mat4& clip) {
+    auto row = [&clip](int i) {
+        return glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    };
+    Frustum frustum = {{
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2),
+        row(3) - row(2)
+    }};
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool be::Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : planes)
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    return true;
+}
@@ -0,0 +1,189 @@
+#include "frustumCuller.hpp"
+#include <array>
+#include <bit>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(BE_X86_KERNELS)
+#define BE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BE_TARGET_AVX2
+#endif
+
+namespace {
+    const size_t LANES = 8;
+
+    // a box is outside when its whole extent is behind one plane: dot(n, c) + w + dot(|n|, e) < 0
+    struct PlaneTerms {
+        float nx, ny, nz, w;
+        float ax, ay, az;
+    };
+
+    std::array<PlaneTerms, 6> planeTerms(const be::Frustum& frustum) {
+        std::array<PlaneTerms, 6> terms;
+        for (size_t p = 0; p < 6; p++) {
+            const glm::vec4& plane = frustum.planes[p];
+            terms[p] = {plane.x, plane.y, plane.z, plane.w, std::abs(plane.x), std::abs(plane.y), std::abs(plane.z)};
+        }
+        return terms;
+    }
+}
+
+be::FrustumCuller::FrustumCuller() :
+    m_boxCount(0),
+    m_kernel(CullKernel::scalar)
+{
+    if (isSupported(CullKernel::avx2))
+        m_kernel = CullKernel::avx2;
+    else if (isSupported(CullKernel::sse))
+        m_kernel = CullKernel::sse;
+}
+
+bool be::FrustumCuller::isSupported(CullKernel kernel) {
+    switch (kernel) {
+        case CullKernel::scalar:
+            return true;
+#ifdef BE_X86_KERNELS
+        // SSE2 is part of x86-64
+        case CullKernel::sse:
+            return true;
+        case CullKernel::avx2:
+#ifdef __GNUC__
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+#endif
+        default:
+            return false;
+    }
+}
+
+void be::FrustumCuller::setKernel(CullKernel kernel) {
+    m_kernel = isSupported(kernel) ? kernel : CullKernel::scalar;
+}
+
+be::CullKernel be::FrustumCuller::getKernel() const {
+    return m_kernel;
+}
+
+size_t be::FrustumCuller::getBoxCount() const {
+    return m_boxCount;
+}
+
+void be::FrustumCuller::setBoxes(std::span<const glm::vec3> boxesMin, std::span<const glm::vec3> boxesMax) {
+    m_boxCount = boxesMin.size();
+    size_t paddedCount = (m_boxCount + LANES - 1) / LANES * LANES;
+    // the padding boxes sit at infinity so they are always culled
+    const float far = INFINITY;
+    for (std::vector<float>* array : {&m_centerX, &m_centerY, &m_centerZ})
+        array->assign(paddedCount, -far);
+    for (std::vector<float>* array : {&m_extentX, &m_extentY, &m_extentZ})
+        array->assign(paddedCount, 0);
+    for (size_t i = 0; i < m_boxCount; i++) {
+        glm::vec3 center = (boxesMin[i] + boxesMax[i]) * 0.5f;
+        glm::vec3 extent = (boxesMax[i] - boxesMin[i]) * 0.5f;
+        m_centerX[i] = center.x;
+        m_centerY[i] = center.y;
+        m_centerZ[i] = center.z;
+        m_extentX[i] = extent.x;
+        m_extentY[i] = extent.y;
+        m_extentZ[i] = extent.z;
+    }
+}
+
+void be::FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    visible.clear();
+    switch (m_kernel) {
+        case CullKernel::avx2:
+            cullAvx2(frustum, visible);
+            break;
+        case CullKernel::sse:
+            cullSse(frustum, visible);
+            break;
+        default:
+            cullScalar(frustum, visible);
+            break;
+    }
+}
+
+void be::FrustumCuller::cullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    std::array<PlaneTerms, 6> planes = planeTerms(frustum);
+    for (size_t i = 0; i < m_boxCount; i++) {
+        bool inside = true;
+        for (const PlaneTerms& plane : planes) {
+            float distance = plane.nx * m_centerX[i] + plane.ny * m_centerY[i] + plane.nz * m_centerZ[i] + plane.w;
+            float radius = plane.ax * m_extentX[i] + plane.ay * m_extentY[i] + plane.az * m_extentZ[i];
+            if (distance + radius < 0) {
+                inside = false;
+                break;
+            }
+        }
+        if (inside)
+            visible.push_back(i);
+    }
+}
+
+#ifdef BE_X86_KERNELS
+void be::FrustumCuller::cullSse(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    std::array<PlaneTerms, 6> planes = planeTerms(frustum);
+    for (size_t i = 0; i < m_boxCount; i += 4) {
+        __m128 cx = _mm_loadu_ps(&m_centerX[i]), cy = _mm_loadu_ps(&m_centerY[i]), cz = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&m_extentX[i]), ey = _mm_loadu_ps(&m_extentY[i]), ez = _mm_loadu_ps(&m_extentZ[i]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const PlaneTerms& plane : planes) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.nx), cx), _mm_mul_ps(_mm_set1_ps(plane.ny), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.nz), cz), _mm_set1_ps(plane.w))
+            );
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.ax), ex), _mm_mul_ps(_mm_set1_ps(plane.ay), ey)),
+                _mm_mul_ps(_mm_set1_ps(plane.az), ez)
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        unsigned mask = _mm_movemask_ps(inside);
+        while (mask != 0) {
+            visible.push_back(i + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+}
+
+BE_TARGET_AVX2 void be::FrustumCuller::cullAvx2(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    std::array<PlaneTerms, 6> planes = planeTerms(frustum);
+    for (size_t i = 0; i < m_boxCount; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&m_centerX[i]), cy = _mm256_loadu_ps(&m_centerY[i]), cz = _mm256_loadu_ps(&m_centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&m_extentX[i]), ey = _mm256_loadu_ps(&m_extentY[i]), ez = _mm256_loadu_ps(&m_extentZ[i]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const PlaneTerms& plane : planes) {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.nx), cx), _mm256_mul_ps(_mm256_set1_ps(plane.ny), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.nz), cz), _mm256_set1_ps(plane.w))
+            );
+            __m256 radius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.ax), ex), _mm256_mul_ps(_mm256_set1_ps(plane.ay), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(plane.az), ez)
+            );
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        unsigned mask = _mm256_movemask_ps(inside);
+        while (mask != 0) {
+            visible.push_back(i + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+}
+#else
+void be::FrustumCuller::cullSse(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    cullScalar(frustum, visible);
+}
+
+void be::FrustumCuller::cullAvx2(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    cullScalar(frustum, visible);
+}
+#endif
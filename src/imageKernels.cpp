@@ -0,0 +1,624 @@
+#include "imageKernels.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(BE_X86_KERNELS)
+#define BE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define BE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BE_TARGET_SSE41
+#define BE_TARGET_AVX2
+#endif
+
+namespace {
+    // entries of the linear to sRGB table, fine enough to round like the exact curve
+    constexpr int SRGB_TABLE_SIZE = 8192;
+    constexpr int KAISER_TAPS = 8;
+
+    struct SrgbTables {
+        std::array<float, 256> toLinear;
+        std::array<int32_t, SRGB_TABLE_SIZE> fromLinear;
+    };
+
+    const SrgbTables& getSrgbTables() {
+        static const SrgbTables tables = [] {
+            SrgbTables values;
+            for (size_t i = 0; i < values.toLinear.size(); i++) {
+                float srgb = i / 255.0f;
+                values.toLinear[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+            }
+            for (size_t i = 0; i < values.fromLinear.size(); i++) {
+                float linear = i / static_cast<float>(SRGB_TABLE_SIZE - 1);
+                float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+                values.fromLinear[i] = static_cast<int32_t>(std::clamp(srgb * 255.0f + 0.5f, 0.0f, 255.0f));
+            }
+            return values;
+        }();
+        return tables;
+    }
+
+    uint8_t toSrgb(const SrgbTables& tables, float linear) {
+        int index = static_cast<int>(linear * (SRGB_TABLE_SIZE - 1) + 0.5f);
+        return static_cast<uint8_t>(tables.fromLinear[std::clamp(index, 0, SRGB_TABLE_SIZE - 1)]);
+    }
+
+    // the windowed sinc at half the source rate, tap k of output x reads source 2x - 3 + k
+    const std::array<float, KAISER_TAPS>& getKaiserWeights() {
+        static const std::array<float, KAISER_TAPS> weights = [] {
+            const double beta = 4.0;
+            const double radius = KAISER_TAPS / 2;
+            auto bessel = [](double x) {
+                double sum = 1.0;
+                double term = 1.0;
+                for (int k = 1; k < 32; k++) {
+                    term *= (x / (2 * k)) * (x / (2 * k));
+                    sum += term;
+                }
+                return sum;
+            };
+            std::array<double, KAISER_TAPS> values;
+            double total = 0.0;
+            for (int k = 0; k < KAISER_TAPS; k++) {
+                double distance = k - 3.5;
+                double x = std::numbers::pi * distance / 2;
+                double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+                double ratio = distance / radius;
+                values[k] = sinc * bessel(beta * std::sqrt(1.0 - ratio * ratio)) / bessel(beta);
+                total += values[k];
+            }
+            std::array<float, KAISER_TAPS> normalized;
+            for (int k = 0; k < KAISER_TAPS; k++)
+                normalized[k] = static_cast<float>(values[k] / total);
+            return normalized;
+        }();
+        return weights;
+    }
+
+    uint32_t getLevelSize(uint32_t size) {
+        return std::max(size / 2, 1u);
+    }
+
+    /*
+        The vector kernels take a range of pixels and give back how many they did, the scalar ones finish the rest.
+        Their results match the scalar ones bit for bit, but for the renormalized normals that can differ by one.
+    */
+
+    void expandRgbToRgbaScalar(const uint8_t* rgb, uint8_t* rgba, size_t begin, size_t count) {
+        for (size_t i = begin; i < count; i++) {
+            rgba[i * 4] = rgb[i * 3];
+            rgba[i * 4 + 1] = rgb[i * 3 + 1];
+            rgba[i * 4 + 2] = rgb[i * 3 + 2];
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    void expandRToRgbaScalar(const uint8_t* r, uint8_t* rgba, size_t begin, size_t count) {
+        for (size_t i = begin; i < count; i++) {
+            rgba[i * 4] = r[i];
+            rgba[i * 4 + 1] = r[i];
+            rgba[i * 4 + 2] = r[i];
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    // c * a / 255 rounded, without a division
+    uint8_t multiply(uint8_t color, uint8_t alpha) {
+        uint32_t product = color * alpha + 128;
+        return static_cast<uint8_t>((product + (product >> 8)) >> 8);
+    }
+
+    void premultiplyAlphaScalar(uint8_t* rgba, size_t begin, size_t count) {
+        for (size_t i = begin; i < count; i++)
+            for (size_t channel = 0; channel < 3; channel++)
+                rgba[i * 4 + channel] = multiply(rgba[i * 4 + channel], rgba[i * 4 + 3]);
+    }
+
+    void renormalizeNormalsScalar(uint8_t* rgba, size_t begin, size_t count) {
+        for (size_t i = begin; i < count; i++) {
+            uint8_t* texel = rgba + i * 4;
+            std::array<float, 3> normal;
+            for (size_t channel = 0; channel < 3; channel++)
+                normal[channel] = texel[channel] * (2.0f / 255.0f) - 1.0f;
+            float length = normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2];
+            if (length > 1e-12f) {
+                length = std::sqrt(length);
+                for (float& value : normal)
+                    value = value / length;
+            } else {
+                normal = {0.0f, 0.0f, 1.0f};
+            }
+            for (size_t channel = 0; channel < 3; channel++)
+                texel[channel] = static_cast<uint8_t>(std::nearbyint(normal[channel] * 127.5f + 127.5f));
+        }
+    }
+
+    // the output pixels from begin to count of a row, the last row or column of an odd side is repeated when it is alone
+    void downsampleBoxScalar(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* destination, size_t begin, size_t count, bool srgb) {
+        const SrgbTables& tables = getSrgbTables();
+        for (size_t x = begin; x < count; x++) {
+            size_t x0 = 2 * x * 4;
+            size_t x1 = std::min<size_t>(2 * x + 1, width - 1) * 4;
+            for (size_t channel = 0; channel < 4; channel++) {
+                // alpha is always linear
+                if (srgb && channel < 3) {
+                    float sum = tables.toLinear[row0[x0 + channel]] + tables.toLinear[row0[x1 + channel]];
+                    sum = sum + tables.toLinear[row1[x0 + channel]];
+                    sum = sum + tables.toLinear[row1[x1 + channel]];
+                    destination[x * 4 + channel] = toSrgb(tables, sum * 0.25f);
+                } else {
+                    uint32_t sum = row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel] + 2;
+                    destination[x * 4 + channel] = static_cast<uint8_t>(sum >> 2);
+                }
+            }
+        }
+    }
+
+    void storeKaiserTexel(const float* values, uint8_t* texel, bool srgb) {
+        const SrgbTables& tables = getSrgbTables();
+        for (size_t channel = 0; channel < 4; channel++) {
+            float value = std::clamp(values[channel], 0.0f, 1.0f);
+            if (srgb && channel < 3)
+                texel[channel] = toSrgb(tables, value);
+            else
+                texel[channel] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+    }
+
+    void linearize(std::span<const uint8_t> source, float* linear, bool srgb) {
+        const SrgbTables& tables = getSrgbTables();
+        for (size_t i = 0; i < source.size(); i++)
+            linear[i] = srgb && i % 4 != 3 ? tables.toLinear[source[i]] : source[i] / 255.0f;
+    }
+
+    void storeKaiserRow(const float* values, uint8_t* texels, size_t count, bool srgb) {
+        for (size_t x = 0; x < count; x++)
+            storeKaiserTexel(values + x * 4, texels + x * 4, srgb);
+    }
+
+    // tap k of output x reads source 2x - 3 + k, the taps outside of the image are clamped
+    void filterKaiserRowScalar(const float* row, uint32_t width, float* output, size_t begin, size_t count) {
+        const std::array<float, KAISER_TAPS>& weights = getKaiserWeights();
+        for (size_t x = begin; x < count; x++) {
+            std::array<float, 4> sum = {};
+            for (int k = 0; k < KAISER_TAPS; k++) {
+                const float* texel = row + std::clamp<int64_t>(2 * int64_t(x) - 3 + k, 0, width - 1) * 4;
+                for (size_t channel = 0; channel < 4; channel++)
+                    sum[channel] = sum[channel] + weights[k] * texel[channel];
+            }
+            std::copy(sum.begin(), sum.end(), output + x * 4);
+        }
+    }
+
+    // the vertical pass of a whole output row, from the rows its taps read
+    void filterKaiserColumnsScalar(const std::array<const float*, KAISER_TAPS>& rows, float* output, size_t begin, size_t length) {
+        const std::array<float, KAISER_TAPS>& weights = getKaiserWeights();
+        for (size_t i = begin; i < length; i++) {
+            float sum = 0.0f;
+            for (int k = 0; k < KAISER_TAPS; k++)
+                sum = sum + weights[k] * rows[k][i];
+            output[i] = sum;
+        }
+    }
+
+#ifdef BE_X86_KERNELS
+    BE_TARGET_SSE41 size_t expandRgbToRgbaSse41(const uint8_t* rgb, uint8_t* rgba, size_t count) {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(0xff000000);
+        size_t i = 0;
+        // 16 bytes are read for 12, the last 4 pixels are left to the scalar loop
+        for (; i + 6 <= count; i += 4) {
+            __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), _mm_or_si128(_mm_shuffle_epi8(texels, shuffle), alpha));
+        }
+        return i;
+    }
+
+    BE_TARGET_AVX2 size_t expandRgbToRgbaAvx2(const uint8_t* rgb, uint8_t* rgba, size_t count) {
+        // the 12 bytes of each half go to their own lane before the shuffle
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+        const __m256i shuffle = _mm256_setr_epi8(
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+        );
+        const __m256i alpha = _mm256_set1_epi32(0xff000000);
+        size_t i = 0;
+        for (; i + 11 <= count; i += 8) {
+            __m256i texels = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + i * 3)), lanes);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(texels, shuffle), alpha));
+        }
+        return i;
+    }
+
+    BE_TARGET_SSE41 size_t expandRToRgbaSse41(const uint8_t* r, uint8_t* rgba, size_t count) {
+        const __m128i shuffles[4] = {
+            _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+            _mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+            _mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+            _mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1)
+        };
+        const __m128i alpha = _mm_set1_epi32(0xff000000);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+            for (size_t part = 0; part < 4; part++)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + (i + part * 4) * 4), _mm_or_si128(_mm_shuffle_epi8(values, shuffles[part]), alpha));
+        }
+        return i;
+    }
+
+    BE_TARGET_AVX2 size_t expandRToRgbaAvx2(const uint8_t* r, uint8_t* rgba, size_t count) {
+        const __m256i low = _mm256_setr_epi8(
+            0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+            4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1
+        );
+        const __m256i high = _mm256_setr_epi8(
+            8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1,
+            12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1
+        );
+        const __m256i alpha = _mm256_set1_epi32(0xff000000);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i values = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(values, low), alpha));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4 + 32), _mm256_or_si256(_mm256_shuffle_epi8(values, high), alpha));
+        }
+        return i;
+    }
+
+    // two pixels widened to 16 bits
+    BE_TARGET_SSE41 __m128i premultiplyPair(__m128i texels) {
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(texels, 0xFF), 0xFF);
+        __m128i product = _mm_add_epi16(_mm_mullo_epi16(texels, alpha), _mm_set1_epi16(128));
+        product = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+        return _mm_blend_epi16(product, texels, 0x88);
+    }
+
+    BE_TARGET_SSE41 size_t premultiplyAlphaSse41(uint8_t* rgba, size_t count) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4));
+            __m128i low = premultiplyPair(_mm_unpacklo_epi8(texels, _mm_setzero_si128()));
+            __m128i high = premultiplyPair(_mm_unpackhi_epi8(texels, _mm_setzero_si128()));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), _mm_packus_epi16(low, high));
+        }
+        return i;
+    }
+
+    BE_TARGET_AVX2 __m256i premultiplyPairs(__m256i texels) {
+        __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(texels, 0xFF), 0xFF);
+        __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(texels, alpha), _mm256_set1_epi16(128));
+        product = _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+        return _mm256_blend_epi16(product, texels, 0x88);
+    }
+
+    BE_TARGET_AVX2 size_t premultiplyAlphaAvx2(uint8_t* rgba, size_t count) {
+        size_t i = 0;
+        // unpacking and packing both work per lane, so the pixels come back in order
+        for (; i + 8 <= count; i += 8) {
+            __m256i texels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + i * 4));
+            __m256i low = premultiplyPairs(_mm256_unpacklo_epi8(texels, _mm256_setzero_si256()));
+            __m256i high = premultiplyPairs(_mm256_unpackhi_epi8(texels, _mm256_setzero_si256()));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), _mm256_packus_epi16(low, high));
+        }
+        return i;
+    }
+
+    BE_TARGET_SSE41 size_t renormalizeNormalsSse41(uint8_t* rgba, size_t count) {
+        const __m128 scale = _mm_set1_ps(2.0f / 255.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 up = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+        const __m128 half = _mm_set1_ps(127.5f);
+        for (size_t i = 0; i < count; i++) {
+            int32_t packed;
+            std::copy_n(rgba + i * 4, 4, reinterpret_cast<uint8_t*>(&packed));
+            __m128 texel = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+            __m128 normal = _mm_sub_ps(_mm_mul_ps(texel, scale), one);
+            __m128 length = _mm_dp_ps(normal, normal, 0x7F);
+            __m128 valid = _mm_cmpgt_ps(length, _mm_set1_ps(1e-12f));
+            normal = _mm_blendv_ps(up, _mm_div_ps(normal, _mm_sqrt_ps(length)), valid);
+            normal = _mm_blend_ps(_mm_add_ps(_mm_mul_ps(normal, half), half), texel, 0b1000);
+            __m128i values = _mm_cvtps_epi32(normal);
+            packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(values, values), _mm_setzero_si128()));
+            std::copy_n(reinterpret_cast<const uint8_t*>(&packed), 4, rgba + i * 4);
+        }
+        return count;
+    }
+
+    BE_TARGET_AVX2 size_t renormalizeNormalsAvx2(uint8_t* rgba, size_t count) {
+        const __m256 scale = _mm256_set1_ps(2.0f / 255.0f);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 up = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+        const __m256 half = _mm256_set1_ps(127.5f);
+        size_t i = 0;
+        // one pixel per lane
+        for (; i + 2 <= count; i += 2) {
+            __m256 texels = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rgba + i * 4))));
+            __m256 normals = _mm256_sub_ps(_mm256_mul_ps(texels, scale), one);
+            __m256 lengths = _mm256_dp_ps(normals, normals, 0x7F);
+            __m256 valid = _mm256_cmp_ps(lengths, _mm256_set1_ps(1e-12f), _CMP_GT_OQ);
+            normals = _mm256_blendv_ps(up, _mm256_div_ps(normals, _mm256_sqrt_ps(lengths)), valid);
+            normals = _mm256_blend_ps(_mm256_add_ps(_mm256_mul_ps(normals, half), half), texels, 0b10001000);
+            __m256i values = _mm256_cvtps_epi32(normals);
+            __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(rgba + i * 4), _mm_packus_epi16(words, _mm_setzero_si128()));
+        }
+        return i;
+    }
+
+    // the averages of the 2 output pixels of 4 source pixels in both rows, in 16 bits
+    BE_TARGET_SSE41 __m128i averagePairs(const uint8_t* row0, const uint8_t* row1) {
+        __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+        __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+        __m128i left = _mm_add_epi16(_mm_cvtepu8_epi16(top), _mm_cvtepu8_epi16(bottom));
+        __m128i right = _mm_add_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(top, 8)), _mm_cvtepu8_epi16(_mm_srli_si128(bottom, 8)));
+        __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(left, right), _mm_unpackhi_epi64(left, right));
+        return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+    }
+
+    BE_TARGET_SSE41 size_t downsampleBoxSse41(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* destination, size_t count, bool srgb) {
+        // the sRGB curve needs two table lookups per channel, gathering them is slower than the scalar loop
+        if (srgb || width < 2)
+            return 0;
+        size_t x = 0;
+        for (; x + 4 <= count; x += 4) {
+            __m128i first = averagePairs(row0 + x * 8, row1 + x * 8);
+            __m128i second = averagePairs(row0 + x * 8 + 16, row1 + x * 8 + 16);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x * 4), _mm_packus_epi16(first, second));
+        }
+        return x;
+    }
+
+    // per lane, the sum of 2 output pixels of 4 source pixels in both rows, in 16 bits
+    BE_TARGET_AVX2 __m256i sumPairs(const uint8_t* row0, const uint8_t* row1) {
+        __m256i top = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0)));
+        __m256i bottom = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1)));
+        return _mm256_add_epi16(top, bottom);
+    }
+
+    BE_TARGET_AVX2 size_t downsampleBoxLinearAvx2(const uint8_t* row0, const uint8_t* row1, uint8_t* destination, size_t count) {
+        // the packing leaves the output pixels as 0 2 4 6 1 3 5 7
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        const __m256i rounding = _mm256_set1_epi16(2);
+        size_t x = 0;
+        for (; x + 8 <= count; x += 8) {
+            __m256i averages[2];
+            for (size_t half = 0; half < 2; half++) {
+                const uint8_t* top = row0 + (x + half * 4) * 8;
+                const uint8_t* bottom = row1 + (x + half * 4) * 8;
+                __m256i first = sumPairs(top, bottom);
+                __m256i second = sumPairs(top + 16, bottom + 16);
+                __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(first, second), _mm256_unpackhi_epi64(first, second));
+                averages[half] = _mm256_srli_epi16(_mm256_add_epi16(sum, rounding), 2);
+            }
+            __m256i packed = _mm256_packus_epi16(averages[0], averages[1]);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + x * 4), _mm256_permutevar8x32_epi32(packed, order));
+        }
+        return x;
+    }
+
+    BE_TARGET_AVX2 size_t downsampleBoxAvx2(const uint8_t* row0, const uint8_t* row1, uint32_t width, uint8_t* destination, size_t count, bool srgb) {
+        if (srgb || width < 2)
+            return 0;
+        return downsampleBoxLinearAvx2(row0, row1, destination, count);
+    }
+
+    BE_TARGET_SSE41 size_t filterKaiserRowSse41(const float* row, uint32_t width, float* output, size_t count) {
+        const std::array<float, KAISER_TAPS>& weights = getKaiserWeights();
+        for (size_t x = 0; x < count; x++) {
+            int64_t first = 2 * int64_t(x) - 3;
+            // only the pixels near the sides need their taps clamped
+            bool inside = first >= 0 && first + KAISER_TAPS <= width;
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < KAISER_TAPS; k++) {
+                int64_t tap = inside ? first + k : std::clamp<int64_t>(first + k, 0, width - 1);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(row + tap * 4)));
+            }
+            _mm_storeu_ps(output + x * 4, sum);
+        }
+        return count;
+    }
+
+    BE_TARGET_SSE41 size_t filterKaiserColumnsSse41(const std::array<const float*, KAISER_TAPS>& rows, float* output, size_t length) {
+        const std::array<float, KAISER_TAPS>& weights = getKaiserWeights();
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < KAISER_TAPS; k++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+            _mm_storeu_ps(output + i, sum);
+        }
+        return i;
+    }
+
+    BE_TARGET_AVX2 size_t filterKaiserColumnsAvx2(const std::array<const float*, KAISER_TAPS>& rows, float* output, size_t length) {
+        const std::array<float, KAISER_TAPS>& weights = getKaiserWeights();
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            for (int k = 0; k < KAISER_TAPS; k++)
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+            _mm256_storeu_ps(output + i, sum);
+        }
+        return i;
+    }
+#else
+    size_t expandRgbToRgbaSse41(const uint8_t*, uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t expandRgbToRgbaAvx2(const uint8_t*, uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t expandRToRgbaSse41(const uint8_t*, uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t expandRToRgbaAvx2(const uint8_t*, uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t premultiplyAlphaSse41(uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t premultiplyAlphaAvx2(uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t renormalizeNormalsSse41(uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t renormalizeNormalsAvx2(uint8_t*, size_t) {
+        return 0;
+    }
+
+    size_t downsampleBoxSse41(const uint8_t*, const uint8_t*, uint32_t, uint8_t*, size_t, bool) {
+        return 0;
+    }
+
+    size_t downsampleBoxAvx2(const uint8_t*, const uint8_t*, uint32_t, uint8_t*, size_t, bool) {
+        return 0;
+    }
+
+    size_t filterKaiserRowSse41(const float*, uint32_t, float*, size_t) {
+        return 0;
+    }
+
+    size_t filterKaiserColumnsSse41(const std::array<const float*, KAISER_TAPS>&, float*, size_t) {
+        return 0;
+    }
+
+    size_t filterKaiserColumnsAvx2(const std::array<const float*, KAISER_TAPS>&, float*, size_t) {
+        return 0;
+    }
+#endif
+}
+
+be::ImageKernels::ImageKernels() :
+    m_kernel(ImageKernel::scalar)
+{
+    if (isSupported(ImageKernel::avx2))
+        m_kernel = ImageKernel::avx2;
+    else if (isSupported(ImageKernel::sse41))
+        m_kernel = ImageKernel::sse41;
+}
+
+bool be::ImageKernels::isSupported(ImageKernel kernel) {
+    switch (kernel) {
+        case ImageKernel::scalar:
+            return true;
+#if defined(BE_X86_KERNELS) && defined(__GNUC__)
+        case ImageKernel::sse41:
+            return __builtin_cpu_supports("sse4.1");
+        case ImageKernel::avx2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+void be::ImageKernels::setKernel(ImageKernel kernel) {
+    m_kernel = isSupported(kernel) ? kernel : ImageKernel::scalar;
+}
+
+be::ImageKernel be::ImageKernels::getKernel() const {
+    return m_kernel;
+}
+
+void be::ImageKernels::expandRgbToRgba(std::span<const uint8_t> rgb, std::span<uint8_t> rgba) const {
+    size_t count = std::min(rgb.size() / 3, rgba.size() / 4);
+    size_t done = 0;
+    if (m_kernel == ImageKernel::avx2)
+        done = expandRgbToRgbaAvx2(rgb.data(), rgba.data(), count);
+    else if (m_kernel == ImageKernel::sse41)
+        done = expandRgbToRgbaSse41(rgb.data(), rgba.data(), count);
+    expandRgbToRgbaScalar(rgb.data(), rgba.data(), done, count);
+}
+
+void be::ImageKernels::expandRToRgba(std::span<const uint8_t> r, std::span<uint8_t> rgba) const {
+    size_t count = std::min(r.size(), rgba.size() / 4);
+    size_t done = 0;
+    if (m_kernel == ImageKernel::avx2)
+        done = expandRToRgbaAvx2(r.data(), rgba.data(), count);
+    else if (m_kernel == ImageKernel::sse41)
+        done = expandRToRgbaSse41(r.data(), rgba.data(), count);
+    expandRToRgbaScalar(r.data(), rgba.data(), done, count);
+}
+
+void be::ImageKernels::premultiplyAlpha(std::span<uint8_t> rgba) const {
+    size_t count = rgba.size() / 4;
+    size_t done = 0;
+    if (m_kernel == ImageKernel::avx2)
+        done = premultiplyAlphaAvx2(rgba.data(), count);
+    else if (m_kernel == ImageKernel::sse41)
+        done = premultiplyAlphaSse41(rgba.data(), count);
+    premultiplyAlphaScalar(rgba.data(), done, count);
+}
+
+void be::ImageKernels::renormalizeNormals(std::span<uint8_t> rgba) const {
+    size_t count = rgba.size() / 4;
+    size_t done = 0;
+    if (m_kernel == ImageKernel::avx2)
+        done = renormalizeNormalsAvx2(rgba.data(), count);
+    else if (m_kernel == ImageKernel::sse41)
+        done = renormalizeNormalsSse41(rgba.data(), count);
+    renormalizeNormalsScalar(rgba.data(), done, count);
+}
+
+void be::ImageKernels::downsampleBox(std::span<const uint8_t> source, uint32_t width, uint32_t height, std::span<uint8_t> destination, bool srgb) const {
+    uint32_t nextWidth = getLevelSize(width);
+    uint32_t nextHeight = getLevelSize(height);
+    for (uint32_t y = 0; y < nextHeight; y++) {
+        const uint8_t* row0 = source.data() + static_cast<size_t>(2 * y) * width * 4;
+        const uint8_t* row1 = source.data() + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width * 4;
+        uint8_t* row = destination.data() + static_cast<size_t>(y) * nextWidth * 4;
+        size_t done = 0;
+        if (m_kernel == ImageKernel::avx2)
+            done = downsampleBoxAvx2(row0, row1, width, row, nextWidth, srgb);
+        else if (m_kernel == ImageKernel::sse41)
+            done = downsampleBoxSse41(row0, row1, width, row, nextWidth, srgb);
+        downsampleBoxScalar(row0, row1, width, row, done, nextWidth, srgb);
+    }
+}
+
+void be::ImageKernels::downsampleKaiser(std::span<const uint8_t> source, uint32_t width, uint32_t height, std::span<uint8_t> destination, std::span<float> scratch, bool srgb) const {
+    uint32_t nextWidth = getLevelSize(width);
+    uint32_t nextHeight = getLevelSize(height);
+    float* linear = scratch.data();
+    float* horizontal = linear + static_cast<size_t>(width) * height * 4;
+    linearize(source.first(static_cast<size_t>(width) * height * 4), linear, srgb);
+    for (uint32_t y = 0; y < height; y++) {
+        const float* row = linear + static_cast<size_t>(y) * width * 4;
+        float* output = horizontal + static_cast<size_t>(y) * nextWidth * 4;
+        size_t done = m_kernel == ImageKernel::scalar ? 0 : filterKaiserRowSse41(row, width, output, nextWidth);
+        filterKaiserRowScalar(row, width, output, done, nextWidth);
+    }
+    // the linear source is done with, it holds the output rows before they are stored
+    size_t length = static_cast<size_t>(nextWidth) * 4;
+    for (uint32_t y = 0; y < nextHeight; y++) {
+        std::array<const float*, KAISER_TAPS> rows;
+        for (int k = 0; k < KAISER_TAPS; k++)
+            rows[k] = horizontal + std::clamp<int64_t>(2 * int64_t(y) - 3 + k, 0, height - 1) * length;
+        size_t done = 0;
+        if (m_kernel == ImageKernel::avx2)
+            done = filterKaiserColumnsAvx2(rows, linear, length);
+        else if (m_kernel == ImageKernel::sse41)
+            done = filterKaiserColumnsSse41(rows, linear, length);
+        filterKaiserColumnsScalar(rows, linear, done, length);
+        storeKaiserRow(linear, destination.data() + y * length, nextWidth, srgb);
+    }
+}
+
+size_t be::ImageKernels::getKaiserScratchSize(uint32_t width, uint32_t height) {
+    return (static_cast<size_t>(width) + getLevelSize(width)) * height * 4;
+}
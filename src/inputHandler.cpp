@@ -4,7 +4,9 @@
 
 InputHandler::InputHandler() : 
     m_cursorPos(0, 0),
-    leftClickPressed(false)
+    leftClickPressed(false),
+    rightClickPressed(false),
+    m_pickRequested(false)
 {}
 
 void InputHandler::event(const Window& renderer, Camera& camera, const double dt) {
@@ -50,5 +52,18 @@ void InputHandler::event(const Window& renderer, Camera& camera, const double dt
     if (!buttonsPressed[static_cast<unsigned int>(Input::leftClick)]) {
         leftClickPressed = false;
     }
+    if (buttonsPressed[static_cast<unsigned int>(Input::rightClick)] && !rightClickPressed) {
+        m_pickRequested = true;
+        rightClickPressed = true;
+    }
+    if (!buttonsPressed[static_cast<unsigned int>(Input::rightClick)]) {
+        rightClickPressed = false;
+    }
+
+}
 
-}
\ No newline at end of file
+bool InputHandler::consumePickRequest() {
+    bool pickRequested = m_pickRequested;
+    m_pickRequested = false;
+    return pickRequested;
+}
@@ -0,0 +1,299 @@
+#include "ktxFile.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <string_view>
+#include <system_error>
+
+namespace {
+    constexpr std::array<unsigned char, 12> IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    constexpr std::string_view SOURCE_KEY = "BlastEngine.source";
+
+    struct Header {
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    struct LevelEntry {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    struct SourceStamp {
+        uint32_t version;
+        uint32_t role;
+        uint64_t size;
+        int64_t lastWrite;
+    };
+
+    // bytes of a 4x4 block, 0 for the formats the file does not handle
+    uint32_t getBlockBytes(vk::Format format) {
+        switch (format) {
+            case vk::Format::eBc7SrgbBlock:
+            case vk::Format::eBc5UnormBlock:
+                return 16;
+            case vk::Format::eBc4UnormBlock:
+                return 8;
+            default:
+                return 0;
+        }
+    }
+
+    uint64_t getLevelSize(vk::Format format, uint32_t width, uint32_t height, uint32_t level) {
+        uint64_t blocksX = (std::max(width >> level, 1u) + 3) / 4;
+        uint64_t blocksY = (std::max(height >> level, 1u) + 3) / 4;
+        return blocksX * blocksY * getBlockBytes(format);
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool stampSource(const std::filesystem::path& sourcePath, be::TextureRole role, SourceStamp& stamp) {
+        std::error_code error;
+        stamp = {be::KtxFile::VERSION, static_cast<uint32_t>(role), 0, 0};
+        stamp.size = std::filesystem::file_size(sourcePath, error);
+        if (error)
+            return false;
+        stamp.lastWrite = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+        return !error;
+    }
+
+    // the basic descriptor block of the Khronos data format specification for the three block formats
+    std::vector<uint32_t> createDataFormatDescriptor(vk::Format format) {
+        constexpr uint32_t MODEL_BC4 = 131;
+        constexpr uint32_t MODEL_BC5 = 132;
+        constexpr uint32_t MODEL_BC7 = 134;
+        constexpr uint32_t PRIMARIES_BT709 = 1;
+        constexpr uint32_t TRANSFER_LINEAR = 1;
+        constexpr uint32_t TRANSFER_SRGB = 2;
+
+        uint32_t model = format == vk::Format::eBc7SrgbBlock ? MODEL_BC7 : format == vk::Format::eBc5UnormBlock ? MODEL_BC5 : MODEL_BC4;
+        uint32_t transfer = format == vk::Format::eBc7SrgbBlock ? TRANSFER_SRGB : TRANSFER_LINEAR;
+        uint32_t blockBytes = getBlockBytes(format);
+        // a BC5 block is two BC4 blocks, red then green, the other formats have a single sample
+        uint32_t sampleCount = format == vk::Format::eBc5UnormBlock ? 2 : 1;
+        uint32_t sampleBits = format == vk::Format::eBc5UnormBlock ? 64 : blockBytes * 8;
+
+        std::vector<uint32_t> words = {
+            0,
+            0,
+            2 | (24 + 16 * sampleCount) << 16,
+            model | PRIMARIES_BT709 << 8 | transfer << 16,
+            // 4x4 texel blocks, stored as dimension - 1
+            3 | 3 << 8,
+            blockBytes,
+            0
+        };
+        for (uint32_t sample = 0; sample < sampleCount; sample++) {
+            words.push_back((sample * sampleBits) | (sampleBits - 1) << 16 | sample << 24);
+            words.push_back(0);
+            words.push_back(0);
+            words.push_back(UINT32_MAX);
+        }
+        words[0] = words.size() * sizeof(uint32_t);
+        return words;
+    }
+
+    std::vector<std::byte> createKeyValueData(const SourceStamp& stamp) {
+        uint32_t length = SOURCE_KEY.size() + 1 + sizeof(SourceStamp);
+        std::vector<std::byte> data = std::vector<std::byte>(alignUp(sizeof(uint32_t) + length, 4));
+        memcpy(data.data(), &length, sizeof(uint32_t));
+        memcpy(data.data() + sizeof(uint32_t), SOURCE_KEY.data(), SOURCE_KEY.size());
+        memcpy(data.data() + sizeof(uint32_t) + SOURCE_KEY.size() + 1, &stamp, sizeof(SourceStamp));
+        return data;
+    }
+
+    // the stamp stored under SOURCE_KEY, false when there is none
+    bool findSourceStamp(std::span<const std::byte> keyValueData, SourceStamp& stamp) {
+        size_t offset = 0;
+        while (offset + sizeof(uint32_t) <= keyValueData.size()) {
+            uint32_t length;
+            memcpy(&length, keyValueData.data() + offset, sizeof(uint32_t));
+            offset += sizeof(uint32_t);
+            if (length > keyValueData.size() - offset)
+                return false;
+            std::string_view entry = std::string_view(reinterpret_cast<const char*>(keyValueData.data() + offset), length);
+            if (entry.size() == SOURCE_KEY.size() + 1 + sizeof(SourceStamp) && entry.starts_with(SOURCE_KEY) && entry[SOURCE_KEY.size()] == '\0') {
+                memcpy(&stamp, entry.data() + SOURCE_KEY.size() + 1, sizeof(SourceStamp));
+                return true;
+            }
+            offset = alignUp(offset + length, 4);
+        }
+        return false;
+    }
+}
+
+be::KtxFile::KtxFile() :
+    m_file(),
+    m_format(vk::Format::eUndefined),
+    m_width(0),
+    m_height(0)
+{}
+
+bool be::KtxFile::load(const std::filesystem::path& path, const std::filesystem::path& sourcePath, TextureRole role) {
+    clean();
+    if (!m_file.open(path))
+        return false;
+
+    std::span<const std::byte> data = m_file.getData();
+    Header header;
+    if (data.size() < IDENTIFIER.size() + sizeof(Header) || memcmp(data.data(), IDENTIFIER.data(), IDENTIFIER.size()) != 0) {
+        clean();
+        return false;
+    }
+    memcpy(&header, data.data() + IDENTIFIER.size(), sizeof(Header));
+    vk::Format format = static_cast<vk::Format>(header.vkFormat);
+    if (getBlockBytes(format) == 0
+        || header.pixelWidth == 0
+        || header.pixelHeight == 0
+        || header.pixelDepth != 0
+        || header.layerCount != 0
+        || header.faceCount != 1
+        || header.levelCount == 0
+        || header.levelCount > std::bit_width(std::max(header.pixelWidth, header.pixelHeight))
+        || header.supercompressionScheme != 0
+        || static_cast<uint64_t>(header.kvdByteOffset) + header.kvdByteLength > data.size()) {
+        clean();
+        return false;
+    }
+
+    SourceStamp stored, stamp;
+    if (!findSourceStamp(data.subspan(header.kvdByteOffset, header.kvdByteLength), stored)
+        || !stampSource(sourcePath, role, stamp)
+        || memcmp(&stored, &stamp, sizeof(SourceStamp)) != 0) {
+        clean();
+        return false;
+    }
+
+    size_t levelIndex = IDENTIFIER.size() + sizeof(Header);
+    if (data.size() < levelIndex + sizeof(LevelEntry) * header.levelCount) {
+        clean();
+        return false;
+    }
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        LevelEntry entry;
+        memcpy(&entry, data.data() + levelIndex + level * sizeof(LevelEntry), sizeof(LevelEntry));
+        if (entry.byteLength != getLevelSize(format, header.pixelWidth, header.pixelHeight, level) || entry.byteOffset + entry.byteLength > data.size()) {
+            clean();
+            return false;
+        }
+        m_levels.push_back(data.subspan(entry.byteOffset, entry.byteLength));
+    }
+    m_format = format;
+    m_width = header.pixelWidth;
+    m_height = header.pixelHeight;
+    return true;
+}
+
+bool be::KtxFile::write(const std::filesystem::path& path, const std::filesystem::path& sourcePath, TextureRole role, const EncodedTexture& texture) {
+    SourceStamp stamp;
+    if (!stampSource(sourcePath, role, stamp))
+        return false;
+    std::vector<uint32_t> dataFormatDescriptor = createDataFormatDescriptor(texture.format);
+    std::vector<std::byte> keyValueData = createKeyValueData(stamp);
+
+    uint32_t levelCount = texture.levels.size();
+    Header header = {
+        .vkFormat = static_cast<uint32_t>(texture.format),
+        .typeSize = 1,
+        .pixelWidth = texture.width,
+        .pixelHeight = texture.height,
+        .pixelDepth = 0,
+        .layerCount = 0,
+        .faceCount = 1,
+        .levelCount = levelCount,
+        .supercompressionScheme = 0,
+        .dfdByteOffset = static_cast<uint32_t>(IDENTIFIER.size() + sizeof(Header) + sizeof(LevelEntry) * levelCount),
+        .dfdByteLength = static_cast<uint32_t>(dataFormatDescriptor.size() * sizeof(uint32_t)),
+        .kvdByteOffset = 0,
+        .kvdByteLength = static_cast<uint32_t>(keyValueData.size()),
+        .sgdByteOffset = 0,
+        .sgdByteLength = 0
+    };
+    header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+
+    // the smallest level comes first, each one aligned on a block
+    std::vector<LevelEntry> entries = std::vector<LevelEntry>(levelCount);
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for (uint32_t level = levelCount; level-- > 0;) {
+        offset = alignUp(offset, getBlockBytes(texture.format));
+        entries[level] = {offset, texture.levels[level].size(), texture.levels[level].size()};
+        offset += texture.levels[level].size();
+    }
+
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file = std::ofstream(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::println("Failed to write texture cache {}.", path.string());
+            return false;
+        }
+        const char zeros[16] = {};
+        file.write(reinterpret_cast<const char*>(IDENTIFIER.data()), IDENTIFIER.size());
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(entries.data()), sizeof(LevelEntry) * entries.size());
+        file.write(reinterpret_cast<const char*>(dataFormatDescriptor.data()), header.dfdByteLength);
+        file.write(reinterpret_cast<const char*>(keyValueData.data()), keyValueData.size());
+        uint64_t written = header.kvdByteOffset + header.kvdByteLength;
+        for (uint32_t level = levelCount; level-- > 0;) {
+            file.write(zeros, entries[level].byteOffset - written);
+            file.write(reinterpret_cast<const char*>(texture.levels[level].data()), texture.levels[level].size());
+            written = entries[level].byteOffset + entries[level].byteLength;
+        }
+        if (!file) {
+            std::println("Failed to write texture cache {}.", path.string());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error) {
+        std::println("Failed to write texture cache {} : {}.", path.string(), error.message());
+        return false;
+    }
+    return true;
+}
+
+vk::Format be::KtxFile::getFormat() const {
+    return m_format;
+}
+
+vk::Extent3D be::KtxFile::getExtent() const {
+    return vk::Extent3D(m_width, m_height, 1);
+}
+
+uint32_t be::KtxFile::getLevelCount() const {
+    return m_levels.size();
+}
+
+std::span<const std::byte> be::KtxFile::getLevel(uint32_t level) const {
+    return m_levels[level];
+}
+
+void be::KtxFile::clean() {
+    m_file.clean();
+    m_levels.clear();
+    m_format = vk::Format::eUndefined;
+    m_width = 0;
+    m_height = 0;
+}
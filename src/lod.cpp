@@ -0,0 +1,20 @@
+#include "lod.hpp"
+#include <algorithm>
+
+float be::projectError(float error, const glm::vec4& sphere, const glm::mat4& modelView, float pixelsPerUnit) {
+    float scale = glm::length(glm::vec3(modelView[0]));
+    glm::vec3 center = glm::vec3(modelView * glm::vec4(glm::vec3(sphere), 1));
+    // inside the sphere the error can be right in front of the camera
+    float distance = std::max(glm::length(center) - sphere.w * scale, 1e-4f);
+    return error * scale / distance * pixelsPerUnit;
+}
+
+uint32_t be::selectLod(std::span<const LodLevel> levels, const glm::vec4& sphere, const glm::mat4& modelView, float pixelsPerUnit, float maxPixelError) {
+    uint32_t selected = 0;
+    for (uint32_t level = 1; level < levels.size(); level++) {
+        if (projectError(levels[level].error, sphere, modelView, pixelsPerUnit) > maxPixelError)
+            break;
+        selected = level;
+    }
+    return selected;
+}
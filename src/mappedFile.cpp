@@ -0,0 +1,83 @@
+#include "mappedFile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+be::MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0)
+{}
+
+be::MappedFile::MappedFile(const std::filesystem::path& path) :
+    m_data(nullptr),
+    m_size(0)
+{
+    open(path);
+}
+
+be::MappedFile::MappedFile(MappedFile&& another) :
+    m_data(another.m_data),
+    m_size(another.m_size)
+{
+    another.m_data = nullptr;
+    another.m_size = 0;
+}
+
+be::MappedFile& be::MappedFile::operator=(MappedFile&& another) {
+    if (this != &another) {
+        clean();
+        m_data = another.m_data;
+        another.m_data = nullptr;
+        m_size = another.m_size;
+        another.m_size = 0;
+    }
+    return *this;
+}
+
+be::MappedFile::~MappedFile() {
+    clean();
+}
+
+bool be::MappedFile::open(const std::filesystem::path& path) {
+    clean();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference on the file
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    madvise(data, fileStat.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const std::byte*>(data);
+    m_size = fileStat.st_size;
+    return true;
+}
+
+bool be::MappedFile::isOpen() const {
+    return m_data != nullptr;
+}
+
+std::span<const std::byte> be::MappedFile::getData() const {
+    return {m_data, m_size};
+}
+
+size_t be::MappedFile::getSize() const {
+    return m_size;
+}
+
+void be::MappedFile::clean() {
+    if (m_data != nullptr)
+        munmap(const_cast<std::byte*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
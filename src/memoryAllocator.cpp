@@ -0,0 +1,554 @@
+#include "memoryAllocator.hpp"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <functional>
+#include <print>
+#include <stdexcept>
+
+be::MemoryAllocator::MemoryAllocator() :
+    m_device(nullptr),
+    m_memoryProperties(),
+    m_blockSize(DEFAULT_MEMORY_BLOCK_SIZE),
+    m_granularity(1),
+    m_allocationLimit(0),
+    m_evacuationPool(NO_MEMORY_NODE),
+    m_evacuationBlock(NO_MEMORY_NODE),
+    m_stats({})
+{}
+
+float be::getFragmentation(const MemoryStats& stats) {
+    if (stats.freeBytes == 0)
+        return 0.0f;
+    return 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(stats.freeBytes);
+}
+
+void be::MemoryAllocator::init(vk::Device device, vk::PhysicalDevice physicalDevice, vk::DeviceSize blockSize) {
+    m_device = device;
+    m_blockSize = blockSize;
+    m_memoryProperties = physicalDevice.getMemoryProperties();
+    vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+    m_granularity = limits.bufferImageGranularity;
+    m_allocationLimit = limits.maxMemoryAllocationCount;
+    m_pools.resize(2 * m_memoryProperties.memoryTypeCount);
+    for (size_t i = 0; i < m_pools.size(); i++) {
+        Pool& pool = m_pools[i];
+        pool.memoryType = i / 2;
+        pool.firstLevelMap = 0;
+        std::fill_n(pool.secondLevelMaps, FIRST_LEVEL_COUNT, 0);
+        for (uint32_t firstLevel = 0; firstLevel < FIRST_LEVEL_COUNT; firstLevel++)
+            std::fill_n(pool.heads[firstLevel], SECOND_LEVEL_COUNT, NO_MEMORY_NODE);
+    }
+}
+
+be::Allocation be::MemoryAllocator::allocateBuffer(vk::Buffer buffer, MemoryUsage usage, std::string_view name) {
+    auto requirements = m_device.getBufferMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        vk::BufferMemoryRequirementsInfo2(buffer)
+    );
+    const vk::MemoryDedicatedRequirements& dedicatedRequirements = requirements.get<vk::MemoryDedicatedRequirements>();
+    Allocation allocation = allocate(
+        requirements.get<vk::MemoryRequirements2>().memoryRequirements,
+        usage,
+        true,
+        dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation,
+        vk::MemoryDedicatedAllocateInfo(nullptr, buffer),
+        name
+    );
+    m_device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+be::Allocation be::MemoryAllocator::allocateImage(vk::Image image, vk::ImageTiling tiling, MemoryUsage usage, std::string_view name) {
+    auto requirements = m_device.getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        vk::ImageMemoryRequirementsInfo2(image)
+    );
+    const vk::MemoryRequirements& memoryRequirements = requirements.get<vk::MemoryRequirements2>().memoryRequirements;
+    const vk::MemoryDedicatedRequirements& dedicatedRequirements = requirements.get<vk::MemoryDedicatedRequirements>();
+    Allocation allocation = allocate(
+        memoryRequirements,
+        usage,
+        tiling == vk::ImageTiling::eLinear,
+        dedicatedRequirements.prefersDedicatedAllocation
+            || dedicatedRequirements.requiresDedicatedAllocation
+            || memoryRequirements.size >= DEDICATED_IMAGE_SIZE,
+        vk::MemoryDedicatedAllocateInfo(image, nullptr),
+        name
+    );
+    m_device.bindImageMemory(image, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+be::Allocation be::MemoryAllocator::allocate(
+    const vk::MemoryRequirements& requirements,
+    MemoryUsage usage,
+    bool linear,
+    bool dedicated,
+    const vk::MemoryDedicatedAllocateInfo& dedicatedInfo,
+    std::string_view name
+) {
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    uint32_t memoryType = selectMemoryType(requirements.memoryTypeBits, usage);
+    // small heaps, like the host visible part of the VRAM, still hold a few blocks
+    vk::DeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    vk::DeviceSize blockSize = std::min(m_blockSize, heapSize / 8);
+    if (dedicated || requirements.size > blockSize / 2)
+        return allocateDedicated(requirements, memoryType, dedicatedInfo, name);
+
+    uint32_t poolIndex = 2 * memoryType + (!linear && m_granularity > 1 ? 1 : 0);
+    Pool& pool = m_pools[poolIndex];
+    Allocation allocation = Allocation();
+    if (!allocateFromPool(pool, poolIndex, requirements, name, allocation)) {
+        addBlock(pool, blockSize);
+        if (!allocateFromPool(pool, poolIndex, requirements, name, allocation))
+            throw std::runtime_error("Failed to sub-allocate device memory!");
+    }
+    m_stats.allocations++;
+    m_stats.usedBytes += allocation.size;
+    m_stats.peakUsedBytes = std::max(m_stats.peakUsedBytes, m_stats.usedBytes);
+    return allocation;
+}
+
+be::Allocation be::MemoryAllocator::allocateDedicated(
+    const vk::MemoryRequirements& requirements,
+    uint32_t memoryType,
+    const vk::MemoryDedicatedAllocateInfo& dedicatedInfo,
+    std::string_view name
+) {
+    vk::MemoryAllocateInfo allocateInfo = vk::MemoryAllocateInfo(requirements.size, memoryType, &dedicatedInfo);
+    vk::DeviceMemory memory = m_device.allocateMemory(allocateInfo);
+    m_dedicated.push_back({memory, requirements.size, memoryType, std::string(name)});
+    m_stats.dedicatedAllocations++;
+    m_stats.reservedBytes += requirements.size;
+    m_stats.allocations++;
+    m_stats.usedBytes += requirements.size;
+    m_stats.peakUsedBytes = std::max(m_stats.peakUsedBytes, m_stats.usedBytes);
+    return {memory, 0, requirements.size, mapIfHostVisible(memory, memoryType), 0, NO_MEMORY_NODE};
+}
+
+uint32_t be::MemoryAllocator::selectMemoryType(uint32_t typeBits, MemoryUsage usage) const {
+    vk::MemoryPropertyFlags required;
+    vk::MemoryPropertyFlags preferred;
+    vk::MemoryPropertyFlags unwanted;
+    switch (usage) {
+        case MemoryUsage::gpuOnly:
+            required = vk::MemoryPropertyFlagBits::eDeviceLocal;
+            unwanted = vk::MemoryPropertyFlagBits::eHostVisible;
+            break;
+        case MemoryUsage::upload:
+            required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+            // the host visible VRAM is small, it is left to the buffers that ask for it
+            unwanted = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostCached;
+            break;
+        case MemoryUsage::readback:
+            required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+            preferred = vk::MemoryPropertyFlagBits::eHostCached;
+            break;
+    }
+
+    uint32_t bestType = UINT32_MAX;
+    int bestScore = INT_MIN;
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        vk::MemoryPropertyFlags flags = m_memoryProperties.memoryTypes[i].propertyFlags;
+        if (!(typeBits & (1u << i)) || (flags & required) != required)
+            continue;
+        int score = std::popcount(static_cast<uint32_t>(flags & preferred)) - std::popcount(static_cast<uint32_t>(flags & unwanted));
+        if (score > bestScore) {
+            bestScore = score;
+            bestType = i;
+        }
+    }
+    if (bestType == UINT32_MAX)
+        throw std::runtime_error("Failed to find a correct memory type!");
+    return bestType;
+}
+
+void* be::MemoryAllocator::mapIfHostVisible(vk::DeviceMemory memory, uint32_t memoryType) {
+    if (!(m_memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible))
+        return nullptr;
+    return m_device.mapMemory(memory, 0, vk::WholeSize);
+}
+
+bool be::MemoryAllocator::allocateFromPool(Pool& pool, uint32_t poolIndex, const vk::MemoryRequirements& requirements, std::string_view name, Allocation& allocation) {
+    vk::DeviceSize alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+    // any range of this size fits once aligned
+    uint32_t index = findFree(pool, getSearchSize(requirements.size, alignment));
+    if (index == NO_MEMORY_NODE)
+        return false;
+    removeFree(pool, index);
+
+    vk::DeviceSize offset = (pool.nodes[index].offset + alignment - 1) / alignment * alignment;
+    vk::DeviceSize padding = offset - pool.nodes[index].offset;
+    if (padding > 0) {
+        uint32_t front = createNode(pool);
+        Node& node = pool.nodes[index];
+        pool.nodes[front].offset = node.offset;
+        pool.nodes[front].size = padding;
+        pool.nodes[front].block = node.block;
+        pool.nodes[front].previous = node.previous;
+        pool.nodes[front].next = index;
+        if (node.previous != NO_MEMORY_NODE)
+            pool.nodes[node.previous].next = front;
+        node.previous = front;
+        node.offset = offset;
+        node.size -= padding;
+        insertFree(pool, front);
+    }
+    vk::DeviceSize remaining = pool.nodes[index].size - requirements.size;
+    if (remaining > 0) {
+        uint32_t back = createNode(pool);
+        Node& node = pool.nodes[index];
+        pool.nodes[back].offset = offset + requirements.size;
+        pool.nodes[back].size = remaining;
+        pool.nodes[back].block = node.block;
+        pool.nodes[back].previous = index;
+        pool.nodes[back].next = node.next;
+        if (node.next != NO_MEMORY_NODE)
+            pool.nodes[node.next].previous = back;
+        node.next = back;
+        node.size = requirements.size;
+        insertFree(pool, back);
+    }
+
+    Node& node = pool.nodes[index];
+    node.state = NodeState::allocated;
+    node.alignment = alignment;
+    node.name = name;
+    Block& block = pool.blocks[node.block];
+    block.allocations++;
+    allocation = {
+        block.memory,
+        offset,
+        requirements.size,
+        block.data == nullptr ? nullptr : static_cast<std::byte*>(block.data) + offset,
+        poolIndex,
+        index
+    };
+    return true;
+}
+
+void be::MemoryAllocator::free(const Allocation& allocation) {
+    if (!allocation.memory)
+        return;
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    m_stats.allocations--;
+    m_stats.usedBytes -= allocation.size;
+    if (allocation.node == NO_MEMORY_NODE) {
+        auto dedicated = std::ranges::find(m_dedicated, allocation.memory, &DedicatedAllocation::memory);
+        if (dedicated == m_dedicated.end())
+            throw std::runtime_error("Freeing an unknown dedicated allocation!");
+        m_device.freeMemory(dedicated->memory);
+        m_stats.dedicatedAllocations--;
+        m_stats.reservedBytes -= dedicated->size;
+        *dedicated = std::move(m_dedicated.back());
+        m_dedicated.pop_back();
+        return;
+    }
+
+    Pool& pool = m_pools[allocation.pool];
+    uint32_t index = allocation.node;
+    uint32_t block = pool.nodes[index].block;
+    // the free ranges of a block being emptied are merged but stay out of the free lists
+    bool listed = !pool.blocks[block].evacuating;
+    pool.nodes[index].state = NodeState::free;
+    pool.nodes[index].movable = false;
+    pool.nodes[index].name.clear();
+    pool.blocks[block].allocations--;
+
+    uint32_t next = pool.nodes[index].next;
+    if (next != NO_MEMORY_NODE && pool.nodes[next].state == NodeState::free) {
+        if (listed)
+            removeFree(pool, next);
+        pool.nodes[index].size += pool.nodes[next].size;
+        pool.nodes[index].next = pool.nodes[next].next;
+        if (pool.nodes[index].next != NO_MEMORY_NODE)
+            pool.nodes[pool.nodes[index].next].previous = index;
+        destroyNode(pool, next);
+    }
+    uint32_t previous = pool.nodes[index].previous;
+    if (previous != NO_MEMORY_NODE && pool.nodes[previous].state == NodeState::free) {
+        if (listed)
+            removeFree(pool, previous);
+        pool.nodes[previous].size += pool.nodes[index].size;
+        pool.nodes[previous].next = pool.nodes[index].next;
+        if (pool.nodes[previous].next != NO_MEMORY_NODE)
+            pool.nodes[pool.nodes[previous].next].previous = previous;
+        destroyNode(pool, index);
+        index = previous;
+    }
+    if (!listed) {
+        // the evacuation is over once the block is empty, its content lives in the other blocks of the pool
+        if (pool.blocks[block].allocations == 0) {
+            destroyNode(pool, index);
+            releaseBlock(pool, block);
+            m_evacuationPool = NO_MEMORY_NODE;
+            m_evacuationBlock = NO_MEMORY_NODE;
+        }
+        return;
+    }
+    insertFree(pool, index);
+
+    // an empty block is given back unless it is the last one of its pool, which avoids reallocating it on the next request
+    size_t liveBlocks = std::ranges::count_if(pool.blocks, [](const Block& poolBlock) { return static_cast<bool>(poolBlock.memory); });
+    if (pool.blocks[block].allocations == 0 && liveBlocks > 1) {
+        removeFree(pool, index);
+        destroyNode(pool, index);
+        releaseBlock(pool, block);
+    }
+}
+
+void be::MemoryAllocator::setMovable(const Allocation& allocation) {
+    if (allocation.node == NO_MEMORY_NODE)
+        return;
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    m_pools[allocation.pool].nodes[allocation.node].movable = true;
+}
+
+bool be::MemoryAllocator::beginEvacuation(float maxUsage) {
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    if (m_evacuationBlock != NO_MEMORY_NODE)
+        return false;
+    float bestUsage = maxUsage;
+    for (uint32_t poolIndex = 0; poolIndex < m_pools.size(); poolIndex++) {
+        const Pool& pool = m_pools[poolIndex];
+        if (std::ranges::count_if(pool.blocks, [](const Block& block) { return static_cast<bool>(block.memory); }) < 2)
+            continue;
+        std::vector<vk::DeviceSize> usedBytes = std::vector<vk::DeviceSize>(pool.blocks.size(), 0);
+        std::vector<bool> movable = std::vector<bool>(pool.blocks.size(), true);
+        for (const Node& node : pool.nodes) {
+            if (node.state == NodeState::allocated) {
+                usedBytes[node.block] += node.size;
+                movable[node.block] = movable[node.block] && node.movable;
+            }
+        }
+        for (uint32_t block = 0; block < pool.blocks.size(); block++) {
+            const Block& candidate = pool.blocks[block];
+            if (!candidate.memory || candidate.allocations == 0 || !movable[block])
+                continue;
+            float usage = static_cast<float>(usedBytes[block]) / static_cast<float>(candidate.size);
+            if (usage >= bestUsage)
+                continue;
+
+            // places the allocations, largest first, in the smallest free range of the other blocks they fit in,
+            // an evacuation that would need a new block only moves the fragmentation
+            std::vector<vk::DeviceSize> freeRanges;
+            std::vector<vk::DeviceSize> searchSizes;
+            for (const Node& node : pool.nodes) {
+                if (node.state == NodeState::free && node.block != block)
+                    freeRanges.push_back(node.size);
+                else if (node.state == NodeState::allocated && node.block == block)
+                    searchSizes.push_back(getSearchSize(node.size, node.alignment));
+            }
+            std::ranges::sort(freeRanges);
+            std::ranges::sort(searchSizes, std::greater<>());
+            bool fits = true;
+            for (vk::DeviceSize searchSize : searchSizes) {
+                // findFree rounds the size up to the next class
+                vk::DeviceSize needed = searchSize + (searchSize >> SECOND_LEVEL_LOG2);
+                auto range = std::ranges::lower_bound(freeRanges, needed);
+                if (range == freeRanges.end()) {
+                    fits = false;
+                    break;
+                }
+                vk::DeviceSize remaining = *range - searchSize;
+                freeRanges.erase(range);
+                freeRanges.insert(std::ranges::upper_bound(freeRanges, remaining), remaining);
+            }
+            if (fits) {
+                bestUsage = usage;
+                m_evacuationPool = poolIndex;
+                m_evacuationBlock = block;
+            }
+        }
+    }
+    if (m_evacuationBlock == NO_MEMORY_NODE)
+        return false;
+
+    Pool& pool = m_pools[m_evacuationPool];
+    pool.blocks[m_evacuationBlock].evacuating = true;
+    for (uint32_t node = 0; node < pool.nodes.size(); node++)
+        if (pool.nodes[node].state == NodeState::free && pool.nodes[node].block == m_evacuationBlock)
+            removeFree(pool, node);
+    return true;
+}
+
+void be::MemoryAllocator::endEvacuation() {
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    if (m_evacuationBlock == NO_MEMORY_NODE)
+        return;
+    Pool& pool = m_pools[m_evacuationPool];
+    pool.blocks[m_evacuationBlock].evacuating = false;
+    for (uint32_t node = 0; node < pool.nodes.size(); node++)
+        if (pool.nodes[node].state == NodeState::free && pool.nodes[node].block == m_evacuationBlock)
+            insertFree(pool, node);
+    m_evacuationPool = NO_MEMORY_NODE;
+    m_evacuationBlock = NO_MEMORY_NODE;
+}
+
+bool be::MemoryAllocator::isEvacuating() const {
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    return m_evacuationBlock != NO_MEMORY_NODE;
+}
+
+bool be::MemoryAllocator::isEvacuating(const Allocation& allocation) const {
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    return m_evacuationBlock != NO_MEMORY_NODE
+        && allocation.node != NO_MEMORY_NODE
+        && allocation.pool == m_evacuationPool
+        && m_pools[allocation.pool].nodes[allocation.node].block == m_evacuationBlock;
+}
+
+void be::MemoryAllocator::addBlock(Pool& pool, vk::DeviceSize size) {
+    vk::DeviceMemory memory = m_device.allocateMemory(vk::MemoryAllocateInfo(size, pool.memoryType));
+    auto emptySlot = std::ranges::find_if(pool.blocks, [](const Block& block) { return !block.memory; });
+    uint32_t block = static_cast<uint32_t>(std::distance(pool.blocks.begin(), emptySlot));
+    if (emptySlot == pool.blocks.end())
+        pool.blocks.push_back({});
+    pool.blocks[block] = {memory, mapIfHostVisible(memory, pool.memoryType), size, 0, false};
+
+    uint32_t node = createNode(pool);
+    pool.nodes[node].offset = 0;
+    pool.nodes[node].size = size;
+    pool.nodes[node].block = block;
+    insertFree(pool, node);
+    m_stats.blocks++;
+    m_stats.reservedBytes += size;
+}
+
+void be::MemoryAllocator::releaseBlock(Pool& pool, uint32_t block) {
+    // freeing mapped memory unmaps it
+    m_device.freeMemory(pool.blocks[block].memory);
+    m_stats.blocks--;
+    m_stats.reservedBytes -= pool.blocks[block].size;
+    pool.blocks[block] = {nullptr, nullptr, 0, 0, false};
+}
+
+vk::DeviceSize be::MemoryAllocator::getSearchSize(vk::DeviceSize size, vk::DeviceSize alignment) {
+    return size + alignment - 1;
+}
+
+void be::MemoryAllocator::mapping(vk::DeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel) {
+    if (size < (1ull << SMALL_SIZE_LOG2)) {
+        firstLevel = 0;
+        secondLevel = static_cast<uint32_t>(size >> (SMALL_SIZE_LOG2 - SECOND_LEVEL_LOG2));
+        return;
+    }
+    uint32_t log2 = std::bit_width(size) - 1;
+    firstLevel = log2 - SMALL_SIZE_LOG2 + 1;
+    secondLevel = static_cast<uint32_t>(size >> (log2 - SECOND_LEVEL_LOG2)) & (SECOND_LEVEL_COUNT - 1);
+}
+
+uint32_t be::MemoryAllocator::findFree(const Pool& pool, vk::DeviceSize size) {
+    // rounded up to the next class, so that every range of the class found is large enough
+    if (size < (1ull << SMALL_SIZE_LOG2))
+        size += (1ull << (SMALL_SIZE_LOG2 - SECOND_LEVEL_LOG2)) - 1;
+    else
+        size += (1ull << (std::bit_width(size) - 1 - SECOND_LEVEL_LOG2)) - 1;
+    uint32_t firstLevel, secondLevel;
+    mapping(size, firstLevel, secondLevel);
+    if (firstLevel >= FIRST_LEVEL_COUNT)
+        return NO_MEMORY_NODE;
+
+    uint32_t secondLevelMap = pool.secondLevelMaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0) {
+        uint64_t firstLevelMap = firstLevel + 1 < 64 ? pool.firstLevelMap & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0)
+            return NO_MEMORY_NODE;
+        firstLevel = std::countr_zero(firstLevelMap);
+        secondLevelMap = pool.secondLevelMaps[firstLevel];
+    }
+    return pool.heads[firstLevel][std::countr_zero(secondLevelMap)];
+}
+
+void be::MemoryAllocator::insertFree(Pool& pool, uint32_t node) {
+    uint32_t firstLevel, secondLevel;
+    mapping(pool.nodes[node].size, firstLevel, secondLevel);
+    uint32_t head = pool.heads[firstLevel][secondLevel];
+    pool.nodes[node].state = NodeState::free;
+    pool.nodes[node].previousFree = NO_MEMORY_NODE;
+    pool.nodes[node].nextFree = head;
+    if (head != NO_MEMORY_NODE)
+        pool.nodes[head].previousFree = node;
+    pool.heads[firstLevel][secondLevel] = node;
+    pool.secondLevelMaps[firstLevel] |= 1u << secondLevel;
+    pool.firstLevelMap |= 1ull << firstLevel;
+}
+
+void be::MemoryAllocator::removeFree(Pool& pool, uint32_t node) {
+    uint32_t firstLevel, secondLevel;
+    mapping(pool.nodes[node].size, firstLevel, secondLevel);
+    uint32_t previousFree = pool.nodes[node].previousFree;
+    uint32_t nextFree = pool.nodes[node].nextFree;
+    if (nextFree != NO_MEMORY_NODE)
+        pool.nodes[nextFree].previousFree = previousFree;
+    if (previousFree != NO_MEMORY_NODE) {
+        pool.nodes[previousFree].nextFree = nextFree;
+        return;
+    }
+    pool.heads[firstLevel][secondLevel] = nextFree;
+    if (nextFree == NO_MEMORY_NODE) {
+        pool.secondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+        if (pool.secondLevelMaps[firstLevel] == 0)
+            pool.firstLevelMap &= ~(1ull << firstLevel);
+    }
+}
+
+uint32_t be::MemoryAllocator::createNode(Pool& pool) {
+    uint32_t node;
+    if (pool.unusedNodes.empty()) {
+        node = static_cast<uint32_t>(pool.nodes.size());
+        pool.nodes.push_back({});
+    } else {
+        node = pool.unusedNodes.back();
+        pool.unusedNodes.pop_back();
+    }
+    pool.nodes[node] = {0, 0, 1, 0, NO_MEMORY_NODE, NO_MEMORY_NODE, NO_MEMORY_NODE, NO_MEMORY_NODE, NodeState::free, false, {}};
+    return node;
+}
+
+void be::MemoryAllocator::destroyNode(Pool& pool, uint32_t node) {
+    pool.nodes[node].state = NodeState::unused;
+    pool.unusedNodes.push_back(node);
+}
+
+be::MemoryStats be::MemoryAllocator::getStats() const {
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    MemoryStats stats = m_stats;
+    for (const Pool& pool : m_pools) {
+        for (const Node& node : pool.nodes) {
+            if (node.state != NodeState::free)
+                continue;
+            stats.freeRanges++;
+            stats.freeBytes += node.size;
+            stats.largestFreeRange = std::max(stats.largestFreeRange, node.size);
+        }
+    }
+    return stats;
+}
+
+uint32_t be::MemoryAllocator::getMemoryAllocationLimit() const {
+    return m_allocationLimit;
+}
+
+void be::MemoryAllocator::clean() {
+    std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(m_mutex);
+    for (const Pool& pool : m_pools)
+        for (const Node& node : pool.nodes)
+            if (node.state == NodeState::allocated)
+                std::println("Leaked {} bytes of memory type {} at offset {}: {}.", node.size, pool.memoryType, node.offset, node.name);
+    for (const DedicatedAllocation& dedicated : m_dedicated)
+        std::println("Leaked a dedicated allocation of {} bytes of memory type {}: {}.", dedicated.size, dedicated.memoryType, dedicated.name);
+    if (m_stats.allocations > 0)
+        std::println("{} allocations of {} bytes were still alive at shutdown.", m_stats.allocations, m_stats.usedBytes);
+
+    for (Pool& pool : m_pools)
+        for (Block& block : pool.blocks)
+            if (block.memory)
+                m_device.freeMemory(block.memory);
+    for (const DedicatedAllocation& dedicated : m_dedicated)
+        m_device.freeMemory(dedicated.memory);
+    m_pools.clear();
+    m_dedicated.clear();
+    m_evacuationPool = NO_MEMORY_NODE;
+    m_evacuationBlock = NO_MEMORY_NODE;
+    m_stats = {};
+}
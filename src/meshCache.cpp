@@ -0,0 +1,235 @@
+#include "meshCache.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <print>
+#include <system_error>
+
+namespace {
+    constexpr uint32_t MAGIC = 0x434d4542; // "BEMC"
+    constexpr uint64_t ALIGNMENT = 16;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceLastWrite;
+        uint64_t sourceHash;
+        uint32_t sectionCount;
+        uint32_t padding;
+    };
+
+    struct SectionEntry {
+        uint32_t elementSize;
+        uint32_t padding;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    // FNV-1a, enough to detect an edited source file, chained over several files through hash
+    uint64_t hashBytes(std::span<const std::byte> bytes, uint64_t hash = 0xcbf29ce484222325ull) {
+        for (std::byte b : bytes) {
+            hash ^= static_cast<uint64_t>(b);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
+
+be::MeshCache::MeshCache(const std::filesystem::path& sourcePath) :
+    m_sourcePath(sourcePath),
+    m_cachePath(sourcePath),
+    m_file(),
+    m_sections({})
+{
+    m_cachePath += ".becache";
+}
+
+be::MeshCache::SourceStamp be::MeshCache::stampSource(bool withHash) const {
+    std::error_code error;
+    SourceStamp stamp = {0, 0, 0};
+    stamp.size = std::filesystem::file_size(m_sourcePath, error);
+    if (error)
+        return stamp;
+    stamp.lastWrite = std::filesystem::last_write_time(m_sourcePath, error).time_since_epoch().count();
+    if (withHash) {
+        be::MappedFile source = be::MappedFile(m_sourcePath);
+        stamp.hash = hashBytes(source.getData());
+    }
+    // a missing library adds nothing, its size changes the stamp once it appears
+    for (const std::filesystem::path& library : m_materialLibraries) {
+        uint64_t size = std::filesystem::file_size(library, error);
+        if (error)
+            continue;
+        stamp.size += size;
+        stamp.lastWrite = std::max(stamp.lastWrite, static_cast<int64_t>(std::filesystem::last_write_time(library, error).time_since_epoch().count()));
+        if (withHash && size > 0) {
+            be::MappedFile source = be::MappedFile(library);
+            stamp.hash = hashBytes(source.getData(), stamp.hash);
+        }
+    }
+    return stamp;
+}
+
+bool be::MeshCache::load() {
+    clean();
+    if (!m_file.open(m_cachePath))
+        return false;
+
+    std::span<const std::byte> data = m_file.getData();
+    Header header;
+    if (data.size() < sizeof(Header)) {
+        clean();
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(Header));
+    if (header.magic != MAGIC || header.version != VERSION || header.sectionCount != m_sections.size()) {
+        clean();
+        return false;
+    }
+
+    if (data.size() < sizeof(Header) + sizeof(SectionEntry) * m_sections.size()) {
+        clean();
+        return false;
+    }
+    for (size_t i = 0; i < m_sections.size(); i++) {
+        SectionEntry entry;
+        memcpy(&entry, data.data() + sizeof(Header) + i * sizeof(SectionEntry), sizeof(SectionEntry));
+        if (entry.offset % ALIGNMENT != 0 || entry.offset + entry.size > data.size() || (entry.elementSize != 0 && entry.size % entry.elementSize != 0)) {
+            clean();
+            return false;
+        }
+        m_sections[i] = {entry.elementSize, data.subspan(entry.offset, entry.size)};
+    }
+
+    // the libraries the cache was built from are part of the stamp
+    m_materialLibraries = parsePaths(Section::materialLibraries);
+    // mtime and size are enough when untouched, otherwise fall back on the content hash
+    SourceStamp stamp = stampSource(false);
+    if (stamp.size != header.sourceSize || stamp.lastWrite != header.sourceLastWrite) {
+        stamp = stampSource(true);
+        if (stamp.size != header.sourceSize || stamp.hash != header.sourceHash) {
+            clean();
+            return false;
+        }
+        // touched but not edited, the next launches can skip the hash again
+        restamp(stamp);
+    }
+
+    m_texturesPath = parsePaths(Section::texturePaths);
+    return true;
+}
+
+void be::MeshCache::restamp(const SourceStamp& stamp) const {
+    // a failed write only costs the hash at the next launch
+    std::fstream file = std::fstream(m_cachePath, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file)
+        return;
+    file.seekp(offsetof(Header, sourceLastWrite));
+    file.write(reinterpret_cast<const char*>(&stamp.lastWrite), sizeof(stamp.lastWrite));
+}
+
+bool be::MeshCache::write() {
+    SourceStamp stamp = stampSource(true);
+    Header header = {
+        .magic = MAGIC,
+        .version = VERSION,
+        .sourceSize = stamp.size,
+        .sourceLastWrite = stamp.lastWrite,
+        .sourceHash = stamp.hash,
+        .sectionCount = static_cast<uint32_t>(m_sections.size()),
+        .padding = 0
+    };
+
+    std::vector<SectionEntry> entries;
+    uint64_t offset = alignUp(sizeof(Header) + sizeof(SectionEntry) * m_sections.size());
+    for (const SectionData& section : m_sections) {
+        entries.push_back({section.elementSize, 0, offset, section.bytes.size()});
+        offset = alignUp(offset + section.bytes.size());
+    }
+
+    std::filesystem::path tmpPath = m_cachePath;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file = std::ofstream(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::println("Failed to write mesh cache {}.", m_cachePath.string());
+            return false;
+        }
+        const char zeros[ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(entries.data()), sizeof(SectionEntry) * entries.size());
+        uint64_t written = sizeof(Header) + sizeof(SectionEntry) * entries.size();
+        for (size_t i = 0; i < m_sections.size(); i++) {
+            file.write(zeros, entries[i].offset - written);
+            file.write(reinterpret_cast<const char*>(m_sections[i].bytes.data()), m_sections[i].bytes.size());
+            written = entries[i].offset + m_sections[i].bytes.size();
+        }
+        if (!file) {
+            std::println("Failed to write mesh cache {}.", m_cachePath.string());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, m_cachePath, error);
+    if (error) {
+        std::println("Failed to write mesh cache {} : {}.", m_cachePath.string(), error.message());
+        return false;
+    }
+    return true;
+}
+
+void be::MeshCache::addTexturePaths(const std::vector<std::filesystem::path>& texturesPath) {
+    m_texturesPath = texturesPath;
+    m_texturePathsBlob = joinPaths(texturesPath);
+    addSection<char>(Section::texturePaths, m_texturePathsBlob);
+}
+
+void be::MeshCache::addMaterialLibraries(const std::vector<std::filesystem::path>& materialLibraries) {
+    m_materialLibraries = materialLibraries;
+    m_materialLibrariesBlob = joinPaths(materialLibraries);
+    addSection<char>(Section::materialLibraries, m_materialLibrariesBlob);
+}
+
+std::string be::MeshCache::joinPaths(const std::vector<std::filesystem::path>& paths) {
+    std::string blob;
+    for (const std::filesystem::path& path : paths) {
+        blob += path.generic_string();
+        blob += '\0';
+    }
+    return blob;
+}
+
+std::vector<std::filesystem::path> be::MeshCache::parsePaths(Section section) const {
+    std::vector<std::filesystem::path> paths;
+    std::span<const char> blob = getSection<char>(section);
+    size_t begin = 0;
+    for (size_t i = 0; i < blob.size(); i++) {
+        if (blob[i] == '\0') {
+            paths.emplace_back(std::string(blob.data() + begin, i - begin));
+            begin = i + 1;
+        }
+    }
+    return paths;
+}
+
+const std::vector<std::filesystem::path>& be::MeshCache::getTexturePath() const {
+    return m_texturesPath;
+}
+
+const std::filesystem::path& be::MeshCache::getPath() const {
+    return m_cachePath;
+}
+
+void be::MeshCache::clean() {
+    m_file.clean();
+    m_sections = {};
+    m_texturesPath.clear();
+    m_materialLibraries.clear();
+}
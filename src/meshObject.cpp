@@ -1,69 +1,53 @@
 #include "meshObject.hpp"
+#include "objParser.hpp"
 #include "vertex.hpp"
+#include "vertexWelder.hpp"
 #include <cstddef>
+#include <glm/ext.hpp>
 #include <stdexcept>
-#include <unordered_map>
-#include <unordered_set>
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
 #include <iostream>
 
 MeshObject::MeshObject(const std::filesystem::path& filename) :
     model(1)
 {
-    //tinyobj::ObjReaderConfig readerConfig;
-    //readerConfig.mtl_search_path = filename.string();
+    be::ObjParser objReader = be::ObjParser(filename);
 
-    tinyobj::ObjReader objReader;
-    if (!objReader.ParseFromFile(filename.string())) {
-        if (!objReader.Error().empty()) {
-            throw std::runtime_error("Failed to open the obj file");
-        }
-        exit(1);
-    }
-
-    if (!objReader.Warning().empty()) 
-        std::cout << "TinyObjLoader : " << objReader.Warning() << std::endl;
+    if (!objReader.getWarning().empty()) 
+        std::cout << "ObjParser : " << objReader.getWarning() << std::endl;
     
-    const tinyobj::attrib_t& attrib = objReader.GetAttrib();
-    const std::vector<tinyobj::shape_t>& shapes = objReader.GetShapes();
-    //const std::vector<tinyobj::material_t>& materials = objReader.GetMaterials();
-    std::unordered_map<Vertex, int> verticies_map;
-    for(const tinyobj::shape_t& shape : shapes) {
-        size_t offset = 0;
+    const be::ObjAttrib& attrib = objReader.getAttrib();
+    const std::vector<be::ObjShape>& shapes = objReader.getShapes();
+    size_t cornerCount = 0;
+    for (const be::ObjShape& shape : shapes)
+        cornerCount += shape.indices.size();
+    be::VertexWelder verticies_map = be::VertexWelder(cornerCount);
+    indices.reserve(cornerCount);
+    for(const be::ObjShape& shape : shapes) {
+        for (const be::ObjIndex& vertexIndex : shape.indices) {
+            glm::vec3 position;
+            position.x = attrib.vertices[3 * vertexIndex.vertexIndex];
+            position.y = attrib.vertices[3 * vertexIndex.vertexIndex + 1];
+            position.z = attrib.vertices[3 * vertexIndex.vertexIndex + 2];
+            position = glm::rotate(glm::mat4(1), glm::radians(-90.f), glm::vec3(0, 1, 0)) * glm::rotate(glm::mat4(1), glm::radians(-90.f), glm::vec3(1, 0, 0)) * glm::vec4(position, 1);
             
-        for (size_t i = 0; i < shape.mesh.num_face_vertices.size(); i++) {
-            size_t vertexNumberOnFace = shape.mesh.num_face_vertices[i];
-
-            for (size_t j = 0; j < vertexNumberOnFace; j++) {
-                tinyobj::index_t vertexIndex = shape.mesh.indices[offset + j];
-                
-                glm::vec3 position;
-                position.x = attrib.vertices[3 * vertexIndex.vertex_index];
-                position.y = attrib.vertices[3 * vertexIndex.vertex_index + 1];
-                position.z = attrib.vertices[3 * vertexIndex.vertex_index + 2];
-                position = glm::rotate(glm::mat4(1), glm::radians(-90.f), glm::vec3(0, 1, 0)) * glm::rotate(glm::mat4(1), glm::radians(-90.f), glm::vec3(1, 0, 0)) * glm::vec4(position, 1);
-                
-                glm::vec3 normal;
-                normal.x = attrib.normals[3 * vertexIndex.normal_index];
-                normal.y = attrib.normals[3 * vertexIndex.normal_index + 1];
-                normal.z = attrib.normals[3 * vertexIndex.normal_index + 2];
-                
-                glm::vec2 texCoord;
-                texCoord.x = attrib.texcoords[2 * vertexIndex.texcoord_index];
-                texCoord.y = attrib.texcoords[2 * vertexIndex.texcoord_index + 1];
-                
-                Vertex vertex{position, {1, 1, 1}, normal, texCoord, -1};
-
-                if(verticies_map.count(vertex) == 0) {
-                    verticies_map[vertex] = verticies_map.size();
-                    vertices.push_back(vertex);
-                }
-                indices.push_back(verticies_map[vertex]);
+            glm::vec3 normal = glm::vec3(0);
+            if (vertexIndex.normalIndex >= 0) {
+                normal.x = attrib.normals[3 * vertexIndex.normalIndex];
+                normal.y = attrib.normals[3 * vertexIndex.normalIndex + 1];
+                normal.z = attrib.normals[3 * vertexIndex.normalIndex + 2];
+            }
+            
+            glm::vec2 texCoord = glm::vec2(0);
+            if (vertexIndex.texCoordIndex >= 0) {
+                texCoord.x = attrib.texCoords[2 * vertexIndex.texCoordIndex];
+                texCoord.y = attrib.texCoords[2 * vertexIndex.texCoordIndex + 1];
             }
-            offset += vertexNumberOnFace;
+            
+            Vertex vertex{position, {1, 1, 1}, normal, texCoord, -1};
+            indices.push_back(verticies_map.findOrInsert(vertex));
         }
     }
+    vertices = verticies_map.releaseVertices();
 }
 
 const std::vector<Vertex>& MeshObject::getVertices() {
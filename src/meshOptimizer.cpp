@@ -0,0 +1,294 @@
+#include "meshOptimizer.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    /**
+        FIFO cache driven by time stamps: a vertex is still in the cache
+        if less than cacheSize misses happened since it was loaded.
+    */
+    class CacheSimulator {
+        public:
+            CacheSimulator(size_t vertexCount, uint32_t cacheSize) :
+                m_timeStamps(vertexCount, 0),
+                m_time(cacheSize + 1),
+                m_cacheSize(cacheSize)
+            {}
+            bool access(int vertex) {
+                if (m_time - m_timeStamps[vertex] > m_cacheSize) {
+                    m_timeStamps[vertex] = m_time++;
+                    return false;
+                }
+                return true;
+            }
+            void reset() {
+                m_time += m_cacheSize + 1;
+            }
+        private:
+            std::vector<uint64_t> m_timeStamps;
+            uint64_t m_time;
+            uint32_t m_cacheSize;
+    };
+
+    // triangles using every vertex, in compressed rows
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    Adjacency buildAdjacency(std::span<const int> indices, size_t vertexCount) {
+        Adjacency adjacency;
+        adjacency.offsets.assign(vertexCount + 1, 0);
+        for (int index : indices)
+            adjacency.offsets[index + 1]++;
+        std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+        adjacency.triangles.resize(indices.size());
+        std::vector<uint32_t> fill = std::vector<uint32_t>(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency.triangles[fill[indices[i]]++] = i / 3;
+        return adjacency;
+    }
+}
+
+be::VertexCacheStats be::analyzeVertexCache(std::span<const int> indices, size_t vertexCount, uint32_t cacheSize) {
+    CacheSimulator cache = CacheSimulator(vertexCount, cacheSize);
+    std::vector<bool> used = std::vector<bool>(vertexCount, false);
+    size_t misses = 0, usedCount = 0;
+    for (int index : indices) {
+        misses += !cache.access(index);
+        if (!used[index]) {
+            used[index] = true;
+            usedCount++;
+        }
+    }
+    size_t triangleCount = indices.size() / 3;
+    return {
+        triangleCount == 0 ? 0 : static_cast<float>(misses) / triangleCount,
+        usedCount == 0 ? 0 : static_cast<float>(misses) / usedCount
+    };
+}
+
+std::vector<uint32_t> be::optimizeVertexCache(std::span<int> indices, size_t vertexCount, uint32_t cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> hardBoundaries;
+    if (triangleCount == 0)
+        return hardBoundaries;
+
+    Adjacency adjacency = buildAdjacency(indices, vertexCount);
+    std::vector<uint32_t> liveTriangles = std::vector<uint32_t>(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    std::vector<uint64_t> cacheTime = std::vector<uint64_t>(vertexCount, 0);
+    std::vector<bool> emitted = std::vector<bool>(triangleCount, false);
+    std::vector<int> deadEnds;
+    std::vector<int> candidates;
+    std::vector<int> result;
+    result.reserve(indices.size());
+
+    uint64_t time = cacheSize + 1;
+    size_t cursor = 0;
+    auto skipDeadEnd = [&]() -> int {
+        while (!deadEnds.empty()) {
+            int vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+        for (; cursor < vertexCount; cursor++)
+            if (liveTriangles[cursor] > 0)
+                return cursor;
+        return -1;
+    };
+
+    int fanning = skipDeadEnd();
+    hardBoundaries.push_back(0);
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning + 1]; i++) {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle])
+                continue;
+            for (int corner = 0; corner < 3; corner++) {
+                int vertex = indices[3 * triangle + corner];
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize)
+                    cacheTime[vertex] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // prefer the candidate which stays in cache the longest once its remaining triangles are emitted
+        int best = -1;
+        uint64_t bestPriority = 0;
+        for (int vertex : candidates) {
+            if (liveTriangles[vertex] == 0)
+                continue;
+            uint64_t priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                priority = time - cacheTime[vertex];
+            if (best < 0 || priority > bestPriority) {
+                best = vertex;
+                bestPriority = priority;
+            }
+        }
+        if (best < 0) {
+            best = skipDeadEnd();
+            if (best >= 0)
+                hardBoundaries.push_back(result.size() / 3);
+        }
+        fanning = best;
+    }
+
+    std::ranges::copy(result, indices.begin());
+    return hardBoundaries;
+}
+
+void be::optimizeOverdraw(std::span<int> indices, std::span<const Vertex> vertices, std::span<const uint32_t> hardBoundaries, float threshold, uint32_t cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // split the hard clusters where the cache efficiency is already good enough
+    CacheSimulator cache = CacheSimulator(vertices.size(), cacheSize);
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c < hardBoundaries.size(); c++) {
+        uint32_t begin = hardBoundaries[c];
+        uint32_t end = c + 1 < hardBoundaries.size() ? hardBoundaries[c + 1] : triangleCount;
+        cache.reset();
+        size_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; t++)
+            for (int corner = 0; corner < 3; corner++)
+                clusterMisses += !cache.access(indices[3 * t + corner]);
+        float clusterThreshold = threshold * clusterMisses / (end - begin);
+
+        cache.reset();
+        clusters.push_back(begin);
+        size_t misses = 0;
+        uint32_t softBegin = begin;
+        for (uint32_t t = begin; t < end; t++) {
+            for (int corner = 0; corner < 3; corner++)
+                misses += !cache.access(indices[3 * t + corner]);
+            if (t + 1 < end && static_cast<float>(misses) / (t + 1 - softBegin) <= clusterThreshold) {
+                clusters.push_back(t + 1);
+                softBegin = t + 1;
+                misses = 0;
+                cache.reset();
+            }
+        }
+    }
+
+    glm::vec3 meshCentroid = glm::vec3(0);
+    float meshArea = 0;
+    struct Cluster {
+        uint32_t begin;
+        uint32_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> sortedClusters;
+    std::vector<glm::vec3> centroids, normals;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        uint32_t begin = clusters[c];
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        glm::vec3 centroid = glm::vec3(0), normal = glm::vec3(0);
+        float area = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            const glm::vec3& p0 = vertices[indices[3 * t]].pos;
+            const glm::vec3& p1 = vertices[indices[3 * t + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[3 * t + 2]].pos;
+            // the cross product length is twice the area, the factor cancels out
+            glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(areaNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3);
+            normal += areaNormal;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids.push_back(area > 0 ? centroid / area : centroid);
+        float normalLength = glm::length(normal);
+        normals.push_back(normalLength > 0 ? normal / normalLength : normal);
+        sortedClusters.push_back({begin, end, 0});
+    }
+    if (meshArea > 0)
+        meshCentroid /= meshArea;
+
+    for (size_t c = 0; c < sortedClusters.size(); c++)
+        sortedClusters[c].sortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    std::ranges::stable_sort(sortedClusters, [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<int> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : sortedClusters)
+        result.insert(result.end(), indices.begin() + 3 * cluster.begin, indices.begin() + 3 * cluster.end);
+    std::ranges::copy(result, indices.begin());
+}
+
+void be::optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<int> indices) {
+    std::vector<int> remap = std::vector<int>(vertices.size(), -1);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (int& index : indices) {
+        if (remap[index] < 0) {
+            remap[index] = result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(result);
+}
+
+std::vector<be::IndexRange> be::splitIndexRanges(std::span<const Vertex> vertices, std::span<const int> indices, std::vector<Vertex>& rangeVertices, std::vector<uint32_t>& localIndices, size_t maxVertices) {
+    std::vector<IndexRange> ranges;
+    // a vertex belongs to the current range when its stamp matches
+    std::vector<uint32_t> stamps = std::vector<uint32_t>(vertices.size(), 0);
+    std::vector<uint32_t> rangeIndices = std::vector<uint32_t>(vertices.size());
+    uint32_t currentStamp = 1;
+    auto startRange = [&]() -> IndexRange {
+        IndexRange range = {};
+        range.firstIndex = localIndices.size();
+        range.vertexOffset = rangeVertices.size();
+        return range;
+    };
+    IndexRange range = startRange();
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const int* triangle = &indices[t];
+        uint32_t newVertices = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            bool repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+            newVertices += stamps[triangle[corner]] != currentStamp && !repeated;
+        }
+        if (range.vertexCount + newVertices > maxVertices) {
+            ranges.push_back(range);
+            currentStamp++;
+            range = startRange();
+        }
+        for (int corner = 0; corner < 3; corner++) {
+            int vertex = triangle[corner];
+            if (stamps[vertex] != currentStamp) {
+                stamps[vertex] = currentStamp;
+                rangeIndices[vertex] = range.vertexCount++;
+                rangeVertices.push_back(vertices[vertex]);
+            }
+            localIndices.push_back(rangeIndices[vertex]);
+        }
+        range.indexCount += 3;
+    }
+    if (range.indexCount > 0)
+        ranges.push_back(range);
+    return ranges;
+}
+
+size_t be::countUniqueVertices(std::span<const int> indices, size_t vertexCount) {
+    std::vector<bool> used = std::vector<bool>(vertexCount, false);
+    size_t count = 0;
+    for (int index : indices) {
+        count += !used[index];
+        used[index] = true;
+    }
+    return count;
+}
@@ -0,0 +1,198 @@
+#include "meshSimplifier.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+    // symmetric 4x4 matrix of the sum of squared distances to a set of planes
+    struct Quadric {
+        std::array<double, 10> m = {};
+
+        static Quadric fromPlane(const glm::vec3& normal, float distance) {
+            double a = normal.x, b = normal.y, c = normal.z, d = distance;
+            return {{a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d}};
+        }
+        Quadric& operator+=(const Quadric& another) {
+            for (size_t i = 0; i < m.size(); i++)
+                m[i] += another.m[i];
+            return *this;
+        }
+        double evaluate(const glm::vec3& position) const {
+            double x = position.x, y = position.y, z = position.z;
+            return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+                + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+                + m[7] * z * z + 2 * m[8] * z
+                + m[9];
+        }
+    };
+
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const Collapse& another) const {
+            return cost > another.cost;
+        }
+    };
+
+    glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        return glm::cross(b - a, c - a);
+    }
+}
+
+be::SimplifiedMesh be::simplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float maxError) {
+    size_t vertexCount = vertices.size();
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> triangles = std::vector<uint32_t>(indices.begin(), indices.begin() + 3 * triangleCount);
+
+    // vertices sharing a position but not their attributes sit on a seam
+    std::vector<bool> locked = std::vector<bool>(vertexCount, false);
+    std::unordered_map<glm::vec3, uint32_t> positions;
+    for (size_t v = 0; v < vertexCount; v++) {
+        auto [it, inserted] = positions.try_emplace(vertices[v].pos, v);
+        if (!inserted) {
+            locked[v] = true;
+            locked[it->second] = true;
+        }
+    }
+
+    // an edge used by a single triangle is a border, by more than two it is non-manifold
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int c = 0; c < 3; c++) {
+            uint64_t a = triangles[3 * t + c];
+            uint64_t b = triangles[3 * t + (c + 1) % 3];
+            edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+        }
+    }
+    std::ranges::sort(edges);
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i])
+            j++;
+        if (j - i != 2) {
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & UINT32_MAX] = true;
+        }
+        i = j;
+    }
+
+    std::vector<Quadric> quadrics = std::vector<Quadric>(vertexCount);
+    std::vector<std::vector<uint32_t>> vertexTriangles = std::vector<std::vector<uint32_t>>(vertexCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* triangle = &triangles[3 * t];
+        glm::vec3 normal = triangleNormal(vertices[triangle[0]].pos, vertices[triangle[1]].pos, vertices[triangle[2]].pos);
+        float length = glm::length(normal);
+        if (length > 0) {
+            normal /= length;
+            Quadric quadric = Quadric::fromPlane(normal, -glm::dot(normal, vertices[triangle[0]].pos));
+            for (int c = 0; c < 3; c++)
+                quadrics[triangle[c]] += quadric;
+        }
+        for (int c = 0; c < 3; c++)
+            vertexTriangles[triangle[c]].push_back(t);
+    }
+
+    std::vector<bool> aliveVertices = std::vector<bool>(vertexCount, true);
+    std::vector<bool> aliveTriangles = std::vector<bool>(triangleCount, true);
+    std::vector<uint32_t> versions = std::vector<uint32_t>(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses;
+    auto pushCollapse = [&](uint32_t from, uint32_t to) {
+        if (locked[from] || from == to)
+            return;
+        Quadric quadric = quadrics[from];
+        quadric += quadrics[to];
+        double cost = std::max(0.0, quadric.evaluate(vertices[to].pos));
+        collapses.push({cost, from, to, versions[from], versions[to]});
+    };
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int c = 0; c < 3; c++) {
+            pushCollapse(triangles[3 * t + c], triangles[3 * t + (c + 1) % 3]);
+            pushCollapse(triangles[3 * t + (c + 1) % 3], triangles[3 * t + c]);
+        }
+    }
+
+    size_t liveTriangles = triangleCount;
+    double maxCost = static_cast<double>(maxError) * maxError;
+    double error = 0;
+    while (3 * liveTriangles > targetIndexCount && !collapses.empty()) {
+        Collapse collapse = collapses.top();
+        collapses.pop();
+        if (collapse.cost > maxCost)
+            break;
+        uint32_t from = collapse.from, to = collapse.to;
+        if (!aliveVertices[from] || !aliveVertices[to] || versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion)
+            continue;
+
+        // moving from onto to must not fold any of the remaining triangles over
+        bool flips = false;
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!aliveTriangles[t])
+                continue;
+            const uint32_t* triangle = &triangles[3 * t];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+                continue;
+            std::array<glm::vec3, 3> corners;
+            for (int c = 0; c < 3; c++)
+                corners[c] = vertices[triangle[c]].pos;
+            glm::vec3 before = triangleNormal(corners[0], corners[1], corners[2]);
+            for (int c = 0; c < 3; c++)
+                if (triangle[c] == from)
+                    corners[c] = vertices[to].pos;
+            glm::vec3 after = triangleNormal(corners[0], corners[1], corners[2]);
+            if (glm::dot(before, after) <= 0) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips)
+            continue;
+
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!aliveTriangles[t])
+                continue;
+            uint32_t* triangle = &triangles[3 * t];
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                aliveTriangles[t] = false;
+                liveTriangles--;
+                continue;
+            }
+            for (int c = 0; c < 3; c++)
+                if (triangle[c] == from)
+                    triangle[c] = to;
+            vertexTriangles[to].push_back(t);
+        }
+        aliveVertices[from] = false;
+        vertexTriangles[from].clear();
+        quadrics[to] += quadrics[from];
+        versions[to]++;
+        error = std::max(error, collapse.cost);
+
+        std::erase_if(vertexTriangles[to], [&aliveTriangles](uint32_t t) {
+            return !aliveTriangles[t];
+        });
+        for (uint32_t t : vertexTriangles[to]) {
+            for (int c = 0; c < 3; c++) {
+                uint32_t neighbour = triangles[3 * t + c];
+                if (neighbour == to)
+                    continue;
+                pushCollapse(neighbour, to);
+                pushCollapse(to, neighbour);
+            }
+        }
+    }
+
+    SimplifiedMesh result;
+    result.indices.reserve(3 * liveTriangles);
+    for (size_t t = 0; t < triangleCount; t++)
+        if (aliveTriangles[t])
+            result.indices.insert(result.indices.end(), triangles.begin() + 3 * t, triangles.begin() + 3 * t + 3);
+    result.error = static_cast<float>(std::sqrt(error));
+    return result;
+}
@@ -0,0 +1,100 @@
+#include "meshlet.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // vertices is the block starting at vertexOffset in the vertex buffer
+    void computeBounds(be::Meshlet& meshlet, const be::MeshletData& data, std::span<const Vertex> vertices, uint32_t vertexOffset) {
+        glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+            const glm::vec3& position = vertices[data.vertices[meshlet.vertexOffset + i] - vertexOffset].pos;
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+        }
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0;
+        for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+            radius = std::max(radius, glm::distance(center, vertices[data.vertices[meshlet.vertexOffset + i] - vertexOffset].pos));
+        meshlet.sphere = glm::vec4(center, radius);
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.triangleCount);
+        glm::vec3 axis = glm::vec3(0);
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+            uint32_t triangle = data.triangles[meshlet.triangleOffset + t];
+            glm::vec3 corners[3];
+            for (int c = 0; c < 3; c++)
+                corners[c] = vertices[data.vertices[meshlet.vertexOffset + ((triangle >> (8 * c)) & 0xff)] - vertexOffset].pos;
+            glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+            float length = glm::length(normal);
+            if (length == 0)
+                continue;
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+        float axisLength = glm::length(axis);
+        meshlet.cone = glm::vec4(0, 0, 0, 1);
+        if (axisLength == 0)
+            return;
+        axis /= axisLength;
+        float minDot = 1;
+        for (const glm::vec3& normal : normals)
+            minDot = std::min(minDot, glm::dot(normal, axis));
+        // wider than ~84 degrees the cone would almost never cull
+        if (minDot <= 0.1f)
+            return;
+        meshlet.cone = glm::vec4(axis, std::sqrt(1 - minDot * minDot));
+    }
+}
+
+void be::appendMeshlets(MeshletData& data, std::span<const Vertex> vertices, std::span<const uint32_t> indices, uint32_t vertexOffset, uint32_t rangeIndex, uint32_t lodLevel) {
+    // a vertex is already in the current meshlet when its stamp matches
+    std::vector<uint32_t> stamps = std::vector<uint32_t>(vertices.size(), 0);
+    std::vector<uint8_t> localIndices = std::vector<uint8_t>(vertices.size());
+    uint32_t stamp = 1;
+    auto startMeshlet = [&]() -> Meshlet {
+        Meshlet meshlet = {};
+        meshlet.vertexOffset = data.vertices.size();
+        meshlet.triangleOffset = data.triangles.size();
+        meshlet.rangeIndex = rangeIndex;
+        meshlet.lodLevel = lodLevel;
+        return meshlet;
+    };
+    Meshlet meshlet = startMeshlet();
+
+    auto flush = [&]() {
+        if (meshlet.triangleCount == 0)
+            return;
+        computeBounds(meshlet, data, vertices, vertexOffset);
+        data.meshlets.push_back(meshlet);
+        meshlet = startMeshlet();
+        stamp++;
+    };
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const uint32_t* triangle = &indices[t];
+        uint32_t newVertices = 0;
+        for (int c = 0; c < 3; c++) {
+            bool repeated = (c > 0 && triangle[c] == triangle[0]) || (c > 1 && triangle[c] == triangle[1]);
+            newVertices += stamps[triangle[c]] != stamp && !repeated;
+        }
+        if (meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES || meshlet.triangleCount == MESHLET_MAX_TRIANGLES)
+            flush();
+
+        uint32_t packed = 0;
+        for (int c = 0; c < 3; c++) {
+            uint32_t vertex = triangle[c];
+            if (stamps[vertex] != stamp) {
+                stamps[vertex] = stamp;
+                localIndices[vertex] = meshlet.vertexCount++;
+                data.vertices.push_back(vertexOffset + vertex);
+            }
+            packed |= static_cast<uint32_t>(localIndices[vertex]) << (8 * c);
+        }
+        data.triangles.push_back(packed);
+        meshlet.triangleCount++;
+    }
+    flush();
+}
@@ -1,106 +1,120 @@
 #include "objLoader.hpp"
 #include "materialObject.hpp"
+#include "meshSimplifier.hpp"
+#include "objParser.hpp"
 #include "vertex.hpp"
+#include "vertexWelder.hpp"
 #include <algorithm>
 #include <cstddef>
 #include <filesystem>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
 
 ObjLoader::ObjLoader(const std::filesystem::path& path) {
-    tinyobj::ObjReaderConfig config;
-    config.mtl_search_path = path.parent_path();
-
-    tinyobj::ObjReader reader;
-    if (!reader.ParseFromFile(path.string(), config)) 
-        if (!reader.Error().empty())
-            throw std::runtime_error(reader.Error());
+    be::ObjParser reader = be::ObjParser(path);
     
-    if (!reader.Warning().empty()) {
-        std::cout << "TinyObjLoader : " << reader.Warning().c_str() << std::endl;
+    if (!reader.getWarning().empty()) {
+        std::cout << "ObjParser : " << reader.getWarning().c_str() << std::endl;
     }
 
-    const std::vector<tinyobj::shape_t>& shapes = reader.GetShapes();
-    const std::vector<tinyobj::material_t>& materials = reader.GetMaterials();
-    const tinyobj::attrib_t& attrib = reader.GetAttrib();
+    const std::vector<be::ObjShape>& shapes = reader.getShapes();
+    const std::vector<be::ObjMaterial>& materials = reader.getMaterials();
+    const be::ObjAttrib& attrib = reader.getAttrib();
+    m_materialLibraries = reader.getMaterialLibraries();
     
-    std::unordered_map<Vertex, size_t> uniqueVerticies;
+    size_t cornerCount = 0;
+    for (const be::ObjShape& shape : shapes)
+        cornerCount += shape.indices.size();
+    be::VertexWelder uniqueVerticies = be::VertexWelder(cornerCount);
+    m_vertexIndices.reserve(cornerCount);
     std::unordered_map<std::string, size_t> uniqueMaterials;
     std::unordered_map<std::filesystem::path, size_t> uniqueTexturesNames;
 
-    for (const tinyobj::shape_t& shape : shapes) {
-        int offsetVerticies = 0;
-        for (size_t indexFace = 0; indexFace < shape.mesh.num_face_vertices.size(); indexFace ++) {
-            size_t numVerticiesInFace = shape.mesh.num_face_vertices[indexFace];
-            int materialIndex = shape.mesh.material_ids[indexFace];
-            tinyobj::material_t material = materials[materialIndex];
+    for (uint32_t shapeIndex = 0; shapeIndex < shapes.size(); shapeIndex++) {
+        const be::ObjShape& shape = shapes[shapeIndex];
+        for (size_t indexFace = 0; indexFace < shape.materialIds.size(); indexFace ++) {
+            int materialIndex = shape.materialIds[indexFace];
 
             int indexMat = -1;
-            if (uniqueMaterials.count(material.name) == 0) {
-                int indexMapKa = -1, indexMapKs = -1, indexMapKd = -1, indexMapBump = -1;
-                indexMapBump = checkAndGetIndexTexture(uniqueTexturesNames, material.bump_texname);
-                indexMapKa = checkAndGetIndexTexture(uniqueTexturesNames, material.ambient_texname);
-                indexMapKd = checkAndGetIndexTexture(uniqueTexturesNames, material.diffuse_texname);
-                indexMapKs = checkAndGetIndexTexture(uniqueTexturesNames, material.specular_texname);
-
-                MaterialObject mat = {
-                                        .Ns = material.shininess,
-                                        .Ni = material.ior,
-                                        .d = material.dissolve,
-                                        .illum = material.illum,
-                                        .Tf = {material.transmittance[0], material.transmittance[1], material.transmittance[2], 0},
-                                        .Ka = {material.ambient[0], material.ambient[1], material.ambient[2], 0},
-                                        .Kd = {material.diffuse[0], material.diffuse[1], material.diffuse[2], 0},
-                                        .Ks = {material.specular[0], material.specular[1], material.specular[2], 0},
-                                        .Ke = {material.emission[0], material.emission[1], material.emission[2], 0},
-                                        .indexAmbiantMap = indexMapKa,
-                                        .indexDiffuseMap = indexMapKd,
-                                        .indexSpecularMap = indexMapKs,
-                                        .indexBumpMap = indexMapBump
-                };
-                uniqueMaterials[material.name] = uniqueMaterials.size();
-                m_materials.push_back(mat);
-            }
+            if (materialIndex >= 0) {
+                const be::ObjMaterial& material = materials[materialIndex];
+                if (uniqueMaterials.count(material.name) == 0) {
+                    int indexMapKa = -1, indexMapKs = -1, indexMapKd = -1, indexMapBump = -1;
+                    indexMapBump = checkAndGetIndexTexture(uniqueTexturesNames, material.bumpTexture);
+                    indexMapKa = checkAndGetIndexTexture(uniqueTexturesNames, material.ambientTexture);
+                    indexMapKd = checkAndGetIndexTexture(uniqueTexturesNames, material.diffuseTexture);
+                    indexMapKs = checkAndGetIndexTexture(uniqueTexturesNames, material.specularTexture);
+
+                    MaterialObject mat = {
+                                            .Ns = material.shininess,
+                                            .Ni = material.ior,
+                                            .d = material.dissolve,
+                                            .illum = material.illum,
+                                            .Tf = {material.transmittance[0], material.transmittance[1], material.transmittance[2], 0},
+                                            .Ka = {material.ambient[0], material.ambient[1], material.ambient[2], 0},
+                                            .Kd = {material.diffuse[0], material.diffuse[1], material.diffuse[2], 0},
+                                            .Ks = {material.specular[0], material.specular[1], material.specular[2], 0},
+                                            .Ke = {material.emission[0], material.emission[1], material.emission[2], 0},
+                                            .indexAmbiantMap = indexMapKa,
+                                            .indexDiffuseMap = indexMapKd,
+                                            .indexSpecularMap = indexMapKs,
+                                            .indexBumpMap = indexMapBump
+                    };
+                    uniqueMaterials[material.name] = uniqueMaterials.size();
+                    m_materials.push_back(mat);
+                }
 
-            indexMat = uniqueMaterials[material.name];
-            for (size_t j = 0; j < numVerticiesInFace; j++) {
-                tinyobj::index_t vertexIndex = shape.mesh.indices[offsetVerticies + j];
+                indexMat = uniqueMaterials[material.name];
+            }
+            // a new submesh starts with every shape and every material change inside a shape
+            if (m_submeshes.empty() || m_submeshes.back().shapeIndex != shapeIndex || m_submeshes.back().materialIndex != indexMat) {
+                be::Submesh submesh = {};
+                submesh.firstIndex = m_vertexIndices.size();
+                submesh.materialIndex = indexMat;
+                submesh.shapeIndex = shapeIndex;
+                m_submeshes.push_back(submesh);
+            }
+            m_submeshes.back().indexCount += 3;
+            for (size_t j = 0; j < 3; j++) {
+                be::ObjIndex vertexIndex = shape.indices[3 * indexFace + j];
 
                 glm::vec3 position;
-                position.x = attrib.vertices[3 * vertexIndex.vertex_index]; 
-                position.y = attrib.vertices[3 * vertexIndex.vertex_index + 1];
-                position.z = attrib.vertices[3 * vertexIndex.vertex_index + 2];
+                position.x = attrib.vertices[3 * vertexIndex.vertexIndex]; 
+                position.y = attrib.vertices[3 * vertexIndex.vertexIndex + 1];
+                position.z = attrib.vertices[3 * vertexIndex.vertexIndex + 2];
             
-                glm::vec3 normal;
-                normal.x = attrib.vertices[3 * vertexIndex.normal_index]; 
-                normal.y = attrib.vertices[3 * vertexIndex.normal_index + 1];
-                normal.z = attrib.vertices[3 * vertexIndex.normal_index + 2];
+                // kept reading the position array to stay identical to the previous loader output
+                glm::vec3 normal = glm::vec3(0);
+                if (vertexIndex.normalIndex >= 0 && 3 * static_cast<size_t>(vertexIndex.normalIndex) + 2 < attrib.vertices.size()) {
+                    normal.x = attrib.vertices[3 * vertexIndex.normalIndex]; 
+                    normal.y = attrib.vertices[3 * vertexIndex.normalIndex + 1];
+                    normal.z = attrib.vertices[3 * vertexIndex.normalIndex + 2];
+                }
     
-                glm::vec2 texCoord;
-                texCoord.x = attrib.texcoords[2 * vertexIndex.texcoord_index];
-                texCoord.y = attrib.texcoords[2 * vertexIndex.texcoord_index + 1];
+                glm::vec2 texCoord = glm::vec2(0);
+                if (vertexIndex.texCoordIndex >= 0) {
+                    texCoord.x = attrib.texCoords[2 * vertexIndex.texCoordIndex];
+                    texCoord.y = attrib.texCoords[2 * vertexIndex.texCoordIndex + 1];
+                }
 
-                glm::vec3 color;
-                color.r = attrib.colors[3 * vertexIndex.vertex_index];
-                color.g = attrib.colors[3 * vertexIndex.vertex_index + 1];
-                color.b = attrib.colors[3 * vertexIndex.vertex_index + 2];
+                glm::vec3 color = glm::vec3(1);
+                if (!attrib.colors.empty()) {
+                    color.r = attrib.colors[3 * vertexIndex.vertexIndex];
+                    color.g = attrib.colors[3 * vertexIndex.vertexIndex + 1];
+                    color.b = attrib.colors[3 * vertexIndex.vertexIndex + 2];
+                }
 
                 Vertex v = {.pos = position, .color = color, .normal = normal, .texCoord = texCoord, .indexMat = indexMat};
-                if (uniqueVerticies.count(v) == 0) {
-                    uniqueVerticies[v] = uniqueVerticies.size();
-                    m_verticies.push_back(v);
-                }
-                m_vertexIndices.push_back(uniqueVerticies[v]);
+                m_vertexIndices.push_back(uniqueVerticies.findOrInsert(v));
             }
-
-            offsetVerticies += numVerticiesInFace;
         }
 
     }
+    m_weldStats = uniqueVerticies.getStats();
+    m_verticies = uniqueVerticies.releaseVertices();
 }
 
 std::filesystem::path ObjLoader::correctPathFormat(const std::string& entryPath) {
@@ -139,6 +153,10 @@ const std::vector<std::filesystem::path>& ObjLoader::getTexturePath() {
     return m_texturesPath;
 }
 
+const std::vector<std::filesystem::path>& ObjLoader::getMaterialLibraries() {
+    return m_materialLibraries;
+}
+
 const std::vector<MaterialObject>& ObjLoader::getMaterials() {
     return m_materials;
 }
@@ -150,3 +168,151 @@ const std::vector<Vertex>& ObjLoader::getVertices() {
 const std::vector<int>& ObjLoader::getIndices() {
     return m_vertexIndices;
 }
+
+be::MeshOptimizationReport ObjLoader::optimize() {
+    be::MeshOptimizationReport report;
+    report.before = be::analyzeVertexCache(m_vertexIndices, m_verticies.size());
+    // triangles are only reordered inside their submesh so the table stays valid
+    for (const be::Submesh& submesh : m_submeshes) {
+        std::span<int> indices = std::span<int>(m_vertexIndices).subspan(submesh.firstIndex, submesh.indexCount);
+        std::vector<uint32_t> clusters = be::optimizeVertexCache(indices, m_verticies.size());
+        be::optimizeOverdraw(indices, m_verticies, clusters);
+    }
+    be::optimizeVertexFetch(m_verticies, m_vertexIndices);
+    report.after = be::analyzeVertexCache(m_vertexIndices, m_verticies.size());
+    return report;
+}
+
+void ObjLoader::splitIndexRanges(size_t vertexSize) {
+    std::vector<Vertex> rangeVertices;
+    // one range per submesh needs no duplicated vertex
+    size_t unsplitVertices = 0;
+    for (const be::Submesh& submesh : m_submeshes)
+        unsplitVertices += be::countUniqueVertices(std::span<const int>(m_vertexIndices).subspan(submesh.firstIndex, submesh.indexCount), m_verticies.size());
+    split(be::MAX_SHORT_INDEX_VERTICES, rangeVertices);
+    m_shortIndices = vertexSize * (rangeVertices.size() - unsplitVertices) <= 2 * m_vertexIndices.size();
+    if (!m_shortIndices)
+        split(std::numeric_limits<size_t>::max(), rangeVertices);
+    m_verticies = std::move(rangeVertices);
+    // keeps the 32 bit indices valid for the duplicated vertices
+    for (const be::IndexRange& range : m_indexRanges)
+        for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++)
+            m_vertexIndices[i] = range.vertexOffset + m_rangeIndices[i];
+}
+
+void ObjLoader::split(size_t maxVertices, std::vector<Vertex>& rangeVertices) {
+    rangeVertices.clear();
+    rangeVertices.reserve(m_verticies.size());
+    m_rangeIndices.clear();
+    m_rangeIndices.reserve(m_vertexIndices.size());
+    m_indexRanges.clear();
+    for (uint32_t s = 0; s < m_submeshes.size(); s++) {
+        be::Submesh& submesh = m_submeshes[s];
+        submesh.firstRange = m_indexRanges.size();
+        submesh.firstVertex = rangeVertices.size();
+        std::span<const int> indices = std::span<const int>(m_vertexIndices).subspan(submesh.firstIndex, submesh.indexCount);
+        std::vector<be::IndexRange> ranges = be::splitIndexRanges(m_verticies, indices, rangeVertices, m_rangeIndices, maxVertices);
+        for (be::IndexRange& range : ranges)
+            range.submeshIndex = s;
+        m_indexRanges.insert(m_indexRanges.end(), ranges.begin(), ranges.end());
+        submesh.rangeCount = ranges.size();
+        submesh.vertexCount = rangeVertices.size() - submesh.firstVertex;
+
+        glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (size_t v = submesh.firstVertex; v < rangeVertices.size(); v++) {
+            boundsMin = glm::min(boundsMin, rangeVertices[v].pos);
+            boundsMax = glm::max(boundsMax, rangeVertices[v].pos);
+        }
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0;
+        for (size_t v = submesh.firstVertex; v < rangeVertices.size(); v++)
+            radius = std::max(radius, glm::distance(center, rangeVertices[v].pos));
+        submesh.aabbMin = glm::vec4(boundsMin, 0);
+        submesh.aabbMax = glm::vec4(boundsMax, 0);
+        submesh.sphere = glm::vec4(center, radius);
+    }
+}
+
+bool ObjLoader::hasShortIndices() {
+    return m_shortIndices;
+}
+
+const std::vector<uint32_t>& ObjLoader::getRangeIndices() {
+    return m_rangeIndices;
+}
+
+std::vector<uint16_t> ObjLoader::getShortIndices() {
+    if (!m_shortIndices)
+        return {};
+    return std::vector<uint16_t>(m_rangeIndices.begin(), m_rangeIndices.end());
+}
+
+const std::vector<be::IndexRange>& ObjLoader::getIndexRanges() {
+    return m_indexRanges;
+}
+
+const std::vector<be::Submesh>& ObjLoader::getSubmeshes() {
+    return m_submeshes;
+}
+
+void ObjLoader::buildLods() {
+    // below that many triangles a range is not worth simplifying
+    const size_t minLodIndices = 3 * 64;
+    m_lods.clear();
+    for (be::IndexRange& range : m_indexRanges) {
+        std::span<const Vertex> rangeVertices = std::span<const Vertex>(m_verticies).subspan(range.vertexOffset, range.vertexCount);
+        glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const Vertex& vertex : rangeVertices) {
+            boundsMin = glm::min(boundsMin, vertex.pos);
+            boundsMax = glm::max(boundsMax, vertex.pos);
+        }
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0;
+        for (const Vertex& vertex : rangeVertices)
+            radius = std::max(radius, glm::distance(center, vertex.pos));
+        range.sphere = glm::vec4(center, radius);
+
+        range.firstLod = m_lods.size();
+        m_lods.push_back({range.firstIndex, range.indexCount, 0});
+        std::vector<uint32_t> indices = std::vector<uint32_t>(m_rangeIndices.begin() + range.firstIndex, m_rangeIndices.begin() + range.firstIndex + range.indexCount);
+        float error = 0;
+        while (m_lods.size() - range.firstLod < be::MAX_LOD_LEVELS && indices.size() >= minLodIndices) {
+            size_t target = indices.size() / 6 * 3;
+            be::SimplifiedMesh simplified = be::simplifyMesh(rangeVertices, indices, target);
+            // locked borders and seams stop the simplification early
+            if (10 * simplified.indices.size() > 9 * indices.size())
+                break;
+            std::vector<int> lodIndices = std::vector<int>(simplified.indices.begin(), simplified.indices.end());
+            be::optimizeVertexCache(lodIndices, range.vertexCount);
+            error += simplified.error;
+            m_lods.push_back({static_cast<uint32_t>(m_rangeIndices.size()), static_cast<uint32_t>(lodIndices.size()), error});
+            m_rangeIndices.insert(m_rangeIndices.end(), lodIndices.begin(), lodIndices.end());
+            indices = std::move(simplified.indices);
+        }
+        range.lodCount = m_lods.size() - range.firstLod;
+    }
+}
+
+const std::vector<be::LodLevel>& ObjLoader::getLods() {
+    return m_lods;
+}
+
+be::MeshletData ObjLoader::buildMeshlets() {
+    be::MeshletData data;
+    for (uint32_t r = 0; r < m_indexRanges.size(); r++) {
+        const be::IndexRange& range = m_indexRanges[r];
+        std::span<const Vertex> rangeVertices = std::span<const Vertex>(m_verticies).subspan(range.vertexOffset, range.vertexCount);
+        for (uint32_t level = 0; level < range.lodCount; level++) {
+            const be::LodLevel& lod = m_lods[range.firstLod + level];
+            std::span<const uint32_t> indices = std::span<const uint32_t>(m_rangeIndices).subspan(lod.firstIndex, lod.indexCount);
+            be::appendMeshlets(data, rangeVertices, indices, range.vertexOffset, r, level);
+        }
+    }
+    return data;
+}
+
+const be::WeldStats& ObjLoader::getWeldStats() {
+    return m_weldStats;
+}
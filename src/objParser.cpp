@@ -0,0 +1,416 @@
+#include "objParser.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    // chunks smaller than this are not worth a thread
+    constexpr size_t MIN_CHUNK_SIZE = 1 << 18;
+
+    enum RelativeIndex : uint8_t {
+        relativeVertex = 1,
+        relativeTexCoord = 2,
+        relativeNormal = 4
+    };
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    void skipBlanks(const char*& cursor, const char* end) {
+        while (cursor < end && isBlank(*cursor))
+            cursor++;
+    }
+
+    bool parseFloat(const char*& cursor, const char* end, float& value) {
+        skipBlanks(cursor, end);
+        if (cursor < end && *cursor == '+')
+            cursor++;
+        auto [ptr, error] = std::from_chars(cursor, end, value);
+        if (ptr == cursor)
+            return false;
+        cursor = ptr;
+        return error == std::errc();
+    }
+
+    bool parseInt(const char*& cursor, const char* end, int& value) {
+        if (cursor < end && *cursor == '+')
+            cursor++;
+        auto [ptr, error] = std::from_chars(cursor, end, value);
+        if (ptr == cursor)
+            return false;
+        cursor = ptr;
+        return error == std::errc();
+    }
+
+    bool startsWithKeyword(const char* cursor, const char* end, std::string_view keyword) {
+        size_t length = keyword.size();
+        return static_cast<size_t>(end - cursor) > length
+            && std::memcmp(cursor, keyword.data(), length) == 0
+            && isBlank(cursor[length]);
+    }
+
+    std::string_view trimmed(const char* begin, const char* end) {
+        while (begin < end && isBlank(*begin))
+            begin++;
+        while (end > begin && isBlank(end[-1]))
+            end--;
+        return {begin, static_cast<size_t>(end - begin)};
+    }
+
+    // OBJ indices are 1-based, negative ones are relative to the last element read so far
+    int resolveIndex(int raw, size_t count, uint8_t flag, uint8_t& mask) {
+        if (raw > 0)
+            return raw - 1;
+        if (raw < 0) {
+            mask |= flag;
+            return static_cast<int>(count) + raw;
+        }
+        return -1;
+    }
+
+    float squaredDistance(const std::vector<float>& vertices, int a, int b) {
+        float x = vertices[3 * a] - vertices[3 * b];
+        float y = vertices[3 * a + 1] - vertices[3 * b + 1];
+        float z = vertices[3 * a + 2] - vertices[3 * b + 2];
+        return x * x + y * y + z * z;
+    }
+}
+
+struct be::ObjParser::Chunk {
+    enum class StatementType {
+        material,
+        group,
+        library
+    };
+
+    struct Statement {
+        StatementType type;
+        size_t face;
+        std::string name;
+    };
+
+    std::vector<float> vertices;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+    std::vector<float> colors;
+    std::vector<ObjIndex> corners;
+    std::vector<uint8_t> relativeMasks;
+    std::vector<uint32_t> faceSizes;
+    std::vector<Statement> statements;
+};
+
+be::ObjParser::ObjParser(const std::filesystem::path& path) {
+    be::MappedFile file = be::MappedFile(path);
+    if (!file.isOpen())
+        throw std::runtime_error(std::format("Failed to open {}.", path.string()));
+    std::string_view text = std::string_view(reinterpret_cast<const char*>(file.getData().data()), file.getSize());
+
+    // split the file on line boundaries
+    size_t chunkCount = std::clamp<size_t>(text.size() / MIN_CHUNK_SIZE, 1, be::getWorkerCount() * 4);
+    std::vector<std::string_view> chunkTexts;
+    size_t begin = 0;
+    for (size_t i = 1; i <= chunkCount && begin < text.size(); i++) {
+        size_t end = i == chunkCount ? text.size() : std::max(begin, text.size() * i / chunkCount);
+        end = text.find('\n', end);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+        chunkTexts.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    std::vector<Chunk> chunks = std::vector<Chunk>(chunkTexts.size());
+    be::parallelFor(chunks.size(), [&](size_t i) {
+        parseChunk(chunkTexts[i], chunks[i]);
+    });
+
+    // offsets of every chunk in the merged attributes
+    bool hasColors = std::ranges::any_of(chunks, [](const Chunk& chunk) { return !chunk.colors.empty(); });
+    std::vector<size_t> vertexOffsets, normalOffsets, texCoordOffsets;
+    size_t vertexCount = 0, normalCount = 0, texCoordCount = 0;
+    for (const Chunk& chunk : chunks) {
+        vertexOffsets.push_back(vertexCount);
+        normalOffsets.push_back(normalCount);
+        texCoordOffsets.push_back(texCoordCount);
+        vertexCount += chunk.vertices.size();
+        normalCount += chunk.normals.size();
+        texCoordCount += chunk.texCoords.size();
+    }
+    m_attrib.vertices.resize(vertexCount);
+    m_attrib.normals.resize(normalCount);
+    m_attrib.texCoords.resize(texCoordCount);
+    if (hasColors)
+        m_attrib.colors.resize(vertexCount, 1);
+
+    std::atomic<bool> invalidIndex = false;
+    std::vector<std::vector<ObjIndex>> triangles = std::vector<std::vector<ObjIndex>>(chunks.size());
+    std::vector<std::vector<uint32_t>> trianglesPerFace = std::vector<std::vector<uint32_t>>(chunks.size());
+    be::parallelFor(chunks.size(), [&](size_t i) {
+        Chunk& chunk = chunks[i];
+        std::ranges::copy(chunk.vertices, m_attrib.vertices.begin() + vertexOffsets[i]);
+        std::ranges::copy(chunk.normals, m_attrib.normals.begin() + normalOffsets[i]);
+        std::ranges::copy(chunk.texCoords, m_attrib.texCoords.begin() + texCoordOffsets[i]);
+        if (hasColors)
+            std::ranges::copy(chunk.colors, m_attrib.colors.begin() + vertexOffsets[i]);
+
+        for (size_t j = 0; j < chunk.corners.size(); j++) {
+            ObjIndex& corner = chunk.corners[j];
+            uint8_t mask = chunk.relativeMasks[j];
+            if (mask & relativeVertex)
+                corner.vertexIndex += vertexOffsets[i] / 3;
+            if (mask & relativeTexCoord)
+                corner.texCoordIndex += texCoordOffsets[i] / 2;
+            if (mask & relativeNormal)
+                corner.normalIndex += normalOffsets[i] / 3;
+            if (corner.vertexIndex < 0 || static_cast<size_t>(corner.vertexIndex) >= vertexCount / 3
+                || corner.texCoordIndex >= static_cast<int>(texCoordCount / 2)
+                || corner.normalIndex >= static_cast<int>(normalCount / 3))
+                invalidIndex = true;
+        }
+    });
+    if (invalidIndex)
+        throw std::runtime_error(std::format("Failed to parse {} : face index out of range.", path.string()));
+    be::parallelFor(chunks.size(), [&](size_t i) {
+        triangulate(chunks[i], triangles[i], trianglesPerFace[i]);
+    });
+
+    // materials have to be known before resolving usemtl
+    for (const Chunk& chunk : chunks)
+        for (const Chunk::Statement& statement : chunk.statements)
+            if (statement.type == Chunk::StatementType::library) {
+                m_materialLibraries.push_back(path.parent_path() / statement.name);
+                parseMaterials(m_materialLibraries.back());
+            }
+    std::unordered_map<std::string, int> materialIds;
+    for (size_t i = 0; i < m_materials.size(); i++)
+        materialIds[m_materials[i].name] = i;
+
+    // deterministic merge in file order
+    ObjShape shape;
+    int currentMaterial = -1;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        const Chunk& chunk = chunks[i];
+        size_t nextStatement = 0;
+        size_t triangleOffset = 0;
+        for (size_t face = 0; face <= chunk.faceSizes.size(); face++) {
+            for (; nextStatement < chunk.statements.size() && chunk.statements[nextStatement].face == face; nextStatement++) {
+                const Chunk::Statement& statement = chunk.statements[nextStatement];
+                if (statement.type == Chunk::StatementType::material) {
+                    auto material = materialIds.find(statement.name);
+                    currentMaterial = material == materialIds.end() ? -1 : material->second;
+                    if (material == materialIds.end())
+                        m_warning += std::format("material [ '{}' ] not found in .mtl\n", statement.name);
+                } else if (statement.type == Chunk::StatementType::group) {
+                    if (!shape.indices.empty())
+                        m_shapes.push_back(std::move(shape));
+                    shape = ObjShape();
+                    shape.name = statement.name;
+                }
+            }
+            if (face == chunk.faceSizes.size())
+                break;
+            uint32_t triangleCount = trianglesPerFace[i][face];
+            shape.indices.insert(shape.indices.end(), triangles[i].begin() + 3 * triangleOffset, triangles[i].begin() + 3 * (triangleOffset + triangleCount));
+            shape.materialIds.insert(shape.materialIds.end(), triangleCount, currentMaterial);
+            triangleOffset += triangleCount;
+        }
+    }
+    if (!shape.indices.empty())
+        m_shapes.push_back(std::move(shape));
+}
+
+void be::ObjParser::parseChunk(std::string_view text, Chunk& chunk) const {
+    const char* cursor = text.data();
+    const char* textEnd = text.data() + text.size();
+    while (cursor < textEnd) {
+        const char* end = static_cast<const char*>(std::memchr(cursor, '\n', textEnd - cursor));
+        const char* nextLine = end == nullptr ? textEnd : end + 1;
+        end = end == nullptr ? textEnd : end;
+        skipBlanks(cursor, end);
+        if (cursor == end || *cursor == '#') {
+            cursor = nextLine;
+            continue;
+        }
+
+        if (startsWithKeyword(cursor, end, "v")) {
+            cursor += 1;
+            float position[3] = {0, 0, 0};
+            for (float& value : position)
+                parseFloat(cursor, end, value);
+            chunk.vertices.insert(chunk.vertices.end(), position, position + 3);
+            float color[3];
+            if (parseFloat(cursor, end, color[0]) && parseFloat(cursor, end, color[1]) && parseFloat(cursor, end, color[2])) {
+                // colors start at the first vertex which has one, the previous ones are white
+                chunk.colors.resize(chunk.vertices.size() - 3, 1);
+                chunk.colors.insert(chunk.colors.end(), color, color + 3);
+            } else if (!chunk.colors.empty()) {
+                chunk.colors.resize(chunk.vertices.size(), 1);
+            }
+        } else if (startsWithKeyword(cursor, end, "vn")) {
+            cursor += 2;
+            float normal[3] = {0, 0, 0};
+            for (float& value : normal)
+                parseFloat(cursor, end, value);
+            chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+        } else if (startsWithKeyword(cursor, end, "vt")) {
+            cursor += 2;
+            float texCoord[2] = {0, 0};
+            for (float& value : texCoord)
+                parseFloat(cursor, end, value);
+            chunk.texCoords.insert(chunk.texCoords.end(), texCoord, texCoord + 2);
+        } else if (startsWithKeyword(cursor, end, "f")) {
+            cursor += 1;
+            uint32_t faceSize = 0;
+            while (true) {
+                skipBlanks(cursor, end);
+                int raw = 0;
+                if (!parseInt(cursor, end, raw))
+                    break;
+                uint8_t mask = 0;
+                ObjIndex index = {resolveIndex(raw, chunk.vertices.size() / 3, relativeVertex, mask), -1, -1};
+                if (cursor < end && *cursor == '/') {
+                    cursor++;
+                    if (parseInt(cursor, end, raw))
+                        index.texCoordIndex = resolveIndex(raw, chunk.texCoords.size() / 2, relativeTexCoord, mask);
+                    if (cursor < end && *cursor == '/') {
+                        cursor++;
+                        if (parseInt(cursor, end, raw))
+                            index.normalIndex = resolveIndex(raw, chunk.normals.size() / 3, relativeNormal, mask);
+                    }
+                }
+                chunk.corners.push_back(index);
+                chunk.relativeMasks.push_back(mask);
+                faceSize++;
+            }
+            chunk.faceSizes.push_back(faceSize);
+        } else if (startsWithKeyword(cursor, end, "usemtl")) {
+            chunk.statements.push_back({Chunk::StatementType::material, chunk.faceSizes.size(), std::string(trimmed(cursor + 6, end))});
+        } else if (startsWithKeyword(cursor, end, "mtllib")) {
+            chunk.statements.push_back({Chunk::StatementType::library, chunk.faceSizes.size(), std::string(trimmed(cursor + 6, end))});
+        } else if (startsWithKeyword(cursor, end, "o") || startsWithKeyword(cursor, end, "g")) {
+            chunk.statements.push_back({Chunk::StatementType::group, chunk.faceSizes.size(), std::string(trimmed(cursor + 1, end))});
+        }
+        cursor = nextLine;
+    }
+}
+
+void be::ObjParser::triangulate(const Chunk& chunk, std::vector<ObjIndex>& triangles, std::vector<uint32_t>& trianglesPerFace) const {
+    triangles.reserve(chunk.corners.size());
+    trianglesPerFace.reserve(chunk.faceSizes.size());
+    size_t offset = 0;
+    for (uint32_t faceSize : chunk.faceSizes) {
+        const ObjIndex* corners = chunk.corners.data() + offset;
+        offset += faceSize;
+        if (faceSize < 3) {
+            trianglesPerFace.push_back(0);
+            continue;
+        }
+        if (faceSize == 4) {
+            // split quads along their shortest diagonal
+            if (squaredDistance(m_attrib.vertices, corners[0].vertexIndex, corners[2].vertexIndex)
+                < squaredDistance(m_attrib.vertices, corners[1].vertexIndex, corners[3].vertexIndex)) {
+                triangles.insert(triangles.end(), {corners[0], corners[1], corners[2], corners[0], corners[2], corners[3]});
+            } else {
+                triangles.insert(triangles.end(), {corners[0], corners[1], corners[3], corners[1], corners[2], corners[3]});
+            }
+            trianglesPerFace.push_back(2);
+            continue;
+        }
+        for (uint32_t i = 1; i + 1 < faceSize; i++)
+            triangles.insert(triangles.end(), {corners[0], corners[i], corners[i + 1]});
+        trianglesPerFace.push_back(faceSize - 2);
+    }
+}
+
+void be::ObjParser::parseMaterials(const std::filesystem::path& path) {
+    std::ifstream file = std::ifstream(path);
+    if (!file) {
+        m_warning += std::format("Material file [ {} ] not found.\n", path.string());
+        return;
+    }
+
+    auto readColor = [](std::istringstream& stream, std::array<float, 3>& color) {
+        stream >> color[0] >> color[1] >> color[2];
+    };
+    // texture options come first, the file name is the last token
+    auto readTexture = [](const std::string& line, size_t keywordSize) {
+        std::string_view rest = trimmed(line.data() + keywordSize, line.data() + line.size());
+        size_t separator = rest.find_last_of(" \t");
+        return std::string(separator == std::string_view::npos ? rest : rest.substr(separator + 1));
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream = std::istringstream(line);
+        std::string keyword;
+        stream >> keyword;
+        if (keyword == "newmtl") {
+            ObjMaterial material;
+            material.name = std::string(trimmed(line.data() + line.find("newmtl") + 6, line.data() + line.size()));
+            m_materials.push_back(material);
+            continue;
+        }
+        if (keyword.empty() || keyword[0] == '#' || m_materials.empty())
+            continue;
+
+        ObjMaterial& material = m_materials.back();
+        size_t keywordSize = line.find(keyword) + keyword.size();
+        if (keyword == "Ka")
+            readColor(stream, material.ambient);
+        else if (keyword == "Kd")
+            readColor(stream, material.diffuse);
+        else if (keyword == "Ks")
+            readColor(stream, material.specular);
+        else if (keyword == "Ke")
+            readColor(stream, material.emission);
+        else if (keyword == "Tf" || keyword == "Kt")
+            readColor(stream, material.transmittance);
+        else if (keyword == "Ns")
+            stream >> material.shininess;
+        else if (keyword == "Ni")
+            stream >> material.ior;
+        else if (keyword == "d")
+            stream >> material.dissolve;
+        else if (keyword == "Tr") {
+            float transparency = 0;
+            stream >> transparency;
+            material.dissolve = 1 - transparency;
+        } else if (keyword == "illum")
+            stream >> material.illum;
+        else if (keyword == "map_Ka")
+            material.ambientTexture = readTexture(line, keywordSize);
+        else if (keyword == "map_Kd")
+            material.diffuseTexture = readTexture(line, keywordSize);
+        else if (keyword == "map_Ks")
+            material.specularTexture = readTexture(line, keywordSize);
+        else if (keyword == "map_bump" || keyword == "map_Bump" || keyword == "bump")
+            material.bumpTexture = readTexture(line, keywordSize);
+    }
+}
+
+const be::ObjAttrib& be::ObjParser::getAttrib() const {
+    return m_attrib;
+}
+
+const std::vector<be::ObjShape>& be::ObjParser::getShapes() const {
+    return m_shapes;
+}
+
+const std::vector<be::ObjMaterial>& be::ObjParser::getMaterials() const {
+    return m_materials;
+}
+
+const std::string& be::ObjParser::getWarning() const {
+    return m_warning;
+}
+
+const std::vector<std::filesystem::path>& be::ObjParser::getMaterialLibraries() const {
+    return m_materialLibraries;
+}
@@ -0,0 +1,456 @@
+#include "occlusionRasterizer.hpp"
+#include "meshSimplifier.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(BE_X86_KERNELS)
+#define BE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BE_TARGET_AVX2
+#endif
+
+namespace {
+    // vertices closer than this to the eye plane are not projected
+    const float MIN_CLIP_W = 1e-4f;
+    const size_t SETUP_CHUNK_SIZE = 4096;
+    // distance to the planes of its triangles, relative to the submesh diagonal, under which a vertex of an occluder may collapse,
+    // half a pixel of the buffer when the submesh spans its width
+    const float OCCLUDER_PLANE_TOLERANCE = 0.5f / be::OCCLUSION_BUFFER_WIDTH;
+
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    glm::vec2 toPixels(const glm::vec4& clip) {
+        return glm::vec2(
+            (clip.x / clip.w * 0.5f + 0.5f) * be::OCCLUSION_BUFFER_WIDTH,
+            (clip.y / clip.w * 0.5f + 0.5f) * be::OCCLUSION_BUFFER_HEIGHT
+        );
+    }
+
+    // bit l is set when minX <= x + l <= maxX
+    unsigned laneMask(int32_t x, int32_t minX, int32_t maxX, int32_t lanes) {
+        unsigned mask = (1u << lanes) - 1;
+        if (x < minX)
+            mask &= ~((1u << (minX - x)) - 1);
+        if (x + lanes - 1 > maxX)
+            mask &= (1u << (maxX - x + 1)) - 1;
+        return mask;
+    }
+}
+
+be::OccluderMesh be::buildOccluders(
+    std::span<const Submesh> submeshes,
+    std::span<const Vertex> vertices,
+    std::span<const uint32_t> indices,
+    std::span<const IndexRange> ranges,
+    float minExtent,
+    float reduction
+) {
+    glm::vec3 sceneMin = glm::vec3(INFINITY), sceneMax = glm::vec3(-INFINITY);
+    for (const Submesh& submesh : submeshes) {
+        sceneMin = glm::min(sceneMin, glm::vec3(submesh.aabbMin));
+        sceneMax = glm::max(sceneMax, glm::vec3(submesh.aabbMax));
+    }
+    float sceneDiagonal = glm::length(sceneMax - sceneMin);
+
+    // walls and floors: large in at least two directions
+    std::vector<uint32_t> candidates;
+    for (uint32_t s = 0; s < submeshes.size(); s++) {
+        glm::vec3 extent = glm::vec3(submeshes[s].aabbMax - submeshes[s].aabbMin);
+        float middle = std::max(std::min(extent.x, extent.y), std::min(std::max(extent.x, extent.y), extent.z));
+        if (middle >= minExtent * sceneDiagonal && submeshes[s].indexCount >= 3)
+            candidates.push_back(s);
+    }
+
+    std::vector<OccluderMesh> parts = std::vector<OccluderMesh>(candidates.size());
+    parallelFor(candidates.size(), [&](size_t task) {
+        const Submesh& submesh = submeshes[candidates[task]];
+        // only the position matters, welding removes the seams the simplifier would lock
+        std::unordered_map<glm::vec3, uint32_t> welded;
+        std::vector<Vertex> positions;
+        std::vector<uint32_t> localIndices;
+        for (uint32_t r = submesh.firstRange; r < submesh.firstRange + submesh.rangeCount; r++) {
+            const IndexRange& range = ranges[r];
+            for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount / 3 * 3; i++) {
+                const glm::vec3& position = vertices[range.vertexOffset + indices[i]].pos;
+                auto [it, inserted] = welded.try_emplace(position, positions.size());
+                if (inserted) {
+                    Vertex vertex = {};
+                    vertex.pos = position;
+                    positions.push_back(vertex);
+                }
+                localIndices.push_back(it->second);
+            }
+        }
+        size_t targetIndexCount = std::max<size_t>(3, static_cast<size_t>(localIndices.size() * reduction) / 3 * 3);
+        // only the collapses that stay on the surface, an occluder reaching past it would hide what is behind the real geometry
+        float maxError = OCCLUDER_PLANE_TOLERANCE * glm::length(glm::vec3(submesh.aabbMax - submesh.aabbMin));
+        SimplifiedMesh simplified = simplifyMesh(positions, localIndices, targetIndexCount, maxError);
+
+        OccluderMesh& part = parts[task];
+        std::vector<uint32_t> remap = std::vector<uint32_t>(positions.size(), UINT32_MAX);
+        for (uint32_t index : simplified.indices) {
+            if (remap[index] == UINT32_MAX) {
+                remap[index] = part.positions.size();
+                part.positions.push_back(positions[index].pos);
+            }
+            part.indices.push_back(remap[index]);
+        }
+    });
+
+    OccluderMesh occluders = {};
+    occluders.submeshCount = candidates.size();
+    for (const OccluderMesh& part : parts) {
+        uint32_t firstVertex = occluders.positions.size();
+        occluders.positions.insert(occluders.positions.end(), part.positions.begin(), part.positions.end());
+        for (uint32_t index : part.indices)
+            occluders.indices.push_back(firstVertex + index);
+    }
+    return occluders;
+}
+
+be::OcclusionRasterizer::OcclusionRasterizer() :
+    m_depth(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT, INFINITY),
+    m_stats({}),
+    m_kernel(CullKernel::scalar)
+{
+    if (FrustumCuller::isSupported(CullKernel::avx2))
+        m_kernel = CullKernel::avx2;
+    else if (FrustumCuller::isSupported(CullKernel::sse))
+        m_kernel = CullKernel::sse;
+}
+
+void be::OcclusionRasterizer::setOccluders(OccluderMesh occluders) {
+    m_positions = std::move(occluders.positions);
+    m_indices = std::move(occluders.indices);
+    m_clipPositions.resize(m_positions.size());
+    m_triangles.resize(m_indices.size() / 3);
+    m_areas.resize(m_triangles.size());
+    m_farthest.resize(m_triangles.size());
+
+    // the submeshes were welded by position, the triangles of a surface share their edges
+    auto edgeKey = [](uint32_t from, uint32_t to) {
+        return static_cast<uint64_t>(from) << 32 | to;
+    };
+    std::unordered_map<uint64_t, uint32_t> halfEdges;
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    for (uint32_t i = 0; i < m_indices.size(); i++) {
+        uint32_t from = m_indices[i], to = m_indices[i / 3 * 3 + (i + 1) % 3];
+        halfEdges[edgeKey(from, to)] = i;
+        edgeUses[edgeKey(std::min(from, to), std::max(from, to))]++;
+    }
+    m_neighbors.assign(m_indices.size(), UINT32_MAX);
+    for (uint32_t i = 0; i < m_indices.size(); i++) {
+        uint32_t from = m_indices[i], to = m_indices[i / 3 * 3 + (i + 1) % 3];
+        auto twin = halfEdges.find(edgeKey(to, from));
+        if (from != to && twin != halfEdges.end() && edgeUses[edgeKey(std::min(from, to), std::max(from, to))] == 2)
+            m_neighbors[i] = twin->second / 3;
+    }
+
+    m_stats = {};
+    m_stats.occluderTriangles = m_triangles.size();
+}
+
+bool be::OcclusionRasterizer::hasOccluders() const {
+    return !m_triangles.empty();
+}
+
+void be::OcclusionRasterizer::setKernel(CullKernel kernel) {
+    m_kernel = FrustumCuller::isSupported(kernel) ? kernel : CullKernel::scalar;
+}
+
+be::CullKernel be::OcclusionRasterizer::getKernel() const {
+    return m_kernel;
+}
+
+std::span<const float> be::OcclusionRasterizer::getDepth() const {
+    return m_depth;
+}
+
+const be::SoftwareOcclusionStats& be::OcclusionRasterizer::getStats() const {
+    return m_stats;
+}
+
+void be::OcclusionRasterizer::render(const glm::mat4& clip) {
+    auto start = std::chrono::steady_clock::now();
+    std::ranges::fill(m_depth, INFINITY);
+
+    size_t chunkCount = (m_positions.size() + SETUP_CHUNK_SIZE - 1) / SETUP_CHUNK_SIZE;
+    parallelFor(chunkCount, [&](size_t chunk) {
+        for (size_t v = chunk * SETUP_CHUNK_SIZE; v < std::min(m_positions.size(), (chunk + 1) * SETUP_CHUNK_SIZE); v++)
+            m_clipPositions[v] = clip * glm::vec4(m_positions[v], 1);
+    });
+
+    chunkCount = (m_triangles.size() + SETUP_CHUNK_SIZE - 1) / SETUP_CHUNK_SIZE;
+    parallelFor(chunkCount, [&](size_t chunk) {
+        for (size_t t = chunk * SETUP_CHUNK_SIZE; t < std::min(m_triangles.size(), (chunk + 1) * SETUP_CHUNK_SIZE); t++) {
+            m_areas[t] = 0;
+            m_farthest[t] = INFINITY;
+            const glm::vec4& p0 = m_clipPositions[m_indices[3 * t]];
+            const glm::vec4& p1 = m_clipPositions[m_indices[3 * t + 1]];
+            const glm::vec4& p2 = m_clipPositions[m_indices[3 * t + 2]];
+            // clipping would be needed, dropping an occluder is always safe
+            if (p0.w <= MIN_CLIP_W || p1.w <= MIN_CLIP_W || p2.w <= MIN_CLIP_W)
+                continue;
+            glm::vec2 s0 = toPixels(p0), s1 = toPixels(p1), s2 = toPixels(p2);
+            float area = (s1.x - s0.x) * (s2.y - s0.y) - (s1.y - s0.y) * (s2.x - s0.x);
+            if (std::abs(area) < 1e-6f)
+                continue;
+            m_areas[t] = area;
+            m_farthest[t] = std::max(std::max(p0.z / p0.w, p1.z / p1.w), p2.z / p2.w);
+        }
+    });
+
+    std::atomic<size_t> rasterized = 0;
+    parallelFor(chunkCount, [&](size_t chunk) {
+        size_t chunkRasterized = 0;
+        for (size_t t = chunk * SETUP_CHUNK_SIZE; t < std::min(m_triangles.size(), (chunk + 1) * SETUP_CHUNK_SIZE); t++) {
+            ScreenTriangle& triangle = m_triangles[t];
+            // empty unless it covers a pixel
+            triangle.minX = 0;
+            triangle.maxX = -1;
+            triangle.minY = 0;
+            triangle.maxY = -1;
+            if (m_areas[t] == 0)
+                continue;
+            std::array<glm::vec2, 3> corners = {
+                toPixels(m_clipPositions[m_indices[3 * t]]),
+                toPixels(m_clipPositions[m_indices[3 * t + 1]]),
+                toPixels(m_clipPositions[m_indices[3 * t + 2]])
+            };
+            float orientation = m_areas[t] > 0 ? 1.f : -1.f;
+            triangle.depth = m_farthest[t];
+            for (int e = 0; e < 3; e++) {
+                const glm::vec2& from = corners[e];
+                const glm::vec2& to = corners[(e + 1) % 3];
+                float a = (from.y - to.y) * orientation;
+                float b = (to.x - from.x) * orientation;
+                float c = (from.x * to.y - to.x * from.y) * orientation;
+                triangle.a[e] = a;
+                triangle.b[e] = b;
+                uint32_t neighbor = m_neighbors[3 * t + e];
+                if (neighbor != UINT32_MAX && m_areas[neighbor] * m_areas[t] > 0) {
+                    // the neighbour covers the other side, sampled at the pixel centre,
+                    // the pair has opposite edge functions and the top-left rule gives the pixels on the edge to one of them
+                    triangle.c[e] = c + 0.5f * a + 0.5f * b;
+                    bool topLeft = a > 0 || (a == 0 && b > 0);
+                    triangle.threshold[e] = topLeft ? 0 : std::numeric_limits<float>::denorm_min();
+                    // those pixels may show a part of the neighbour
+                    triangle.depth = std::max(triangle.depth, m_farthest[neighbor]);
+                } else {
+                    // sampled at the corner of the pixel farthest inside, so only the pixels covered whole are written
+                    triangle.c[e] = c + std::min(a, 0.f) + std::min(b, 0.f);
+                    triangle.threshold[e] = 0;
+                }
+            }
+            glm::vec2 cornerMin = glm::min(glm::min(corners[0], corners[1]), corners[2]);
+            glm::vec2 cornerMax = glm::max(glm::max(corners[0], corners[1]), corners[2]);
+            triangle.minX = std::max(0, static_cast<int32_t>(std::floor(cornerMin.x)));
+            triangle.maxX = std::min<int32_t>(OCCLUSION_BUFFER_WIDTH - 1, static_cast<int32_t>(std::ceil(cornerMax.x)) - 1);
+            triangle.minY = std::max(0, static_cast<int32_t>(std::floor(cornerMin.y)));
+            triangle.maxY = std::min<int32_t>(OCCLUSION_BUFFER_HEIGHT - 1, static_cast<int32_t>(std::ceil(cornerMax.y)) - 1);
+            chunkRasterized += triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY;
+        }
+        rasterized += chunkRasterized;
+    });
+    m_stats.rasterizedTriangles = rasterized;
+
+    parallelFor(OCCLUSION_BUFFER_HEIGHT / OCCLUSION_BAND_HEIGHT, [this](size_t band) {
+        rasterizeBand(band);
+    });
+    m_stats.rasterMilliseconds = elapsedMilliseconds(start);
+}
+
+void be::OcclusionRasterizer::rasterizeBand(uint32_t band) {
+    int32_t bandMin = band * OCCLUSION_BAND_HEIGHT;
+    int32_t bandMax = bandMin + OCCLUSION_BAND_HEIGHT - 1;
+    for (const ScreenTriangle& triangle : m_triangles) {
+        if (triangle.minX > triangle.maxX || triangle.maxY < bandMin || triangle.minY > bandMax)
+            continue;
+        for (int32_t y = std::max(triangle.minY, bandMin); y <= std::min(triangle.maxY, bandMax); y++) {
+            switch (m_kernel) {
+                case CullKernel::avx2:
+                    rasterizeRowAvx2(triangle, y);
+                    break;
+                case CullKernel::sse:
+                    rasterizeRowSse(triangle, y);
+                    break;
+                default:
+                    rasterizeRowScalar(triangle, y);
+                    break;
+            }
+        }
+    }
+}
+
+void be::OcclusionRasterizer::rasterizeRowScalar(const ScreenTriangle& triangle, int32_t y) {
+    float* row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+    for (int32_t x = triangle.minX; x <= triangle.maxX; x++) {
+        bool covered = true;
+        for (int e = 0; e < 3; e++)
+            covered = covered && triangle.a[e] * x + (triangle.b[e] * y + triangle.c[e]) >= triangle.threshold[e];
+        if (covered)
+            row[x] = std::min(row[x], triangle.depth);
+    }
+}
+
+void be::OcclusionRasterizer::cull(const glm::mat4& clip, std::span<const Submesh> submeshes, std::vector<uint32_t>& visibleSubmeshes) {
+    auto start = std::chrono::steady_clock::now();
+    m_stats.testedBoxes = visibleSubmeshes.size();
+    std::erase_if(visibleSubmeshes, [&](uint32_t s) {
+        return !isBoxVisible(clip, glm::vec3(submeshes[s].aabbMin), glm::vec3(submeshes[s].aabbMax));
+    });
+    m_stats.occludedBoxes = m_stats.testedBoxes - visibleSubmeshes.size();
+    m_stats.testMilliseconds = elapsedMilliseconds(start);
+}
+
+bool be::OcclusionRasterizer::isBoxVisible(const glm::mat4& clip, const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    glm::vec2 pixelMin = glm::vec2(INFINITY), pixelMax = glm::vec2(-INFINITY);
+    float nearest = INFINITY;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = glm::vec3((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+        glm::vec4 position = clip * glm::vec4(corner, 1);
+        // crossing the eye plane, the projection is not bounded
+        if (position.w <= MIN_CLIP_W)
+            return true;
+        glm::vec2 pixel = toPixels(position);
+        pixelMin = glm::min(pixelMin, pixel);
+        pixelMax = glm::max(pixelMax, pixel);
+        nearest = std::min(nearest, position.z / position.w);
+    }
+    // every pixel the rectangle touches, rounded outwards
+    int32_t minX = std::max(0, static_cast<int32_t>(std::floor(pixelMin.x)));
+    int32_t maxX = std::min<int32_t>(OCCLUSION_BUFFER_WIDTH - 1, static_cast<int32_t>(std::floor(pixelMax.x)));
+    int32_t minY = std::max(0, static_cast<int32_t>(std::floor(pixelMin.y)));
+    int32_t maxY = std::min<int32_t>(OCCLUSION_BUFFER_HEIGHT - 1, static_cast<int32_t>(std::floor(pixelMax.y)));
+    // outside of the screen, left to the frustum test
+    if (minX > maxX || minY > maxY)
+        return true;
+    for (int32_t y = minY; y <= maxY; y++) {
+        bool visible;
+        switch (m_kernel) {
+            case CullKernel::avx2:
+                visible = testRowAvx2(y, minX, maxX, nearest);
+                break;
+            case CullKernel::sse:
+                visible = testRowSse(y, minX, maxX, nearest);
+                break;
+            default:
+                visible = testRowScalar(y, minX, maxX, nearest);
+                break;
+        }
+        if (visible)
+            return true;
+    }
+    return false;
+}
+
+bool be::OcclusionRasterizer::testRowScalar(int32_t y, int32_t minX, int32_t maxX, float depth) const {
+    const float* row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+    for (int32_t x = minX; x <= maxX; x++)
+        if (row[x] >= depth)
+            return true;
+    return false;
+}
+
+#ifdef BE_X86_KERNELS
+void be::OcclusionRasterizer::rasterizeRowSse(const ScreenTriangle& triangle, int32_t y) {
+    float* row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+    int32_t firstX = triangle.minX & ~3;
+    __m128 a0 = _mm_set1_ps(triangle.a[0]), a1 = _mm_set1_ps(triangle.a[1]), a2 = _mm_set1_ps(triangle.a[2]);
+    __m128 xs = _mm_add_ps(_mm_set1_ps(static_cast<float>(firstX)), _mm_setr_ps(0, 1, 2, 3));
+    // evaluated per block rather than stepped, so the two triangles of a shared edge get opposite values on the same pixel
+    __m128 row0 = _mm_set1_ps(triangle.b[0] * y + triangle.c[0]);
+    __m128 row1 = _mm_set1_ps(triangle.b[1] * y + triangle.c[1]);
+    __m128 row2 = _mm_set1_ps(triangle.b[2] * y + triangle.c[2]);
+    __m128 t0 = _mm_set1_ps(triangle.threshold[0]), t1 = _mm_set1_ps(triangle.threshold[1]), t2 = _mm_set1_ps(triangle.threshold[2]);
+    __m128 depth = _mm_set1_ps(triangle.depth);
+    for (int32_t x = firstX; x <= triangle.maxX; x += 4) {
+        __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, xs), row0);
+        __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, xs), row1);
+        __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, xs), row2);
+        __m128 covered = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, t0), _mm_cmpge_ps(e1, t1)), _mm_cmpge_ps(e2, t2));
+        if (_mm_movemask_ps(covered) != 0) {
+            __m128 current = _mm_loadu_ps(&row[x]);
+            __m128 closer = _mm_min_ps(current, depth);
+            _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(covered, closer), _mm_andnot_ps(covered, current)));
+        }
+        xs = _mm_add_ps(xs, _mm_set1_ps(4));
+    }
+}
+
+BE_TARGET_AVX2 void be::OcclusionRasterizer::rasterizeRowAvx2(const ScreenTriangle& triangle, int32_t y) {
+    float* row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+    int32_t firstX = triangle.minX & ~7;
+    __m256 a0 = _mm256_set1_ps(triangle.a[0]), a1 = _mm256_set1_ps(triangle.a[1]), a2 = _mm256_set1_ps(triangle.a[2]);
+    __m256 xs = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(firstX)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256 row0 = _mm256_set1_ps(triangle.b[0] * y + triangle.c[0]);
+    __m256 row1 = _mm256_set1_ps(triangle.b[1] * y + triangle.c[1]);
+    __m256 row2 = _mm256_set1_ps(triangle.b[2] * y + triangle.c[2]);
+    __m256 t0 = _mm256_set1_ps(triangle.threshold[0]), t1 = _mm256_set1_ps(triangle.threshold[1]), t2 = _mm256_set1_ps(triangle.threshold[2]);
+    __m256 depth = _mm256_set1_ps(triangle.depth);
+    for (int32_t x = firstX; x <= triangle.maxX; x += 8) {
+        __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, xs), row0);
+        __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, xs), row1);
+        __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, xs), row2);
+        __m256 covered = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(e0, t0, _CMP_GE_OQ), _mm256_cmp_ps(e1, t1, _CMP_GE_OQ)),
+            _mm256_cmp_ps(e2, t2, _CMP_GE_OQ)
+        );
+        if (_mm256_movemask_ps(covered) != 0) {
+            __m256 current = _mm256_loadu_ps(&row[x]);
+            _mm256_storeu_ps(&row[x], _mm256_blendv_ps(current, _mm256_min_ps(current, depth), covered));
+        }
+        xs = _mm256_add_ps(xs, _mm256_set1_ps(8));
+    }
+}
+
+bool be::OcclusionRasterizer::testRowSse(int32_t y, int32_t minX, int32_t maxX, float depth) const {
+    const float* row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+    __m128 boxDepth = _mm_set1_ps(depth);
+    for (int32_t x = minX & ~3; x <= maxX; x += 4) {
+        unsigned behind = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(&row[x]), boxDepth));
+        if ((behind & laneMask(x, minX, maxX, 4)) != 0)
+            return true;
+    }
+    return false;
+}
+
+BE_TARGET_AVX2 bool be::OcclusionRasterizer::testRowAvx2(int32_t y, int32_t minX, int32_t maxX, float depth) const {
+    const float* row = &m_depth[y * OCCLUSION_BUFFER_WIDTH];
+    __m256 boxDepth = _mm256_set1_ps(depth);
+    for (int32_t x = minX & ~7; x <= maxX; x += 8) {
+        unsigned behind = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(&row[x]), boxDepth, _CMP_GE_OQ));
+        if ((behind & laneMask(x, minX, maxX, 8)) != 0)
+            return true;
+    }
+    return false;
+}
+#else
+void be::OcclusionRasterizer::rasterizeRowSse(const ScreenTriangle& triangle, int32_t y) {
+    rasterizeRowScalar(triangle, y);
+}
+
+void be::OcclusionRasterizer::rasterizeRowAvx2(const ScreenTriangle& triangle, int32_t y) {
+    rasterizeRowScalar(triangle, y);
+}
+
+bool be::OcclusionRasterizer::testRowSse(int32_t y, int32_t minX, int32_t maxX, float depth) const {
+    return testRowScalar(y, minX, maxX, depth);
+}
+
+bool be::OcclusionRasterizer::testRowAvx2(int32_t y, int32_t minX, int32_t maxX, float depth) const {
+    return testRowScalar(y, minX, maxX, depth);
+}
+#endif
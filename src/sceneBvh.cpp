@@ -0,0 +1,89 @@
+#include "sceneBvh.hpp"
+#include "parallel.hpp"
+#include <numeric>
+
+void be::SceneBvh::build(
+    std::span<const Submesh> submeshes,
+    std::span<const Vertex> vertices,
+    std::span<const uint32_t> indices,
+    std::span<const IndexRange> ranges,
+    bool withTriangles
+) {
+    m_submeshBounds.clear();
+    for (const Submesh& submesh : submeshes)
+        m_submeshBounds.push_back({glm::vec3(submesh.aabbMin), glm::vec3(submesh.aabbMax)});
+    m_submeshBvh.build(m_submeshBounds);
+
+    m_triangleMeshes.clear();
+    if (!withTriangles)
+        return;
+    m_triangleMeshes.resize(submeshes.size());
+    // one submesh per task, the biggest first so a large one does not end up last
+    std::vector<uint32_t> order = std::vector<uint32_t>(submeshes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, [&submeshes](uint32_t a, uint32_t b) {
+        return submeshes[a].indexCount > submeshes[b].indexCount;
+    });
+    parallelFor(order.size(), [&](size_t task) {
+        uint32_t s = order[task];
+        TriangleMesh& mesh = m_triangleMeshes[s];
+        std::vector<Aabb> triangleBounds;
+        for (uint32_t r = submeshes[s].firstRange; r < submeshes[s].firstRange + submeshes[s].rangeCount; r++) {
+            const IndexRange& range = ranges[r];
+            for (uint32_t i = range.firstIndex; i + 2 < range.firstIndex + range.indexCount; i += 3) {
+                Aabb box;
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    const glm::vec3& position = vertices[range.vertexOffset + indices[i + corner]].pos;
+                    mesh.corners.push_back(position);
+                    box.grow(position);
+                }
+                triangleBounds.push_back(box);
+                mesh.triangles.push_back(i / 3);
+            }
+        }
+        // already spread over the cores by submesh
+        mesh.bvh.build(triangleBounds, false);
+    });
+}
+
+void be::SceneBvh::cull(const Frustum& frustum, std::vector<uint32_t>& visibleSubmeshes) const {
+    m_submeshBvh.cull(frustum, visibleSubmeshes);
+}
+
+void be::SceneBvh::overlap(const Aabb& box, std::vector<uint32_t>& submeshes) const {
+    m_submeshBvh.overlap(box, submeshes);
+}
+
+std::optional<be::RayHit> be::SceneBvh::pick(const Ray& ray) const {
+    RayHit hit = {INFINITY, 0, UINT32_MAX};
+    m_submeshBvh.intersect(ray, INFINITY, [&](uint32_t submesh, float maxDistance) {
+        if (m_triangleMeshes.empty()) {
+            float distance = intersectBox(ray, m_submeshBounds[submesh], maxDistance);
+            if (distance < hit.distance)
+                hit = {distance, submesh, UINT32_MAX};
+            return distance;
+        }
+        const TriangleMesh& mesh = m_triangleMeshes[submesh];
+        return mesh.bvh.intersect(ray, maxDistance, [&](uint32_t triangle, float maxTriangleDistance) {
+            const glm::vec3* corners = &mesh.corners[3 * triangle];
+            float distance = intersectTriangle(ray, corners[0], corners[1], corners[2]);
+            if (distance < maxTriangleDistance && distance < hit.distance)
+                hit = {distance, submesh, mesh.triangles[triangle]};
+            return distance;
+        });
+    });
+    if (hit.distance == INFINITY)
+        return std::nullopt;
+    return hit;
+}
+
+bool be::SceneBvh::hasTriangles() const {
+    return !m_triangleMeshes.empty();
+}
+
+size_t be::SceneBvh::getNodeCount() const {
+    size_t nodeCount = m_submeshBvh.getNodeCount();
+    for (const TriangleMesh& mesh : m_triangleMeshes)
+        nodeCount += mesh.bvh.getNodeCount();
+    return nodeCount;
+}
@@ -8,6 +8,10 @@ ShaderCompiler::ShaderCompiler() {
 }
 
 
+void ShaderCompiler::addMacro(const std::string& name, const std::string& value) {
+  macros.emplace_back(name, value);
+}
+
 void ShaderCompiler::setOptions() {
 
 }
@@ -25,6 +29,12 @@ void ShaderCompiler::createSession(const SlangCompileTarget format, const std::s
   sessionDesc.targets = &targetDesc;
   sessionDesc.targetCount = 1;
 
+  std::vector<slang::PreprocessorMacroDesc> macroDescs;
+  for (const auto& [name, value] : macros)
+    macroDescs.push_back({name.c_str(), value.c_str()});
+  sessionDesc.preprocessorMacros = macroDescs.data();
+  sessionDesc.preprocessorMacroCount = static_cast<SlangInt>(macroDescs.size());
+
   globalSession->createSession(sessionDesc, session.writeRef());
 
   std::array<slang::CompilerOptionEntry, 2> options = {{
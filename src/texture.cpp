@@ -1,12 +1,30 @@
 #include "texture.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <format>
+#include <utility>
 #include <vector>
+#include "ktxFile.hpp"
 #include "utils.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-be::Texture::Texture(const std::filesystem::path& name, vk::Queue queue) :
-    m_queue(queue)
+namespace {
+    // what shapes the cached texels besides the source: flipped vertically, levels filtered in sRGB space
+    constexpr uint64_t DECODED_TEXTURE_SETTINGS = 0x3;
+}
+
+uint32_t be::getMipLevelCount(vk::Extent3D extent) {
+    return std::bit_width(std::max(extent.width, extent.height));
+}
+
+be::Texture::Texture(const std::filesystem::path& name, vk::Queue queue, TextureRole role, bool streamed) :
+    m_role(role),
+    m_streamed(streamed),
+    m_queue(queue),
+    m_baseLevel(0),
+    m_chainLength(1)
 {
     loadImage(name);
 }
@@ -19,22 +37,137 @@ void be::Texture::setPhysicalDevice(vk::PhysicalDevice physicalDevice) {
     be::Texture::m_physicalDevice = physicalDevice;
 }
 
+void be::Texture::setAllocator(be::MemoryAllocator& allocator) {
+    be::Texture::m_allocator = &allocator;
+}
+
+void be::Texture::setBlockCompression(bool enabled) {
+    be::Texture::m_blockCompression = enabled;
+}
+
+void be::Texture::setCache(be::TextureCache* cache) {
+    be::Texture::m_cache = cache;
+}
+
+void be::Texture::setResidentSize(uint32_t residentSize) {
+    be::Texture::m_residentSize = residentSize;
+}
+
 void be::Texture::loadImage(const std::filesystem::path& name) {
+    m_levelOffsets.clear();
+    // a streamed texture uploads its levels one by one, they cannot be blitted from the first
+    TextureLevels levels = readLevels(name, m_role, m_streamed || !supportsLinearBlit(m_physicalDevice, vk::Format::eR8G8B8A8Srgb));
+    m_width = levels.width;
+    m_height = levels.height;
+    m_format = levels.format;
+    m_chainLength = levels.levels.size();
+    m_baseLevel = m_streamed ? getResidentLevel(getExtent(), m_chainLength) : 0;
+    stageLevels(std::span(levels.levels).subspan(m_baseLevel), name);
+    // the first level of a larger image, the others are blitted
+    if (levels.levels.size() == 1 && be::getMipLevelCount(getExtent()) > 1) {
+        m_chainLength = be::getMipLevelCount(getExtent());
+        m_levelOffsets.clear();
+    }
+}
+
+uint32_t be::Texture::getResidentLevel(vk::Extent3D extent, uint32_t chainLength) {
+    uint32_t level = 0;
+    while (level + 1 < chainLength && std::max(extent.width >> level, extent.height >> level) > m_residentSize)
+        level++;
+    return level;
+}
+
+be::TextureLevels be::Texture::readLevels(const std::filesystem::path& name, TextureRole role, bool mipChain) {
+    TextureLevels levels = {};
+    std::filesystem::path compressedPath = name;
+    compressedPath += ".ktx2";
+    if (m_blockCompression && levels.compressed.load(compressedPath, name, role) && supportsSampledCopies(m_physicalDevice, levels.compressed.getFormat())) {
+        levels.width = levels.compressed.getExtent().width;
+        levels.height = levels.compressed.getExtent().height;
+        levels.format = levels.compressed.getFormat();
+        for (uint32_t level = 0; level < levels.compressed.getLevelCount(); level++)
+            levels.levels.push_back(levels.compressed.getLevel(level));
+        return levels;
+    }
+
+    be::MappedFile source = be::MappedFile(name);
+    int width = 0;
+    int height = 0;
+    int sourceChannels = 0;
+    if (!source.isOpen() || !stbi_info_from_memory(reinterpret_cast<const stbi_uc*>(source.getData().data()), source.getSize(), &width, &height, &sourceChannels)) {
+        std::string errorMsg = std::format("Failed to load {} texture", name.c_str());
+        throw std::runtime_error(errorMsg);
+    }
+
+    // a bump map is classified from its texels
+    std::vector<unsigned char> rgba;
+    if (m_blockCompression)
+        rgba = decodeImage(source, name, width, height);
+    if (m_blockCompression && supportsSampledCopies(m_physicalDevice, be::getEncodedFormat(rgba, sourceChannels, role))) {
+        levels.encoded = be::encodeTexture(rgba, width, height, sourceChannels, role);
+        // a failed write only costs the encoding at the next launch
+        be::KtxFile::write(compressedPath, name, role, levels.encoded);
+        levels.width = width;
+        levels.height = height;
+        levels.format = levels.encoded.format;
+        levels.levels = std::vector<std::span<const std::byte>>(levels.encoded.levels.begin(), levels.encoded.levels.end());
+        return levels;
+    }
+
+    // stb_image expands every image to RGBA
+    levels.format = vk::Format::eR8G8B8A8Srgb;
+    be::DecodedTexture decoded;
+    uint64_t cacheKey = m_cache != nullptr ? be::TextureCache::getKey(source.getData(), DECODED_TEXTURE_SETTINGS) : 0;
+    if (m_cache != nullptr && m_cache->find(cacheKey, levels.cached, decoded)) {
+        width = decoded.width;
+        height = decoded.height;
+    } else {
+        levels.decoded = rgba.empty() ? decodeImage(source, name, width, height) : std::move(rgba);
+        std::vector<vk::DeviceSize> levelOffsets;
+        // the cache keeps the whole chain
+        if (m_cache != nullptr || mipChain)
+            levelOffsets = be::appendMipChain(levels.decoded, width, height, true);
+        decoded = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(sourceChannels), levels.decoded, levelOffsets};
+        if (m_cache != nullptr)
+            m_cache->store(cacheKey, decoded);
+    }
+    levels.width = width;
+    levels.height = height;
+    std::span<const std::byte> texels = std::as_bytes(decoded.texels);
+    if (decoded.levelOffsets.empty()) {
+        levels.levels.push_back(texels);
+        return levels;
+    }
+    for (size_t level = 0; level < decoded.levelOffsets.size(); level++) {
+        vk::DeviceSize end = level + 1 < decoded.levelOffsets.size() ? decoded.levelOffsets[level + 1] : texels.size();
+        levels.levels.push_back(texels.subspan(decoded.levelOffsets[level], end - decoded.levelOffsets[level]));
+    }
+    return levels;
+}
+
+std::vector<unsigned char> be::Texture::decodeImage(const be::MappedFile& source, const std::filesystem::path& name, int& width, int& height) {
     stbi_set_flip_vertically_on_load(true);
     int texChannels;
-    stbi_uc* pixels = stbi_load(name.c_str(), &m_width, &m_height, &texChannels, STBI_rgb_alpha);
+    stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(source.getData().data()), source.getSize(), &width, &height, &texChannels, STBI_rgb_alpha);
     if (pixels == nullptr) {
         std::string errorMsg = std::format("Failed to load {} texture", name.c_str());
         throw std::runtime_error(errorMsg);
     }
-
-    auto [format, correctTextureData] = pickFormat(name, pixels, m_height * m_width, texChannels);
-    m_format = format;
-    texChannels = format == vk::Format::eR8G8B8A8Srgb ? 4:texChannels;
-    m_buffer = be::Buffer(m_device, m_height * m_width * 4);
-    m_buffer.create(vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, m_physicalDevice);
-    m_buffer.map<stbi_uc>(std::vector<stbi_uc>(pixels, pixels + m_height * m_width * 4));
+    std::vector<unsigned char> texels = std::vector<unsigned char>(pixels, pixels + height * width * 4);
     stbi_image_free(pixels);
+    return texels;
+}
+
+void be::Texture::stageLevels(std::span<const std::span<const std::byte>> levels, const std::filesystem::path& name) {
+    vk::DeviceSize size = 0;
+    for (std::span<const std::byte> level : levels) {
+        m_levelOffsets.push_back(size);
+        size += level.size();
+    }
+    m_buffer = be::Buffer(m_device, size);
+    m_buffer.create(vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, *m_allocator, be::MemoryUsage::upload, name.filename().string());
+    for (size_t level = 0; level < levels.size(); level++)
+        m_buffer.write(levels[level].data(), levels[level].size(), m_levelOffsets[level]);
 }
 
 void be::Texture::createTextureImage(vk::ImageType type,
@@ -44,70 +177,146 @@ void be::Texture::createTextureImage(vk::ImageType type,
                                 vk::ImageTiling tiling,
                                 vk::ImageUsageFlags usage,
                                 vk::SharingMode sharingMode,
-                                vk::MemoryPropertyFlags properties
+                                be::MemoryUsage memoryUsage
     ) {
-    std::tie(m_memory, m_image) = createImage(
+    m_mipLevels = mipLevel;
+    m_tiling = tiling;
+    m_usage = usage;
+    m_memoryUsage = memoryUsage;
+    std::tie(m_allocation, m_image) = createImage(
         m_device,
-        m_physicalDevice,
+        *m_allocator,
         type,
-        vk::Format::eR8G8B8A8Srgb,
-        {static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height), 1},
+        m_format,
+        getLevelExtent(m_baseLevel),
         mipLevel,
         arrayLayers,
         sampleCount,
         tiling,
         usage,
         sharingMode,
-        properties
+        memoryUsage,
+        "texture"
     );
+    // single channel textures read as grey
+    vk::ComponentMapping components = m_format == vk::Format::eBc4UnormBlock
+        ? vk::ComponentMapping(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eOne)
+        : vk::ComponentMapping();
     m_imageView = createImageView(
         m_device,
         m_image,
         vk::ImageViewType::e2D,
-        vk::Format::eR8G8B8A8Srgb,
-        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+        m_format,
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevel, 0, 1),
+        components
     );
 }
 
 void be::Texture::copyBufferToImage(vk::CommandPool commandPool) {
     vk::CommandBuffer commandBuffer = beginSingleTimeCommands(m_device, commandPool);
-    vk::BufferImageCopy region = vk::BufferImageCopy(
-        0,
-        0,
-        0,
-        vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
-        vk::Offset3D(0, 0, 0),
-        vk::Extent3D(m_width, m_height, 1)
-    );
-    commandBuffer.copyBufferToImage(m_buffer.getBuffer(), m_image, vk::ImageLayout::eTransferDstOptimal,region);
+    commandBuffer.copyBufferToImage(m_buffer.getBuffer(), m_image, vk::ImageLayout::eTransferDstOptimal, getCopyRegions());
     endSingleTimeCommands(m_device, commandPool, commandBuffer, m_queue);
 }
 
-void be::Texture::transitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::CommandPool commandPool) {
-    vk::ImageMemoryBarrier barrier;
-    barrier.setOldLayout(oldLayout);
-    barrier.setNewLayout(newLayout);
+void be::Texture::releaseStagingBuffer() {
+    if (!m_buffer.getBuffer())
+        return;
+    m_buffer.clean();
+    m_buffer = be::Buffer();
+}
 
-    vk::PipelineStageFlags srcStage, dstStage;
-    if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal) {
-        barrier.setSrcAccessMask({});
-        barrier.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+std::vector<vk::BufferImageCopy> be::Texture::getCopyRegions() const {
+    // only the first level is in the staging buffer when the others are blitted
+    uint32_t levels = m_levelOffsets.empty() ? 1 : std::min<uint32_t>(m_mipLevels, m_levelOffsets.size());
+    std::vector<vk::BufferImageCopy> regions;
+    for (uint32_t level = 0; level < levels; level++)
+        regions.push_back(vk::BufferImageCopy(
+            m_levelOffsets.empty() ? 0 : m_levelOffsets[level],
+            0,
+            0,
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+            vk::Offset3D(0, 0, 0),
+            getLevelExtent(m_baseLevel + level)
+        ));
+    return regions;
+}
 
-        srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
-        dstStage = vk::PipelineStageFlagBits::eTransfer;
-    } else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
-        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
-        barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+bool be::Texture::hasUploadedMips() const {
+    return !m_levelOffsets.empty();
+}
 
-        srcStage = vk::PipelineStageFlagBits::eTransfer;
-        dstStage = vk::PipelineStageFlagBits::eFragmentShader;
-    } else {
-        throw std::invalid_argument("Unsuported image Layout for transition");
-    }
+std::tuple<vk::Image, vk::ImageView, be::Allocation> be::Texture::relocate(vk::CommandBuffer commandBuffer) {
+    return rebase(commandBuffer, m_baseLevel);
+}
+
+std::tuple<vk::Image, vk::ImageView, be::Allocation> be::Texture::rebase(vk::CommandBuffer commandBuffer, uint32_t baseLevel) {
+    std::tuple<vk::Image, vk::ImageView, be::Allocation> old = {m_image, m_imageView, m_allocation};
+    vk::Image oldImage = m_image;
+    uint32_t oldBaseLevel = m_baseLevel;
+    uint32_t chainLength = m_baseLevel + m_mipLevels;
+    m_baseLevel = baseLevel;
+    createTextureImage(vk::ImageType::e2D, chainLength - baseLevel, 1, vk::SampleCountFlagBits::e1, m_tiling, m_usage, vk::SharingMode::eExclusive, m_memoryUsage);
+
+    // levels of the chain held by both images
+    uint32_t firstShared = std::max(oldBaseLevel, baseLevel);
+    uint32_t sharedLevels = chainLength - firstShared;
+    vk::ImageSubresourceRange oldRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, firstShared - oldBaseLevel, sharedLevels, 0, 1);
+    vk::ImageSubresourceRange newRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, firstShared - baseLevel, sharedLevels, 0, 1);
+    std::array<vk::ImageMemoryBarrier2, 2> toCopy = {
+        vk::ImageMemoryBarrier2(
+            vk::PipelineStageFlagBits2::eAllCommands, {},
+            vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferRead,
+            vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+            vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, oldImage, oldRange
+        ),
+        vk::ImageMemoryBarrier2(
+            vk::PipelineStageFlagBits2::eNone, {},
+            vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+            vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+            vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, m_image, newRange
+        )
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, toCopy));
+
+    std::vector<vk::ImageCopy> regions;
+    for (uint32_t level = firstShared; level < chainLength; level++)
+        regions.push_back(vk::ImageCopy(
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - oldBaseLevel, 0, 1),
+            vk::Offset3D(0, 0, 0),
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - baseLevel, 0, 1),
+            vk::Offset3D(0, 0, 0),
+            getLevelExtent(level)
+        ));
+    commandBuffer.copyImage(oldImage, vk::ImageLayout::eTransferSrcOptimal, m_image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+    // the frames still in flight keep sampling the old image until they are patched
+    std::array<vk::ImageMemoryBarrier2, 2> toSample = {
+        vk::ImageMemoryBarrier2(
+            vk::PipelineStageFlagBits2::eCopy, {},
+            vk::PipelineStageFlagBits2::eAllCommands, {},
+            vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, oldImage, oldRange
+        ),
+        vk::ImageMemoryBarrier2(
+            vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+            vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eShaderSampledRead,
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, m_image, newRange
+        )
+    };
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, toSample));
+    return old;
+}
+
+void be::Texture::transitionImageLayout(vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::CommandPool commandPool, uint32_t baseMipLevel, uint32_t levelCount) {
+    vk::ImageMemoryBarrier2 barrier = createImageBarrier(
+        m_image,
+        oldLayout,
+        newLayout,
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, baseMipLevel, levelCount, 0, 1)
+    );
     vk::CommandBuffer commandBuffer = beginSingleTimeCommands(m_device, commandPool);
-    barrier.setImage(m_image),
-    barrier.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
-    commandBuffer.pipelineBarrier(srcStage, dstStage, {}, {}, {}, barrier);
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, barrier));
     endSingleTimeCommands(m_device, commandPool, commandBuffer, m_queue);
 }
 
@@ -125,67 +334,13 @@ void be::Texture::createTextureSampler() {
         vk::True,
         properties.limits.maxSamplerAnisotropy,
         vk::False,
-        vk::CompareOp::eAlways
+        vk::CompareOp::eAlways,
+        0.0f,
+        vk::LodClampNone
     );
     sampler = m_device.createSampler(samplerInfo);
 }
 
-std::pair<vk::Format, std::vector<unsigned char>> be::Texture::pickFormat(const std::filesystem::path& path, unsigned char* pixels, size_t nbPixels, int nbChannels) const {
-    vk::Format resFormat = vk::Format::eR8G8B8A8Srgb;
-    if (path.extension().string().compare(".jpeg") == 0) {
-        switch (nbChannels) {
-            case 1: 
-                resFormat = vk::Format::eR8Unorm;
-            break;
-            case 3:
-                resFormat = vk::Format::eR8G8B8A8Srgb;
-            break;        
-            default:
-                // resFormat = vk::Format::eR8G8B8A8Srgb;
-            break;
-        }
-    } else if (path.extension().string().compare(".png") == 0) {
-        switch (nbChannels) {
-            case 1: 
-                resFormat = vk::Format::eR8Unorm;
-            break;
-            case 3:
-                resFormat = vk::Format::eR8G8B8A8Srgb;
-            break;
-            case 4:
-                resFormat = vk::Format::eR8G8B8A8Srgb;
-            break;     
-            default:
-                // resFormat = vk::Format::eR8G8B8A8Srgb;     
-            break;
-        }
-    } else if (path.extension().string().compare(".bmp") == 0) {
-        switch (nbChannels) {
-            case 3:
-                resFormat = vk::Format::eR8G8B8A8Srgb;
-            break;        
-            default:
-                // resFormat = vk::Format::eR8G8B8Srgb;
-            break;
-        }
-    }
-
-    std::vector<unsigned char> finalTextures;
-    if (nbChannels == 3) {
-        finalTextures.push_back(pixels[0]);
-        for(size_t i = 1; i < nbPixels * nbChannels; i++) {
-            if (i%3 == 0) {
-                finalTextures.push_back(255);
-            }
-            finalTextures.push_back(pixels[i]);
-        }
-    } else {
-        finalTextures = std::vector<unsigned char>(pixels, pixels + nbPixels * nbChannels);
-    }
-
-    return {resFormat, finalTextures};
-}
-
 vk::ImageView be::Texture::getImageView() const {
     return m_imageView;
 }
@@ -194,6 +349,30 @@ vk::Image be::Texture::getImage() const {
     return m_image;
 }
 
+vk::Extent3D be::Texture::getExtent() const {
+    return vk::Extent3D(m_width, m_height, 1);
+}
+
+vk::Extent3D be::Texture::getLevelExtent(uint32_t level) const {
+    return vk::Extent3D(std::max(m_width >> level, 1), std::max(m_height >> level, 1), 1);
+}
+
+uint32_t be::Texture::getMipLevels() const {
+    return m_mipLevels;
+}
+
+uint32_t be::Texture::getBaseLevel() const {
+    return m_baseLevel;
+}
+
+uint32_t be::Texture::getMipChainLength() const {
+    return m_chainLength;
+}
+
+vk::Format be::Texture::getFormat() const {
+    return m_format;
+}
+
 vk::Sampler be::Texture::getSampler() {
     return sampler;
 }
@@ -202,10 +381,14 @@ vk::Buffer be::Texture::getBuffer() const {
     return m_buffer.getBuffer();
 }
 
+const be::Allocation& be::Texture::getAllocation() const {
+    return m_allocation;
+}
+
 void be::Texture::clean() {
-    m_buffer.clean();
-    m_device.freeMemory(m_memory);
+    releaseStagingBuffer();
     m_device.destroyImage(m_image);
+    m_allocator->free(m_allocation);
     m_device.destroyImageView(m_imageView);
 }
 
@@ -0,0 +1,205 @@
+#include "textureCache.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <print>
+#include <string_view>
+#include <system_error>
+
+namespace {
+    constexpr uint32_t MAGIC = 0x58544542; // "BETX"
+    constexpr uint64_t ALIGNMENT = 16;
+    constexpr std::string_view EXTENSION = ".betex";
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t width;
+        uint32_t height;
+        uint32_t sourceChannels;
+        uint32_t levelCount;
+    };
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    // the offset of the texels in an entry, after the header and the level offsets
+    uint64_t getTexelsOffset(uint32_t levelCount) {
+        return alignUp(sizeof(Header) + sizeof(uint64_t) * levelCount);
+    }
+
+    uint64_t mix(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+}
+
+be::TextureCache::TextureCache() :
+    m_maxSize(DEFAULT_TEXTURE_CACHE_SIZE),
+    m_stats({})
+{}
+
+void be::TextureCache::init(const std::filesystem::path& directory, uint64_t maxSize) {
+    m_directory = directory;
+    m_maxSize = maxSize;
+    m_entries.clear();
+    m_stats = {};
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(m_directory, error)) {
+        std::string name = file.path().filename().string();
+        uint64_t key;
+        if (name.size() != 16 + EXTENSION.size() || !name.ends_with(EXTENSION) || std::from_chars(name.data(), name.data() + 16, key, 16).ec != std::errc())
+            continue;
+        std::error_code fileError;
+        Entry entry = {file.file_size(fileError), file.last_write_time(fileError)};
+        if (fileError)
+            continue;
+        m_entries[key] = entry;
+        m_stats.bytes += entry.size;
+    }
+    m_stats.entries = m_entries.size();
+    evict(0);
+}
+
+uint64_t be::TextureCache::getKey(std::span<const std::byte> source, uint64_t settings) {
+    // FNV-1a over 8 byte words, the tail byte by byte
+    uint64_t hash = 0xcbf29ce484222325ull ^ mix(settings + VERSION);
+    size_t words = source.size() / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        memcpy(&word, source.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+    for (size_t i = words * sizeof(uint64_t); i < source.size(); i++)
+        hash = (hash ^ static_cast<uint64_t>(source[i])) * 0x100000001b3ull;
+    return mix(hash ^ source.size());
+}
+
+bool be::TextureCache::find(uint64_t key, be::MappedFile& file, DecodedTexture& texture) {
+    if (!m_entries.contains(key) || !file.open(getPath(key))) {
+        m_stats.misses++;
+        return false;
+    }
+
+    std::span<const std::byte> data = file.getData();
+    Header header;
+    bool valid = data.size() >= sizeof(Header);
+    if (valid) {
+        memcpy(&header, data.data(), sizeof(Header));
+        valid = header.magic == MAGIC
+            && header.version == VERSION
+            && header.key == key
+            && header.width > 0
+            && header.height > 0
+            && header.levelCount == static_cast<uint32_t>(std::bit_width(std::max(header.width, header.height)))
+            && data.size() >= getTexelsOffset(header.levelCount);
+    }
+    if (valid) {
+        texture = {header.width, header.height, header.sourceChannels, {}, std::vector<vk::DeviceSize>(header.levelCount)};
+        memcpy(texture.levelOffsets.data(), data.data() + sizeof(Header), sizeof(uint64_t) * header.levelCount);
+        // the levels follow each other, the last one ends the entry
+        uint64_t size = 0;
+        for (uint32_t level = 0; level < header.levelCount && valid; level++) {
+            valid = texture.levelOffsets[level] == size;
+            size += static_cast<uint64_t>(std::max(header.width >> level, 1u)) * std::max(header.height >> level, 1u) * 4;
+        }
+        valid = valid && data.size() == getTexelsOffset(header.levelCount) + size;
+        if (valid)
+            texture.texels = std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(data.data() + getTexelsOffset(header.levelCount)), size);
+    }
+    if (!valid) {
+        file.clean();
+        remove(key);
+        m_stats.misses++;
+        return false;
+    }
+
+    // a hit makes the entry the most recently used
+    std::error_code error;
+    std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(getPath(key), now, error);
+    m_entries[key].lastUse = now;
+    m_stats.hits++;
+    return true;
+}
+
+bool be::TextureCache::store(uint64_t key, const DecodedTexture& texture) {
+    uint32_t levelCount = texture.levelOffsets.size();
+    uint64_t size = getTexelsOffset(levelCount) + texture.texels.size();
+    if (size > m_maxSize)
+        return false;
+    remove(key);
+    evict(size);
+
+    Header header = {MAGIC, VERSION, key, texture.width, texture.height, texture.sourceChannels, levelCount};
+    std::filesystem::path path = getPath(key);
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file = std::ofstream(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::println("Failed to write texture cache entry {}.", path.string());
+            return false;
+        }
+        const char zeros[ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(texture.levelOffsets.data()), sizeof(uint64_t) * levelCount);
+        file.write(zeros, getTexelsOffset(levelCount) - sizeof(Header) - sizeof(uint64_t) * levelCount);
+        file.write(reinterpret_cast<const char*>(texture.texels.data()), texture.texels.size());
+        if (!file) {
+            std::println("Failed to write texture cache entry {}.", path.string());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error) {
+        std::println("Failed to write texture cache entry {} : {}.", path.string(), error.message());
+        return false;
+    }
+    m_entries[key] = {size, std::filesystem::file_time_type::clock::now()};
+    m_stats.bytes += size;
+    m_stats.entries = m_entries.size();
+    return true;
+}
+
+const be::TextureCacheStats& be::TextureCache::getStats() const {
+    return m_stats;
+}
+
+std::filesystem::path be::TextureCache::getPath(uint64_t key) const {
+    return m_directory / std::format("{:016x}{}", key, EXTENSION);
+}
+
+void be::TextureCache::evict(uint64_t size) {
+    while (!m_entries.empty() && m_stats.bytes + size > m_maxSize) {
+        auto oldest = std::ranges::min_element(m_entries, {}, [](const auto& entry) {
+            return entry.second.lastUse;
+        });
+        remove(oldest->first);
+        m_stats.evictions++;
+    }
+}
+
+void be::TextureCache::remove(uint64_t key) {
+    auto entry = m_entries.find(key);
+    if (entry == m_entries.end())
+        return;
+    // a mapped entry stays readable until it is unmapped
+    std::error_code error;
+    std::filesystem::remove(getPath(key), error);
+    m_stats.bytes -= entry->second.size;
+    m_entries.erase(entry);
+    m_stats.entries = m_entries.size();
+}
@@ -0,0 +1,342 @@
+#include "textureEncoder.hpp"
+#include "imageKernels.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace {
+    using Block = std::array<std::array<int, 4>, 16>;
+
+    // texels of a bump map looked at to classify it
+    constexpr size_t NORMAL_MAP_SAMPLES = 4096;
+
+    // interpolation weights of the 4 bit indices, out of 64
+    constexpr std::array<int, 16> BC7_WEIGHTS = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    Block loadBlock(std::span<const unsigned char> rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY) {
+        Block block;
+        for (uint32_t y = 0; y < 4; y++) {
+            for (uint32_t x = 0; x < 4; x++) {
+                size_t texel = (static_cast<size_t>(std::min(blockY * 4 + y, height - 1)) * width + std::min(blockX * 4 + x, width - 1)) * 4;
+                for (size_t channel = 0; channel < 4; channel++)
+                    block[y * 4 + x][channel] = rgba[texel + channel];
+            }
+        }
+        return block;
+    }
+
+    // writes the fields of a zeroed block from its lowest bit
+    class BitWriter {
+        public:
+            BitWriter(std::byte* data) :
+                m_data(data),
+                m_position(0)
+            {}
+
+            void write(uint32_t value, uint32_t bits) {
+                for (uint32_t i = 0; i < bits; i++, m_position++)
+                    if ((value >> i) & 1)
+                        m_data[m_position / 8] |= std::byte(1u << (m_position % 8));
+            }
+        private:
+            std::byte* m_data;
+            uint32_t m_position;
+    };
+
+    struct Mode6 {
+        // 7 bit, the p-bit is the lowest bit of the decoded 8 bit value
+        std::array<std::array<int, 4>, 2> endpoints;
+        std::array<int, 2> pBits;
+        std::array<int, 16> indices;
+        int64_t error;
+    };
+
+    // the closest palette entry of every texel for the quantized endpoints
+    void selectIndices(const Block& block, Mode6& mode) {
+        std::array<std::array<int, 4>, 16> palette;
+        for (size_t i = 0; i < palette.size(); i++) {
+            for (size_t channel = 0; channel < 4; channel++) {
+                int e0 = (mode.endpoints[0][channel] << 1) | mode.pBits[0];
+                int e1 = (mode.endpoints[1][channel] << 1) | mode.pBits[1];
+                palette[i][channel] = ((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6;
+            }
+        }
+        mode.error = 0;
+        for (size_t texel = 0; texel < block.size(); texel++) {
+            int bestError = std::numeric_limits<int>::max();
+            for (size_t i = 0; i < palette.size(); i++) {
+                int error = 0;
+                for (size_t channel = 0; channel < 4; channel++) {
+                    int difference = palette[i][channel] - block[texel][channel];
+                    error += difference * difference;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    mode.indices[texel] = i;
+                }
+            }
+            mode.error += bestError;
+        }
+    }
+
+    // rounds the endpoints to 7 bits under every pair of p-bits and keeps the closest
+    Mode6 quantize(const Block& block, const std::array<std::array<float, 4>, 2>& endpoints) {
+        Mode6 best;
+        best.error = std::numeric_limits<int64_t>::max();
+        for (int p0 = 0; p0 < 2; p0++) {
+            for (int p1 = 0; p1 < 2; p1++) {
+                Mode6 mode;
+                mode.pBits = {p0, p1};
+                for (size_t e = 0; e < 2; e++)
+                    for (size_t channel = 0; channel < 4; channel++)
+                        mode.endpoints[e][channel] = std::clamp(static_cast<int>(std::lround((endpoints[e][channel] - mode.pBits[e]) / 2.0f)), 0, 127);
+                selectIndices(block, mode);
+                if (mode.error < best.error)
+                    best = mode;
+            }
+        }
+        return best;
+    }
+
+    void encodeBC7Block(const Block& block, std::byte* output) {
+        std::array<float, 4> mean = {};
+        for (const std::array<int, 4>& texel : block)
+            for (size_t channel = 0; channel < 4; channel++)
+                mean[channel] += texel[channel] / 16.0f;
+        std::array<std::array<float, 4>, 4> covariance = {};
+        for (const std::array<int, 4>& texel : block)
+            for (size_t i = 0; i < 4; i++)
+                for (size_t j = 0; j < 4; j++)
+                    covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+
+        // the endpoints span the texels along their principal axis, found by power iteration
+        std::array<float, 4> axis = {1.0f, 1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 8; iteration++) {
+            std::array<float, 4> next = {};
+            for (size_t i = 0; i < 4; i++)
+                for (size_t j = 0; j < 4; j++)
+                    next[i] += covariance[i][j] * axis[j];
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length < 1e-6f) {
+                axis = {};
+                break;
+            }
+            for (size_t i = 0; i < 4; i++)
+                axis[i] = next[i] / length;
+        }
+        float low = 0.0f, high = 0.0f;
+        for (const std::array<int, 4>& texel : block) {
+            float t = 0.0f;
+            for (size_t channel = 0; channel < 4; channel++)
+                t += (texel[channel] - mean[channel]) * axis[channel];
+            low = std::min(low, t);
+            high = std::max(high, t);
+        }
+        std::array<std::array<float, 4>, 2> endpoints;
+        for (size_t channel = 0; channel < 4; channel++) {
+            endpoints[0][channel] = std::clamp(mean[channel] + low * axis[channel], 0.0f, 255.0f);
+            endpoints[1][channel] = std::clamp(mean[channel] + high * axis[channel], 0.0f, 255.0f);
+        }
+        Mode6 best = quantize(block, endpoints);
+
+        // least squares fit of the endpoints to the chosen indices, kept while it lowers the error
+        for (int iteration = 0; iteration < 2 && best.error > 0; iteration++) {
+            float a = 0.0f, b = 0.0f, c = 0.0f;
+            std::array<float, 4> x0 = {}, x1 = {};
+            for (size_t texel = 0; texel < block.size(); texel++) {
+                float w = BC7_WEIGHTS[best.indices[texel]] / 64.0f;
+                a += (1.0f - w) * (1.0f - w);
+                b += (1.0f - w) * w;
+                c += w * w;
+                for (size_t channel = 0; channel < 4; channel++) {
+                    x0[channel] += (1.0f - w) * block[texel][channel];
+                    x1[channel] += w * block[texel][channel];
+                }
+            }
+            float determinant = a * c - b * b;
+            if (std::abs(determinant) < 1e-6f)
+                break;
+            for (size_t channel = 0; channel < 4; channel++) {
+                endpoints[0][channel] = std::clamp((c * x0[channel] - b * x1[channel]) / determinant, 0.0f, 255.0f);
+                endpoints[1][channel] = std::clamp((a * x1[channel] - b * x0[channel]) / determinant, 0.0f, 255.0f);
+            }
+            Mode6 refit = quantize(block, endpoints);
+            if (refit.error >= best.error)
+                break;
+            best = refit;
+        }
+
+        // the index of the first texel is stored without its high bit, which has to be zero
+        if (best.indices[0] & 8) {
+            std::swap(best.endpoints[0], best.endpoints[1]);
+            std::swap(best.pBits[0], best.pBits[1]);
+            for (int& index : best.indices)
+                index = 15 - index;
+        }
+        BitWriter bits = BitWriter(output);
+        bits.write(1u << 6, 7);
+        for (size_t channel = 0; channel < 4; channel++)
+            for (size_t e = 0; e < 2; e++)
+                bits.write(best.endpoints[e][channel], 7);
+        bits.write(best.pBits[0], 1);
+        bits.write(best.pBits[1], 1);
+        bits.write(best.indices[0], 3);
+        for (size_t texel = 1; texel < best.indices.size(); texel++)
+            bits.write(best.indices[texel], 4);
+    }
+
+    // eight values between the extremes of the channel, the first endpoint is the larger
+    void encodeBC4Block(const Block& block, size_t channel, std::byte* output) {
+        int low = 255, high = 0;
+        for (const std::array<int, 4>& texel : block) {
+            low = std::min(low, texel[channel]);
+            high = std::max(high, texel[channel]);
+        }
+        std::array<int, 8> palette = {high, low};
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * high + (i - 1) * low + 3) / 7;
+        output[0] = std::byte(high);
+        output[1] = std::byte(low);
+        BitWriter bits = BitWriter(output + 2);
+        for (const std::array<int, 4>& texel : block) {
+            uint32_t bestIndex = 0;
+            // equal endpoints select the six value mode, where index 0 is still the first endpoint
+            if (high != low) {
+                int bestError = std::numeric_limits<int>::max();
+                for (uint32_t i = 0; i < palette.size(); i++) {
+                    int error = std::abs(palette[i] - texel[channel]);
+                    if (error < bestError) {
+                        bestError = error;
+                        bestIndex = i;
+                    }
+                }
+            }
+            bits.write(bestIndex, 3);
+        }
+    }
+
+    template<size_t BLOCK_BYTES, typename F>
+    std::vector<std::byte> encodeBlocks(std::span<const unsigned char> rgba, uint32_t width, uint32_t height, F encodeBlock) {
+        uint32_t blocksX = (width + 3) / 4;
+        uint32_t blocksY = (height + 3) / 4;
+        std::vector<std::byte> output = std::vector<std::byte>(static_cast<size_t>(blocksX) * blocksY * BLOCK_BYTES);
+        // a row of blocks per task
+        be::parallelFor(blocksY, [&](size_t blockY) {
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+                encodeBlock(loadBlock(rgba, width, height, blockX, blockY), output.data() + (blockY * blocksX + blockX) * BLOCK_BYTES);
+        });
+        return output;
+    }
+}
+
+std::vector<vk::DeviceSize> be::appendMipChain(std::vector<unsigned char>& texels, int width, int height, bool srgb, MipFilter filter) {
+    std::vector<vk::DeviceSize> levelOffsets = {0};
+    size_t size = texels.size();
+    for (int levelWidth = width, levelHeight = height; levelWidth > 1 || levelHeight > 1;) {
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+        levelOffsets.push_back(size);
+        size += static_cast<size_t>(levelWidth) * levelHeight * 4;
+    }
+    texels.resize(size);
+
+    be::ImageKernels kernels;
+    std::vector<float> scratch;
+    if (filter == MipFilter::kaiser)
+        scratch.resize(be::ImageKernels::getKaiserScratchSize(width, height));
+    std::span<unsigned char> levels = texels;
+    for (size_t level = 1; level < levelOffsets.size(); level++) {
+        std::span<const unsigned char> source = levels.subspan(levelOffsets[level - 1], levelOffsets[level] - levelOffsets[level - 1]);
+        std::span<unsigned char> destination = levels.subspan(levelOffsets[level], static_cast<size_t>(std::max(width / 2, 1)) * std::max(height / 2, 1) * 4);
+        if (filter == MipFilter::kaiser)
+            kernels.downsampleKaiser(source, width, height, destination, scratch, srgb);
+        else
+            kernels.downsampleBox(source, width, height, destination, srgb);
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return levelOffsets;
+}
+
+bool be::isNormalMap(std::span<const unsigned char> rgba, int channels, TextureRole role) {
+    if (role != TextureRole::bump || channels < 3 || rgba.size() < 4)
+        return false;
+    size_t texelCount = rgba.size() / 4;
+    size_t stride = std::max<size_t>(texelCount / NORMAL_MAP_SAMPLES, 1);
+    size_t samples = 0;
+    size_t grey = 0;
+    size_t unit = 0;
+    for (size_t texel = 0; texel < texelCount; texel += stride) {
+        const unsigned char* color = rgba.data() + texel * 4;
+        samples++;
+        if (color[0] == color[1] && color[1] == color[2])
+            grey++;
+        float x = color[0] / 127.5f - 1.0f;
+        float y = color[1] / 127.5f - 1.0f;
+        float z = color[2] / 127.5f - 1.0f;
+        // 8 bit quantization and compression leave the lengths a bit off
+        float length = std::sqrt(x * x + y * y + z * z);
+        if (std::abs(length - 1.0f) < 0.2f && z > -0.05f)
+            unit++;
+    }
+    // a grey height map can hit unit lengths at a few heights, never on most of its texels while also coloured
+    return grey * 2 < samples && unit * 10 >= samples * 9;
+}
+
+vk::Format be::getEncodedFormat(std::span<const unsigned char> rgba, int channels, TextureRole role) {
+    if (role == TextureRole::color)
+        return vk::Format::eBc7SrgbBlock;
+    // the height is in red, with or without alpha
+    return isNormalMap(rgba, channels, role) ? vk::Format::eBc5UnormBlock : vk::Format::eBc4UnormBlock;
+}
+
+be::EncodedTexture be::encodeTexture(std::span<const unsigned char> rgba, uint32_t width, uint32_t height, int channels, TextureRole role) {
+    bool normalMap = isNormalMap(rgba, channels, role);
+    vk::Format format = getEncodedFormat(rgba, channels, role);
+    std::vector<unsigned char> texels = std::vector<unsigned char>(rgba.begin(), rgba.end());
+    // the encoding is already slow, the sharper filter costs little on top of it
+    std::vector<vk::DeviceSize> levelOffsets = appendMipChain(texels, width, height, format == vk::Format::eBc7SrgbBlock, MipFilter::kaiser);
+    // filtered normals are shorter than one, filtered heights are left as they are
+    if (normalMap && levelOffsets.size() > 1)
+        be::ImageKernels().renormalizeNormals(std::span<unsigned char>(texels).subspan(levelOffsets[1]));
+
+    EncodedTexture encoded = {format, width, height, {}};
+    for (size_t level = 0; level < levelOffsets.size(); level++) {
+        uint32_t levelWidth = std::max(width >> level, 1u);
+        uint32_t levelHeight = std::max(height >> level, 1u);
+        std::span<const unsigned char> levelTexels = std::span<const unsigned char>(texels).subspan(levelOffsets[level], static_cast<size_t>(levelWidth) * levelHeight * 4);
+        switch (format) {
+            case vk::Format::eBc7SrgbBlock:
+                encoded.levels.push_back(encodeBC7(levelTexels, levelWidth, levelHeight));
+                break;
+            case vk::Format::eBc5UnormBlock:
+                encoded.levels.push_back(encodeBC5(levelTexels, levelWidth, levelHeight));
+                break;
+            default:
+                encoded.levels.push_back(encodeBC4(levelTexels, levelWidth, levelHeight));
+                break;
+        }
+    }
+    return encoded;
+}
+
+std::vector<std::byte> be::encodeBC7(std::span<const unsigned char> rgba, uint32_t width, uint32_t height) {
+    return encodeBlocks<16>(rgba, width, height, [](const Block& block, std::byte* output) {
+        encodeBC7Block(block, output);
+    });
+}
+
+std::vector<std::byte> be::encodeBC5(std::span<const unsigned char> rgba, uint32_t width, uint32_t height) {
+    return encodeBlocks<16>(rgba, width, height, [](const Block& block, std::byte* output) {
+        encodeBC4Block(block, 0, output);
+        encodeBC4Block(block, 1, output + 8);
+    });
+}
+
+std::vector<std::byte> be::encodeBC4(std::span<const unsigned char> rgba, uint32_t width, uint32_t height) {
+    return encodeBlocks<8>(rgba, width, height, [](const Block& block, std::byte* output) {
+        encodeBC4Block(block, 0, output);
+    });
+}
@@ -0,0 +1,262 @@
+#include "textureStreamer.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+be::TextureStreamer::TextureStreamer() :
+    m_device(nullptr),
+    m_allocator(nullptr),
+    m_uploads(nullptr),
+    m_framesInFlight(1),
+    m_frameCount(0),
+    m_budget(DEFAULT_TEXTURE_BUDGET),
+    m_budgetReached(false),
+    m_stats({})
+{}
+
+void be::TextureStreamer::init(
+    vk::Device device,
+    be::MemoryAllocator& allocator,
+    be::UploadManager& uploads,
+    size_t framesInFlight,
+    std::span<const MaterialObject> materials,
+    ImagePatch imagePatch
+) {
+    m_device = device;
+    m_allocator = &allocator;
+    m_uploads = &uploads;
+    m_framesInFlight = framesInFlight;
+    m_imagePatch = std::move(imagePatch);
+    // the shader only samples the diffuse maps, the other textures stay at their initial level
+    for (const MaterialObject& material : materials)
+        m_materialTextures.push_back(material.indexDiffuseMap);
+    m_feedback.assign(std::max<size_t>(materials.size(), 1), FEEDBACK_UNUSED);
+    m_frameBases.resize(framesInFlight);
+    for (size_t i = 0; i < framesInFlight; i++) {
+        be::Buffer feedbackBuffer = be::Buffer(m_device, m_feedback.size() * sizeof(uint32_t));
+        feedbackBuffer.create(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::readback, "texture feedback");
+        feedbackBuffer.map();
+        // read before the first frame of the slot resets it
+        feedbackBuffer.write(m_feedback.data(), feedbackBuffer.getSize(), 0);
+        m_feedbackBuffers.push_back(feedbackBuffer);
+    }
+    m_worker = std::jthread([this](std::stop_token stopToken) {
+        work(stopToken);
+    });
+}
+
+void be::TextureStreamer::addTexture(be::Texture& texture, const std::filesystem::path& path, TextureRole role) {
+    m_textures.push_back({&texture, path, role, texture.getBaseLevel(), texture.getBaseLevel(), 0, false, false});
+    for (std::vector<uint32_t>& bases : m_frameBases)
+        bases.push_back(texture.getBaseLevel());
+}
+
+const std::vector<be::Buffer>& be::TextureStreamer::getFeedbackBuffers() const {
+    return m_feedbackBuffers;
+}
+
+void be::TextureStreamer::readFeedback(size_t frame) {
+    m_feedbackBuffers[frame].read(m_feedback.data());
+    for (size_t material = 0; material < m_materialTextures.size(); material++) {
+        int index = m_materialTextures[material];
+        if (index < 0 || static_cast<size_t>(index) >= m_textures.size() || m_feedback[material] == FEEDBACK_UNUSED)
+            continue;
+        Resident& resident = m_textures[index];
+        // the written level is relative to the image the set of the frame pointed to
+        int64_t chainLength = resident.texture->getBaseLevel() + resident.texture->getMipLevels();
+        int64_t level = static_cast<int64_t>(m_feedback[material]) - FEEDBACK_LEVEL_BIAS + m_frameBases[frame][index];
+        uint32_t wantedLevel = static_cast<uint32_t>(std::clamp<int64_t>(level, 0, chainLength - 1));
+        // several materials can share a texture, the finest level wins
+        if (resident.lastSampled != m_frameCount)
+            resident.wantedLevel = wantedLevel;
+        else
+            resident.wantedLevel = std::min(resident.wantedLevel, wantedLevel);
+        resident.lastSampled = m_frameCount;
+    }
+
+    m_budgetReached = false;
+    std::lock_guard lock = std::lock_guard(m_mutex);
+    for (size_t i = 0; i < m_textures.size(); i++) {
+        Resident& resident = m_textures[i];
+        uint32_t baseLevel = resident.texture->getBaseLevel();
+        if (resident.busy || resident.failed || resident.lastSampled != m_frameCount || resident.wantedLevel >= baseLevel)
+            continue;
+        // the evictions make room first
+        if (m_stats.residentBytes >= m_budget) {
+            m_budgetReached = true;
+            continue;
+        }
+        resident.busy = true;
+        m_requests.push_back({i, resident.path, resident.role, resident.wantedLevel, baseLevel - resident.wantedLevel, resident.texture->getFormat(), {}});
+    }
+    m_condition.notify_one();
+}
+
+void be::TextureStreamer::work(std::stop_token stopToken) {
+    while (true) {
+        std::unique_lock lock = std::unique_lock(m_mutex);
+        if (!m_condition.wait(lock, stopToken, [this] { return !m_requests.empty(); }))
+            return;
+        Load load = std::move(m_requests.front());
+        m_requests.pop_front();
+        lock.unlock();
+
+        try {
+            // the whole chain is read, the cache or the KTX copy usually have it ready
+            be::TextureLevels levels = be::Texture::readLevels(load.path, load.role, true);
+            if (levels.format == load.format && levels.levels.size() >= load.firstLevel + load.levelCount)
+                for (uint32_t level = load.firstLevel; level < load.firstLevel + load.levelCount; level++)
+                    load.levels.emplace_back(levels.levels[level].begin(), levels.levels[level].end());
+        } catch (const std::runtime_error&) {
+            load.levels.clear();
+        }
+
+        lock.lock();
+        m_loaded.push_back(std::move(load));
+    }
+}
+
+void be::TextureStreamer::update(vk::CommandBuffer commandBuffer, size_t frame) {
+    m_frameCount++;
+    // the frame that patched the last set was the last to use the old image, and its slot comes back framesInFlight frames later
+    std::erase_if(m_swaps, [&](const Swap& swap) {
+        if (swap.frame == 0 || std::ranges::find(swap.patched, false) != swap.patched.end() || m_frameCount < swap.frame + m_framesInFlight)
+            return false;
+        release(swap);
+        m_textures[swap.texture].busy = false;
+        return true;
+    });
+    std::deque<Load> loaded;
+    {
+        std::lock_guard lock = std::lock_guard(m_mutex);
+        loaded.swap(m_loaded);
+    }
+    for (Load& load : loaded) {
+        if (load.levels.empty()) {
+            m_textures[load.texture].busy = false;
+            m_textures[load.texture].failed = true;
+            m_stats.failedLoads += load.levelCount;
+            continue;
+        }
+        startSwap(commandBuffer, load);
+    }
+    evict(commandBuffer);
+    for (Swap& swap : m_swaps) {
+        // the new levels are sampled once the transfer queue is done with them, the frame taking them does not wait
+        if (swap.frame == 0 && (swap.uploadCount == 0 || m_uploads->isComplete(swap.firstUpload + swap.uploadCount - 1))) {
+            for (uint32_t i = 0; i < swap.uploadCount; i++)
+                m_uploads->acquire(swap.firstUpload + i);
+            swap.frame = m_frameCount;
+        }
+        if (swap.frame == 0 || swap.patched[frame])
+            continue;
+        m_imagePatch(frame, swap.oldView, swap.newView);
+        swap.patched[frame] = true;
+        m_frameBases[frame][swap.texture] = swap.baseLevel;
+    }
+    m_stats.residentBytes = 0;
+    for (const Resident& resident : m_textures)
+        m_stats.residentBytes += resident.texture->getAllocation().size;
+
+    commandBuffer.fillBuffer(m_feedbackBuffers[frame].getBuffer(), 0, vk::WholeSize, FEEDBACK_UNUSED);
+    vk::MemoryBarrier2 resetBarrier = vk::MemoryBarrier2(
+        vk::PipelineStageFlagBits2::eTransfer,
+        vk::AccessFlagBits2::eTransferWrite,
+        vk::PipelineStageFlagBits2::eFragmentShader,
+        vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+    );
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &resetBarrier));
+}
+
+void be::TextureStreamer::recordReadback(vk::CommandBuffer commandBuffer) {
+    // the fence alone does not make the writes of the fragment shader visible to the host
+    vk::MemoryBarrier2 readbackBarrier = vk::MemoryBarrier2(
+        vk::PipelineStageFlagBits2::eFragmentShader,
+        vk::AccessFlagBits2::eShaderStorageWrite,
+        vk::PipelineStageFlagBits2::eHost,
+        vk::AccessFlagBits2::eHostRead
+    );
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &readbackBarrier));
+}
+
+void be::TextureStreamer::startSwap(vk::CommandBuffer commandBuffer, Load& load) {
+    be::Texture& texture = *m_textures[load.texture].texture;
+    // the levels the texture has are copied from its current image, the new ones are uploaded
+    auto [oldImage, oldView, oldAllocation] = texture.rebase(commandBuffer, load.firstLevel);
+    m_allocator->setMovable(texture.getAllocation());
+    uint64_t firstUpload = 0;
+    for (uint32_t i = 0; i < load.levelCount; i++) {
+        uint64_t upload = m_uploads->enqueueImage(texture.getImage(), i, texture.getLevelExtent(load.firstLevel + i), load.format, load.levels[i]);
+        if (i == 0)
+            firstUpload = upload;
+    }
+    m_swaps.push_back({load.texture, load.firstLevel, texture.getImage(), oldImage, oldView, texture.getImageView(), oldAllocation, firstUpload, load.levelCount, 0, std::vector<bool>(m_framesInFlight, false)});
+    m_stats.loadedLevels += load.levelCount;
+    m_stats.swaps++;
+}
+
+void be::TextureStreamer::evict(vk::CommandBuffer commandBuffer) {
+    if (m_stats.residentBytes <= m_budget && !m_budgetReached)
+        return;
+    // textures left unsampled for a while, or holding finer levels than they were last asked for, least recently sampled first
+    Resident* victim = nullptr;
+    for (Resident& resident : m_textures) {
+        uint32_t baseLevel = resident.texture->getBaseLevel();
+        if (resident.busy || baseLevel >= resident.initialLevel)
+            continue;
+        bool stale = m_frameCount - resident.lastSampled >= STREAMING_EVICTION_DELAY;
+        if (!stale && resident.wantedLevel <= baseLevel)
+            continue;
+        if (victim == nullptr || resident.lastSampled < victim->lastSampled)
+            victim = &resident;
+    }
+    if (victim == nullptr)
+        return;
+
+    uint32_t baseLevel = victim->texture->getBaseLevel() + 1;
+    auto [oldImage, oldView, oldAllocation] = victim->texture->rebase(commandBuffer, baseLevel);
+    m_allocator->setMovable(victim->texture->getAllocation());
+    victim->busy = true;
+    // nothing to upload, the sets take the new view from this frame on
+    size_t texture = std::distance(m_textures.data(), victim);
+    m_swaps.push_back({texture, baseLevel, victim->texture->getImage(), oldImage, oldView, victim->texture->getImageView(), oldAllocation, 0, 0, 0, std::vector<bool>(m_framesInFlight, false)});
+    m_stats.evictedLevels++;
+    m_stats.swaps++;
+}
+
+void be::TextureStreamer::release(const Swap& swap) {
+    m_device.destroyImageView(swap.oldView);
+    m_device.destroyImage(swap.oldImage);
+    m_allocator->free(swap.oldAllocation);
+}
+
+bool be::TextureStreamer::isSwapping() const {
+    return !m_swaps.empty();
+}
+
+void be::TextureStreamer::setBudget(vk::DeviceSize budget) {
+    m_budget = budget;
+}
+
+vk::DeviceSize be::TextureStreamer::getBudget() const {
+    return m_budget;
+}
+
+const be::StreamingStats& be::TextureStreamer::getStats() const {
+    return m_stats;
+}
+
+void be::TextureStreamer::clean() {
+    if (m_worker.joinable()) {
+        m_worker.request_stop();
+        m_worker.join();
+    }
+    for (const Swap& swap : m_swaps)
+        release(swap);
+    m_swaps.clear();
+    for (be::Buffer& feedbackBuffer : m_feedbackBuffers)
+        feedbackBuffer.clean();
+    m_feedbackBuffers.clear();
+    m_requests.clear();
+    m_loaded.clear();
+    m_textures.clear();
+}
@@ -0,0 +1,106 @@
+#include "textureUploader.hpp"
+#include "utils.hpp"
+#include <algorithm>
+
+be::TextureUploader::TextureUploader(vk::Device device, vk::CommandPool commandPool, vk::Queue queue) :
+    m_device(device),
+    m_commandPool(commandPool),
+    m_queue(queue)
+{}
+
+void be::TextureUploader::add(const Texture& texture) {
+    m_uploads.push_back({
+        texture.getBuffer(),
+        texture.getImage(),
+        texture.getLevelExtent(texture.getBaseLevel()),
+        texture.getMipLevels(),
+        texture.getCopyRegions(),
+        !texture.hasUploadedMips() && texture.getMipLevels() > 1
+    });
+}
+
+size_t be::TextureUploader::getTextureCount() const {
+    return m_uploads.size();
+}
+
+void be::TextureUploader::submit() {
+    if (m_uploads.empty())
+        return;
+    vk::CommandBufferAllocateInfo allocateInfo = vk::CommandBufferAllocateInfo(
+        m_commandPool,
+        vk::CommandBufferLevel::ePrimary,
+        1
+    );
+    vk::CommandBuffer commandBuffer = m_device.allocateCommandBuffers(allocateInfo).front();
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+    std::vector<vk::ImageMemoryBarrier2> toTransfer;
+    uint32_t maxMipLevels = 1;
+    for (const Upload& upload : m_uploads) {
+        toTransfer.push_back(createImageBarrier(
+            upload.image,
+            vk::ImageLayout::eUndefined,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, upload.mipLevels, 0, 1)
+        ));
+        if (upload.blitMips)
+            maxMipLevels = std::max(maxMipLevels, upload.mipLevels);
+    }
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, toTransfer));
+    for (const Upload& upload : m_uploads)
+        commandBuffer.copyBufferToImage(upload.staging, upload.image, vk::ImageLayout::eTransferDstOptimal, upload.regions);
+
+    for (uint32_t level = 1; level < maxMipLevels; level++) {
+        // the level above was just written, it becomes the source of this one
+        std::vector<vk::ImageMemoryBarrier2> toSource;
+        for (const Upload& upload : m_uploads)
+            if (upload.blitMips && level < upload.mipLevels)
+                toSource.push_back(createImageBarrier(
+                    upload.image,
+                    vk::ImageLayout::eTransferDstOptimal,
+                    vk::ImageLayout::eTransferSrcOptimal,
+                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level - 1, 1, 0, 1)
+                ));
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, toSource));
+        for (const Upload& upload : m_uploads) {
+            if (!upload.blitMips || level >= upload.mipLevels)
+                continue;
+            vk::ImageBlit region = vk::ImageBlit(
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - 1, 0, 1),
+                {vk::Offset3D(0, 0, 0), vk::Offset3D(std::max(upload.extent.width >> (level - 1), 1u), std::max(upload.extent.height >> (level - 1), 1u), 1)},
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+                {vk::Offset3D(0, 0, 0), vk::Offset3D(std::max(upload.extent.width >> level, 1u), std::max(upload.extent.height >> level, 1u), 1)}
+            );
+            commandBuffer.blitImage(upload.image, vk::ImageLayout::eTransferSrcOptimal, upload.image, vk::ImageLayout::eTransferDstOptimal, region, vk::Filter::eLinear);
+        }
+    }
+
+    // the blit sources are in the transfer source layout, the last level and the copied chains in the transfer destination one
+    std::vector<vk::ImageMemoryBarrier2> toShader;
+    for (const Upload& upload : m_uploads) {
+        uint32_t blitSources = upload.blitMips ? upload.mipLevels - 1 : 0;
+        if (blitSources > 0)
+            toShader.push_back(createImageBarrier(
+                upload.image,
+                vk::ImageLayout::eTransferSrcOptimal,
+                vk::ImageLayout::eShaderReadOnlyOptimal,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, blitSources, 0, 1)
+            ));
+        toShader.push_back(createImageBarrier(
+            upload.image,
+            vk::ImageLayout::eTransferDstOptimal,
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, blitSources, upload.mipLevels - blitSources, 0, 1)
+        ));
+    }
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, toShader));
+    commandBuffer.end();
+
+    vk::Fence fence = m_device.createFence(vk::FenceCreateInfo());
+    m_queue.submit(vk::SubmitInfo({}, {}, {}, 1, &commandBuffer), fence);
+    while (m_device.waitForFences(1, &fence, vk::True, UINT64_MAX) == vk::Result::eTimeout)
+        ;
+    m_device.destroyFence(fence);
+    m_device.freeCommandBuffers(m_commandPool, commandBuffer);
+    m_uploads.clear();
+}
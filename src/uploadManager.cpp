@@ -0,0 +1,393 @@
+#include "uploadManager.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // bytes of a row of texels, or of blocks for the block compressed formats
+    vk::DeviceSize getRowBytes(vk::Extent3D extent, vk::Format format) {
+        uint32_t blockWidth = vk::blockExtent(format)[0];
+        return static_cast<vk::DeviceSize>((extent.width + blockWidth - 1) / blockWidth) * vk::blockSize(format);
+    }
+}
+
+be::UploadManager::UploadManager() :
+    m_device(nullptr),
+    m_queue(nullptr),
+    m_queueFamily(0),
+    m_graphicsQueueFamily(0),
+    m_commandPool(nullptr),
+    m_timeline(nullptr),
+    m_queueFamilies({}),
+    m_submittedValue(0),
+    m_nextRequest(1),
+    m_submittedRequest(0),
+    m_waitValue(0),
+    m_capacity(0),
+    m_alignment(16),
+    m_head(0),
+    m_tail(0),
+    m_used(0),
+    m_frameBudget(DEFAULT_FRAME_UPLOAD_BUDGET),
+    m_current({}),
+    m_recording(false),
+    m_stats({})
+{}
+
+void be::UploadManager::init(
+    vk::Device device,
+    vk::PhysicalDevice physicalDevice,
+    be::MemoryAllocator& allocator,
+    vk::Queue queue,
+    uint32_t queueFamily,
+    uint32_t graphicsQueueFamily,
+    vk::DeviceSize capacity
+) {
+    m_device = device;
+    m_queue = queue;
+    m_queueFamily = queueFamily;
+    m_graphicsQueueFamily = graphicsQueueFamily;
+    m_queueFamilies = {queueFamily, graphicsQueueFamily};
+    m_capacity = capacity;
+    vk::SemaphoreTypeCreateInfo timelineInfo = vk::SemaphoreTypeCreateInfo(vk::SemaphoreType::eTimeline, 0);
+    m_timeline = m_device.createSemaphore(vk::SemaphoreCreateInfo({}, &timelineInfo));
+    // image copies also need a multiple of the texel or block size
+    m_alignment = std::max<vk::DeviceSize>(16, physicalDevice.getProperties().limits.optimalBufferCopyOffsetAlignment);
+    m_commandPool = m_device.createCommandPool(vk::CommandPoolCreateInfo(
+        vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient,
+        queueFamily
+    ));
+    m_ring = be::Buffer(m_device, m_capacity);
+    m_ring.create(vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, allocator, be::MemoryUsage::upload, "staging ring");
+    m_ring.map();
+}
+
+uint64_t be::UploadManager::enqueueBuffer(const be::Buffer& destination, std::span<const std::byte> data, vk::DeviceSize destinationOffset) {
+    if (data.empty())
+        return 0;
+    m_pending.push_back({m_nextRequest, destination.getBuffer(), destinationOffset, nullptr, 0, {}, {}, std::vector<std::byte>(data.begin(), data.end()), 0});
+    m_stats.pendingBytes += data.size();
+    return m_nextRequest++;
+}
+
+uint64_t be::UploadManager::enqueueImage(vk::Image image, uint32_t mipLevel, vk::Extent3D extent, vk::Format format, std::span<const std::byte> data) {
+    if (getRowBytes(extent, format) > m_capacity / 2)
+        throw std::runtime_error("An image row does not fit in the staging ring.");
+    m_pending.push_back({m_nextRequest, nullptr, 0, image, mipLevel, extent, format, std::vector<std::byte>(data.begin(), data.end()), 0});
+    m_stats.pendingBytes += data.size();
+    return m_nextRequest++;
+}
+
+void be::UploadManager::setFrameBudget(vk::DeviceSize budget) {
+    m_frameBudget = budget;
+}
+
+vk::DeviceSize be::UploadManager::getFrameBudget() const {
+    return m_frameBudget;
+}
+
+vk::Semaphore be::UploadManager::getTimeline() const {
+    return m_timeline;
+}
+
+bool be::UploadManager::usesDedicatedQueue() const {
+    return m_queueFamily != m_graphicsQueueFamily;
+}
+
+vk::SharingMode be::UploadManager::getSharingMode() const {
+    return usesDedicatedQueue() ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive;
+}
+
+std::span<const uint32_t> be::UploadManager::getQueueFamilies() const {
+    if (!usesDedicatedQueue())
+        return {};
+    return m_queueFamilies;
+}
+
+uint64_t be::UploadManager::recordAcquires(vk::CommandBuffer commandBuffer) {
+    if (!m_imageAcquires.empty())
+        commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, m_imageAcquires));
+    m_imageAcquires.clear();
+    return m_waitValue;
+}
+
+uint64_t be::UploadManager::getValue(uint64_t request) const {
+    auto submission = std::ranges::find_if(m_inFlight, [&](const Submission& submission) {
+        return submission.firstRequest <= request && request <= submission.lastRequest;
+    });
+    return submission == m_inFlight.end() ? 0 : submission->value;
+}
+
+bool be::UploadManager::isComplete(uint64_t request) const {
+    if (request == 0)
+        return true;
+    if (request > m_submittedRequest)
+        return false;
+    uint64_t value = getValue(request);
+    return value == 0 || m_device.getSemaphoreCounterValue(m_timeline) >= value;
+}
+
+void be::UploadManager::acquire(uint64_t request) {
+    if (request > m_submittedRequest)
+        throw std::runtime_error("An upload is acquired before its submission.");
+    m_waitValue = std::max(m_waitValue, getValue(request));
+    auto release = std::ranges::find(m_releases, request, &Release::request);
+    if (release == m_releases.end())
+        return;
+    if (usesDedicatedQueue())
+        m_imageAcquires.push_back(release->acquire);
+    m_releases.erase(release);
+}
+
+bool be::UploadManager::hasPendingUploads() const {
+    return !m_pending.empty();
+}
+
+const be::UploadStats& be::UploadManager::getStats() const {
+    return m_stats;
+}
+
+void be::UploadManager::flush() {
+    reclaim(false);
+    upload(m_frameBudget, false);
+    if (!m_pending.empty())
+        m_stats.deferredFlushes++;
+}
+
+void be::UploadManager::finish() {
+    upload(std::numeric_limits<vk::DeviceSize>::max(), true);
+    while (!m_inFlight.empty())
+        reclaim(true);
+}
+
+void be::UploadManager::upload(vk::DeviceSize budget, bool wait) {
+    auto start = std::chrono::steady_clock::now();
+    vk::DeviceSize moved = 0;
+    while (!m_pending.empty() && moved < budget) {
+        Request& request = m_pending.front();
+        vk::DeviceSize chunk = std::min({request.data.size() - request.uploaded, m_capacity / 2, budget - moved});
+        vk::DeviceSize rowBytes = request.image ? getRowBytes(request.extent, request.format) : 1;
+        if (request.image) {
+            // whole rows, at least one so a small budget still makes progress
+            chunk = chunk / rowBytes * rowBytes;
+            if (chunk == 0) {
+                if (moved > 0)
+                    break;
+                chunk = rowBytes;
+            }
+        }
+
+        if (!m_recording)
+            beginSubmission();
+        vk::DeviceSize offset;
+        bool allocated = allocate(chunk, offset);
+        if (!allocated) {
+            // what is recorded has to be submitted before its space can come back
+            if (m_current.bytes > 0) {
+                endSubmission();
+                beginSubmission();
+            }
+            reclaim(false);
+            allocated = allocate(chunk, offset);
+            while (!allocated && wait) {
+                if (m_inFlight.empty())
+                    throw std::runtime_error("The staging ring is too small for the upload.");
+                reclaim(true);
+                allocated = allocate(chunk, offset);
+            }
+        }
+        if (!allocated)
+            break;
+
+        m_ring.write(request.data.data() + request.uploaded, chunk, offset);
+        vk::CommandBuffer commandBuffer = m_current.commandBuffer;
+        if (request.image) {
+            vk::ImageSubresourceRange range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, request.mipLevel, 1, 0, 1);
+            if (request.uploaded == 0) {
+                vk::ImageMemoryBarrier2 toTransfer = vk::ImageMemoryBarrier2(
+                    vk::PipelineStageFlagBits2::eAllCommands,
+                    {},
+                    vk::PipelineStageFlagBits2::eCopy,
+                    vk::AccessFlagBits2::eTransferWrite,
+                    vk::ImageLayout::eUndefined,
+                    vk::ImageLayout::eTransferDstOptimal,
+                    VK_QUEUE_FAMILY_IGNORED,
+                    VK_QUEUE_FAMILY_IGNORED,
+                    request.image,
+                    range
+                );
+                commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, toTransfer));
+            }
+            // a row of blocks covers several rows of texels, the last one may cross the edge
+            uint32_t rowHeight = vk::blockExtent(request.format)[1];
+            uint32_t firstRow = request.uploaded / rowBytes * rowHeight;
+            uint32_t rows = std::min<uint32_t>(chunk / rowBytes * rowHeight, request.extent.height - firstRow);
+            vk::BufferImageCopy region = vk::BufferImageCopy(
+                offset,
+                0,
+                0,
+                vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, request.mipLevel, 0, 1),
+                vk::Offset3D(0, firstRow, 0),
+                vk::Extent3D(request.extent.width, rows, 1)
+            );
+            commandBuffer.copyBufferToImage(m_ring.getBuffer(), request.image, vk::ImageLayout::eTransferDstOptimal, region);
+            if (request.uploaded + chunk == request.data.size())
+                releaseImage(request);
+        } else {
+            commandBuffer.copyBuffer(m_ring.getBuffer(), request.buffer, vk::BufferCopy(offset, request.bufferOffset + request.uploaded, chunk));
+            m_current.writesBuffers = true;
+        }
+
+        request.uploaded += chunk;
+        moved += chunk;
+        m_stats.bytesUploaded += chunk;
+        m_stats.pendingBytes -= chunk;
+        if (request.uploaded == request.data.size()) {
+            m_current.lastRequest = request.id;
+            m_pending.pop_front();
+        }
+    }
+    if (m_recording && m_current.bytes > 0)
+        endSubmission();
+    m_stats.recordMilliseconds += elapsedMilliseconds(start);
+}
+
+bool be::UploadManager::allocate(vk::DeviceSize size, vk::DeviceSize& offset) {
+    size = (size + m_alignment - 1) / m_alignment * m_alignment;
+    if (m_used == 0) {
+        m_head = 0;
+        m_tail = 0;
+    } else if (m_head == m_tail) {
+        return false;
+    }
+    vk::DeviceSize consumed = 0;
+    if (m_head >= m_tail) {
+        if (m_capacity - m_head >= size) {
+            offset = m_head;
+            consumed = size;
+        } else if (m_tail >= size) {
+            // the end of the ring is skipped and given back with this submission
+            offset = 0;
+            consumed = m_capacity - m_head + size;
+        } else {
+            return false;
+        }
+    } else if (m_tail - m_head >= size) {
+        offset = m_head;
+        consumed = size;
+    } else {
+        return false;
+    }
+    m_head = offset + size;
+    m_used += consumed;
+    m_current.bytes += consumed;
+    return true;
+}
+
+void be::UploadManager::reclaim(bool waitOldest) {
+    if (waitOldest && !m_inFlight.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        vk::SemaphoreWaitInfo waitInfo = vk::SemaphoreWaitInfo({}, 1, &m_timeline, &m_inFlight.front().value);
+        while (m_device.waitSemaphores(waitInfo, UINT64_MAX) == vk::Result::eTimeout)
+            ;
+        m_stats.stalls++;
+        m_stats.stallMilliseconds += elapsedMilliseconds(start);
+    }
+    uint64_t completedValue = m_device.getSemaphoreCounterValue(m_timeline);
+    while (!m_inFlight.empty() && m_inFlight.front().value <= completedValue) {
+        Submission& submission = m_inFlight.front();
+        m_tail = submission.end;
+        m_used -= submission.bytes;
+        submission.commandBuffer.reset();
+        m_free.push_back(submission);
+        m_inFlight.pop_front();
+    }
+}
+
+void be::UploadManager::beginSubmission() {
+    if (m_free.empty()) {
+        vk::CommandBufferAllocateInfo allocateInfo = vk::CommandBufferAllocateInfo(m_commandPool, vk::CommandBufferLevel::ePrimary, 1);
+        m_current = {0, m_device.allocateCommandBuffers(allocateInfo).front(), 0, 0, 0, 0, false};
+    } else {
+        m_current = m_free.back();
+        m_free.pop_back();
+    }
+    m_current.bytes = 0;
+    m_current.firstRequest = m_submittedRequest + 1;
+    m_current.lastRequest = m_submittedRequest;
+    m_current.writesBuffers = false;
+    m_current.commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    m_recording = true;
+}
+
+void be::UploadManager::releaseImage(const Request& request) {
+    vk::ImageSubresourceRange range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, request.mipLevel, 1, 0, 1);
+    vk::ImageMemoryBarrier2 barrier = vk::ImageMemoryBarrier2(
+        vk::PipelineStageFlagBits2::eCopy,
+        vk::AccessFlagBits2::eTransferWrite,
+        vk::PipelineStageFlagBits2::eAllCommands,
+        vk::AccessFlagBits2::eShaderSampledRead,
+        vk::ImageLayout::eTransferDstOptimal,
+        vk::ImageLayout::eShaderReadOnlyOptimal,
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        request.image,
+        range
+    );
+    vk::ImageMemoryBarrier2 acquire = {};
+    if (usesDedicatedQueue()) {
+        // the layout transition happens once, between the release and the matching acquire
+        barrier.setSrcQueueFamilyIndex(m_queueFamily).setDstQueueFamilyIndex(m_graphicsQueueFamily);
+        acquire = barrier;
+        barrier.setDstStageMask(vk::PipelineStageFlagBits2::eNone).setDstAccessMask({});
+        acquire.setSrcStageMask(vk::PipelineStageFlagBits2::eNone).setSrcAccessMask({});
+    }
+    m_releases.push_back({request.id, acquire});
+    m_current.commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, barrier));
+}
+
+void be::UploadManager::endSubmission() {
+    if (!usesDedicatedQueue()) {
+        // later submissions on the queue see the copies
+        vk::MemoryBarrier2 barrier = vk::MemoryBarrier2(
+            vk::PipelineStageFlagBits2::eCopy,
+            vk::AccessFlagBits2::eTransferWrite,
+            vk::PipelineStageFlagBits2::eAllCommands,
+            vk::AccessFlagBits2::eMemoryRead
+        );
+        m_current.commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &barrier));
+    }
+    m_current.commandBuffer.end();
+    m_current.value = ++m_submittedValue;
+    vk::TimelineSemaphoreSubmitInfo timelineInfo = vk::TimelineSemaphoreSubmitInfo({}, m_current.value);
+    m_queue.submit(vk::SubmitInfo({}, {}, m_current.commandBuffer, m_timeline, &timelineInfo));
+    m_current.end = m_head;
+    m_submittedRequest = m_current.lastRequest;
+    // the frames may already read the buffers, every next one waits for them
+    if (m_current.writesBuffers)
+        m_waitValue = m_current.value;
+    m_inFlight.push_back(m_current);
+    m_recording = false;
+    m_stats.submissions++;
+}
+
+void be::UploadManager::clean() {
+    if (m_recording) {
+        m_current.commandBuffer.end();
+        m_free.push_back(m_current);
+        m_recording = false;
+    }
+    while (!m_inFlight.empty())
+        reclaim(true);
+    m_free.clear();
+    m_releases.clear();
+    m_imageAcquires.clear();
+    m_device.destroySemaphore(m_timeline);
+    m_device.destroyCommandPool(m_commandPool);
+    m_ring.clean();
+}
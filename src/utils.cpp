@@ -1,4 +1,5 @@
 #include "utils.hpp"
+#include <format>
 #include <stdexcept>
 
 uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties, vk::PhysicalDevice physicalDevice) {
@@ -57,9 +58,9 @@ vk::Format findSupportedFormat(vk::PhysicalDevice physicalDevice, const std::vec
 	throw std::runtime_error("There is no supported Format!");
 }
 
-std::tuple<vk::DeviceMemory, vk::Image> createImage(
+std::tuple<be::Allocation, vk::Image> createImage(
 				vk::Device device,
-				vk::PhysicalDevice physicalDevice,
+				be::MemoryAllocator& allocator,
 				vk::ImageType type,
 				vk::Format format,
 				vk::Extent3D extent,
@@ -69,7 +70,8 @@ std::tuple<vk::DeviceMemory, vk::Image> createImage(
 				vk::ImageTiling tiling,
 				vk::ImageUsageFlags usage,
 				vk::SharingMode sharingMode,
-				vk::MemoryPropertyFlags properties
+				be::MemoryUsage memoryUsage,
+				std::string_view name
     		)
 	{
 
@@ -86,26 +88,79 @@ std::tuple<vk::DeviceMemory, vk::Image> createImage(
         sharingMode
     );
     vk::Image image = device.createImage(imageInfo);
-    vk::MemoryRequirements memoryRequirement = device.getImageMemoryRequirements(image);
-    
-    vk::MemoryAllocateInfo memoryInfo = vk::MemoryAllocateInfo(
-        memoryRequirement.size,
-        findMemoryType(memoryRequirement.memoryTypeBits, properties, physicalDevice)
-    );
-    vk::DeviceMemory memory = device.allocateMemory(memoryInfo);
-    device.bindImageMemory(image, memory, 0);
-	return {memory, image};
+    be::Allocation allocation = allocator.allocateImage(image, tiling, memoryUsage, name);
+	return {allocation, image};
 }
 
-vk::ImageView createImageView(vk::Device device, vk::Image image, vk::ImageViewType type, vk::Format format, vk::ImageSubresourceRange imageSubresourceRange) {
+vk::ImageView createImageView(vk::Device device, vk::Image image, vk::ImageViewType type, vk::Format format, vk::ImageSubresourceRange imageSubresourceRange, vk::ComponentMapping components) {
     vk::ImageViewCreateInfo imageViewInfo = vk::ImageViewCreateInfo(
         {},
         image,
         type,
         format,
-        {},
+        components,
         imageSubresourceRange
     );
     
     return device.createImageView(imageViewInfo);
-}
\ No newline at end of file
+}
+
+std::pair<vk::PipelineStageFlags2, vk::AccessFlags2> getLayoutSynchronization(vk::ImageLayout layout) {
+	switch (layout) {
+		case vk::ImageLayout::eUndefined:
+			return {vk::PipelineStageFlagBits2::eNone, {}};
+		case vk::ImageLayout::eTransferDstOptimal:
+			return {vk::PipelineStageFlagBits2::eCopy | vk::PipelineStageFlagBits2::eBlit, vk::AccessFlagBits2::eTransferWrite};
+		case vk::ImageLayout::eTransferSrcOptimal:
+			return {vk::PipelineStageFlagBits2::eCopy | vk::PipelineStageFlagBits2::eBlit, vk::AccessFlagBits2::eTransferRead};
+		case vk::ImageLayout::eShaderReadOnlyOptimal:
+			return {vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderSampledRead};
+		case vk::ImageLayout::eColorAttachmentOptimal:
+			return {vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite};
+		case vk::ImageLayout::eDepthAttachmentOptimal:
+		case vk::ImageLayout::eDepthStencilAttachmentOptimal:
+			return {
+				vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests,
+				vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite
+			};
+		case vk::ImageLayout::eGeneral:
+			return {vk::PipelineStageFlagBits2::eAllCommands, vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite};
+		case vk::ImageLayout::ePresentSrcKHR:
+			return {vk::PipelineStageFlagBits2::eNone, {}};
+		default:
+			throw std::invalid_argument(std::format("Unsupported image layout {} for a transition", vk::to_string(layout)));
+	}
+}
+
+vk::ImageMemoryBarrier2 createImageBarrier(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::ImageSubresourceRange range) {
+	auto [srcStage, srcAccess] = getLayoutSynchronization(oldLayout);
+	auto [dstStage, dstAccess] = getLayoutSynchronization(newLayout);
+	return vk::ImageMemoryBarrier2(
+		srcStage,
+		// reads need no availability, only the writes of the old layout are made visible
+		srcAccess & (vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eMemoryWrite),
+		dstStage,
+		dstAccess,
+		oldLayout,
+		newLayout,
+		vk::QueueFamilyIgnored,
+		vk::QueueFamilyIgnored,
+		image,
+		range
+	);
+}
+
+bool supportsLinearBlit(vk::PhysicalDevice physicalDevice, vk::Format format) {
+	vk::FormatFeatureFlags features = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+	vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	return (features & required) == required;
+}
+
+bool supportsSampledCopies(vk::PhysicalDevice physicalDevice, vk::Format format) {
+	vk::FormatFeatureFlags features = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+	vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eSampledImage
+		| vk::FormatFeatureFlagBits::eSampledImageFilterLinear
+		| vk::FormatFeatureFlagBits::eTransferSrc
+		| vk::FormatFeatureFlagBits::eTransferDst;
+	return (features & required) == required;
+}
@@ -1,10 +1,59 @@
 #include "vertex.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <bit>
+#include <cmath>
 
-vk::VertexInputBindingDescription Vertex::getBindingDescription() {
+namespace {
+    uint64_t mix(uint64_t hash, uint32_t word) {
+        hash ^= word;
+        hash *= 0x9e3779b97f4a7c15ull;
+        return hash ^ (hash >> 29);
+    }
+
+    uint64_t mix(uint64_t hash, float value) {
+        // -0 and 0 compare equal so they have to hash the same
+        return mix(hash, std::bit_cast<uint32_t>(value + 0.0f));
+    }
+
+    // a flat axis still needs a non-zero range to quantize against
+    glm::vec3 quantizationRange(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+        glm::vec3 range = boundsMax - boundsMin;
+        for (int i = 0; i < 3; i++)
+            if (range[i] <= 0)
+                range[i] = 1;
+        return range;
+    }
+
+    // projects the unit sphere on an octahedron unfolded in the [-1, 1] square
+    glm::vec2 octahedralEncode(glm::vec3 normal) {
+        float norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (norm == 0)
+            return glm::vec2(0, 0);
+        normal /= norm;
+        glm::vec2 encoded = glm::vec2(normal.x, normal.y);
+        if (normal.z < 0) {
+            encoded.x = (1 - std::abs(normal.y)) * (normal.x >= 0 ? 1 : -1);
+            encoded.y = (1 - std::abs(normal.x)) * (normal.y >= 0 ? 1 : -1);
+        }
+        return encoded;
+    }
+}
+
+vk::VertexInputBindingDescription Vertex::getBindingDescription(be::VertexFormat format) {
+    if (format == be::VertexFormat::packed)
+        return {0, sizeof(PackedVertex), vk::VertexInputRate::eVertex};
     return {0, sizeof(Vertex), vk::VertexInputRate::eVertex};
 }
 
-std::array<vk::VertexInputAttributeDescription, 5> Vertex::getAttributeDescriptions() {
+std::vector<vk::VertexInputAttributeDescription> Vertex::getAttributeDescriptions(be::VertexFormat format) {
+    if (format == be::VertexFormat::packed)
+        return {
+            vk::VertexInputAttributeDescription(0, 0, vk::Format::eR16G16B16A16Unorm, offsetof(PackedVertex, pos)),
+            vk::VertexInputAttributeDescription(1, 0, vk::Format::eR16G16Snorm, offsetof(PackedVertex, normal)),
+            vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16Sfloat, offsetof(PackedVertex, texCoord)),
+            vk::VertexInputAttributeDescription(3, 0, vk::Format::eR16Sint, offsetof(PackedVertex, indexMat))
+        };
     return {
         vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, pos)),
         vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color)),
@@ -12,4 +61,41 @@ std::array<vk::VertexInputAttributeDescription, 5> Vertex::getAttributeDescripti
         vk::VertexInputAttributeDescription(3, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, texCoord)),
         vk::VertexInputAttributeDescription(4, 0, vk::Format::eR32Sint, offsetof(Vertex, indexMat))
     };
-}
\ No newline at end of file
+}
+
+uint64_t Vertex::hash() const {
+    uint64_t h = 0;
+    for (int i = 0; i < 3; i++)
+        h = mix(h, pos[i]);
+    for (int i = 0; i < 3; i++)
+        h = mix(h, color[i]);
+    for (int i = 0; i < 3; i++)
+        h = mix(h, normal[i]);
+    for (int i = 0; i < 2; i++)
+        h = mix(h, texCoord[i]);
+    h = mix(h, static_cast<uint32_t>(indexMat));
+    // murmur3 finalizer, spreads the entropy to every bit
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 33);
+}
+
+PackedVertex PackedVertex::pack(const Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    PackedVertex packed;
+    glm::vec3 position = (vertex.pos - boundsMin) / quantizationRange(boundsMin, boundsMax);
+    for (int i = 0; i < 3; i++)
+        packed.pos[i] = glm::packUnorm1x16(position[i]);
+    packed.indexMat = static_cast<int16_t>(vertex.indexMat);
+    glm::vec2 normal = octahedralEncode(vertex.normal);
+    for (int i = 0; i < 2; i++) {
+        packed.normal[i] = static_cast<int16_t>(glm::packSnorm1x16(normal[i]));
+        packed.texCoord[i] = glm::packHalf1x16(vertex.texCoord[i]);
+    }
+    return packed;
+}
+
+glm::mat4 PackedVertex::getDequantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    return glm::scale(glm::translate(glm::mat4(1), boundsMin), quantizationRange(boundsMin, boundsMax));
+}
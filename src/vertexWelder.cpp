@@ -0,0 +1,90 @@
+#include "vertexWelder.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+be::VertexWelder::VertexWelder(size_t expectedVertices, float epsilon) :
+    m_mask(0),
+    m_epsilon(epsilon)
+{
+    m_vertices.reserve(expectedVertices);
+    // keeps the load factor under 3/4 without growing
+    rehash(std::bit_ceil(std::max<size_t>(16, expectedVertices + expectedVertices / 3 + 1)));
+}
+
+Vertex be::VertexWelder::snap(const Vertex& vertex) const {
+    if (m_epsilon <= 0)
+        return vertex;
+    auto snapValue = [this](float value) {
+        return std::round(value / m_epsilon) * m_epsilon;
+    };
+    Vertex snapped = vertex;
+    for (int i = 0; i < 3; i++) {
+        snapped.pos[i] = snapValue(vertex.pos[i]);
+        snapped.color[i] = snapValue(vertex.color[i]);
+        snapped.normal[i] = snapValue(vertex.normal[i]);
+    }
+    for (int i = 0; i < 2; i++)
+        snapped.texCoord[i] = snapValue(vertex.texCoord[i]);
+    return snapped;
+}
+
+void be::VertexWelder::rehash(size_t capacity) {
+    std::vector<uint32_t> oldSlots = std::move(m_slots);
+    std::vector<uint32_t> oldHashes = std::move(m_hashes);
+    m_slots.assign(capacity, EMPTY);
+    m_hashes.assign(capacity, 0);
+    m_mask = capacity - 1;
+    m_stats.capacity = capacity;
+    for (size_t i = 0; i < oldSlots.size(); i++) {
+        if (oldSlots[i] == EMPTY)
+            continue;
+        size_t slot = oldHashes[i] & m_mask;
+        while (m_slots[slot] != EMPTY)
+            slot = (slot + 1) & m_mask;
+        m_slots[slot] = oldSlots[i];
+        m_hashes[slot] = oldHashes[i];
+    }
+}
+
+uint32_t be::VertexWelder::findOrInsert(const Vertex& vertex) {
+    Vertex key = snap(vertex);
+    uint32_t hash = static_cast<uint32_t>(key.hash());
+    size_t slot = hash & m_mask;
+    size_t probeLength = 1;
+    m_stats.lookups++;
+    while (m_slots[slot] != EMPTY) {
+        uint32_t index = m_slots[slot];
+        if (m_hashes[slot] == hash && snap(m_vertices[index]) == key) {
+            m_stats.totalProbes += probeLength;
+            m_stats.maxProbeLength = std::max(m_stats.maxProbeLength, probeLength);
+            return index;
+        }
+        m_stats.collisions++;
+        slot = (slot + 1) & m_mask;
+        probeLength++;
+    }
+    m_stats.totalProbes += probeLength;
+    m_stats.maxProbeLength = std::max(m_stats.maxProbeLength, probeLength);
+
+    uint32_t index = m_vertices.size();
+    m_slots[slot] = index;
+    m_hashes[slot] = hash;
+    m_vertices.push_back(vertex);
+    m_stats.uniqueVertices++;
+    if (4 * m_vertices.size() > 3 * m_slots.size())
+        rehash(2 * m_slots.size());
+    return index;
+}
+
+const std::vector<Vertex>& be::VertexWelder::getVertices() const {
+    return m_vertices;
+}
+
+std::vector<Vertex> be::VertexWelder::releaseVertices() {
+    return std::move(m_vertices);
+}
+
+const be::WeldStats& be::VertexWelder::getStats() const {
+    return m_stats;
+}
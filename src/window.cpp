@@ -85,6 +85,12 @@ void Window::cursorButtonInfoCallback(GLFWwindow* window, int button, int action
 	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
 		renderer->m_buttonPressed[static_cast<unsigned int>(Input::leftClick)] = false;
 	}
+	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
+		renderer->m_buttonPressed[static_cast<unsigned int>(Input::rightClick)] = true;
+	}
+	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE) {
+		renderer->m_buttonPressed[static_cast<unsigned int>(Input::rightClick)] = false;
+	}
 
 }
 